@@ -28,6 +28,7 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 
@@ -52,6 +53,9 @@
 #define PRAGMA_FOREIGN_KEYS_ID "db6"
 #define PRAGMA_FOREIGN_KEYS "PRAGMA foreign_keys=ON;"
 
+// Replay of a rolled back batch
+#define REPLAY_BATCH_STATEMENT_ID "replay_batch_statement"
+
 // Check if a table exists
 #define CHECK_TABLE_EXISTS_ID "check_table_exists"
 #define CHECK_TABLE_EXISTS "SELECT 1 FROM sqlite_master WHERE type='table' AND name=?1;"
@@ -232,71 +236,129 @@ void Db::close() {
     _sqliteDb->close();
 }
 
-bool Db::queryCreate(const std::string &id) {
+bool Db::queryCreate(std::string_view id) {
     return _sqliteDb->queryCreate(id);
 }
 
-bool Db::queryPrepare(const std::string &id, const std::string sql, bool allow_failure, int &errId, std::string &error) {
+bool Db::queryPrepare(std::string_view id, const std::string sql, bool allow_failure, int &errId, std::string &error) {
     return _sqliteDb->queryPrepare(id, sql, allow_failure, errId, error);
 }
 
-bool Db::queryResetAndClearBindings(const std::string &id) {
+Db::QueryHandle Db::queryHandle(std::string_view id) {
+    return _sqliteDb->queryHandle(id);
+}
+
+bool Db::queryResetAndClearBindings(std::string_view id) {
     return _sqliteDb->queryResetAndClearBindings(id);
 }
 
-bool Db::queryBindValue(const std::string &id, int index, const dbtype &value) {
+bool Db::queryResetAndClearBindings(QueryHandle query) {
+    return _sqliteDb->queryResetAndClearBindings(query);
+}
+
+bool Db::queryBindValue(std::string_view id, int index, const dbtype &value) {
     return _sqliteDb->queryBindValue(id, index, value);
 }
 
-bool Db::queryExec(const std::string &id, int &errId, std::string &error) {
-    bool ret = _sqliteDb->queryExec(id, errId, error);
-    ASSERT(_sqliteDb->queryResetAndClearBindings(id));
+bool Db::queryBindValue(QueryHandle query, int index, const dbtype &value) {
+    return _sqliteDb->queryBindValue(query, index, value);
+}
+
+bool Db::queryBindValue(QueryHandle query, int index, dbtype &&value) {
+    return _sqliteDb->queryBindValue(query, index, std::move(value));
+}
+
+bool Db::queryExec(std::string_view id, int &errId, std::string &error) {
+    return queryExec(_sqliteDb->queryHandle(id), errId, error);
+}
+
+bool Db::queryExec(QueryHandle query, int &errId, std::string &error) {
+    bool ret = _sqliteDb->queryExec(query, errId, error);
+    if (ret) {
+        batchStatementExecuted(query, 0);
+    }
+    ASSERT(_sqliteDb->queryResetAndClearBindings(query));
     return ret;
 }
 
-bool Db::queryExecAndGetRowId(const std::string &id, int64_t &rowId, int &errId, std::string &error) {
-    bool ret = _sqliteDb->queryExecAndGetRowId(id, rowId, errId, error);
-    ASSERT(_sqliteDb->queryResetAndClearBindings(id));
+bool Db::queryExecAndGetRowId(std::string_view id, int64_t &rowId, int &errId, std::string &error) {
+    return queryExecAndGetRowId(_sqliteDb->queryHandle(id), rowId, errId, error);
+}
+
+bool Db::queryExecAndGetRowId(QueryHandle query, int64_t &rowId, int &errId, std::string &error) {
+    bool ret = _sqliteDb->queryExecAndGetRowId(query, rowId, errId, error);
+    if (ret) {
+        batchStatementExecuted(query, rowId);
+    }
+    ASSERT(_sqliteDb->queryResetAndClearBindings(query));
     return ret;
 }
 
-bool Db::queryNext(const std::string &id, bool &hasData) {
-    bool ret = _sqliteDb->queryNext(id, hasData);
+bool Db::queryNext(std::string_view id, bool &hasData) {
+    return queryNext(_sqliteDb->queryHandle(id), hasData);
+}
+
+bool Db::queryNext(QueryHandle query, bool &hasData) {
+    bool ret = _sqliteDb->queryNext(query, hasData);
     if (!ret || !hasData) {
-        ASSERT(_sqliteDb->queryResetAndClearBindings(id));
+        ASSERT(_sqliteDb->queryResetAndClearBindings(query));
     }
     return ret;
 }
 
-bool Db::queryIntValue(const std::string &id, int index, int &value) const {
+bool Db::queryIntValue(std::string_view id, int index, int &value) const {
     return _sqliteDb->queryIntValue(id, index, value);
 }
 
-bool Db::queryInt64Value(const std::string &id, int index, int64_t &value) const {
+bool Db::queryIntValue(const QueryInfo *query, int index, int &value) const {
+    return _sqliteDb->queryIntValue(query, index, value);
+}
+
+bool Db::queryInt64Value(std::string_view id, int index, int64_t &value) const {
     return _sqliteDb->queryInt64Value(id, index, value);
 }
 
-bool Db::queryDoubleValue(const std::string &id, int index, double &value) const {
+bool Db::queryInt64Value(const QueryInfo *query, int index, int64_t &value) const {
+    return _sqliteDb->queryInt64Value(query, index, value);
+}
+
+bool Db::queryDoubleValue(std::string_view id, int index, double &value) const {
     return _sqliteDb->queryDoubleValue(id, index, value);
 }
 
-bool Db::queryStringValue(const std::string &id, int index, std::string &value) const {
+bool Db::queryStringValue(std::string_view id, int index, std::string &value) const {
     return _sqliteDb->queryStringValue(id, index, value);
 }
 
-bool Db::querySyncNameValue(const std::string &id, int index, SyncName &value) const {
+bool Db::queryStringValue(const QueryInfo *query, int index, std::string &value) const {
+    return _sqliteDb->queryStringValue(query, index, value);
+}
+
+bool Db::queryStringValue(const QueryInfo *query, int index, std::string_view &value) const {
+    return _sqliteDb->queryStringValue(query, index, value);
+}
+
+bool Db::querySyncNameValue(std::string_view id, int index, SyncName &value) const {
     return _sqliteDb->querySyncNameValue(id, index, value);
 }
 
-bool Db::queryBlobValue(const std::string &id, int index, std::shared_ptr<std::vector<char>> &value) const {
+bool Db::querySyncNameValue(const QueryInfo *query, int index, SyncName &value) const {
+    return _sqliteDb->querySyncNameValue(query, index, value);
+}
+
+bool Db::queryBlobValue(std::string_view id, int index, std::shared_ptr<std::vector<char>> &value) const {
     return _sqliteDb->queryBlobValue(id, index, value);
 }
 
-bool Db::queryIsNullValue(const std::string &id, int index, bool &ok) {
+bool Db::queryIsNullValue(std::string_view id, int index, bool &ok) {
     return _sqliteDb->queryIsNullValue(id, index, ok);
 }
 
-void Db::queryFree(const std::string &id) {
+bool Db::queryIsNullValue(const QueryInfo *query, int index, bool &ok) {
+    return _sqliteDb->queryIsNullValue(query, index, ok);
+}
+
+void Db::queryFree(std::string_view id) {
     return _sqliteDb->queryFree(id);
 }
 
@@ -437,16 +499,17 @@ void Db::startTransaction() {
     }
 }
 
-void Db::commitTransaction() {
+bool Db::commitTransaction() {
     if (_transaction) {
         if (!_sqliteDb->commit()) {
             LOG_WARN(_logger, "ERROR committing to the database: " << _sqliteDb->error().c_str());
-            return;
+            return false;
         }
         _transaction = false;
     } else {
         LOG_DEBUG(_logger, "No database Transaction to commit");
     }
+    return true;
 }
 
 void Db::rollbackTransaction() {
@@ -456,11 +519,157 @@ void Db::rollbackTransaction() {
             return;
         }
         _transaction = false;
+        transactionRolledBack();
     } else {
         LOG_DEBUG(_logger, "No database Transaction to rollback");
     }
 }
 
+void Db::startBatch(uint64_t maxRows, std::chrono::milliseconds maxDelay) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    _batchActive = true;
+    _batchMaxRows = std::max<uint64_t>(maxRows, 1);
+    _batchMaxDelay = maxDelay;
+    _batchNbRows = 0;
+    _batchStatements.clear();
+    _batchReplayable = true;
+    _batchStartTime = std::chrono::steady_clock::now();
+    _batchNbCommits = 0;
+    _batchNbCommittedRows = 0;
+    startTransaction();
+}
+
+bool Db::commitBatchIfDue() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!_batchActive || _batchNbRows == 0 || std::chrono::steady_clock::now() - _batchFirstRowTime < _batchMaxDelay) {
+        return true;
+    }
+    return commitBatch(true);
+}
+
+bool Db::endBatch() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!_batchActive) {
+        return true;
+    }
+
+    const bool ok = commitBatch(false);
+    _batchActive = false;
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - _batchStartTime).count();
+    LOG_INFO(_logger, "Batched writes: " << _batchNbCommittedRows << " rows in " << _batchNbCommits << " commits, "
+                                         << (_batchNbCommits ? _batchNbCommittedRows / _batchNbCommits : 0) << " rows/commit, "
+                                         << (elapsed > 0 ? _batchNbCommits / elapsed : 0) << " commits/s");
+    return ok;
+}
+
+bool Db::batchRowWritten() {
+    if (!_batchActive) {
+        return true;
+    }
+
+    if (!_transaction) {
+        // The transaction has been committed by another request, this row is already written
+        startTransaction();
+        return true;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (_batchNbRows == 0) {
+        _batchFirstRowTime = now;
+    }
+    _batchNbRows++;
+    if (_batchNbRows >= _batchMaxRows || now - _batchFirstRowTime >= _batchMaxDelay) {
+        return commitBatch(true);
+    }
+    return true;
+}
+
+void Db::batchStatementExecuted(QueryHandle query, int64_t rowId) {
+    if (!_batchActive || !_transaction || !_batchReplayable) {
+        return;
+    }
+
+    // Keep the statement, to apply it again if the batch is rolled back
+    std::string sql;
+    if (_sqliteDb->queryExpandedSql(query, sql)) {
+        _batchStatements.push_back({std::move(sql), rowId});
+    } else {
+        LOG_WARN(_logger, "Unable to record a batch statement, the batch can't be replayed");
+        _batchReplayable = false;
+        _batchStatements.clear();
+    }
+}
+
+bool Db::commitBatch(bool restart) {
+    bool ok = true;
+    if (!commitTransaction()) {
+        LOG_WARN(_logger, "Rolling back a batch of " << _batchNbRows << " rows");
+        rollbackTransaction();
+        ok = replayBatch();
+    } else if (_batchNbRows > 0) {
+        _batchNbCommits++;
+        _batchNbCommittedRows += _batchNbRows;
+    }
+    _batchNbRows = 0;
+    _batchStatements.clear();
+    _batchReplayable = true;
+
+    if (restart) {
+        startTransaction();
+    }
+    return ok;
+}
+
+bool Db::replayBatch() {
+    if (!_batchReplayable) {
+        LOG_WARN(_logger, "The rolled back batch can't be replayed");
+        return false;
+    }
+
+    // One transaction per statement: a failure only loses the statements not replayed yet
+    _sqliteDb->queryCreate(REPLAY_BATCH_STATEMENT_ID);
+    bool ok = true;
+    size_t nbReplayed = 0;
+    for (const auto &statement : _batchStatements) {
+        int errId;
+        std::string error;
+        if (!_sqliteDb->queryPrepare(REPLAY_BATCH_STATEMENT_ID, statement._sql, true, errId, error)) {
+            LOG_WARN(_logger, "Error preparing a batch statement to replay: " << error.c_str());
+            ok = false;
+            break;
+        }
+
+        const QueryHandle query = _sqliteDb->queryHandle(REPLAY_BATCH_STATEMENT_ID);
+        if (statement._rowId) {
+            int64_t rowId = 0;
+            if (!_sqliteDb->queryExecAndGetRowId(query, rowId, errId, error) || rowId != statement._rowId) {
+                // The rows written after this one may reference its ID
+                LOG_WARN(_logger, "Error replaying a batch insert: " << error.c_str() << " - rowId=" << rowId
+                                                                     << " expected=" << statement._rowId);
+                ok = false;
+                break;
+            }
+        } else if (!_sqliteDb->queryExec(query, errId, error)) {
+            LOG_WARN(_logger, "Error replaying a batch statement: " << error.c_str());
+            ok = false;
+            break;
+        }
+        nbReplayed++;
+    }
+    _sqliteDb->queryFree(REPLAY_BATCH_STATEMENT_ID);
+
+    LOG_INFO(_logger, "Replayed " << nbReplayed << " of " << _batchStatements.size() << " batch statements");
+    if (ok) {
+        _batchNbCommits += nbReplayed;
+        _batchNbCommittedRows += nbReplayed;
+    }
+    return ok;
+}
+
 bool Db::sqlFail(const std::string &log, const std::string &error) {
     commitTransaction();
     LOG_WARN(_logger, "SQL Error - " << log.c_str() << " - " << error.c_str());
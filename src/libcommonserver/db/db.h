@@ -24,7 +24,10 @@
 
 #include <log4cplus/logger.h>
 
+#include <chrono>
 #include <filesystem>
+#include <string_view>
+#include <vector>
 
 #include <Poco/URI.h>
 
@@ -44,21 +47,39 @@ class COMMONSERVER_EXPORT Db {
         std::filesystem::path dbPath() const;
         void close();
 
-        bool queryCreate(const std::string &id);
-        bool queryPrepare(const std::string &id, const std::string sql, bool allow_failure, int &errId, std::string &error);
-        bool queryResetAndClearBindings(const std::string &id);
-        bool queryBindValue(const std::string &id, int index, const dbtype &value);
-        bool queryExec(const std::string &id, int &errId, std::string &error);
-        bool queryExecAndGetRowId(const std::string &id, int64_t &rowId, int &errId, std::string &error);
-        bool queryNext(const std::string &id, bool &hasData);
-        bool queryIntValue(const std::string &id, int index, int &value) const;
-        bool queryInt64Value(const std::string &id, int index, int64_t &value) const;
-        bool queryDoubleValue(const std::string &id, int index, double &value) const;
-        bool queryStringValue(const std::string &id, int index, std::string &value) const;
-        bool querySyncNameValue(const std::string &id, int index, SyncName &value) const;
-        bool queryBlobValue(const std::string &id, int index, std::shared_ptr<std::vector<char>> &value) const;
-        bool queryIsNullValue(const std::string &id, int index, bool &ok);
-        void queryFree(const std::string &id);
+        using QueryHandle = SqliteDb::QueryHandle;
+        using QueryInfo = SqliteDb::QueryInfo;
+
+        bool queryCreate(std::string_view id);
+        bool queryPrepare(std::string_view id, const std::string sql, bool allow_failure, int &errId, std::string &error);
+        /** Looks the query up once, for the functions that run it many times or read many values from it. */
+        QueryHandle queryHandle(std::string_view id);
+        bool queryResetAndClearBindings(std::string_view id);
+        bool queryResetAndClearBindings(QueryHandle query);
+        bool queryBindValue(std::string_view id, int index, const dbtype &value);
+        bool queryBindValue(QueryHandle query, int index, const dbtype &value);
+        bool queryBindValue(QueryHandle query, int index, dbtype &&value);
+        bool queryExec(std::string_view id, int &errId, std::string &error);
+        bool queryExec(QueryHandle query, int &errId, std::string &error);
+        bool queryExecAndGetRowId(std::string_view id, int64_t &rowId, int &errId, std::string &error);
+        bool queryExecAndGetRowId(QueryHandle query, int64_t &rowId, int &errId, std::string &error);
+        bool queryNext(std::string_view id, bool &hasData);
+        bool queryNext(QueryHandle query, bool &hasData);
+        bool queryIntValue(std::string_view id, int index, int &value) const;
+        bool queryIntValue(const QueryInfo *query, int index, int &value) const;
+        bool queryInt64Value(std::string_view id, int index, int64_t &value) const;
+        bool queryInt64Value(const QueryInfo *query, int index, int64_t &value) const;
+        bool queryDoubleValue(std::string_view id, int index, double &value) const;
+        bool queryStringValue(std::string_view id, int index, std::string &value) const;
+        bool queryStringValue(const QueryInfo *query, int index, std::string &value) const;
+        /** The view is valid until the next step or reset of the query. */
+        bool queryStringValue(const QueryInfo *query, int index, std::string_view &value) const;
+        bool querySyncNameValue(std::string_view id, int index, SyncName &value) const;
+        bool querySyncNameValue(const QueryInfo *query, int index, SyncName &value) const;
+        bool queryBlobValue(std::string_view id, int index, std::shared_ptr<std::vector<char>> &value) const;
+        bool queryIsNullValue(std::string_view id, int index, bool &ok);
+        bool queryIsNullValue(const QueryInfo *query, int index, bool &ok);
+        void queryFree(std::string_view id);
 
         int numRowsAffected() const;
         int extendedErrorCode() const;
@@ -71,10 +92,26 @@ class COMMONSERVER_EXPORT Db {
 
         inline const std::string &fromVersion() const { return _fromVersion; }
 
+        /** Groups the following writes into transactions of at most `maxRows` rows, committed at the latest `maxDelay` after
+         * their first write, instead of one transaction per statement.
+         */
+        void startBatch(uint64_t maxRows, std::chrono::milliseconds maxDelay);
+        /** Commits the pending writes if the batch delay has expired. */
+        bool commitBatchIfDue();
+        /** Commits the pending writes and goes back to one transaction per statement. */
+        bool endBatch();
+
     protected:
         void startTransaction();
-        void commitTransaction();
+        bool commitTransaction();
         void rollbackTransaction();
+        /** To call, with _mutex locked, after each row written. Commits the batch when it is full.
+         * On commit failure, the batch is rolled back and its statements are replayed one transaction at a time.
+         * @return false if some statements of the batch could not be replayed: the DB may miss any change of the batch.
+         */
+        bool batchRowWritten();
+        /** Called after a rollback: data cached from the DB may not match it anymore. */
+        virtual void transactionRolledBack() {}
         bool sqlFail(const std::string &log, const std::string &error);
         bool checkConnect(const std::string &version);
 
@@ -87,6 +124,27 @@ class COMMONSERVER_EXPORT Db {
         std::string _fromVersion;
 
     private:
+        struct BatchStatement {
+                std::string _sql;  // Bound values inlined
+                int64_t _rowId;
+        };
+
+        /** Records a write of the open batch. rowId is 0 if the statement is not an insert. */
+        void batchStatementExecuted(QueryHandle query, int64_t rowId);
+        bool commitBatch(bool restart);
+        bool replayBatch();
+
+        bool _batchActive = false;
+        uint64_t _batchMaxRows = 0;
+        std::chrono::milliseconds _batchMaxDelay{0};
+        uint64_t _batchNbRows = 0;                     // Not committed yet
+        std::vector<BatchStatement> _batchStatements;  // Not committed yet
+        bool _batchReplayable = true;                  // false if a statement of the batch could not be recorded
+        std::chrono::steady_clock::time_point _batchFirstRowTime;
+        std::chrono::steady_clock::time_point _batchStartTime;
+        uint64_t _batchNbCommits = 0;
+        uint64_t _batchNbCommittedRows = 0;
+
         bool checkIfTableExists(const std::string &tableName, bool &found);
         bool insertVersion(const std::string &version);
         bool updateVersion(const std::string &version, bool &found);
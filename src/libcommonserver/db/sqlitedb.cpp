@@ -160,184 +160,237 @@ void SqliteDb::close() {
     }
 }
 
-bool SqliteDb::queryCreate(const std::string &id) {
+bool SqliteDb::queryCreate(std::string_view id) {
     if (_queries.find(id) != _queries.end()) {
         return false;
     }
 
-    _queries[id] = {std::shared_ptr<SqliteQuery>(new SqliteQuery(_sqlite3Db)), false, false, {false, false}};
+    _queries.emplace(std::string(id),
+                     QueryInfo{std::shared_ptr<SqliteQuery>(new SqliteQuery(_sqlite3Db)), false, false, {false, false}});
 
     return true;
 }
 
-bool SqliteDb::queryPrepare(const std::string &id, const std::string sql, bool allow_failure, int &errId, std::string &error) {
-    if (_queries.find(id) != _queries.end()) {
-        QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._isPrepared) {
-            queryInfo._query->resetAndClearBindings();
-            queryInfo._isExecuted = false;
-            queryInfo._result._ok = false;
-            queryInfo._result._hasData = false;
-        }
-        queryInfo._isPrepared = (queryInfo._query->prepare(sql, allow_failure) == SQLITE_OK);
-        errId = queryInfo._query->errorId();
-        error = queryInfo._query->error();
-        return queryInfo._isPrepared;
+bool SqliteDb::queryPrepare(std::string_view id, const std::string sql, bool allow_failure, int &errId, std::string &error) {
+    QueryInfo *queryInfo = this->queryInfo(id);
+    if (!queryInfo) {
+        return false;
     }
-    return false;
+
+    if (queryInfo->_isPrepared) {
+        queryInfo->_query->resetAndClearBindings();
+        queryInfo->_isExecuted = false;
+        queryInfo->_result._ok = false;
+        queryInfo->_result._hasData = false;
+    }
+    queryInfo->_isPrepared = (queryInfo->_query->prepare(sql, allow_failure) == SQLITE_OK);
+    errId = queryInfo->_query->errorId();
+    error = queryInfo->_query->error();
+    return queryInfo->_isPrepared;
 }
 
-bool SqliteDb::queryResetAndClearBindings(const std::string &id) {
-    if (_queries.find(id) != _queries.end()) {
-        QueryInfo &queryInfo = _queries.at(id);
-        queryInfo._query->resetAndClearBindings();
-        queryInfo._isExecuted = false;
-        queryInfo._result._ok = false;
-        queryInfo._result._hasData = false;
-        return true;
+SqliteDb::QueryHandle SqliteDb::queryHandle(std::string_view id) {
+    return queryInfo(id);
+}
+
+bool SqliteDb::queryResetAndClearBindings(std::string_view id) {
+    return queryResetAndClearBindings(queryInfo(id));
+}
+
+bool SqliteDb::queryResetAndClearBindings(QueryHandle query) {
+    if (!query) {
+        return false;
     }
-    return false;
+
+    query->_query->resetAndClearBindings();
+    query->_isExecuted = false;
+    query->_result._ok = false;
+    query->_result._hasData = false;
+    return true;
 }
 
-bool SqliteDb::queryBindValue(const std::string &id, int index, const dbtype &value) {
-    if (_queries.find(id) != _queries.end()) {
-        QueryInfo &queryInfo = _queries.at(id);
-        return queryInfo._query->bindValue(index, value);
+bool SqliteDb::queryBindValue(std::string_view id, int index, const dbtype &value) {
+    return queryBindValue(queryInfo(id), index, value);
+}
+
+bool SqliteDb::queryBindValue(QueryHandle query, int index, const dbtype &value) {
+    return query && query->_query->bindValue(index, value);
+}
+
+bool SqliteDb::queryBindValue(QueryHandle query, int index, dbtype &&value) {
+    return query && query->_query->bindValue(index, std::move(value));
+}
+
+bool SqliteDb::queryExec(std::string_view id, int &errId, std::string &error) {
+    return queryExec(queryInfo(id), errId, error);
+}
+
+bool SqliteDb::queryExec(QueryHandle query, int &errId, std::string &error) {
+    if (!query || !query->_isPrepared) {
+        return false;
     }
-    return false;
+
+    query->_isExecuted = query->_query->exec();
+    errId = query->_query->errorId();
+    error = query->_query->error();
+    return query->_isExecuted;
 }
 
-bool SqliteDb::queryExec(const std::string &id, int &errId, std::string &error) {
-    if (_queries.find(id) != _queries.end()) {
-        QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._isPrepared) {
-            queryInfo._isExecuted = queryInfo._query->exec();
-            errId = queryInfo._query->errorId();
-            error = queryInfo._query->error();
-            return queryInfo._isExecuted;
-        }
+bool SqliteDb::queryExecAndGetRowId(std::string_view id, int64_t &rowId, int &errId, std::string &error) {
+    return queryExecAndGetRowId(queryInfo(id), rowId, errId, error);
+}
+
+bool SqliteDb::queryExecAndGetRowId(QueryHandle query, int64_t &rowId, int &errId, std::string &error) {
+    if (!query || !query->_isPrepared) {
+        return false;
     }
-    return false;
+
+    query->_isExecuted = query->_query->execAndGetRowId(rowId);
+    errId = query->_query->errorId();
+    error = query->_query->error();
+    return query->_isExecuted;
 }
 
-bool SqliteDb::queryExecAndGetRowId(const std::string &id, int64_t &rowId, int &errId, std::string &error) {
-    if (_queries.find(id) != _queries.end()) {
-        QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._isPrepared) {
-            queryInfo._isExecuted = queryInfo._query->execAndGetRowId(rowId);
-            errId = queryInfo._query->errorId();
-            error = queryInfo._query->error();
-            return queryInfo._isExecuted;
-        }
+bool SqliteDb::queryExpandedSql(QueryHandle query, std::string &sql) const {
+    if (!query || !query->_isPrepared) {
+        return false;
     }
-    return false;
+
+    sql = query->_query->expandedSql();
+    return !sql.empty();
 }
 
-bool SqliteDb::queryNext(const std::string &id, bool &hasData) {
-    if (_queries.find(id) != _queries.end()) {
-        QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._isPrepared) {
-            queryInfo._result = queryInfo._query->next();
-            hasData = queryInfo._result._hasData;
-            return queryInfo._result._ok;
-        }
+bool SqliteDb::queryNext(std::string_view id, bool &hasData) {
+    return queryNext(queryInfo(id), hasData);
+}
+
+bool SqliteDb::queryNext(QueryHandle query, bool &hasData) {
+    if (!query || !query->_isPrepared) {
+        return false;
     }
-    return false;
+
+    query->_result = query->_query->next();
+    hasData = query->_result._hasData;
+    return query->_result._ok;
 }
 
-bool SqliteDb::queryIntValue(const std::string &id, int index, int &value) const {
-    if (_queries.find(id) != _queries.end()) {
-        const QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._result._hasData) {
-            value = queryInfo._query->intValue(index);
-            return true;
-        }
+bool SqliteDb::queryIntValue(std::string_view id, int index, int &value) const {
+    return queryIntValue(queryInfo(id), index, value);
+}
+
+bool SqliteDb::queryIntValue(const QueryInfo *query, int index, int &value) const {
+    if (!query || !query->_result._hasData) {
+        return false;
     }
-    return false;
+
+    value = query->_query->intValue(index);
+    return true;
 }
 
-bool SqliteDb::queryInt64Value(const std::string &id, int index, int64_t &value) const {
-    if (_queries.find(id) != _queries.end()) {
-        const QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._result._hasData) {
-            value = queryInfo._query->int64Value(index);
-            return true;
-        }
+bool SqliteDb::queryInt64Value(std::string_view id, int index, int64_t &value) const {
+    return queryInt64Value(queryInfo(id), index, value);
+}
+
+bool SqliteDb::queryInt64Value(const QueryInfo *query, int index, int64_t &value) const {
+    if (!query || !query->_result._hasData) {
+        return false;
     }
-    return false;
+
+    value = query->_query->int64Value(index);
+    return true;
 }
 
-bool SqliteDb::queryDoubleValue(const std::string &id, int index, double &value) const {
-    if (_queries.find(id) != _queries.end()) {
-        const QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._result._hasData) {
-            value = queryInfo._query->doubleValue(index);
-            return true;
-        }
+bool SqliteDb::queryDoubleValue(std::string_view id, int index, double &value) const {
+    const QueryInfo *query = queryInfo(id);
+    if (!query || !query->_result._hasData) {
+        return false;
     }
-    return false;
+
+    value = query->_query->doubleValue(index);
+    return true;
 }
 
-bool SqliteDb::queryStringValue(const std::string &id, int index, std::string &value) const {
-    if (_queries.find(id) != _queries.end()) {
-        const QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._result._hasData) {
-            value = queryInfo._query->stringValue(index);
-            return true;
-        }
+bool SqliteDb::queryStringValue(std::string_view id, int index, std::string &value) const {
+    return queryStringValue(queryInfo(id), index, value);
+}
+
+bool SqliteDb::queryStringValue(const QueryInfo *query, int index, std::string &value) const {
+    if (!query || !query->_result._hasData) {
+        return false;
     }
-    return false;
+
+    value = query->_query->stringValue(index);
+    return true;
 }
 
-bool SqliteDb::querySyncNameValue(const std::string &id, int index, SyncName &value) const {
-    if (_queries.find(id) != _queries.end()) {
-        const QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._result._hasData) {
-            value = queryInfo._query->syncNameValue(index);
-            return true;
-        }
+bool SqliteDb::queryStringValue(const QueryInfo *query, int index, std::string_view &value) const {
+    if (!query || !query->_result._hasData) {
+        return false;
     }
-    return false;
+
+    value = query->_query->stringView(index);
+    return true;
 }
 
-bool SqliteDb::queryBlobValue(const std::string &id, int index, std::shared_ptr<std::vector<char>> &value) const {
-    if (_queries.find(id) != _queries.end()) {
-        const QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._result._hasData) {
-            size_t blobSize = queryInfo._query->blobSize(index);
-            if (blobSize) {
-                const unsigned char *blob = (const unsigned char *)queryInfo._query->blobValue(index);
-                value = std::shared_ptr<std::vector<char>>(new std::vector<char>(blob, blob + blobSize));
-                if (!value) {
-                    LOG_WARN(_logger, "Memory allocation error");
-                    return false;
-                }
-            } else {
-                value = nullptr;
-            }
-            return true;
-        }
+bool SqliteDb::querySyncNameValue(std::string_view id, int index, SyncName &value) const {
+    return querySyncNameValue(queryInfo(id), index, value);
+}
+
+bool SqliteDb::querySyncNameValue(const QueryInfo *query, int index, SyncName &value) const {
+    if (!query || !query->_result._hasData) {
+        return false;
     }
-    return false;
+
+    value = query->_query->syncNameValue(index);
+    return true;
 }
 
-bool SqliteDb::queryIsNullValue(const std::string &id, int index, bool &ok) const {
-    if (_queries.find(id) != _queries.end()) {
-        const QueryInfo &queryInfo = _queries.at(id);
-        if (queryInfo._result._hasData) {
-            ok = queryInfo._query->nullValue(index);
-            return true;
-        }
+bool SqliteDb::queryBlobValue(std::string_view id, int index, std::shared_ptr<std::vector<char>> &value) const {
+    const QueryInfo *query = queryInfo(id);
+    if (!query || !query->_result._hasData) {
+        return false;
+    }
+
+    size_t blobSize = query->_query->blobSize(index);
+    if (blobSize) {
+        const char *blob = static_cast<const char *>(query->_query->blobValue(index));
+        value = std::make_shared<std::vector<char>>(blob, blob + blobSize);
+    } else {
+        value = nullptr;
     }
-    return false;
+    return true;
 }
 
-void SqliteDb::queryFree(const std::string &id) {
-    if (_queries.find(id) != _queries.end()) {
-        _queries.erase(id);
+bool SqliteDb::queryIsNullValue(std::string_view id, int index, bool &ok) const {
+    return queryIsNullValue(queryInfo(id), index, ok);
+}
+
+bool SqliteDb::queryIsNullValue(const QueryInfo *query, int index, bool &ok) const {
+    if (!query || !query->_result._hasData) {
+        return false;
+    }
+
+    ok = query->_query->nullValue(index);
+    return true;
+}
+
+void SqliteDb::queryFree(std::string_view id) {
+    auto it = _queries.find(id);
+    if (it != _queries.end()) {
+        _queries.erase(it);
     }
 }
 
+SqliteDb::QueryInfo *SqliteDb::queryInfo(std::string_view id) {
+    auto it = _queries.find(id);
+    return it != _queries.end() ? &it->second : nullptr;
+}
+
+const SqliteDb::QueryInfo *SqliteDb::queryInfo(std::string_view id) const {
+    auto it = _queries.find(id);
+    return it != _queries.end() ? &it->second : nullptr;
+}
+
 int SqliteDb::numRowsAffected() const {
     return sqlite3_changes(_sqlite3Db.get());
 }
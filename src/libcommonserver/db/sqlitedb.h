@@ -23,6 +23,7 @@
 #include <log4cplus/logger.h>
 
 #include <string>
+#include <string_view>
 #include <filesystem>
 #include <unordered_map>
 
@@ -43,21 +44,41 @@ class SqliteDb {
         bool rollback();
         void close();
 
-        bool queryCreate(const std::string &id);
-        bool queryPrepare(const std::string &id, const std::string sql, bool allow_failure, int &errId, std::string &error);
-        bool queryResetAndClearBindings(const std::string &id);
-        bool queryBindValue(const std::string &id, int index, const dbtype &value);
-        bool queryExec(const std::string &id, int &errId, std::string &error);
-        bool queryExecAndGetRowId(const std::string &id, int64_t &rowId, int &errId, std::string &error);
-        bool queryNext(const std::string &id, bool &hasData);
-        bool queryIntValue(const std::string &id, int index, int &value) const;
-        bool queryInt64Value(const std::string &id, int index, int64_t &value) const;
-        bool queryDoubleValue(const std::string &id, int index, double &value) const;
-        bool queryStringValue(const std::string &id, int index, std::string &value) const;
-        bool querySyncNameValue(const std::string &id, int index, SyncName &value) const;
-        bool queryBlobValue(const std::string &id, int index, std::shared_ptr<std::vector<char>> &value) const;
-        bool queryIsNullValue(const std::string &id, int index, bool &ok) const;
-        void queryFree(const std::string &id);
+        struct QueryInfo;
+        /** Direct access to a prepared query, to avoid looking it up by ID for each call. Valid until the query is freed. */
+        using QueryHandle = QueryInfo *;
+
+        bool queryCreate(std::string_view id);
+        bool queryPrepare(std::string_view id, const std::string sql, bool allow_failure, int &errId, std::string &error);
+        QueryHandle queryHandle(std::string_view id);
+        bool queryResetAndClearBindings(std::string_view id);
+        bool queryResetAndClearBindings(QueryHandle query);
+        bool queryBindValue(std::string_view id, int index, const dbtype &value);
+        bool queryBindValue(QueryHandle query, int index, const dbtype &value);
+        bool queryBindValue(QueryHandle query, int index, dbtype &&value);
+        bool queryExec(std::string_view id, int &errId, std::string &error);
+        bool queryExec(QueryHandle query, int &errId, std::string &error);
+        bool queryExecAndGetRowId(std::string_view id, int64_t &rowId, int &errId, std::string &error);
+        bool queryExecAndGetRowId(QueryHandle query, int64_t &rowId, int &errId, std::string &error);
+        /** The SQL of the query with its bound values inlined, to run it again later. */
+        bool queryExpandedSql(QueryHandle query, std::string &sql) const;
+        bool queryNext(std::string_view id, bool &hasData);
+        bool queryNext(QueryHandle query, bool &hasData);
+        bool queryIntValue(std::string_view id, int index, int &value) const;
+        bool queryIntValue(const QueryInfo *query, int index, int &value) const;
+        bool queryInt64Value(std::string_view id, int index, int64_t &value) const;
+        bool queryInt64Value(const QueryInfo *query, int index, int64_t &value) const;
+        bool queryDoubleValue(std::string_view id, int index, double &value) const;
+        bool queryStringValue(std::string_view id, int index, std::string &value) const;
+        bool queryStringValue(const QueryInfo *query, int index, std::string &value) const;
+        /** The view is valid until the next step or reset of the query. */
+        bool queryStringValue(const QueryInfo *query, int index, std::string_view &value) const;
+        bool querySyncNameValue(std::string_view id, int index, SyncName &value) const;
+        bool querySyncNameValue(const QueryInfo *query, int index, SyncName &value) const;
+        bool queryBlobValue(std::string_view id, int index, std::shared_ptr<std::vector<char>> &value) const;
+        bool queryIsNullValue(std::string_view id, int index, bool &ok) const;
+        bool queryIsNullValue(const QueryInfo *query, int index, bool &ok) const;
+        void queryFree(std::string_view id);
 
         int numRowsAffected() const;
         inline int errorId() const { return _errId; }
@@ -65,6 +86,13 @@ class SqliteDb {
         int extendedErrorCode() const;
         inline void setAutoDelete(bool value) { _autoDelete = value; }
 
+        struct QueryInfo {
+                std::shared_ptr<SqliteQuery> _query;
+                bool _isPrepared;
+                bool _isExecuted;
+                SqliteQuery::NextResult _result;
+        };
+
     private:
         enum class CheckDbResult {
             Ok,
@@ -73,21 +101,21 @@ class SqliteDb {
             NotOk,
         };
 
-        struct QueryInfo {
-                std::shared_ptr<SqliteQuery> _query;
-                bool _isPrepared;
-                bool _isExecuted;
-                SqliteQuery::NextResult _result;
-        };
-
         log4cplus::Logger _logger;
         std::shared_ptr<sqlite3> _sqlite3Db;
         int _errId;
         std::string _error;
         std::filesystem::path _dbPath;
-        std::unordered_map<std::string, QueryInfo> _queries;
+        struct QueryIdHash {
+                using is_transparent = void;
+                size_t operator()(std::string_view id) const { return std::hash<std::string_view>()(id); }
+        };
+
+        std::unordered_map<std::string, QueryInfo, QueryIdHash, std::equal_to<>> _queries;
         bool _autoDelete;
 
+        QueryInfo *queryInfo(std::string_view id);
+        const QueryInfo *queryInfo(std::string_view id) const;
         bool openHelper(const std::filesystem::path &dbPath, int sqliteFlags);
         CheckDbResult checkDb();
 };
@@ -75,9 +75,26 @@ void SqliteQuery::resetAndClearBindings() {
         SQLITE_DO(sqlite3_reset(_stmt.get()));
         SQLITE_DO(sqlite3_clear_bindings(_stmt.get()));
     }
+    _boundValues.clear();
 }
 
 bool SqliteQuery::bindValue(int index, const dbtype &value) {
+    return bind(index, value, true);
+}
+
+bool SqliteQuery::bindValue(int index, dbtype &&value) {
+    if (!std::holds_alternative<std::string>(value) && !std::holds_alternative<std::wstring>(value) &&
+        !std::holds_alternative<std::shared_ptr<std::vector<char>>>(value)) {
+        // Nothing to keep
+        return bind(index, value, true);
+    }
+
+    dbtype &boundValue = _boundValues[index];
+    boundValue = std::move(value);
+    return bind(index, boundValue, false);
+}
+
+bool SqliteQuery::bind(int index, const dbtype &value, bool copy) {
     // LOG_DEBUG(_logger, "SQL bind: " << index << " - " << Utility::v2ws(value).c_str());
 
     int res = -1;
@@ -85,6 +102,7 @@ bool SqliteQuery::bindValue(int index, const dbtype &value) {
         return false;
     }
 
+    const sqlite3_destructor_type destructor = copy ? SQLITE_TRANSIENT : SQLITE_STATIC;
     if (std::holds_alternative<int>(value)) {
         res = sqlite3_bind_int(_stmt.get(), index, std::get<int>(value));
     } else if (std::holds_alternative<int64_t>(value)) {
@@ -92,16 +110,14 @@ bool SqliteQuery::bindValue(int index, const dbtype &value) {
     } else if (std::holds_alternative<double>(value)) {
         res = sqlite3_bind_double(_stmt.get(), index, std::get<double>(value));
     } else if (std::holds_alternative<std::string>(value)) {
-        res = sqlite3_bind_text(_stmt.get(), index, std::get<std::string>(value).c_str(), -1, SQLITE_TRANSIENT);
+        const std::string &str = std::get<std::string>(value);
+        res = sqlite3_bind_text(_stmt.get(), index, str.c_str(), static_cast<int>(str.size()), destructor);
     } else if (std::holds_alternative<std::wstring>(value)) {
-        res = sqlite3_bind_text16(_stmt.get(), index, std::get<std::wstring>(value).c_str(), -1, SQLITE_TRANSIENT);
+        res = sqlite3_bind_text16(_stmt.get(), index, std::get<std::wstring>(value).c_str(), -1, destructor);
     } else if (std::holds_alternative<std::shared_ptr<std::vector<char>>>(value)) {
-        std::shared_ptr<std::vector<char>> valuePtr = std::get<std::shared_ptr<std::vector<char>>>(value);
+        const std::shared_ptr<std::vector<char>> &valuePtr = std::get<std::shared_ptr<std::vector<char>>>(value);
         if (valuePtr) {
-            char *buffer = (char *)malloc(valuePtr->size() * sizeof(char));
-            std::uninitialized_copy(valuePtr->begin(), valuePtr->end(), buffer);
-            res = sqlite3_bind_blob(_stmt.get(), index, buffer, static_cast<int>(valuePtr->size()), SQLITE_TRANSIENT);
-            free(buffer);
+            res = sqlite3_bind_blob(_stmt.get(), index, valuePtr->data(), static_cast<int>(valuePtr->size()), destructor);
         } else {
             // Do nothing
             res = SQLITE_OK;
@@ -168,6 +184,20 @@ bool SqliteQuery::execAndGetRowId(int64_t &rowId) {
     return ret;
 }
 
+std::string SqliteQuery::expandedSql() const {
+    if (!_stmt) {
+        return std::string();
+    }
+
+    char *sql = sqlite3_expanded_sql(_stmt.get());
+    if (!sql) {
+        return std::string();
+    }
+    std::string result(sql);
+    sqlite3_free(sql);
+    return result;
+}
+
 SqliteQuery::NextResult KDC::SqliteQuery::next() {
     const bool firstStep = !sqlite3_stmt_busy(_stmt.get());
 
@@ -207,6 +237,11 @@ const std::string SqliteQuery::stringValue(int index) const {
 #endif
 }
 
+std::string_view SqliteQuery::stringView(int index) const {
+    const char *value = reinterpret_cast<const char *>(sqlite3_column_text(_stmt.get(), index));
+    return value ? std::string_view(value, sqlite3_column_bytes(_stmt.get(), index)) : std::string_view();
+}
+
 const SyncName SqliteQuery::syncNameValue(int index) const {
 #ifdef _WIN32
     wchar_t *value = (wchar_t *)sqlite3_column_text16(_stmt.get(), index);
@@ -23,7 +23,9 @@
 
 #include <log4cplus/logger.h>
 
+#include <map>
 #include <string>
+#include <string_view>
 
 #define SQLITE_DO(A)                                                            \
     _errId = (A);                                                               \
@@ -46,8 +48,12 @@ class SqliteQuery {
         int prepare(const std::string &sql, bool allow_failure = false);
         void resetAndClearBindings();
         bool bindValue(int index, const dbtype &value);
+        /** Binds without copy: the value is kept by the query until the bindings are cleared. */
+        bool bindValue(int index, dbtype &&value);
         bool exec();
         bool execAndGetRowId(int64_t &rowId);
+        /** The SQL of the statement with the current bound values inlined, empty on failure. */
+        std::string expandedSql() const;
 
         struct NextResult {
                 bool _ok = false;
@@ -57,6 +63,8 @@ class SqliteQuery {
 
         bool nullValue(int index) const;
         std::string const stringValue(int index) const;
+        /** Valid until the next step or reset of the query. */
+        std::string_view stringView(int index) const;
         SyncName const syncNameValue(int index) const;
         int intValue(int index) const;
         int64_t int64Value(int index) const;
@@ -74,7 +82,9 @@ class SqliteQuery {
         int _errId;
         std::string _error;
         std::string _sql;
+        std::map<int, dbtype> _boundValues;
 
+        bool bind(int index, const dbtype &value, bool copy);
         bool isSelect() const;
         bool isInsert() const;
         bool isPragma() const;
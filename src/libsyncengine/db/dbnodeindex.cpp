@@ -0,0 +1,208 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dbnodeindex.h"
+
+#include <vector>
+
+namespace KDC {
+
+void DbNodeIndex::clear() {
+    _entries.clear();
+    _children.clear();
+    _rootDbIds.clear();
+    for (int index = 0; index < 2; index++) {
+        _dbIdByNodeId[index].clear();
+        _dbIdByName[index].clear();
+    }
+}
+
+void DbNodeIndex::set(DbNodeId dbNodeId, std::optional<DbNodeId> parentDbNodeId, const SyncName &nameLocal,
+                      const SyncName &nameRemote, const std::optional<NodeId> &nodeIdLocal,
+                      const std::optional<NodeId> &nodeIdRemote) {
+    auto entryIt = _entries.find(dbNodeId);
+    if (entryIt != _entries.end()) {
+        unlink(dbNodeId, entryIt->second);
+    } else {
+        entryIt = _entries.emplace(dbNodeId, Entry()).first;
+    }
+
+    Entry &entry = entryIt->second;
+    entry.parentDbNodeId = parentDbNodeId;
+    entry.names[0] = nameLocal;
+    entry.names[1] = nameRemote;
+    entry.nodeIds[0] = nodeIdLocal;
+    entry.nodeIds[1] = nodeIdRemote;
+    link(dbNodeId, entry);
+}
+
+void DbNodeIndex::remove(DbNodeId dbNodeId) {
+    std::vector<DbNodeId> toRemove{dbNodeId};
+    while (!toRemove.empty()) {
+        const DbNodeId currentDbNodeId = toRemove.back();
+        toRemove.pop_back();
+
+        auto childrenIt = _children.find(currentDbNodeId);
+        if (childrenIt != _children.end()) {
+            toRemove.insert(toRemove.end(), childrenIt->second.begin(), childrenIt->second.end());
+            _children.erase(childrenIt);
+        }
+
+        auto entryIt = _entries.find(currentDbNodeId);
+        if (entryIt == _entries.end()) {
+            continue;
+        }
+        unlink(currentDbNodeId, entryIt->second);
+        _entries.erase(entryIt);
+    }
+}
+
+void DbNodeIndex::removeOrphans(DbNodeId keptDbNodeId) {
+    const std::set<DbNodeId> rootDbIds = _rootDbIds;
+    for (const DbNodeId dbNodeId : rootDbIds) {
+        if (dbNodeId != keptDbNodeId) {
+            remove(dbNodeId);
+        }
+    }
+}
+
+bool DbNodeIndex::rootDbId(DbNodeId &dbNodeId) const {
+    if (_rootDbIds.empty()) {
+        return false;
+    }
+    dbNodeId = *_rootDbIds.begin();
+    return true;
+}
+
+bool DbNodeIndex::dbId(ReplicaSide side, const NodeId &nodeId, DbNodeId &dbNodeId) const {
+    const auto &dbIdByNodeId = _dbIdByNodeId[sideIndex(side)];
+    auto it = dbIdByNodeId.find(nodeId);
+    if (it == dbIdByNodeId.end()) {
+        return false;
+    }
+    dbNodeId = it->second;
+    return true;
+}
+
+bool DbNodeIndex::childDbId(ReplicaSide side, DbNodeId parentDbNodeId, const SyncName &name, DbNodeId &dbNodeId) const {
+    const auto &dbIdByName = _dbIdByName[sideIndex(side)];
+    auto it = dbIdByName.find(ChildKey{parentDbNodeId, name});
+    if (it == dbIdByName.end()) {
+        return false;
+    }
+    dbNodeId = it->second;
+    return true;
+}
+
+bool DbNodeIndex::parentDbId(DbNodeId dbNodeId, std::optional<DbNodeId> &parentDbNodeId) const {
+    auto it = _entries.find(dbNodeId);
+    if (it == _entries.end()) {
+        return false;
+    }
+    parentDbNodeId = it->second.parentDbNodeId;
+    return true;
+}
+
+bool DbNodeIndex::id(ReplicaSide side, DbNodeId dbNodeId, std::optional<NodeId> &nodeId) const {
+    auto it = _entries.find(dbNodeId);
+    if (it == _entries.end()) {
+        return false;
+    }
+    nodeId = it->second.nodeIds[sideIndex(side)];
+    return true;
+}
+
+bool DbNodeIndex::name(ReplicaSide side, DbNodeId dbNodeId, SyncName &name) const {
+    auto it = _entries.find(dbNodeId);
+    if (it == _entries.end()) {
+        return false;
+    }
+    name = it->second.names[sideIndex(side)];
+    return true;
+}
+
+bool DbNodeIndex::path(DbNodeId dbNodeId, SyncPath &localPath, SyncPath &remotePath) const {
+    std::vector<const Entry *> branch;
+    std::optional<DbNodeId> currentDbNodeId = dbNodeId;
+    while (currentDbNodeId) {
+        auto it = _entries.find(*currentDbNodeId);
+        if (it == _entries.end()) {
+            return false;
+        }
+        branch.push_back(&it->second);
+        currentDbNodeId = it->second.parentDbNodeId;
+    }
+
+    // The root node name is not part of the path
+    localPath.clear();
+    remotePath.clear();
+    for (auto entryIt = branch.rbegin() + 1; entryIt != branch.rend(); ++entryIt) {
+        localPath.append((*entryIt)->names[0]);
+        remotePath.append((*entryIt)->names[1]);
+    }
+    return true;
+}
+
+void DbNodeIndex::link(DbNodeId dbNodeId, const Entry &entry) {
+    if (entry.parentDbNodeId) {
+        _children[*entry.parentDbNodeId].insert(dbNodeId);
+    } else {
+        _rootDbIds.insert(dbNodeId);
+    }
+
+    for (int index = 0; index < 2; index++) {
+        if (entry.nodeIds[index]) {
+            _dbIdByNodeId[index][*entry.nodeIds[index]] = dbNodeId;
+        }
+        if (entry.parentDbNodeId) {
+            _dbIdByName[index][ChildKey{*entry.parentDbNodeId, entry.names[index]}] = dbNodeId;
+        }
+    }
+}
+
+void DbNodeIndex::unlink(DbNodeId dbNodeId, const Entry &entry) {
+    if (entry.parentDbNodeId) {
+        auto childrenIt = _children.find(*entry.parentDbNodeId);
+        if (childrenIt != _children.end()) {
+            childrenIt->second.erase(dbNodeId);
+            if (childrenIt->second.empty()) {
+                _children.erase(childrenIt);
+            }
+        }
+    } else {
+        _rootDbIds.erase(dbNodeId);
+    }
+
+    // Leave the maps alone if another node took the key over
+    for (int index = 0; index < 2; index++) {
+        if (entry.nodeIds[index]) {
+            auto it = _dbIdByNodeId[index].find(*entry.nodeIds[index]);
+            if (it != _dbIdByNodeId[index].end() && it->second == dbNodeId) {
+                _dbIdByNodeId[index].erase(it);
+            }
+        }
+        if (entry.parentDbNodeId) {
+            auto it = _dbIdByName[index].find(ChildKey{*entry.parentDbNodeId, entry.names[index]});
+            if (it != _dbIdByName[index].end() && it->second == dbNodeId) {
+                _dbIdByName[index].erase(it);
+            }
+        }
+    }
+}
+
+}  // namespace KDC
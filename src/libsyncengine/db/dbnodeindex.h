@@ -0,0 +1,97 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "dbnode.h"
+#include "libcommon/utility/types.h"
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace KDC {
+
+/**
+ * Memory-resident copy of the tree structure of the node table: parent, names and replica IDs of every node.
+ * It lets SyncDb answer the path, ID and ancestor queries in O(depth) without any SQL.
+ * Not thread safe: the owner must serialize the calls.
+ */
+class DbNodeIndex {
+    public:
+        void clear();
+        inline size_t size() const { return _entries.size(); }
+        inline bool contains(DbNodeId dbNodeId) const { return _entries.find(dbNodeId) != _entries.end(); }
+
+        /** Inserts the node or replaces the one with the same DB ID. */
+        void set(DbNodeId dbNodeId, std::optional<DbNodeId> parentDbNodeId, const SyncName &nameLocal,
+                 const SyncName &nameRemote, const std::optional<NodeId> &nodeIdLocal, const std::optional<NodeId> &nodeIdRemote);
+        inline void set(const DbNode &node) {
+            set(node.nodeId(), node.parentNodeId(), node.nameLocal(), node.nameRemote(), node.nodeIdLocal(), node.nodeIdRemote());
+        }
+        /** Removes the node and its descendants, as the DB foreign key does. */
+        void remove(DbNodeId dbNodeId);
+        /** Removes the nodes, other than `keptDbNodeId`, without parent, and their descendants. */
+        void removeOrphans(DbNodeId keptDbNodeId);
+
+        bool rootDbId(DbNodeId &dbNodeId) const;
+        bool dbId(ReplicaSide side, const NodeId &nodeId, DbNodeId &dbNodeId) const;
+        /** `name` must be normalized. */
+        bool childDbId(ReplicaSide side, DbNodeId parentDbNodeId, const SyncName &name, DbNodeId &dbNodeId) const;
+        bool parentDbId(DbNodeId dbNodeId, std::optional<DbNodeId> &parentDbNodeId) const;
+        bool id(ReplicaSide side, DbNodeId dbNodeId, std::optional<NodeId> &nodeId) const;
+        bool name(ReplicaSide side, DbNodeId dbNodeId, SyncName &name) const;
+
+        /** Builds the path of the node on both sides. Returns false if the node or one of its ancestors is missing. */
+        bool path(DbNodeId dbNodeId, SyncPath &localPath, SyncPath &remotePath) const;
+
+    private:
+        struct Entry {
+                std::optional<DbNodeId> parentDbNodeId;
+                SyncName names[2];
+                std::optional<NodeId> nodeIds[2];
+        };
+
+        struct ChildKey {
+                DbNodeId parentDbNodeId;
+                SyncName name;
+
+                bool operator==(const ChildKey &other) const {
+                    return parentDbNodeId == other.parentDbNodeId && name == other.name;
+                }
+        };
+
+        struct ChildKeyHash {
+                size_t operator()(const ChildKey &key) const {
+                    return std::hash<DbNodeId>()(key.parentDbNodeId) ^ (std::hash<SyncName>()(key.name) << 1);
+                }
+        };
+
+        static int sideIndex(ReplicaSide side) { return side == ReplicaSideLocal ? 0 : 1; }
+
+        void link(DbNodeId dbNodeId, const Entry &entry);
+        void unlink(DbNodeId dbNodeId, const Entry &entry);
+
+        std::unordered_map<DbNodeId, Entry> _entries;
+        std::unordered_map<DbNodeId, std::unordered_set<DbNodeId>> _children;
+        std::unordered_map<NodeId, DbNodeId> _dbIdByNodeId[2];
+        std::unordered_map<ChildKey, DbNodeId, ChildKeyHash> _dbIdByName[2];
+        std::set<DbNodeId> _rootDbIds;  // Nodes without parent, the first one is the sync root
+};
+
+}  // namespace KDC
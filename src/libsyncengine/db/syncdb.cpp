@@ -108,11 +108,6 @@
 #define DELETE_NODES_WITH_NULL_PARENTNODEID_REQUEST_ID "delete_node3"
 #define DELETE_NODES_WITH_NULL_PARENTNODEID_REQUEST "DELETE FROM node WHERE nodeId<>1 AND parentNodeId IS NULL;"
 
-#define SELECT_NODE_BY_NODEID_LITE_ID "select_node"
-#define SELECT_NODE_BY_NODEID_LITE                                                   \
-    "SELECT parentNodeId, nameLocal, nameDrive, nodeIdLocal, nodeIdDrive FROM node " \
-    "WHERE nodeId=?1;"
-
 #define SELECT_NODE_BY_NODEID_FULL_ID "select_node2"
 #define SELECT_NODE_BY_NODEID_FULL                                                                                               \
     "SELECT parentNodeId, nameLocal, nameDrive, nodeIdLocal, nodeIdDrive, created, lastModifiedLocal, lastModifiedDrive, type, " \
@@ -157,16 +152,6 @@
 #define SELECT_NODE_BY_REPLICAID_STATUS 9
 #define SELECT_NODE_BY_REPLICAID_SYNCING 10
 
-#define SELECT_NODE_BY_PARENTNODEID_AND_NAMELOCAL_REQUEST_ID "select_node5"
-#define SELECT_NODE_BY_PARENTNODEID_AND_NAMELOCAL_REQUEST    \
-    "SELECT nodeId, nodeIdLocal, status, syncing FROM node " \
-    "WHERE parentNodeId=?1 AND nameLocal=?2;"
-
-#define SELECT_NODE_BY_PARENTNODEID_AND_NAMEDRIVE_REQUEST_ID "select_node6"
-#define SELECT_NODE_BY_PARENTNODEID_AND_NAMEDRIVE_REQUEST    \
-    "SELECT nodeId, nodeIdDrive, status, syncing FROM node " \
-    "WHERE parentNodeId=?1 AND nameDrive=?2;"
-
 #define SELECT_NODE_BY_PARENTNODEID_REQUEST_ID "select_node7"
 #define SELECT_NODE_BY_PARENTNODEID_REQUEST                                                  \
     "SELECT nodeId, nameLocal, nameDrive, nodeIdLocal, nodeIdDrive, type, status FROM node " \
@@ -199,6 +184,15 @@
     "lastModifiedDrive, type, size, checksum, status, syncing FROM node "                                       \
     "WHERE nameLocal != nameDrive;"
 
+#define SELECT_NODES_PAGE_REQUEST_ID "select_node13"
+#define SELECT_NODES_PAGE_REQUEST                                                                               \
+    "SELECT nodeId, parentNodeId, nameLocal, nameDrive, nodeIdLocal, nodeIdDrive, created, lastModifiedLocal, " \
+    "lastModifiedDrive, type, size, checksum, status, syncing FROM node "                                       \
+    "WHERE nodeId > ?1 ORDER BY nodeId LIMIT ?2;"
+
+#define SELECT_ALL_NODES_LITE_REQUEST_ID "select_node14"
+#define SELECT_ALL_NODES_LITE_REQUEST "SELECT nodeId, parentNodeId, nameLocal, nameDrive, nodeIdLocal, nodeIdDrive FROM node;"
+
 //
 // sync_node
 //
@@ -248,6 +242,91 @@
 #define DELETE_ALL_UPLOAD_SESSION_TOKEN_REQUEST_ID "delete_all_upload_session_token"
 #define DELETE_ALL_UPLOAD_SESSION_TOKEN_REQUEST "DELETE FROM upload_session_token;"
 
+//
+// upload_session & upload_session_chunk (deleted with their token)
+//
+#define CREATE_UPLOAD_SESSION_TABLE_ID "create_upload_session"
+#define CREATE_UPLOAD_SESSION_TABLE              \
+    "CREATE TABLE IF NOT EXISTS upload_session(" \
+    "tokenDbId INTEGER PRIMARY KEY,"             \
+    "filePath TEXT,"                             \
+    "fileName TEXT,"                             \
+    "remoteParentId TEXT,"                       \
+    "size INTEGER,"                              \
+    "modtime INTEGER,"                           \
+    "chunkSize INTEGER,"                         \
+    "totalChunks INTEGER,"                       \
+    "creationTime INTEGER,"                      \
+    "FOREIGN KEY (tokenDbId) REFERENCES upload_session_token(dbId) ON DELETE CASCADE ON UPDATE NO ACTION);"
+
+#define CREATE_UPLOAD_SESSION_TABLE_IDX1_ID "create_upload_session_idx1"
+#define CREATE_UPLOAD_SESSION_TABLE_IDX1 "CREATE INDEX IF NOT EXISTS upload_session_idx1 ON upload_session(filePath);"
+
+#define CREATE_UPLOAD_SESSION_CHUNK_TABLE_ID "create_upload_session_chunk"
+#define CREATE_UPLOAD_SESSION_CHUNK_TABLE              \
+    "CREATE TABLE IF NOT EXISTS upload_session_chunk(" \
+    "tokenDbId INTEGER,"                               \
+    "chunkNb INTEGER,"                                 \
+    "hash TEXT,"                                       \
+    "PRIMARY KEY (tokenDbId, chunkNb),"                \
+    "FOREIGN KEY (tokenDbId) REFERENCES upload_session_token(dbId) ON DELETE CASCADE ON UPDATE NO ACTION);"
+
+#define INSERT_UPLOAD_SESSION_REQUEST_ID "insert_upload_session"
+#define INSERT_UPLOAD_SESSION_REQUEST                                                                                      \
+    "INSERT INTO upload_session (tokenDbId, filePath, fileName, remoteParentId, size, modtime, chunkSize, totalChunks, " \
+    "creationTime) "                                                                                                       \
+    "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9);"
+
+#define SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID "select_upload_session_by_token_dbid"
+#define SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST                                                                           \
+    "SELECT upload_session_token.token, filePath, fileName, remoteParentId, size, modtime, chunkSize, totalChunks, "        \
+    "creationTime FROM upload_session "                                                                                     \
+    "INNER JOIN upload_session_token ON upload_session_token.dbId = upload_session.tokenDbId "                             \
+    "WHERE tokenDbId=?1;"
+
+#define SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID "select_upload_session_by_path"
+#define SELECT_UPLOAD_SESSION_BY_PATH_REQUEST \
+    "SELECT tokenDbId FROM upload_session "   \
+    "WHERE filePath=?1;"
+
+#define INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID "insert_upload_session_chunk"
+#define INSERT_UPLOAD_SESSION_CHUNK_REQUEST                                  \
+    "INSERT OR REPLACE INTO upload_session_chunk (tokenDbId, chunkNb, hash) " \
+    "VALUES (?1, ?2, ?3);"
+
+#define SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID "select_upload_session_chunk"
+#define SELECT_UPLOAD_SESSION_CHUNK_REQUEST                \
+    "SELECT chunkNb, hash FROM upload_session_chunk "      \
+    "WHERE tokenDbId=?1;"
+
+//
+// checksum_cache
+//
+#define CREATE_CHECKSUM_CACHE_TABLE_ID "create_checksum_cache"
+#define CREATE_CHECKSUM_CACHE_TABLE              \
+    "CREATE TABLE IF NOT EXISTS checksum_cache(" \
+    "inode INTEGER PRIMARY KEY,"                 \
+    "size INTEGER,"                              \
+    "modtime INTEGER,"                           \
+    "creationTime INTEGER,"                      \
+    "checksum TEXT);"
+
+#define INSERT_CHECKSUM_CACHE_REQUEST_ID "insert_checksum_cache"
+#define INSERT_CHECKSUM_CACHE_REQUEST                                                          \
+    "INSERT OR REPLACE INTO checksum_cache (inode, size, modtime, creationTime, checksum) " \
+    "VALUES (?1, ?2, ?3, ?4, ?5);"
+
+#define SELECT_CHECKSUM_CACHE_REQUEST_ID "select_checksum_cache"
+#define SELECT_CHECKSUM_CACHE_REQUEST   \
+    "SELECT checksum FROM checksum_cache " \
+    "WHERE inode=?1 AND size=?2 AND modtime=?3 AND creationTime=?4;"
+
+#define DELETE_ORPHAN_CHECKSUM_CACHE_REQUEST_ID "delete_orphan_checksum_cache"
+#define DELETE_ORPHAN_CHECKSUM_CACHE_REQUEST \
+    "DELETE FROM checksum_cache "            \
+    "WHERE NOT EXISTS (SELECT 1 FROM node "  \
+    "WHERE node.nodeIdLocal=CAST(checksum_cache.inode AS TEXT));"
+
 namespace KDC {
 
 DbNode SyncDb::_driveRootNode(0, std::nullopt, SyncName(), SyncName(), "1", "1", std::nullopt, std::nullopt, std::nullopt,
@@ -368,6 +447,57 @@ bool SyncDb::create(bool &retry) {
     }
     queryFree(CREATE_UPLOAD_SESSION_TOKEN_TABLE_ID);
 
+    // Upload session tables
+    if (!createUploadSessionTables()) {
+        return false;
+    }
+
+    // Checksum cache table
+    if (!createChecksumCacheTable()) {
+        return false;
+    }
+
+    return true;
+}
+
+bool SyncDb::createUploadSessionTables() {
+    int errId;
+    std::string error;
+
+    for (const auto &[tableId, tableRequest] : std::vector<std::pair<std::string, std::string>>{
+             {CREATE_UPLOAD_SESSION_TABLE_ID, CREATE_UPLOAD_SESSION_TABLE},
+             {CREATE_UPLOAD_SESSION_TABLE_IDX1_ID, CREATE_UPLOAD_SESSION_TABLE_IDX1},
+             {CREATE_UPLOAD_SESSION_CHUNK_TABLE_ID, CREATE_UPLOAD_SESSION_CHUNK_TABLE}}) {
+        ASSERT(queryCreate(tableId));
+        if (!queryPrepare(tableId, tableRequest, false, errId, error)) {
+            queryFree(tableId);
+            return sqlFail(tableId, error);
+        }
+        if (!queryExec(tableId, errId, error)) {
+            queryFree(tableId);
+            return sqlFail(tableId, error);
+        }
+        queryFree(tableId);
+    }
+
+    return true;
+}
+
+bool SyncDb::createChecksumCacheTable() {
+    int errId;
+    std::string error;
+
+    ASSERT(queryCreate(CREATE_CHECKSUM_CACHE_TABLE_ID));
+    if (!queryPrepare(CREATE_CHECKSUM_CACHE_TABLE_ID, CREATE_CHECKSUM_CACHE_TABLE, false, errId, error)) {
+        queryFree(CREATE_CHECKSUM_CACHE_TABLE_ID);
+        return sqlFail(CREATE_CHECKSUM_CACHE_TABLE_ID, error);
+    }
+    if (!queryExec(CREATE_CHECKSUM_CACHE_TABLE_ID, errId, error)) {
+        queryFree(CREATE_CHECKSUM_CACHE_TABLE_ID);
+        return sqlFail(CREATE_CHECKSUM_CACHE_TABLE_ID, error);
+    }
+    queryFree(CREATE_CHECKSUM_CACHE_TABLE_ID);
+
     return true;
 }
 
@@ -375,6 +505,15 @@ bool SyncDb::prepare() {
     int errId;
     std::string error;
 
+    // Tables added without a version bump: create them whatever the stored DB version
+    if (!createUploadSessionTables()) {
+        return false;
+    }
+
+    if (!createChecksumCacheTable()) {
+        return false;
+    }
+
     // Node
     ASSERT(queryCreate(INSERT_NODE_REQUEST_ID));
     if (!queryPrepare(INSERT_NODE_REQUEST_ID, INSERT_NODE_REQUEST, false, errId, error)) {
@@ -425,12 +564,6 @@ bool SyncDb::prepare() {
         return sqlFail(DELETE_NODES_WITH_NULL_PARENTNODEID_REQUEST_ID, error);
     }
 
-    ASSERT(queryCreate(SELECT_NODE_BY_NODEID_LITE_ID));
-    if (!queryPrepare(SELECT_NODE_BY_NODEID_LITE_ID, SELECT_NODE_BY_NODEID_LITE, false, errId, error)) {
-        queryFree(SELECT_NODE_BY_NODEID_LITE_ID);
-        return sqlFail(SELECT_NODE_BY_NODEID_LITE_ID, error);
-    }
-
     ASSERT(queryCreate(SELECT_NODE_BY_NODEID_FULL_ID));
     if (!queryPrepare(SELECT_NODE_BY_NODEID_FULL_ID, SELECT_NODE_BY_NODEID_FULL, false, errId, error)) {
         queryFree(SELECT_NODE_BY_NODEID_FULL_ID);
@@ -449,20 +582,6 @@ bool SyncDb::prepare() {
         return sqlFail(SELECT_NODE_BY_NODEIDDRIVE_ID, error);
     }
 
-    ASSERT(queryCreate(SELECT_NODE_BY_PARENTNODEID_AND_NAMELOCAL_REQUEST_ID));
-    if (!queryPrepare(SELECT_NODE_BY_PARENTNODEID_AND_NAMELOCAL_REQUEST_ID, SELECT_NODE_BY_PARENTNODEID_AND_NAMELOCAL_REQUEST,
-                      false, errId, error)) {
-        queryFree(SELECT_NODE_BY_PARENTNODEID_AND_NAMELOCAL_REQUEST_ID);
-        return sqlFail(SELECT_NODE_BY_PARENTNODEID_AND_NAMELOCAL_REQUEST_ID, error);
-    }
-
-    ASSERT(queryCreate(SELECT_NODE_BY_PARENTNODEID_AND_NAMEDRIVE_REQUEST_ID));
-    if (!queryPrepare(SELECT_NODE_BY_PARENTNODEID_AND_NAMEDRIVE_REQUEST_ID, SELECT_NODE_BY_PARENTNODEID_AND_NAMEDRIVE_REQUEST,
-                      false, errId, error)) {
-        queryFree(SELECT_NODE_BY_PARENTNODEID_AND_NAMEDRIVE_REQUEST_ID);
-        return sqlFail(SELECT_NODE_BY_PARENTNODEID_AND_NAMEDRIVE_REQUEST_ID, error);
-    }
-
     ASSERT(queryCreate(SELECT_NODE_BY_PARENTNODEID_REQUEST_ID));
     if (!queryPrepare(SELECT_NODE_BY_PARENTNODEID_REQUEST_ID, SELECT_NODE_BY_PARENTNODEID_REQUEST, false, errId, error)) {
         queryFree(SELECT_NODE_BY_PARENTNODEID_REQUEST_ID);
@@ -500,6 +619,18 @@ bool SyncDb::prepare() {
         return sqlFail(SELECT_ALL_RENAMED_NODES_REQUEST_ID, error);
     }
 
+    ASSERT(queryCreate(SELECT_NODES_PAGE_REQUEST_ID));
+    if (!queryPrepare(SELECT_NODES_PAGE_REQUEST_ID, SELECT_NODES_PAGE_REQUEST, false, errId, error)) {
+        queryFree(SELECT_NODES_PAGE_REQUEST_ID);
+        return sqlFail(SELECT_NODES_PAGE_REQUEST_ID, error);
+    }
+
+    ASSERT(queryCreate(SELECT_ALL_NODES_LITE_REQUEST_ID));
+    if (!queryPrepare(SELECT_ALL_NODES_LITE_REQUEST_ID, SELECT_ALL_NODES_LITE_REQUEST, false, errId, error)) {
+        queryFree(SELECT_ALL_NODES_LITE_REQUEST_ID);
+        return sqlFail(SELECT_ALL_NODES_LITE_REQUEST_ID, error);
+    }
+
     // Sync Node
     ASSERT(queryCreate(INSERT_SYNC_NODE_REQUEST_ID));
     if (!queryPrepare(INSERT_SYNC_NODE_REQUEST_ID, INSERT_SYNC_NODE_REQUEST, false, errId, error)) {
@@ -545,6 +676,56 @@ bool SyncDb::prepare() {
         return sqlFail(DELETE_ALL_UPLOAD_SESSION_TOKEN_REQUEST_ID, error);
     }
 
+    // Upload session tables
+    ASSERT(queryCreate(INSERT_UPLOAD_SESSION_REQUEST_ID));
+    if (!queryPrepare(INSERT_UPLOAD_SESSION_REQUEST_ID, INSERT_UPLOAD_SESSION_REQUEST, false, errId, error)) {
+        queryFree(INSERT_UPLOAD_SESSION_REQUEST_ID);
+        return sqlFail(INSERT_UPLOAD_SESSION_REQUEST_ID, error);
+    }
+
+    ASSERT(queryCreate(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID));
+    if (!queryPrepare(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST, false, errId,
+                      error)) {
+        queryFree(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID);
+        return sqlFail(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, error);
+    }
+
+    ASSERT(queryCreate(SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID));
+    if (!queryPrepare(SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID, SELECT_UPLOAD_SESSION_BY_PATH_REQUEST, false, errId, error)) {
+        queryFree(SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID);
+        return sqlFail(SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID, error);
+    }
+
+    ASSERT(queryCreate(INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID));
+    if (!queryPrepare(INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID, INSERT_UPLOAD_SESSION_CHUNK_REQUEST, false, errId, error)) {
+        queryFree(INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID);
+        return sqlFail(INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID, error);
+    }
+
+    ASSERT(queryCreate(SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID));
+    if (!queryPrepare(SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID, SELECT_UPLOAD_SESSION_CHUNK_REQUEST, false, errId, error)) {
+        queryFree(SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID);
+        return sqlFail(SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID, error);
+    }
+
+    ASSERT(queryCreate(INSERT_CHECKSUM_CACHE_REQUEST_ID));
+    if (!queryPrepare(INSERT_CHECKSUM_CACHE_REQUEST_ID, INSERT_CHECKSUM_CACHE_REQUEST, false, errId, error)) {
+        queryFree(INSERT_CHECKSUM_CACHE_REQUEST_ID);
+        return sqlFail(INSERT_CHECKSUM_CACHE_REQUEST_ID, error);
+    }
+
+    ASSERT(queryCreate(SELECT_CHECKSUM_CACHE_REQUEST_ID));
+    if (!queryPrepare(SELECT_CHECKSUM_CACHE_REQUEST_ID, SELECT_CHECKSUM_CACHE_REQUEST, false, errId, error)) {
+        queryFree(SELECT_CHECKSUM_CACHE_REQUEST_ID);
+        return sqlFail(SELECT_CHECKSUM_CACHE_REQUEST_ID, error);
+    }
+
+    ASSERT(queryCreate(DELETE_ORPHAN_CHECKSUM_CACHE_REQUEST_ID));
+    if (!queryPrepare(DELETE_ORPHAN_CHECKSUM_CACHE_REQUEST_ID, DELETE_ORPHAN_CHECKSUM_CACHE_REQUEST, false, errId, error)) {
+        queryFree(DELETE_ORPHAN_CHECKSUM_CACHE_REQUEST_ID);
+        return sqlFail(DELETE_ORPHAN_CHECKSUM_CACHE_REQUEST_ID, error);
+    }
+
     if (!initData()) {
         LOG_WARN(_logger, "Error in initParameters");
         return false;
@@ -640,35 +821,37 @@ bool SyncDb::insertNode(const DbNode &node, DbNodeId &dbNodeId, bool &constraint
         return false;
     }
 
+    const QueryHandle query = queryHandle(INSERT_NODE_REQUEST_ID);
+
     int errId;
     std::string error;
 
-    ASSERT(queryResetAndClearBindings(INSERT_NODE_REQUEST_ID));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 1,
-                          (node.parentNodeId() ? dbtype(node.parentNodeId().value()) : std::monostate())));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 2, node.nameLocal()));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 3, node.nameRemote()));
-    ASSERT(
-        queryBindValue(INSERT_NODE_REQUEST_ID, 4, (node.nodeIdLocal() ? dbtype(node.nodeIdLocal().value()) : std::monostate())));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 5,
-                          (node.nodeIdRemote() ? dbtype(node.nodeIdRemote().value()) : std::monostate())));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 6, (node.created() ? dbtype(node.created().value()) : std::monostate())));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 7,
-                          (node.lastModifiedLocal() ? dbtype(node.lastModifiedLocal().value()) : std::monostate())));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 8,
-                          (node.lastModifiedRemote() ? dbtype(node.lastModifiedRemote().value()) : std::monostate())));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 9, static_cast<int>(node.type())));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 10, node.size()));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 11, (node.checksum() ? dbtype(node.checksum().value()) : std::monostate())));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 12, static_cast<int>(node.status())));
-    ASSERT(queryBindValue(INSERT_NODE_REQUEST_ID, 13, static_cast<int>(node.syncing())));
-    if (!queryExecAndGetRowId(INSERT_NODE_REQUEST_ID, dbNodeId, errId, error)) {
+    ASSERT(queryResetAndClearBindings(query));
+    ASSERT(queryBindValue(query, 1, (node.parentNodeId() ? dbtype(node.parentNodeId().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 2, node.nameLocal()));
+    ASSERT(queryBindValue(query, 3, node.nameRemote()));
+    ASSERT(queryBindValue(query, 4, (node.nodeIdLocal() ? dbtype(node.nodeIdLocal().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 5, (node.nodeIdRemote() ? dbtype(node.nodeIdRemote().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 6, (node.created() ? dbtype(node.created().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 7, (node.lastModifiedLocal() ? dbtype(node.lastModifiedLocal().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 8, (node.lastModifiedRemote() ? dbtype(node.lastModifiedRemote().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 9, static_cast<int>(node.type())));
+    ASSERT(queryBindValue(query, 10, node.size()));
+    ASSERT(queryBindValue(query, 11, (node.checksum() ? dbtype(node.checksum().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 12, static_cast<int>(node.status())));
+    ASSERT(queryBindValue(query, 13, static_cast<int>(node.syncing())));
+    if (!queryExecAndGetRowId(query, dbNodeId, errId, error)) {
         LOG_WARN(_logger, "Error running query: " << INSERT_NODE_REQUEST_ID);
         constraintError = (errId == SQLITE_CONSTRAINT);
         return false;
     }
 
-    return true;
+    if (_nodeIndexLoaded) {
+        _nodeIndex.set(dbNodeId, node.parentNodeId(), node.nameLocal(), node.nameRemote(), node.nodeIdLocal(),
+                       node.nodeIdRemote());
+    }
+
+    return batchRowWritten();
 }
 
 bool SyncDb::updateNode(const DbNode &node, bool &found) {
@@ -685,41 +868,41 @@ bool SyncDb::updateNode(const DbNode &node, bool &found) {
         return false;
     }
 
+    const QueryHandle query = queryHandle(UPDATE_NODE_REQUEST_ID);
+
     int errId;
     std::string error;
 
-    ASSERT(queryResetAndClearBindings(UPDATE_NODE_REQUEST_ID));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 1,
-                          (node.parentNodeId() ? dbtype(node.parentNodeId().value()) : std::monostate())));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 2, node.nameLocal()));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 3, node.nameRemote()));
-    ASSERT(
-        queryBindValue(UPDATE_NODE_REQUEST_ID, 4, (node.nodeIdLocal() ? dbtype(node.nodeIdLocal().value()) : std::monostate())));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 5,
-                          (node.nodeIdRemote() ? dbtype(node.nodeIdRemote().value()) : std::monostate())));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 6, (node.created() ? dbtype(node.created().value()) : std::monostate())));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 7,
-                          (node.lastModifiedLocal() ? dbtype(node.lastModifiedLocal().value()) : std::monostate())));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 8,
-                          (node.lastModifiedRemote() ? dbtype(node.lastModifiedRemote().value()) : std::monostate())));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 9, static_cast<int>(node.type())));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 10, node.size()));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 11, (node.checksum() ? dbtype(node.checksum().value()) : std::monostate())));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 12, static_cast<int>(node.status())));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 13, static_cast<int>(node.syncing())));
-    ASSERT(queryBindValue(UPDATE_NODE_REQUEST_ID, 14, node.nodeId()));
-    if (!queryExec(UPDATE_NODE_REQUEST_ID, errId, error)) {
+    ASSERT(queryResetAndClearBindings(query));
+    ASSERT(queryBindValue(query, 1, (node.parentNodeId() ? dbtype(node.parentNodeId().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 2, node.nameLocal()));
+    ASSERT(queryBindValue(query, 3, node.nameRemote()));
+    ASSERT(queryBindValue(query, 4, (node.nodeIdLocal() ? dbtype(node.nodeIdLocal().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 5, (node.nodeIdRemote() ? dbtype(node.nodeIdRemote().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 6, (node.created() ? dbtype(node.created().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 7, (node.lastModifiedLocal() ? dbtype(node.lastModifiedLocal().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 8, (node.lastModifiedRemote() ? dbtype(node.lastModifiedRemote().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 9, static_cast<int>(node.type())));
+    ASSERT(queryBindValue(query, 10, node.size()));
+    ASSERT(queryBindValue(query, 11, (node.checksum() ? dbtype(node.checksum().value()) : std::monostate())));
+    ASSERT(queryBindValue(query, 12, static_cast<int>(node.status())));
+    ASSERT(queryBindValue(query, 13, static_cast<int>(node.syncing())));
+    ASSERT(queryBindValue(query, 14, node.nodeId()));
+    if (!queryExec(query, errId, error)) {
         LOG_WARN(_logger, "Error running query: " << UPDATE_NODE_REQUEST_ID);
         return false;
     }
     if (numRowsAffected() == 1) {
         found = true;
+        if (_nodeIndexLoaded) {
+            _nodeIndex.set(node);
+        }
     } else {
         LOG_WARN(_logger, "Error running query: " << UPDATE_NODE_REQUEST_ID << " - num rows affected != 1");
         found = false;
     }
 
-    return true;
+    return batchRowWritten();
 }
 
 bool SyncDb::updateNodeStatus(DbNodeId nodeId, SyncFileStatus status, bool &found) {
@@ -742,7 +925,7 @@ bool SyncDb::updateNodeStatus(DbNodeId nodeId, SyncFileStatus status, bool &foun
         found = false;
     }
 
-    return true;
+    return batchRowWritten();
 }
 
 bool SyncDb::updateNodesSyncing(bool syncing) {
@@ -758,7 +941,7 @@ bool SyncDb::updateNodesSyncing(bool syncing) {
         return false;
     }
 
-    return true;
+    return batchRowWritten();
 }
 
 bool SyncDb::updateNodeSyncing(DbNodeId nodeId, bool syncing, bool &found) {
@@ -781,29 +964,35 @@ bool SyncDb::updateNodeSyncing(DbNodeId nodeId, bool syncing, bool &found) {
         found = false;
     }
 
-    return true;
+    return batchRowWritten();
 }
 
 bool SyncDb::deleteNode(DbNodeId nodeId, bool &found) {
     const std::lock_guard<std::mutex> lock(_mutex);
 
+    const QueryHandle query = queryHandle(DELETE_NODE_REQUEST_ID);
+
     int errId;
     std::string error;
 
-    ASSERT(queryResetAndClearBindings(DELETE_NODE_REQUEST_ID));
-    ASSERT(queryBindValue(DELETE_NODE_REQUEST_ID, 1, nodeId));
-    if (!queryExec(DELETE_NODE_REQUEST_ID, errId, error)) {
+    ASSERT(queryResetAndClearBindings(query));
+    ASSERT(queryBindValue(query, 1, nodeId));
+    if (!queryExec(query, errId, error)) {
         LOG_WARN(_logger, "Error running query: " << DELETE_NODE_REQUEST_ID);
         return false;
     }
     if (numRowsAffected() == 1) {
         found = true;
+        if (_nodeIndexLoaded) {
+            // The children are deleted by the foreign key
+            _nodeIndex.remove(nodeId);
+        }
     } else {
         LOG_WARN(_logger, "Error running query: " << DELETE_NODE_REQUEST_ID << " - num rows affected != 1");
         found = false;
     }
 
-    return true;
+    return batchRowWritten();
 }
 
 bool SyncDb::status(ReplicaSide side, const SyncPath &path, SyncFileStatus &status, bool &found) {
@@ -950,9 +1139,10 @@ bool SyncDb::node(ReplicaSide snapshot, const NodeId &nodeId, DbNode &dbNode, bo
     const std::lock_guard<std::mutex> lock(_mutex);
 
     std::string id = (snapshot == ReplicaSide::ReplicaSideLocal ? SELECT_NODE_BY_NODEIDLOCAL_ID : SELECT_NODE_BY_NODEIDDRIVE_ID);
-    ASSERT(queryResetAndClearBindings(id));
-    ASSERT(queryBindValue(id, 1, nodeId));
-    if (!queryNext(id, found)) {
+    const QueryHandle query = queryHandle(id);
+    ASSERT(queryResetAndClearBindings(query));
+    ASSERT(queryBindValue(query, 1, nodeId));
+    if (!queryNext(query, found)) {
         LOG_WARN(_logger, "Error getting query result: "
                               << id.c_str() << (snapshot == ReplicaSide::ReplicaSideLocal ? " - nodeIdLocal=" : " - nodeIdDrive=")
                               << nodeId.c_str());
@@ -963,68 +1153,68 @@ bool SyncDb::node(ReplicaSide snapshot, const NodeId &nodeId, DbNode &dbNode, bo
     }
 
     DbNodeId dbNodeId;
-    ASSERT(queryInt64Value(id, SELECT_NODE_BY_REPLICAID_DBID, dbNodeId));
+    ASSERT(queryInt64Value(query, SELECT_NODE_BY_REPLICAID_DBID, dbNodeId));
 
     bool ok;
     std::optional<DbNodeId> parentNodeId;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_REPLICAID_PARENTID, ok));
+    ASSERT(queryIsNullValue(query, SELECT_NODE_BY_REPLICAID_PARENTID, ok));
     if (ok) {
         parentNodeId = std::nullopt;
     } else {
         DbNodeId dbParentNodeId;
-        ASSERT(queryInt64Value(id, SELECT_NODE_BY_REPLICAID_PARENTID, dbParentNodeId));
+        ASSERT(queryInt64Value(query, SELECT_NODE_BY_REPLICAID_PARENTID, dbParentNodeId));
         parentNodeId = std::make_optional(dbParentNodeId);
     }
 
     SyncName nameLocal;
-    ASSERT(querySyncNameValue(id, SELECT_NODE_BY_REPLICAID_NAMELOCAL, nameLocal));
+    ASSERT(querySyncNameValue(query, SELECT_NODE_BY_REPLICAID_NAMELOCAL, nameLocal));
     SyncName nameDrive;
-    ASSERT(querySyncNameValue(id, SELECT_NODE_BY_REPLICAID_NAMEDRIVE, nameDrive));
+    ASSERT(querySyncNameValue(query, SELECT_NODE_BY_REPLICAID_NAMEDRIVE, nameDrive));
 
     std::optional<SyncTime> created;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_REPLICAID_CREATED, ok));
+    ASSERT(queryIsNullValue(query, SELECT_NODE_BY_REPLICAID_CREATED, ok));
     if (ok) {
         created = std::nullopt;
     } else {
         SyncTime timeTmp;
-        ASSERT(queryInt64Value(id, SELECT_NODE_BY_REPLICAID_CREATED, timeTmp));
+        ASSERT(queryInt64Value(query, SELECT_NODE_BY_REPLICAID_CREATED, timeTmp));
         created = std::make_optional(timeTmp);
     }
 
     std::optional<SyncTime> lastModified;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_REPLICAID_LASTMOD, ok));
+    ASSERT(queryIsNullValue(query, SELECT_NODE_BY_REPLICAID_LASTMOD, ok));
     if (ok) {
         lastModified = std::nullopt;
     } else {
         SyncTime timeTmp;
-        ASSERT(queryInt64Value(id, SELECT_NODE_BY_REPLICAID_LASTMOD, timeTmp));
+        ASSERT(queryInt64Value(query, SELECT_NODE_BY_REPLICAID_LASTMOD, timeTmp));
         lastModified = std::make_optional(timeTmp);
     }
 
     int intResult;
-    ASSERT(queryIntValue(id, SELECT_NODE_BY_REPLICAID_TYPE, intResult));
+    ASSERT(queryIntValue(query, SELECT_NODE_BY_REPLICAID_TYPE, intResult));
     NodeType type = static_cast<NodeType>(intResult);
 
     int64_t size;
-    ASSERT(queryInt64Value(id, SELECT_NODE_BY_REPLICAID_SIZE, size));
+    ASSERT(queryInt64Value(query, SELECT_NODE_BY_REPLICAID_SIZE, size));
 
     std::optional<std::string> cs;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_REPLICAID_CHECKSUM, ok));
+    ASSERT(queryIsNullValue(query, SELECT_NODE_BY_REPLICAID_CHECKSUM, ok));
     if (ok) {
         cs = std::nullopt;
     } else {
         std::string csTmp;
-        ASSERT(queryStringValue(id, SELECT_NODE_BY_REPLICAID_CHECKSUM, csTmp));
+        ASSERT(queryStringValue(query, SELECT_NODE_BY_REPLICAID_CHECKSUM, csTmp));
         cs = std::make_optional(csTmp);
     }
 
-    ASSERT(queryIntValue(id, SELECT_NODE_BY_REPLICAID_STATUS, intResult));
+    ASSERT(queryIntValue(query, SELECT_NODE_BY_REPLICAID_STATUS, intResult));
     SyncFileStatus status = static_cast<SyncFileStatus>(intResult);
 
-    ASSERT(queryIntValue(id, SELECT_NODE_BY_REPLICAID_SYNCING, intResult));
+    ASSERT(queryIntValue(query, SELECT_NODE_BY_REPLICAID_SYNCING, intResult));
     bool syncing = static_cast<bool>(intResult);
 
-    ASSERT(queryResetAndClearBindings(id));
+    ASSERT(queryResetAndClearBindings(query));
 
     dbNode.setNodeId(dbNodeId);
     dbNode.setParentNodeId(parentNodeId);
@@ -1079,62 +1269,11 @@ bool SyncDb::dbIds(std::unordered_set<DbNodeId> &ids, bool &found) {
 bool SyncDb::path(DbNodeId dbNodeId, SyncPath &localPath, SyncPath &remotePath, bool &found) {
     const std::lock_guard<std::mutex> lock(_mutex);
 
-    ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
-    ASSERT(queryBindValue(SELECT_NODE_BY_NODEID_LITE_ID, 1, dbNodeId));
-    if (!queryNext(SELECT_NODE_BY_NODEID_LITE_ID, found)) {
-        LOG_WARN(_logger, "Error getting query result: " << SELECT_NODE_BY_NODEID_LITE_ID << " - nodeId=" << dbNodeId);
+    if (!loadNodeIndex()) {
         return false;
     }
-    if (!found) {
-        return true;
-    }
-
-    // Fill names' vector
-    std::vector<std::pair<SyncName, SyncName>> names;  // first: local names, second: drive names
-
-    bool parentNodeDbIdIsNull;
-    DbNodeId parentNodeDbId;
-    ASSERT(queryIsNullValue(SELECT_NODE_BY_NODEID_LITE_ID, SELECT_NODE_BY_NODEID_PARENTID, parentNodeDbIdIsNull));
-    if (!parentNodeDbIdIsNull) {
-        ASSERT(queryInt64Value(SELECT_NODE_BY_NODEID_LITE_ID, SELECT_NODE_BY_NODEID_PARENTID, parentNodeDbId));
-
-        SyncName localName;
-        ASSERT(querySyncNameValue(SELECT_NODE_BY_NODEID_LITE_ID, SELECT_NODE_BY_NODEID_NAMELOCAL, localName));
-        SyncName driveName;
-        ASSERT(querySyncNameValue(SELECT_NODE_BY_NODEID_LITE_ID, SELECT_NODE_BY_NODEID_NAMEDRIVE, driveName));
-        names.push_back({localName, driveName});
-
-        while (!parentNodeDbIdIsNull) {
-            ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
-            ASSERT(queryBindValue(SELECT_NODE_BY_NODEID_LITE_ID, 1, parentNodeDbId));
-            if (!queryNext(SELECT_NODE_BY_NODEID_LITE_ID, found)) {
-                LOG_WARN(_logger, "Error getting query result: " << SELECT_NODE_BY_NODEID_LITE_ID << " - nodeId=" << dbNodeId);
-                return false;
-            }
-            if (!found) {
-                return true;
-            }
-
-            ASSERT(queryIsNullValue(SELECT_NODE_BY_NODEID_LITE_ID, SELECT_NODE_BY_NODEID_PARENTID, parentNodeDbIdIsNull));
-            if (!parentNodeDbIdIsNull) {
-                ASSERT(queryInt64Value(SELECT_NODE_BY_NODEID_LITE_ID, SELECT_NODE_BY_NODEID_PARENTID, parentNodeDbId));
-
-                ASSERT(querySyncNameValue(SELECT_NODE_BY_NODEID_LITE_ID, SELECT_NODE_BY_NODEID_NAMELOCAL, localName));
-                ASSERT(querySyncNameValue(SELECT_NODE_BY_NODEID_LITE_ID, SELECT_NODE_BY_NODEID_NAMEDRIVE, driveName));
-                names.push_back({localName, driveName});
-            }
-        }
-    }
 
-    ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
-
-    // Construct path from names' vector
-    localPath.clear();
-    remotePath.clear();
-    for (auto nameIt = names.rbegin(); nameIt != names.rend(); ++nameIt) {
-        localPath.append(nameIt->first);
-        remotePath.append(nameIt->second);
-    }
+    found = _nodeIndex.path(dbNodeId, localPath, remotePath);
 
     return true;
 }
@@ -1143,9 +1282,10 @@ bool SyncDb::node(DbNodeId dbNodeId, DbNode &dbNode, bool &found) {
     const std::lock_guard<std::mutex> lock(_mutex);
 
     std::string id = SELECT_NODE_BY_NODEID_FULL_ID;
-    ASSERT(queryResetAndClearBindings(id));
-    ASSERT(queryBindValue(id, 1, dbNodeId));
-    if (!queryNext(id, found)) {
+    const QueryHandle query = queryHandle(id);
+    ASSERT(queryResetAndClearBindings(query));
+    ASSERT(queryBindValue(query, 1, dbNodeId));
+    if (!queryNext(query, found)) {
         LOG_WARN(_logger, "Error getting query result: " << id.c_str() << " - dbNodeId=" << dbNodeId);
         return false;
     }
@@ -1155,81 +1295,81 @@ bool SyncDb::node(DbNodeId dbNodeId, DbNode &dbNode, bool &found) {
 
     bool ok;
     std::optional<DbNodeId> parentNodeId;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_NODEID_PARENTID, ok));
+    ASSERT(queryIsNullValue(query, SELECT_NODE_BY_NODEID_PARENTID, ok));
     if (ok) {
         parentNodeId = std::nullopt;
     } else {
         DbNodeId dbParentNodeId;
-        ASSERT(queryInt64Value(id, SELECT_NODE_BY_NODEID_PARENTID, dbParentNodeId));
+        ASSERT(queryInt64Value(query, SELECT_NODE_BY_NODEID_PARENTID, dbParentNodeId));
         parentNodeId = std::make_optional(dbParentNodeId);
     }
 
     SyncName nameLocal;
-    ASSERT(querySyncNameValue(id, SELECT_NODE_BY_NODEID_NAMELOCAL, nameLocal));
+    ASSERT(querySyncNameValue(query, SELECT_NODE_BY_NODEID_NAMELOCAL, nameLocal));
 
     SyncName nameDrive;
-    ASSERT(querySyncNameValue(id, SELECT_NODE_BY_NODEID_NAMEDRIVE, nameDrive));
+    ASSERT(querySyncNameValue(query, SELECT_NODE_BY_NODEID_NAMEDRIVE, nameDrive));
 
     NodeId nodeIdLocal;
-    ASSERT(queryStringValue(id, SELECT_NODE_BY_NODEID_IDLOCAL, nodeIdLocal));
+    ASSERT(queryStringValue(query, SELECT_NODE_BY_NODEID_IDLOCAL, nodeIdLocal));
 
     NodeId nodeIdDrive;
-    ASSERT(queryStringValue(id, SELECT_NODE_BY_NODEID_IDDRIVE, nodeIdDrive));
+    ASSERT(queryStringValue(query, SELECT_NODE_BY_NODEID_IDDRIVE, nodeIdDrive));
 
     std::optional<SyncTime> created;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_NODEID_CREATED, ok));
+    ASSERT(queryIsNullValue(query, SELECT_NODE_BY_NODEID_CREATED, ok));
     if (ok) {
         created = std::nullopt;
     } else {
         SyncTime timeTmp;
-        ASSERT(queryInt64Value(id, SELECT_NODE_BY_NODEID_CREATED, timeTmp));
+        ASSERT(queryInt64Value(query, SELECT_NODE_BY_NODEID_CREATED, timeTmp));
         created = std::make_optional(timeTmp);
     }
 
     std::optional<SyncTime> lastModifiedLocal;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_NODEID_LASTMODLOCAL, ok));
+    ASSERT(queryIsNullValue(query, SELECT_NODE_BY_NODEID_LASTMODLOCAL, ok));
     if (ok) {
         lastModifiedLocal = std::nullopt;
     } else {
         SyncTime timeTmp;
-        ASSERT(queryInt64Value(id, SELECT_NODE_BY_NODEID_LASTMODLOCAL, timeTmp));
+        ASSERT(queryInt64Value(query, SELECT_NODE_BY_NODEID_LASTMODLOCAL, timeTmp));
         lastModifiedLocal = std::make_optional(timeTmp);
     }
 
     std::optional<SyncTime> lastModifiedDrive;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_NODEID_LASTMODDRIVE, ok));
+    ASSERT(queryIsNullValue(query, SELECT_NODE_BY_NODEID_LASTMODDRIVE, ok));
     if (ok) {
         lastModifiedDrive = std::nullopt;
     } else {
         SyncTime timeTmp;
-        ASSERT(queryInt64Value(id, SELECT_NODE_BY_NODEID_LASTMODDRIVE, timeTmp));
+        ASSERT(queryInt64Value(query, SELECT_NODE_BY_NODEID_LASTMODDRIVE, timeTmp));
         lastModifiedDrive = std::make_optional(timeTmp);
     }
 
     int intResult;
-    ASSERT(queryIntValue(id, SELECT_NODE_BY_NODEID_TYPE, intResult));
+    ASSERT(queryIntValue(query, SELECT_NODE_BY_NODEID_TYPE, intResult));
     NodeType type = static_cast<NodeType>(intResult);
 
     int64_t size;
-    ASSERT(queryInt64Value(id, SELECT_NODE_BY_NODEID_SIZE, size));
+    ASSERT(queryInt64Value(query, SELECT_NODE_BY_NODEID_SIZE, size));
 
     std::optional<std::string> cs;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_NODEID_CHECKSUM, ok));
+    ASSERT(queryIsNullValue(query, SELECT_NODE_BY_NODEID_CHECKSUM, ok));
     if (ok) {
         cs = std::nullopt;
     } else {
         std::string csTmp;
-        ASSERT(queryStringValue(id, SELECT_NODE_BY_NODEID_CHECKSUM, csTmp));
+        ASSERT(queryStringValue(query, SELECT_NODE_BY_NODEID_CHECKSUM, csTmp));
         cs = std::make_optional(csTmp);
     }
 
-    ASSERT(queryIntValue(id, SELECT_NODE_BY_NODEID_STATUS, intResult));
+    ASSERT(queryIntValue(query, SELECT_NODE_BY_NODEID_STATUS, intResult));
     SyncFileStatus status = static_cast<SyncFileStatus>(intResult);
 
-    ASSERT(queryIntValue(id, SELECT_NODE_BY_NODEID_SYNCING, intResult));
+    ASSERT(queryIntValue(query, SELECT_NODE_BY_NODEID_SYNCING, intResult));
     bool syncing = static_cast<bool>(intResult);
 
-    ASSERT(queryResetAndClearBindings(id));
+    ASSERT(queryResetAndClearBindings(query));
 
     dbNode.setNodeId(dbNodeId);
     dbNode.setParentNodeId(parentNodeId);
@@ -1252,52 +1392,11 @@ bool SyncDb::node(DbNodeId dbNodeId, DbNode &dbNode, bool &found) {
 bool SyncDb::dbId(ReplicaSide side, const SyncPath &path, DbNodeId &dbNodeId, bool &found) {
     const std::lock_guard<std::mutex> lock(_mutex);
 
-    // Split path
-    std::vector<SyncName> names;
-    SyncPath pathTmp(path);
-    while (pathTmp != pathTmp.root_path()) {
-        names.push_back(pathTmp.filename().native());
-        pathTmp = pathTmp.parent_path();
-    }
-
-    // Find root node
-    ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID));
-    if (!queryNext(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID, found)) {
-        LOG_WARN(_logger, "Error getting query result: " << SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID);
+    if (!loadNodeIndex()) {
         return false;
     }
-    if (!found) {
-        return true;
-    }
-
-    ASSERT(queryInt64Value(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID, 0, dbNodeId));
-
-    ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID));
-
-    if (names.size() > 0) {
-        // Find file node
-        std::string id = (side == ReplicaSide::ReplicaSideLocal ? SELECT_NODE_BY_PARENTNODEID_AND_NAMELOCAL_REQUEST_ID
-                                                                : SELECT_NODE_BY_PARENTNODEID_AND_NAMEDRIVE_REQUEST_ID);
-        for (std::vector<SyncName>::reverse_iterator nameIt = names.rbegin(); nameIt != names.rend(); ++nameIt) {
-            ASSERT(queryResetAndClearBindings(id));
-            ASSERT(queryBindValue(id, 1, dbNodeId));
-            ASSERT(queryBindValue(id, 2, Utility::normalizedSyncName(*nameIt)));
-            if (!queryNext(id, found)) {
-                LOGW_WARN(_logger, L"Error getting query result: " << Utility::s2ws(id).c_str() << L" - parentNodeId="
-                                                                   << std::to_wstring(dbNodeId).c_str() << L" and name="
-                                                                   << (SyncName2WStr(*nameIt)).c_str());
-                return false;
-            }
-            if (!found) {
-                return true;
-            }
-            ASSERT(queryInt64Value(id, 0, dbNodeId));
-
-            ASSERT(queryResetAndClearBindings(id));
-        }
-    }
 
-    found = true;
+    found = indexedDbId(side, path, dbNodeId);
 
     return true;
 }
@@ -1314,6 +1413,9 @@ bool SyncDb::clearNodes() {
         return false;
     }
 
+    // Reloaded on next use, only the root node is left
+    _nodeIndexLoaded = false;
+
     return true;
 }
 
@@ -1322,74 +1424,13 @@ bool SyncDb::clearNodes() {
 bool SyncDb::id(ReplicaSide snapshot, const SyncPath &path, std::optional<NodeId> &nodeId, bool &found) {
     const std::lock_guard<std::mutex> lock(_mutex);
 
-    // Split path
-    std::vector<SyncName> names;
-    SyncPath pathTmp(path);
-    while (pathTmp != pathTmp.root_path()) {
-        names.push_back(pathTmp.filename().native());
-        pathTmp = pathTmp.parent_path();
-    }
-
-    // Find root node
-    ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID));
-    if (!queryNext(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID, found)) {
-        LOG_WARN(_logger, "Error getting query result: " << SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID);
+    if (!loadNodeIndex()) {
         return false;
     }
-    if (!found) {
-        return true;
-    }
-    DbNodeId nodeDbId;
-    ASSERT(queryInt64Value(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID, 0, nodeDbId));
 
-    if (names.size() > 0) {
-        ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID));
-
-        std::string queryId = (snapshot == ReplicaSide::ReplicaSideLocal ? SELECT_NODE_BY_PARENTNODEID_AND_NAMELOCAL_REQUEST_ID
-                                                                         : SELECT_NODE_BY_PARENTNODEID_AND_NAMEDRIVE_REQUEST_ID);
-        // Find file node
-        for (std::vector<SyncName>::reverse_iterator nameIt = names.rbegin(); nameIt != names.rend(); ++nameIt) {
-            ASSERT(queryResetAndClearBindings(queryId));
-            ASSERT(queryBindValue(queryId, 1, nodeDbId));
-            ASSERT(queryBindValue(queryId, 2, Utility::normalizedSyncName(*nameIt)));
-            if (!queryNext(queryId, found)) {
-                LOGW_WARN(_logger, L"Error getting query result: " << queryId.c_str() << L" - parentNodeId=" << nodeDbId
-                                                                   << L" and name=" << (SyncName2WStr(*nameIt)).c_str());
-                return false;
-            }
-            if (!found) {
-                return true;
-            }
-            ASSERT(queryInt64Value(queryId, 0, nodeDbId));
-        }
-        bool ok;
-        ASSERT(queryIsNullValue(queryId, 1, ok));
-        if (ok) {
-            nodeId = std::nullopt;
-        } else {
-            NodeId idTmp;
-            ASSERT(queryStringValue(queryId, 1, idTmp));
-            nodeId = std::make_optional(idTmp);
-        }
-
-        ASSERT(queryResetAndClearBindings(queryId));
-    } else {
-        bool ok;
-        ASSERT(queryIsNullValue(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID, (snapshot == ReplicaSide::ReplicaSideLocal ? 3 : 4),
-                                ok));
-        if (ok) {
-            nodeId = std::nullopt;
-        } else {
-            NodeId idTmp;
-            ASSERT(queryStringValue(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID,
-                                    (snapshot == ReplicaSide::ReplicaSideLocal ? 3 : 4), idTmp));
-            nodeId = std::make_optional(idTmp);
-        }
-
-        ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_PARENTNODEID_ROOT_REQUEST_ID));
-    }
+    DbNodeId dbNodeId;
+    found = indexedDbId(snapshot, path, dbNodeId) && _nodeIndex.id(snapshot, dbNodeId, nodeId);
 
-    found = true;
     return true;
 }
 
@@ -1505,36 +1546,18 @@ bool SyncDb::lastModified(ReplicaSide snapshot, const NodeId &nodeId, std::optio
 bool SyncDb::parent(ReplicaSide snapshot, const NodeId &nodeId, NodeId &parentNodeid, bool &found) {
     const std::lock_guard<std::mutex> lock(_mutex);
 
-    std::string id = (snapshot == ReplicaSide::ReplicaSideLocal ? SELECT_NODE_BY_NODEIDLOCAL_ID : SELECT_NODE_BY_NODEIDDRIVE_ID);
-    ASSERT(queryResetAndClearBindings(id));
-    ASSERT(queryBindValue(id, 1, nodeId));
-    if (!queryNext(id, found)) {
-        LOG_WARN(_logger, "Error getting query result: "
-                              << id.c_str() << (snapshot == ReplicaSide::ReplicaSideLocal ? " - nodeIdLocal=" : " - nodeIdDrive=")
-                              << nodeId.c_str());
+    if (!loadNodeIndex()) {
         return false;
     }
-    if (!found) {
-        return true;
-    }
-    DbNodeId parentNodeDbId;
-    ASSERT(queryInt64Value(id, SELECT_NODE_BY_REPLICAID_PARENTID, parentNodeDbId));
-    ASSERT(queryResetAndClearBindings(id));
 
-    ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
-    ASSERT(queryBindValue(SELECT_NODE_BY_NODEID_LITE_ID, 1, parentNodeDbId));
-    if (!queryNext(SELECT_NODE_BY_NODEID_LITE_ID, found)) {
-        LOG_WARN(_logger, "Error getting query result: "
-                              << SELECT_NODE_BY_NODEID_LITE_ID
-                              << (snapshot == ReplicaSide::ReplicaSideLocal ? " - nodeIdLocal=" : " - nodeIdDrive=")
-                              << nodeId.c_str());
-        return false;
-    }
-    if (!found) {
-        return true;
+    DbNodeId dbNodeId;
+    std::optional<DbNodeId> parentNodeDbId;
+    std::optional<NodeId> parentNodeIdTmp;
+    found = _nodeIndex.dbId(snapshot, nodeId, dbNodeId) && _nodeIndex.parentDbId(dbNodeId, parentNodeDbId) && parentNodeDbId &&
+            _nodeIndex.id(snapshot, *parentNodeDbId, parentNodeIdTmp);
+    if (found) {
+        parentNodeid = parentNodeIdTmp.value_or(NodeId());
     }
-    ASSERT(queryStringValue(SELECT_NODE_BY_NODEID_LITE_ID, (snapshot == ReplicaSide::ReplicaSideLocal ? 3 : 4), parentNodeid));
-    ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
 
     return true;
 }
@@ -1544,68 +1567,16 @@ bool SyncDb::parent(ReplicaSide snapshot, const NodeId &nodeId, NodeId &parentNo
 bool SyncDb::path(ReplicaSide snapshot, const NodeId &nodeId, SyncPath &path, bool &found) {
     const std::lock_guard<std::mutex> lock(_mutex);
 
-    std::string id = (snapshot == ReplicaSide::ReplicaSideLocal ? SELECT_NODE_BY_NODEIDLOCAL_ID : SELECT_NODE_BY_NODEIDDRIVE_ID);
-    ASSERT(queryResetAndClearBindings(id));
-    ASSERT(queryBindValue(id, 1, nodeId));
-    if (!queryNext(id, found)) {
-        LOG_WARN(_logger, "Error getting query result: "
-                              << id.c_str() << (snapshot == ReplicaSide::ReplicaSideLocal ? " - nodeIdLocal=" : " - nodeIdDrive=")
-                              << nodeId.c_str());
+    if (!loadNodeIndex()) {
         return false;
     }
-    if (!found) {
-        return true;
-    }
-
-    // Fill names' vector
-    std::vector<std::string> names;
-
-    bool parentNodeDbIdIsNull;
-    DbNodeId parentNodeDbId;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_REPLICAID_PARENTID, parentNodeDbIdIsNull));
-    if (!parentNodeDbIdIsNull) {
-        ASSERT(queryInt64Value(id, SELECT_NODE_BY_REPLICAID_PARENTID, parentNodeDbId));
-
-        std::string name;
-        ASSERT(queryStringValue(
-            id, snapshot == ReplicaSideLocal ? SELECT_NODE_BY_REPLICAID_NAMELOCAL : SELECT_NODE_BY_REPLICAID_NAMEDRIVE, name));
-        names.push_back(name);
-
-        ASSERT(queryResetAndClearBindings(id));
-
-        while (!parentNodeDbIdIsNull) {
-            ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
-            ASSERT(queryBindValue(SELECT_NODE_BY_NODEID_LITE_ID, 1, parentNodeDbId));
-            if (!queryNext(SELECT_NODE_BY_NODEID_LITE_ID, found)) {
-                LOG_WARN(_logger, "Error getting query result: "
-                                      << SELECT_NODE_BY_NODEID_LITE_ID
-                                      << (snapshot == ReplicaSide::ReplicaSideLocal ? " - nodeIdLocal=" : " - nodeIdDrive=")
-                                      << nodeId.c_str());
-                return false;
-            }
-            if (!found) {
-                return true;
-            }
-
-            ASSERT(queryIsNullValue(SELECT_NODE_BY_NODEID_LITE_ID, 0, parentNodeDbIdIsNull));
-            if (!parentNodeDbIdIsNull) {
-                ASSERT(queryInt64Value(SELECT_NODE_BY_NODEID_LITE_ID, 0, parentNodeDbId));
-
-                ASSERT(
-                    queryStringValue(SELECT_NODE_BY_NODEID_LITE_ID, (snapshot == ReplicaSide::ReplicaSideLocal ? 1 : 2), name));
-                names.push_back(name);
-            }
 
-            ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
-        }
-    } else {
-        ASSERT(queryResetAndClearBindings(id));
-    }
-
-    // Construct path from names' vector
-    path.clear();
-    for (std::vector<std::string>::reverse_iterator nameIt = names.rbegin(); nameIt != names.rend(); ++nameIt) {
-        path.append(*nameIt);
+    DbNodeId dbNodeId;
+    SyncPath localPath;
+    SyncPath remotePath;
+    found = _nodeIndex.dbId(snapshot, nodeId, dbNodeId) && _nodeIndex.path(dbNodeId, localPath, remotePath);
+    if (found) {
+        path = (snapshot == ReplicaSide::ReplicaSideLocal ? localPath : remotePath);
     }
 
     return true;
@@ -1734,66 +1705,41 @@ bool SyncDb::ancestor(ReplicaSide snapshot, const NodeId &nodeId1, const NodeId
         return true;
     }
 
-    // Find node 2
-    std::string id = (snapshot == ReplicaSide::ReplicaSideLocal ? SELECT_NODE_BY_NODEIDLOCAL_ID : SELECT_NODE_BY_NODEIDDRIVE_ID);
-    ASSERT(queryResetAndClearBindings(id));
-    ASSERT(queryBindValue(id, 1, nodeId2));
-    if (!queryNext(id, found)) {
-        LOG_WARN(_logger, "Error getting query result: "
-                              << id.c_str() << (snapshot == ReplicaSide::ReplicaSideLocal ? " - nodeIdLocal=" : " - nodeIdDrive=")
-                              << nodeId2.c_str());
+    if (!loadNodeIndex()) {
         return false;
     }
+
+    // Find node 2
+    DbNodeId dbNodeId;
+    found = _nodeIndex.dbId(snapshot, nodeId2, dbNodeId);
     if (!found) {
         return true;
     }
-    bool parentNodeDbIdIsNull;
-    ASSERT(queryIsNullValue(id, SELECT_NODE_BY_REPLICAID_PARENTID, parentNodeDbIdIsNull));
-    if (parentNodeDbIdIsNull) {
-        ret = false;
-        return true;
-    }
 
     // Loop on the ancestors
-    DbNodeId parentNodeDbId;
-    ASSERT(queryInt64Value(id, SELECT_NODE_BY_REPLICAID_PARENTID, parentNodeDbId));
-    ASSERT(queryResetAndClearBindings(id));
-    do {
-        ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
-        ASSERT(queryBindValue(SELECT_NODE_BY_NODEID_LITE_ID, 1, parentNodeDbId));
-        if (!queryNext(SELECT_NODE_BY_NODEID_LITE_ID, found)) {
-            LOG_WARN(_logger, "Error getting query result: " << SELECT_NODE_BY_NODEID_LITE_ID);
-            return false;
-        }
-        if (!found) {
+    std::optional<DbNodeId> parentNodeDbId;
+    _nodeIndex.parentDbId(dbNodeId, parentNodeDbId);
+    while (parentNodeDbId) {
+        std::optional<NodeId> nodeId;
+        if (!_nodeIndex.id(snapshot, *parentNodeDbId, nodeId)) {
+            found = false;
             return true;
         }
-
-        bool nodeIdIsNull;
-        ASSERT(
-            queryIsNullValue(SELECT_NODE_BY_NODEID_LITE_ID, (snapshot == ReplicaSide::ReplicaSideLocal ? 3 : 4), nodeIdIsNull));
-        if (nodeIdIsNull) {
+        if (!nodeId) {
             // Database inconsistency
             LOG_WARN(_logger, "Database inconsistency: node with dbId="
-                                  << parentNodeDbId << " is not in snapshot="
+                                  << *parentNodeDbId << " is not in snapshot="
                                   << (snapshot == ReplicaSide::ReplicaSideLocal ? "Local" : "Drive") << " while child is");
             found = false;
             return true;
         }
-        NodeId nodeId;
-        ASSERT(queryStringValue(SELECT_NODE_BY_NODEID_LITE_ID, (snapshot == ReplicaSide::ReplicaSideLocal ? 3 : 4), nodeId));
-        if (nodeId == nodeId1) {
+        if (*nodeId == nodeId1) {
             ret = true;
             return true;
         }
 
-        ASSERT(queryIsNullValue(SELECT_NODE_BY_NODEID_LITE_ID, 0, parentNodeDbIdIsNull));
-        if (!parentNodeDbIdIsNull) {
-            ASSERT(queryInt64Value(SELECT_NODE_BY_NODEID_LITE_ID, 0, parentNodeDbId));
-        }
-
-        ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
-    } while (!parentNodeDbIdIsNull);
+        _nodeIndex.parentDbId(*parentNodeDbId, parentNodeDbId);
+    }
 
     ret = false;
     return true;
@@ -1803,20 +1749,11 @@ bool SyncDb::ancestor(ReplicaSide snapshot, const NodeId &nodeId1, const NodeId
 bool SyncDb::dbId(ReplicaSide snapshot, const NodeId &nodeId, DbNodeId &dbNodeId, bool &found) {
     const std::lock_guard<std::mutex> lock(_mutex);
 
-    std::string id = (snapshot == ReplicaSide::ReplicaSideLocal ? SELECT_NODE_BY_NODEIDLOCAL_ID : SELECT_NODE_BY_NODEIDDRIVE_ID);
-    ASSERT(queryResetAndClearBindings(id));
-    ASSERT(queryBindValue(id, 1, nodeId));
-    if (!queryNext(id, found)) {
-        LOG_WARN(_logger, "Error getting query result: "
-                              << id.c_str() << (snapshot == ReplicaSide::ReplicaSideLocal ? " - nodeIdLocal=" : " - nodeIdDrive=")
-                              << nodeId.c_str());
+    if (!loadNodeIndex()) {
         return false;
     }
-    if (!found) {
-        return true;
-    }
-    ASSERT(queryInt64Value(id, SELECT_NODE_BY_REPLICAID_DBID, dbNodeId));
-    ASSERT(queryResetAndClearBindings(id));
+
+    found = _nodeIndex.dbId(snapshot, nodeId, dbNodeId);
 
     return true;
 }
@@ -1825,18 +1762,15 @@ bool SyncDb::dbId(ReplicaSide snapshot, const NodeId &nodeId, DbNodeId &dbNodeId
 bool SyncDb::id(ReplicaSide snapshot, DbNodeId dbNodeId, NodeId &nodeId, bool &found) {
     const std::lock_guard<std::mutex> lock(_mutex);
 
-    ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
-    ASSERT(queryBindValue(SELECT_NODE_BY_NODEID_LITE_ID, 1, dbNodeId));
-    if (!queryNext(SELECT_NODE_BY_NODEID_LITE_ID, found)) {
-        LOG_WARN(_logger, "Error getting query result: " << SELECT_NODE_BY_NODEID_LITE_ID
-                                                         << " - nodeId=" << std::to_string(dbNodeId).c_str());
+    if (!loadNodeIndex()) {
         return false;
     }
-    if (!found) {
-        return true;
+
+    std::optional<NodeId> nodeIdTmp;
+    found = _nodeIndex.id(snapshot, dbNodeId, nodeIdTmp);
+    if (found) {
+        nodeId = nodeIdTmp.value_or(NodeId());
     }
-    ASSERT(queryStringValue(SELECT_NODE_BY_NODEID_LITE_ID, (snapshot == ReplicaSide::ReplicaSideLocal ? 3 : 4), nodeId));
-    ASSERT(queryResetAndClearBindings(SELECT_NODE_BY_NODEID_LITE_ID));
 
     return true;
 }
@@ -1994,6 +1928,130 @@ bool SyncDb::deleteAllUploadSessionToken() {
     return true;
 }
 
+bool SyncDb::insertUploadSessionInfo(const UploadSessionInfo &uploadSessionInfo) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    int errId;
+    std::string error;
+
+    ASSERT(queryResetAndClearBindings(INSERT_UPLOAD_SESSION_REQUEST_ID));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_REQUEST_ID, 1, uploadSessionInfo.tokenDbId()));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_REQUEST_ID, 2, uploadSessionInfo.filePath().native()));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_REQUEST_ID, 3, uploadSessionInfo.fileName()));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_REQUEST_ID, 4, uploadSessionInfo.remoteParentDirId()));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_REQUEST_ID, 5, uploadSessionInfo.size()));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_REQUEST_ID, 6, uploadSessionInfo.modtime()));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_REQUEST_ID, 7, uploadSessionInfo.chunkSize()));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_REQUEST_ID, 8, uploadSessionInfo.totalChunks()));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_REQUEST_ID, 9, uploadSessionInfo.creationTime()));
+    if (!queryExec(INSERT_UPLOAD_SESSION_REQUEST_ID, errId, error)) {
+        LOG_WARN(_logger, "Error running query: " << INSERT_UPLOAD_SESSION_REQUEST_ID);
+        return false;
+    }
+
+    return true;
+}
+
+bool SyncDb::insertUploadSessionChunk(int64_t tokenDbId, int64_t chunkNb, const std::string &hash) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    int errId;
+    std::string error;
+
+    ASSERT(queryResetAndClearBindings(INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID, 1, tokenDbId));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID, 2, chunkNb));
+    ASSERT(queryBindValue(INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID, 3, hash));
+    if (!queryExec(INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID, errId, error)) {
+        LOG_WARN(_logger, "Error running query: " << INSERT_UPLOAD_SESSION_CHUNK_REQUEST_ID);
+        return false;
+    }
+
+    return true;
+}
+
+bool SyncDb::selectUploadSessionInfo(const SyncPath &filePath, UploadSessionInfo &uploadSessionInfo, bool &found) {
+    int64_t tokenDbId;
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+
+        ASSERT(queryResetAndClearBindings(SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID));
+        ASSERT(queryBindValue(SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID, 1, filePath.native()));
+        if (!queryNext(SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID, found)) {
+            LOG_WARN(_logger, "Error getting query result: " << SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID);
+            return false;
+        }
+        if (!found) {
+            return true;
+        }
+
+        ASSERT(queryInt64Value(SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID, 0, tokenDbId));
+        ASSERT(queryResetAndClearBindings(SELECT_UPLOAD_SESSION_BY_PATH_REQUEST_ID));
+    }
+
+    return selectUploadSessionInfo(tokenDbId, uploadSessionInfo, found);
+}
+
+bool SyncDb::selectUploadSessionInfo(int64_t tokenDbId, UploadSessionInfo &uploadSessionInfo, bool &found) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    ASSERT(queryResetAndClearBindings(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID));
+    ASSERT(queryBindValue(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, 1, tokenDbId));
+    if (!queryNext(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, found)) {
+        LOG_WARN(_logger, "Error getting query result: " << SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID);
+        return false;
+    }
+    if (!found) {
+        return true;
+    }
+
+    std::string token;
+    ASSERT(queryStringValue(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, 0, token));
+    SyncName filePath;
+    ASSERT(querySyncNameValue(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, 1, filePath));
+    SyncName fileName;
+    ASSERT(querySyncNameValue(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, 2, fileName));
+    std::string remoteParentDirId;
+    ASSERT(queryStringValue(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, 3, remoteParentDirId));
+    int64_t size;
+    ASSERT(queryInt64Value(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, 4, size));
+    int64_t modtime;
+    ASSERT(queryInt64Value(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, 5, modtime));
+    int64_t chunkSize;
+    ASSERT(queryInt64Value(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, 6, chunkSize));
+    int64_t totalChunks;
+    ASSERT(queryInt64Value(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, 7, totalChunks));
+    int64_t creationTime;
+    ASSERT(queryInt64Value(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID, 8, creationTime));
+    ASSERT(queryResetAndClearBindings(SELECT_UPLOAD_SESSION_BY_TOKEN_DBID_REQUEST_ID));
+
+    uploadSessionInfo = UploadSessionInfo(tokenDbId, filePath, fileName, remoteParentDirId, size, modtime, chunkSize,
+                                          totalChunks, creationTime);
+    uploadSessionInfo.setToken(token);
+
+    ASSERT(queryResetAndClearBindings(SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID));
+    ASSERT(queryBindValue(SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID, 1, tokenDbId));
+    for (;;) {
+        bool chunkFound;
+        if (!queryNext(SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID, chunkFound)) {
+            LOG_WARN(_logger, "Error getting query result: " << SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID);
+            return false;
+        }
+        if (!chunkFound) {
+            break;
+        }
+
+        int64_t chunkNb;
+        ASSERT(queryInt64Value(SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID, 0, chunkNb));
+        std::string hash;
+        ASSERT(queryStringValue(SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID, 1, hash));
+        uploadSessionInfo.setChunkHash(chunkNb, hash);
+    }
+    ASSERT(queryResetAndClearBindings(SELECT_UPLOAD_SESSION_CHUNK_REQUEST_ID));
+
+    return true;
+}
+
 bool SyncDb::setTargetNodeId(const std::string &targetNodeId, bool &found) {
     // Update root node
     _rootNode.setNodeIdRemote(targetNodeId);
@@ -2227,6 +2285,106 @@ bool SyncDb::selectAllRenamedNodes(std::vector<DbNode> &dbNodeList, bool onlyCol
     return true;
 }
 
+bool SyncDb::selectNodes(DbNodeId afterDbNodeId, int limit, std::vector<DbNode> &dbNodeList) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    const QueryHandle query = queryHandle(SELECT_NODES_PAGE_REQUEST_ID);
+
+    dbNodeList.clear();
+
+    ASSERT(queryResetAndClearBindings(query));
+    ASSERT(queryBindValue(query, 1, afterDbNodeId));
+    ASSERT(queryBindValue(query, 2, limit));
+
+    bool found;
+    for (;;) {
+        if (!queryNext(query, found)) {
+            LOG_WARN(_logger, "Error getting query result: " << SELECT_NODES_PAGE_REQUEST_ID);
+            return false;
+        }
+        if (!found) {
+            break;
+        }
+
+        DbNode &dbNode = dbNodeList.emplace_back();
+
+        DbNodeId dbNodeId;
+        ASSERT(queryInt64Value(query, 0, dbNodeId));
+        dbNode.setNodeId(dbNodeId);
+
+        bool isNull;
+        ASSERT(queryIsNullValue(query, 1, isNull));
+        if (isNull) {
+            dbNode.setParentNodeId(std::nullopt);
+        } else {
+            DbNodeId parentNodeId;
+            ASSERT(queryInt64Value(query, 1, parentNodeId));
+            dbNode.setParentNodeId(parentNodeId);
+        }
+
+        SyncName name;
+        ASSERT(querySyncNameValue(query, 2, name));
+        dbNode.setNameLocal(name);
+        ASSERT(querySyncNameValue(query, 3, name));
+        dbNode.setNameRemote(name);
+
+        for (int index : {4, 5}) {
+            std::optional<NodeId> nodeId;
+            ASSERT(queryIsNullValue(query, index, isNull));
+            if (!isNull) {
+                NodeId nodeIdTmp;
+                ASSERT(queryStringValue(query, index, nodeIdTmp));
+                nodeId = nodeIdTmp;
+            }
+            if (index == 4) {
+                dbNode.setNodeIdLocal(nodeId);
+            } else {
+                dbNode.setNodeIdRemote(nodeId);
+            }
+        }
+
+        std::optional<SyncTime> times[3];
+        for (int index = 6; index <= 8; index++) {
+            ASSERT(queryIsNullValue(query, index, isNull));
+            if (!isNull) {
+                SyncTime timeTmp;
+                ASSERT(queryInt64Value(query, index, timeTmp));
+                times[index - 6] = timeTmp;
+            }
+        }
+        dbNode.setCreated(times[0]);
+        dbNode.setLastModifiedLocal(times[1]);
+        dbNode.setLastModifiedRemote(times[2]);
+
+        int intResult;
+        ASSERT(queryIntValue(query, 9, intResult));
+        dbNode.setType(static_cast<NodeType>(intResult));
+
+        int64_t size;
+        ASSERT(queryInt64Value(query, 10, size));
+        dbNode.setSize(size);
+
+        std::optional<std::string> cs;
+        ASSERT(queryIsNullValue(query, 11, isNull));
+        if (!isNull) {
+            std::string csTmp;
+            ASSERT(queryStringValue(query, 11, csTmp));
+            cs = csTmp;
+        }
+        dbNode.setChecksum(cs);
+
+        ASSERT(queryIntValue(query, 12, intResult));
+        dbNode.setStatus(static_cast<SyncFileStatus>(intResult));
+
+        ASSERT(queryIntValue(query, 13, intResult));
+        dbNode.setSyncing(static_cast<bool>(intResult));
+    }
+
+    ASSERT(queryResetAndClearBindings(query));
+
+    return true;
+}
+
 bool SyncDb::deleteNodesWithNullParentNodeId() {
     const std::lock_guard<std::mutex> lock(_mutex);
 
@@ -2239,6 +2397,10 @@ bool SyncDb::deleteNodesWithNullParentNodeId() {
         return false;
     }
 
+    if (_nodeIndexLoaded) {
+        _nodeIndex.removeOrphans(1);
+    }
+
     return true;
 }
 
@@ -2283,4 +2445,150 @@ bool SyncDb::pushChildDbIds(DbNodeId parentNodeDbId, std::unordered_set<DbNodeId
     return true;
 }
 
+bool SyncDb::insertCachedChecksum(uint64_t inode, int64_t size, SyncTime modtime, SyncTime creationTime,
+                                  const std::string &checksum) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    const QueryHandle query = queryHandle(INSERT_CHECKSUM_CACHE_REQUEST_ID);
+
+    int errId;
+    std::string error;
+
+    ASSERT(queryResetAndClearBindings(query));
+    ASSERT(queryBindValue(query, 1, static_cast<int64_t>(inode)));
+    ASSERT(queryBindValue(query, 2, size));
+    ASSERT(queryBindValue(query, 3, modtime));
+    ASSERT(queryBindValue(query, 4, creationTime));
+    ASSERT(queryBindValue(query, 5, checksum));
+    if (!queryExec(query, errId, error)) {
+        LOG_WARN(_logger, "Error running query: " << INSERT_CHECKSUM_CACHE_REQUEST_ID);
+        return false;
+    }
+
+    return true;
+}
+
+bool SyncDb::selectCachedChecksum(uint64_t inode, int64_t size, SyncTime modtime, SyncTime creationTime, std::string &checksum,
+                                  bool &found) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    const QueryHandle query = queryHandle(SELECT_CHECKSUM_CACHE_REQUEST_ID);
+
+    ASSERT(queryResetAndClearBindings(query));
+    ASSERT(queryBindValue(query, 1, static_cast<int64_t>(inode)));
+    ASSERT(queryBindValue(query, 2, size));
+    ASSERT(queryBindValue(query, 3, modtime));
+    ASSERT(queryBindValue(query, 4, creationTime));
+    if (!queryNext(query, found)) {
+        LOG_WARN(_logger, "Error getting query result: " << SELECT_CHECKSUM_CACHE_REQUEST_ID);
+        return false;
+    }
+    if (found) {
+        ASSERT(queryStringValue(query, 0, checksum));
+    }
+    ASSERT(queryResetAndClearBindings(query));
+
+    return true;
+}
+
+bool SyncDb::deleteOrphanCachedChecksums(int &nbDeleted) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    int errId;
+    std::string error;
+
+    ASSERT(queryResetAndClearBindings(DELETE_ORPHAN_CHECKSUM_CACHE_REQUEST_ID));
+    if (!queryExec(DELETE_ORPHAN_CHECKSUM_CACHE_REQUEST_ID, errId, error)) {
+        LOG_WARN(_logger, "Error running query: " << DELETE_ORPHAN_CHECKSUM_CACHE_REQUEST_ID);
+        return false;
+    }
+    nbDeleted = numRowsAffected();
+
+    return true;
+}
+
+void SyncDb::transactionRolledBack() {
+    // Reloaded on next use
+    _nodeIndexLoaded = false;
+}
+
+bool SyncDb::loadNodeIndex() {
+    if (_nodeIndexLoaded) {
+        return true;
+    }
+
+    _nodeIndex.clear();
+    const QueryHandle query = queryHandle(SELECT_ALL_NODES_LITE_REQUEST_ID);
+
+    ASSERT(queryResetAndClearBindings(query));
+
+    bool found;
+    for (;;) {
+        if (!queryNext(query, found)) {
+            LOG_WARN(_logger, "Error getting query result: " << SELECT_ALL_NODES_LITE_REQUEST_ID);
+            return false;
+        }
+        if (!found) {
+            break;
+        }
+
+        DbNodeId dbNodeId;
+        ASSERT(queryInt64Value(query, 0, dbNodeId));
+
+        bool isNull;
+        std::optional<DbNodeId> parentNodeDbId;
+        ASSERT(queryIsNullValue(query, 1, isNull));
+        if (!isNull) {
+            DbNodeId parentNodeDbIdTmp;
+            ASSERT(queryInt64Value(query, 1, parentNodeDbIdTmp));
+            parentNodeDbId = parentNodeDbIdTmp;
+        }
+
+        SyncName nameLocal;
+        ASSERT(querySyncNameValue(query, 2, nameLocal));
+        SyncName nameRemote;
+        ASSERT(querySyncNameValue(query, 3, nameRemote));
+
+        std::optional<NodeId> nodeIds[2];
+        for (int index = 0; index < 2; index++) {
+            ASSERT(queryIsNullValue(query, 4 + index, isNull));
+            if (!isNull) {
+                NodeId nodeIdTmp;
+                ASSERT(queryStringValue(query, 4 + index, nodeIdTmp));
+                nodeIds[index] = nodeIdTmp;
+            }
+        }
+
+        _nodeIndex.set(dbNodeId, parentNodeDbId, nameLocal, nameRemote, nodeIds[0], nodeIds[1]);
+    }
+    ASSERT(queryResetAndClearBindings(query));
+
+    _nodeIndexLoaded = true;
+    LOG_DEBUG(_logger, "Node index loaded with " << _nodeIndex.size() << " nodes");
+
+    return true;
+}
+
+bool SyncDb::indexedDbId(ReplicaSide side, const SyncPath &path, DbNodeId &dbNodeId) const {
+    // Split path
+    std::vector<SyncName> names;
+    SyncPath pathTmp(path);
+    while (pathTmp != pathTmp.root_path()) {
+        names.push_back(pathTmp.filename().native());
+        pathTmp = pathTmp.parent_path();
+    }
+
+    if (!_nodeIndex.rootDbId(dbNodeId)) {
+        return false;
+    }
+
+    for (auto nameIt = names.rbegin(); nameIt != names.rend(); ++nameIt) {
+        if (!_nodeIndex.childDbId(side, dbNodeId, Utility::normalizedSyncName(*nameIt), dbNodeId)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 }  // namespace KDC
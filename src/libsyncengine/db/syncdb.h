@@ -19,9 +19,11 @@
 #pragma once
 
 #include "dbnode.h"
+#include "dbnodeindex.h"
 #include "libcommon/utility/types.h"
 #include "libcommonserver/db/db.h"
 #include "db/uploadsessiontoken.h"
+#include "uploadsessioninfo.h"
 
 #include <log4cplus/loggingmacros.h>
 
@@ -87,6 +89,10 @@ class SyncDb : public Db {
         bool selectAllSyncNodes(SyncNodeType type, std::unordered_set<NodeId> &nodeIdSet);
 
         bool selectAllRenamedNodes(std::vector<DbNode> &dbNodeList, bool onlyColon);
+        /** Reads the nodes by ascending DB ID, at most `limit` at a time.
+         * Pass the DB ID of the last node read to get the next ones. The whole table is scanned once, without a query per node.
+         */
+        bool selectNodes(DbNodeId afterDbNodeId, int limit, std::vector<DbNode> &dbNodeList);
         bool deleteNodesWithNullParentNodeId();
 
         bool insertUploadSessionToken(const UploadSessionToken &uploadSessionToken, int64_t &uploadSessionTokenDbId);
@@ -94,17 +100,46 @@ class SyncDb : public Db {
         bool selectAllUploadSessionTokens(std::vector<UploadSessionToken> &uploadSessionTokenList);
         bool deleteAllUploadSessionToken();
 
+        /** The info of an upload session is deleted with its token.
+         */
+        bool insertUploadSessionInfo(const UploadSessionInfo &uploadSessionInfo);
+        bool insertUploadSessionChunk(int64_t tokenDbId, int64_t chunkNb, const std::string &hash);
+        bool selectUploadSessionInfo(int64_t tokenDbId, UploadSessionInfo &uploadSessionInfo, bool &found);
+        bool selectUploadSessionInfo(const SyncPath &filePath, UploadSessionInfo &uploadSessionInfo, bool &found);
+
+        /** Content checksums of local files, valid as long as the file keeps the same inode, size, modtime and creation time
+         * (status change time on Linux).
+         */
+        bool insertCachedChecksum(uint64_t inode, int64_t size, SyncTime modtime, SyncTime creationTime,
+                                  const std::string &checksum);
+        bool selectCachedChecksum(uint64_t inode, int64_t size, SyncTime modtime, SyncTime creationTime, std::string &checksum,
+                                  bool &found);
+        /** Deletes the cached checksums whose inode is not the local ID of a node anymore. */
+        bool deleteOrphanCachedChecksums(int &nbDeleted);
+
         static DbNode driveRootNode() { return _driveRootNode; }
         DbNode rootNode() { return _rootNode; }
 
         bool setTargetNodeId(const std::string &targetNodeId, bool &found);
 
+    protected:
+        void transactionRolledBack() override;
+
     private:
         static DbNode _driveRootNode;
         DbNode _rootNode;
 
+        // Write-through copy of the node tree, loaded on first use and guarded by _mutex
+        DbNodeIndex _nodeIndex;
+        bool _nodeIndexLoaded = false;
+
+        bool loadNodeIndex();
+        bool indexedDbId(ReplicaSide side, const SyncPath &path, DbNodeId &dbNodeId) const;
+
         bool pushChildIds(ReplicaSide snapshot, DbNodeId parentNodeDbId, std::vector<NodeId> &ids);
         bool pushChildIds(ReplicaSide snapshot, DbNodeId parentNodeDbId, std::unordered_set<NodeId> &ids);
+        bool createUploadSessionTables();
+        bool createChecksumCacheTable();
 };
 
 }  // namespace KDC
@@ -0,0 +1,36 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "uploadsessioninfo.h"
+
+namespace KDC {
+
+UploadSessionInfo::UploadSessionInfo(int64_t tokenDbId, const SyncPath &filePath, const SyncName &fileName,
+                                     const NodeId &remoteParentDirId, int64_t size, SyncTime modtime, int64_t chunkSize,
+                                     int64_t totalChunks, SyncTime creationTime)
+    : _tokenDbId(tokenDbId),
+      _filePath(filePath),
+      _fileName(fileName),
+      _remoteParentDirId(remoteParentDirId),
+      _size(size),
+      _modtime(modtime),
+      _chunkSize(chunkSize),
+      _totalChunks(totalChunks),
+      _creationTime(creationTime) {}
+
+}  // namespace KDC
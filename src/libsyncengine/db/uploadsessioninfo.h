@@ -0,0 +1,69 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "libcommon/utility/types.h"
+
+#include <map>
+#include <string>
+
+namespace KDC {
+
+/**
+ * What is needed to resume an upload session: the file it uploads and the chunks already uploaded, with their hash.
+ */
+class UploadSessionInfo {
+    public:
+        UploadSessionInfo() = default;
+        UploadSessionInfo(int64_t tokenDbId, const SyncPath &filePath, const SyncName &fileName, const NodeId &remoteParentDirId,
+                          int64_t size, SyncTime modtime, int64_t chunkSize, int64_t totalChunks, SyncTime creationTime);
+
+        inline int64_t tokenDbId() const { return _tokenDbId; }
+        inline void setTokenDbId(int64_t tokenDbId) { _tokenDbId = tokenDbId; }
+        inline const std::string &token() const { return _token; }
+        inline void setToken(const std::string &token) { _token = token; }
+        inline const SyncPath &filePath() const { return _filePath; }
+        inline const SyncName &fileName() const { return _fileName; }
+        inline const NodeId &remoteParentDirId() const { return _remoteParentDirId; }
+        inline int64_t size() const { return _size; }
+        inline SyncTime modtime() const { return _modtime; }
+        inline int64_t chunkSize() const { return _chunkSize; }
+        inline int64_t totalChunks() const { return _totalChunks; }
+        inline SyncTime creationTime() const { return _creationTime; }
+
+        /** Hash of each uploaded chunk, by chunk number.
+         */
+        inline const std::map<int64_t, std::string> &chunkHashes() const { return _chunkHashes; }
+        inline void setChunkHash(int64_t chunkNb, const std::string &hash) { _chunkHashes[chunkNb] = hash; }
+
+    private:
+        int64_t _tokenDbId = 0;
+        std::string _token;
+        SyncPath _filePath;
+        SyncName _fileName;
+        NodeId _remoteParentDirId;
+        int64_t _size = 0;
+        SyncTime _modtime = 0;
+        int64_t _chunkSize = 0;
+        int64_t _totalChunks = 0;
+        SyncTime _creationTime = 0;
+        std::map<int64_t, std::string> _chunkHashes;
+};
+
+}  // namespace KDC
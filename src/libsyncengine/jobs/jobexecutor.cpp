@@ -0,0 +1,245 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jobexecutor.h"
+#include "log/log.h"
+
+#include <algorithm>
+
+#include <log4cplus/loggingmacros.h>
+
+namespace KDC {
+
+JobExecutor::JobExecutor(const std::array<int, JobLaneEnd> &nbWorkers) {
+    for (int laneIndex = 0; laneIndex < JobLaneEnd; laneIndex++) {
+        Lane &lane = _lanes[laneIndex];
+        const int laneNbWorkers = std::max(1, nbWorkers[laneIndex]);
+        lane.maxConcurrency = laneNbWorkers;
+        for (int workerIndex = 0; workerIndex < laneNbWorkers; workerIndex++) {
+            lane.workers.push_back(std::make_unique<Worker>());
+        }
+    }
+
+    // Start the threads once all the deques exist, since workers steal from each other
+    for (int laneIndex = 0; laneIndex < JobLaneEnd; laneIndex++) {
+        Lane &lane = _lanes[laneIndex];
+        for (size_t workerIndex = 0; workerIndex < lane.workers.size(); workerIndex++) {
+            lane.workers[workerIndex]->thread =
+                std::thread(&JobExecutor::runWorker, this, static_cast<JobLane>(laneIndex), workerIndex);
+        }
+    }
+}
+
+JobExecutor::~JobExecutor() {
+    stop();
+}
+
+void JobExecutor::stop() {
+    _stop = true;
+    for (Lane &lane : _lanes) {
+        {
+            const std::lock_guard<std::mutex> lock(lane.mutex);
+            for (auto &worker : lane.workers) {
+                worker->wakeUp.notify_one();
+            }
+        }
+        for (auto &worker : lane.workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+}
+
+bool JobExecutor::available(JobLane lane) const {
+    const Lane &laneRef = _lanes[lane];
+    return laneRef.nbRunning + laneRef.nbQueued < laneRef.maxConcurrency;
+}
+
+void JobExecutor::submit(JobLane lane, Poco::Runnable &runnable,
+                         Poco::Thread::Priority priority /*= Poco::Thread::PRIO_NORMAL*/) {
+    Lane &laneRef = _lanes[lane];
+
+    // Spread the tasks over the active workers, idle ones steal what the busy ones cannot start
+    const size_t workerIndex = laneRef.nextWorker++ % static_cast<uint32_t>(laneRef.maxConcurrency);
+    Worker &worker = *laneRef.workers[workerIndex];
+    {
+        const std::lock_guard<std::mutex> lock(worker.mutex);
+        // After the tasks of the same or higher priority
+        const auto it = std::find_if(worker.tasks.begin(), worker.tasks.end(),
+                                     [priority](const Task &task) { return task.priority < priority; });
+        worker.tasks.insert(it, Task{&runnable, priority, std::chrono::steady_clock::now()});
+        worker.frontPriority = worker.tasks.front().priority;
+        laneRef.nbQueued++;
+    }
+
+    // A worker going to sleep checks nbQueued with the lock held, so it either sees the task or gets notified
+    const std::lock_guard<std::mutex> lock(laneRef.mutex);
+    wakeUpIdleWorker(laneRef, workerIndex);
+}
+
+int JobExecutor::nbWorkers(JobLane lane) const {
+    return static_cast<int>(_lanes[lane].workers.size());
+}
+
+int JobExecutor::maxConcurrency(JobLane lane) const {
+    return _lanes[lane].maxConcurrency;
+}
+
+void JobExecutor::setMaxConcurrency(JobLane lane, int maxConcurrency) {
+    Lane &laneRef = _lanes[lane];
+    const std::lock_guard<std::mutex> lock(laneRef.mutex);
+    laneRef.maxConcurrency = std::clamp(maxConcurrency, 1, nbWorkers(lane));
+    // The activated workers take the queued tasks, the deactivated ones stop taking tasks
+    for (auto &worker : laneRef.workers) {
+        worker->wakeUp.notify_one();
+    }
+}
+
+JobExecutor::LaneStats JobExecutor::laneStats(JobLane lane) const {
+    const Lane &laneRef = _lanes[lane];
+    LaneStats stats;
+    stats.nbWorkers = nbWorkers(lane);
+    stats.maxConcurrency = laneRef.maxConcurrency;
+    stats.queueDepth = std::max<int64_t>(laneRef.nbQueued, 0);
+    stats.nbRunning = laneRef.nbRunning;
+    stats.nbCompleted = laneRef.nbCompleted;
+    stats.nbStolen = laneRef.nbStolen;
+    stats.totalQueueLatencyUs = laneRef.totalQueueLatencyUs;
+    stats.maxQueueLatencyUs = laneRef.maxQueueLatencyUs;
+    return stats;
+}
+
+std::string JobExecutor::laneName(JobLane lane) {
+    switch (lane) {
+        case JobLaneNetwork:
+            return "network";
+        case JobLaneDiskCpu:
+            return "disk-cpu";
+        case JobLaneControl:
+            return "control";
+        default:
+            return "unknown";
+    }
+}
+
+void JobExecutor::runWorker(JobLane laneIndex, size_t workerIndex) {
+    Lane &lane = _lanes[laneIndex];
+    Worker &worker = *lane.workers[workerIndex];
+    while (!_stop) {
+        Task task;
+        if (static_cast<int>(workerIndex) >= lane.maxConcurrency || !takeTask(lane, workerIndex, task)) {
+            std::unique_lock<std::mutex> lock(lane.mutex);
+            while (!_stop && (static_cast<int>(workerIndex) >= lane.maxConcurrency || lane.nbQueued == 0)) {
+                worker.isIdle = true;
+                worker.wakeUp.wait(lock);
+            }
+            worker.isIdle = false;
+            // Another worker may take the task first, then try again
+            continue;
+        }
+
+        const auto latencyUs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - task.queuedAt).count());
+        lane.totalQueueLatencyUs += latencyUs;
+        uint64_t maxLatencyUs = lane.maxQueueLatencyUs;
+        while (latencyUs > maxLatencyUs && !lane.maxQueueLatencyUs.compare_exchange_weak(maxLatencyUs, latencyUs)) {
+        }
+
+        try {
+            task.runnable->run();
+        } catch (...) {
+            LOG_WARN(Log::instance()->getLogger(), "Unhandled exception in job executor, lane " << laneName(laneIndex).c_str());
+        }
+        // Do not use task.runnable anymore: the job may have been destroyed by its callback
+
+        lane.nbRunning--;
+        lane.nbCompleted++;
+        if (_taskFinishedCallback) {
+            _taskFinishedCallback(laneIndex);
+        }
+    }
+}
+
+void JobExecutor::wakeUpIdleWorker(Lane &lane, size_t preferredWorkerIndex) {
+    const size_t nbActiveWorkers = static_cast<size_t>(lane.maxConcurrency);
+    for (size_t i = 0; i < nbActiveWorkers; i++) {
+        Worker &worker = *lane.workers[(preferredWorkerIndex + i) % nbActiveWorkers];
+        if (worker.isIdle) {
+            // Not idle anymore for the next submissions, even before it actually wakes up
+            worker.isIdle = false;
+            worker.wakeUp.notify_one();
+            return;
+        }
+    }
+    // All the active workers are busy, the first one to finish its task will take this one
+}
+
+bool JobExecutor::takeTask(Lane &lane, size_t workerIndex, Task &task) {
+    // Steal only a task of higher priority than the own ones, or any task if there is no own one
+    const size_t nbLaneWorkers = lane.workers.size();
+    size_t bestIndex = workerIndex;
+    int bestPriority = lane.workers[workerIndex]->frontPriority;
+    for (size_t i = 1; i < nbLaneWorkers; i++) {
+        const size_t victimIndex = (workerIndex + i) % nbLaneWorkers;
+        const int priority = lane.workers[victimIndex]->frontPriority;
+        if (priority > bestPriority) {
+            bestIndex = victimIndex;
+            bestPriority = priority;
+        }
+    }
+    if (bestPriority == noTask) {
+        return false;
+    }
+
+    if (popTask(lane, *lane.workers[bestIndex], task)) {
+        if (bestIndex != workerIndex) {
+            lane.nbStolen++;
+        }
+        return true;
+    }
+
+    // The deque has been emptied in the meantime
+    for (size_t i = 0; i < nbLaneWorkers; i++) {
+        const size_t victimIndex = (workerIndex + i) % nbLaneWorkers;
+        if (popTask(lane, *lane.workers[victimIndex], task)) {
+            if (victimIndex != workerIndex) {
+                lane.nbStolen++;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobExecutor::popTask(Lane &lane, Worker &worker, Task &task) {
+    const std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+
+    // The deque is sorted: the first task has the highest priority and is the oldest of its priority
+    task = worker.tasks.front();
+    worker.tasks.pop_front();
+    worker.frontPriority = worker.tasks.empty() ? noTask : worker.tasks.front().priority;
+    lane.nbQueued--;
+    lane.nbRunning++;
+    return true;
+}
+
+}  // namespace KDC
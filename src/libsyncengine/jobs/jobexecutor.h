@@ -0,0 +1,141 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace KDC {
+
+/**
+ * Kinds of work that must not starve each other.
+ */
+typedef enum {
+    JobLaneNetwork = 0,  // File transfers and remote operations
+    JobLaneDiskCpu,      // Local file system operations
+    JobLaneControl,      // Long poll, listings and internal jobs
+    JobLaneEnd
+} JobLane;
+
+/**
+ * Executes runnables on separate lanes of worker threads.
+ * Each worker owns a deque of tasks, sorted by priority. It takes its own tasks first and steals from the other workers of its
+ * lane when they have a task of higher priority or when it has none left. A submitted task wakes up a single worker: its owner
+ * if idle, otherwise another idle worker that will steal it.
+ * The number of workers allowed to take tasks (the concurrency) can be changed at any time.
+ */
+class JobExecutor {
+    public:
+        struct LaneStats {
+                int nbWorkers = 0;
+                int maxConcurrency = 0;
+                int64_t queueDepth = 0;
+                int64_t nbRunning = 0;
+                uint64_t nbCompleted = 0;
+                uint64_t nbStolen = 0;
+                uint64_t totalQueueLatencyUs = 0;  // Time spent by the completed tasks between submission and start
+                uint64_t maxQueueLatencyUs = 0;
+        };
+
+        explicit JobExecutor(const std::array<int, JobLaneEnd> &nbWorkers);
+        ~JobExecutor();
+
+        /** Called by a worker once a runnable has returned, i.e. when the lane has one more free slot.
+         * Must be set before the first submission.
+         */
+        inline void setTaskFinishedCallback(const std::function<void(JobLane)> &callback) { _taskFinishedCallback = callback; }
+
+        /** Waits for the running tasks to complete and stops the workers. Queued tasks are dropped.
+         */
+        void stop();
+
+        /** @return true if a task submitted now would start without waiting.
+         */
+        bool available(JobLane lane) const;
+        /** Tasks of higher priority are started first, tasks of the same priority in submission order.
+         */
+        void submit(JobLane lane, Poco::Runnable &runnable, Poco::Thread::Priority priority = Poco::Thread::PRIO_NORMAL);
+
+        int nbWorkers(JobLane lane) const;
+        int maxConcurrency(JobLane lane) const;
+        /** Sets the number of workers of a lane allowed to take tasks, between 1 and the number of workers.
+         */
+        void setMaxConcurrency(JobLane lane, int maxConcurrency);
+
+        LaneStats laneStats(JobLane lane) const;
+        static std::string laneName(JobLane lane);
+
+    private:
+        struct Task {
+                Poco::Runnable *runnable = nullptr;
+                Poco::Thread::Priority priority = Poco::Thread::PRIO_NORMAL;
+                std::chrono::steady_clock::time_point queuedAt;
+        };
+
+        static constexpr int noTask = -1;
+
+        struct Worker {
+                std::mutex mutex;  // Guards the tasks
+                std::deque<Task> tasks;
+                std::atomic<int> frontPriority = noTask;  // Priority of the first task, read without the mutex to pick a victim
+                std::thread thread;
+                std::condition_variable wakeUp;
+                bool isIdle = false;  // Waiting for a task, guarded by the mutex of the lane
+        };
+
+        struct Lane {
+                std::vector<std::unique_ptr<Worker>> workers;
+                std::mutex mutex;  // Only held to put a worker to sleep or to wake it up
+                std::atomic<int> maxConcurrency = 0;
+                std::atomic<uint32_t> nextWorker = 0;
+                std::atomic<int64_t> nbQueued = 0;  // Tasks in the deques of all the workers
+                std::atomic<int64_t> nbRunning = 0;
+                std::atomic<uint64_t> nbCompleted = 0;
+                std::atomic<uint64_t> nbStolen = 0;
+                std::atomic<uint64_t> totalQueueLatencyUs = 0;
+                std::atomic<uint64_t> maxQueueLatencyUs = 0;
+        };
+
+        void runWorker(JobLane laneIndex, size_t workerIndex);
+        /** Pops a task from the deque of the worker, or steals one from another worker of the lane.
+         * Only locks the mutex of one worker at a time.
+         */
+        bool takeTask(Lane &lane, size_t workerIndex, Task &task);
+        bool popTask(Lane &lane, Worker &worker, Task &task);
+        // Called with the mutex of the lane held
+        void wakeUpIdleWorker(Lane &lane, size_t preferredWorkerIndex);
+
+        std::array<Lane, JobLaneEnd> _lanes;
+        std::atomic<bool> _stop = false;
+        std::function<void(JobLane)> _taskFinishedCallback = nullptr;
+};
+
+}  // namespace KDC
@@ -20,22 +20,32 @@
 #include "jobs/network/networkjobsparams.h"
 #include "log/log.h"
 #include "jobs/network/upload_session/uploadsession.h"
+#include "jobs/network/longpolljob.h"
+#include "jobs/network/csvfullfilelistwithcursorjob.h"
+#include "jobs/network/jsonfullfilelistwithcursorjob.h"
+#include "jobs/network/initfilelistwithcursorjob.h"
+#include "jobs/network/continuefilelistwithcursorjob.h"
+#include "jobs/local/localcopyjob.h"
+#include "jobs/local/localcreatedirjob.h"
+#include "jobs/local/localdeletejob.h"
+#include "jobs/local/localmovejob.h"
 #include "libcommonserver/utility/utility.h"
 #include "performance_watcher/performancewatcher.h"
 #include "requests/parameterscache.h"
 
 #include <thread>
-#include <algorithm>  // std::max
+#include <algorithm>  // std::max, std::clamp
 
 #include <log4cplus/loggingmacros.h>
 
 #include <Poco/Exception.h>
-#include <Poco/ThreadPool.h>
 
 namespace KDC {
 
 const int secondsBetweenCpuCalculation = 10;
 const double cpuThreadsThreshold = 0.5;
+const double cpuHysteresis = 0.1;            // The concurrency grows again once the CPU usage is 10% under the threshold
+const double throughputDropThreshold = 0.8;  // The network concurrency shrinks if the throughput dropped by more than 20%
 
 JobManager *JobManager::_instance = nullptr;
 bool JobManager::_stop = false;
@@ -44,14 +54,20 @@ int JobManager::_maxNbThread = 0;
 double JobManager::_cpuUsageThreshold = 0.5;
 int JobManager::_threadAdjustmentStep = 2;
 std::chrono::time_point<std::chrono::steady_clock> JobManager::_maxNbThreadChrono = std::chrono::steady_clock::now();
+uint64_t JobManager::_lastNbCompletedNetworkJobs = 0;
+uint64_t JobManager::_lastNetworkThroughput = 0;
 
 std::unordered_map<UniqueId, std::shared_ptr<AbstractJob>> JobManager::_managedJobs;
-std::priority_queue<std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority>,
-                    std::vector<std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority>>, JobPriorityCmp>
-    JobManager::_queuedJobs;
-std::unordered_set<UniqueId> JobManager::_runningJobs;
+JobManager::JobQueue JobManager::_queuedJobs;
+std::array<JobManager::JobQueue, JobLaneEnd> JobManager::_queuedJobsByLane;
+std::unordered_map<UniqueId, JobClass> JobManager::_runningJobs;
 std::unordered_map<UniqueId, std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority>> JobManager::_pendingJobs;
+std::unordered_map<UniqueId, std::vector<UniqueId>> JobManager::_pendingJobsByParent;
+std::array<std::queue<UniqueId>, JobClassEnd> JobManager::_pendingJobsByClass;
+std::array<int, JobClassEnd> JobManager::_nbRunningJobsByClass{};
 std::mutex JobManager::_mutex;
+std::condition_variable JobManager::_jobsChanged;
+std::unique_ptr<JobExecutor> JobManager::_executor = nullptr;
 
 JobManager *JobManager::instance() {
     if (!_instance) {
@@ -61,23 +77,31 @@ JobManager *JobManager::instance() {
 }
 
 void JobManager::stop() {
+    const std::lock_guard<std::mutex> lock(_mutex);
     _stop = true;
+    _jobsChanged.notify_all();
 }
 
 void JobManager::clear() {
     if (_instance) {
-        Poco::ThreadPool::defaultPool().stopAll();
         _instance->_thread->join();
         _instance->_thread = nullptr;
+        _executor->stop();
     }
 
     const std::lock_guard<std::mutex> lock(_mutex);
     _pendingJobs.clear();
-    while (!_queuedJobs.empty()) {
-        _queuedJobs.pop();
+    _pendingJobsByParent.clear();
+    for (auto &pendingJobs : _pendingJobsByClass) {
+        pendingJobs = std::queue<UniqueId>();
+    }
+    _queuedJobs = JobQueue();
+    for (auto &queuedJobs : _queuedJobsByLane) {
+        queuedJobs = JobQueue();
     }
     _managedJobs.clear();
     _runningJobs.clear();
+    _nbRunningJobsByClass.fill(0);
 }
 
 void JobManager::queueAsyncJob(std::shared_ptr<AbstractJob> job, Poco::Thread::Priority priority /*= Poco::Thread::PRIO_NORMAL*/,
@@ -95,6 +119,8 @@ void JobManager::queueAsyncJob(std::shared_ptr<AbstractJob> job, Poco::Thread::P
     if (externalCallback) {
         job->setAdditionalCallback(externalCallback);
     }
+
+    _jobsChanged.notify_one();
 }
 
 bool JobManager::isJobFinished(const UniqueId &jobId) {
@@ -114,14 +140,29 @@ std::shared_ptr<AbstractJob> JobManager::getJob(const UniqueId &jobId) {
 void JobManager::defaultCallback(UniqueId jobId) {
     const std::lock_guard<std::mutex> lock(_mutex);
     auto node = _managedJobs.extract(jobId);
-    _runningJobs.erase(jobId);
+
+    JobClass finishedJobClass = JobClassDefault;
+    if (auto runningIt = _runningJobs.find(jobId); runningIt != _runningJobs.end()) {
+        finishedJobClass = runningIt->second;
+        _nbRunningJobsByClass[finishedJobClass]--;
+        _runningJobs.erase(runningIt);
+    }
+
+    releasePendingJobs(jobId, finishedJobClass);
+    _jobsChanged.notify_one();
 }
 
 JobManager::JobManager() : _logger(Log::instance()->getLogger()) {
     int jobPoolCapacityFactor = ParametersCache::instance()->parameters().jobPoolCapacityFactor();
+    const int nbCores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
 
-    _maxNbThread = std::max(threadPoolMinCapacity, jobPoolCapacityFactor * (int)std::thread::hardware_concurrency());
-    Poco::ThreadPool::defaultPool().addCapacity(_maxNbThread - Poco::ThreadPool::defaultPool().capacity());
+    _maxNbThread = std::max(threadPoolMinCapacity, jobPoolCapacityFactor * nbCores);
+    std::array<int, JobLaneEnd> nbWorkers;
+    nbWorkers[JobLaneNetwork] = _maxNbThread;
+    nbWorkers[JobLaneDiskCpu] = std::max(2, nbCores);
+    nbWorkers[JobLaneControl] = std::max(threadPoolMinCapacity, nbCores);
+    _executor = std::make_unique<JobExecutor>(nbWorkers);
+    _executor->setTaskFinishedCallback(laneTaskFinished);
 
     _cpuUsageThreshold = ParametersCache::instance()->parameters().maxAllowedCpu() / 100.0;
 
@@ -130,96 +171,150 @@ JobManager::JobManager() : _logger(Log::instance()->getLogger()) {
 }
 
 void JobManager::run() {
-    while (true) {
-        if (_stop) {
-            break;
-        }
-
-        // Count UploadSessionJobs running
-        int uploadSessionCount = countUploadSession();
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop) {
+        while (!_queuedJobs.empty() && !_stop) {
+            auto jobItem = _queuedJobs.top();
+            const auto &job = jobItem.first;
+            _queuedJobs.pop();
+
+            if (hasUnfinishedParent(job)) {
+                // The job will be queued again by releasePendingJobs when its parent is done
+                _pendingJobs.insert({job->jobId(), jobItem});
+                _pendingJobsByParent[job->parentJobId()].push_back(job->jobId());
+                LOG_DEBUG(Log::instance()->getLogger(),
+                          "Job " << job->jobId() << " is pending (waiting for parent job " << job->parentJobId() << " to complete)");
+                continue;
+            }
 
-        // Count UploadSessionJobs running
-        while (Poco::ThreadPool::defaultPool().available()) {
-            if (_stop) {
-                break;
+            const JobClass nextJobClass = jobClass(job);
+            if (_nbRunningJobsByClass[nextJobClass] >= maxRunningJobs(nextJobClass)) {
+                // The job will be queued again by releasePendingJobs when a job of the same class is done
+                _pendingJobs.insert({job->jobId(), jobItem});
+                _pendingJobsByClass[nextJobClass].push(job->jobId());
+                LOG_DEBUG(Log::instance()->getLogger(),
+                          "Job " << job->jobId() << " is pending (thread pool maximum capacity reached)");
+                continue;
             }
 
-            {
-                const std::lock_guard<std::mutex> lock(_mutex);
-
-                if (_queuedJobs.empty()) {
-                    break;
-                }
-                auto jobItem = _queuedJobs.top();
-                const auto &job = jobItem.first;
-                _queuedJobs.pop();
-
-                if (isParentPendingOrRunning(job->jobId()) ||
-                    (std::dynamic_pointer_cast<UploadSession>(job) &&
-                     uploadSessionCount >= Poco::ThreadPool::defaultPool().capacity() / 10)) {
-                    try {
-                        _pendingJobs.insert({job->jobId(), jobItem});
-                        if (job->hasParentJob()) {
-                            LOG_DEBUG(Log::instance()->getLogger(), "Job " << job->jobId()
-                                                                           << " is pending (waiting for parent job "
-                                                                           << job->parentJobId() << " to complete)");
-                        } else {
-                            LOG_DEBUG(Log::instance()->getLogger(),
-                                      "Job " << job->jobId() << " is pending (thread pool maximum capacity reached)");
-                        }
-                    } catch (std::exception &) {
-                        LOG_WARN(Log::instance()->getLogger(), "Job " << job->jobId() << " insertion in pending queue failed");
-                    }
-                } else {
-                    if (std::dynamic_pointer_cast<UploadSession>(job)) {
-                        uploadSessionCount++;
-                    }
-
-                    startJob(jobItem);
-                }
+            const JobLane lane = jobLane(job);
+            if (!_executor->available(lane)) {
+                // The job will be queued again by laneTaskFinished, jobs of the other lanes are not blocked
+                _queuedJobsByLane[lane].push(jobItem);
+                continue;
             }
 
-            // adjustMaxNbThread();
+            startJob(jobItem, nextJobClass, lane);
         }
 
-        managePendingJobs(uploadSessionCount);
+        // Wake up on queued or finished jobs, and periodically to adapt the concurrency of the lanes
+        _jobsChanged.wait_until(lock, _maxNbThreadChrono + std::chrono::seconds(secondsBetweenCpuCalculation),
+                                [] { return _stop || !_queuedJobs.empty(); });
+        adjustLaneConcurrency();
+    }
+}
+
+void JobManager::startJob(std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority> nextJob, JobClass jobClass,
+                          JobLane lane) {
+    const UniqueId jobId = nextJob.first->jobId();
+    if (nextJob.first->isAborted()) {
+        LOG_DEBUG(Log::instance()->getLogger(), "Job " << jobId << " has been canceled");
+        _managedJobs.erase(jobId);
+        releasePendingJobs(jobId, JobClassEnd);
+        return;
+    }
 
-        if (_queuedJobs.empty()) {
-            Utility::msleep(100);  // Sleep for 0.1s
+    LOG_DEBUG(Log::instance()->getLogger(),
+              "Starting job " << jobId << " with priority " << nextJob.second << " on lane " << JobExecutor::laneName(lane).c_str());
+    // Register the job first: it may finish before submit returns
+    _runningJobs.insert({jobId, jobClass});
+    _nbRunningJobsByClass[jobClass]++;
+    _executor->submit(lane, *nextJob.first, nextJob.second);
+}
+
+void JobManager::laneTaskFinished(JobLane lane) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    if (!_queuedJobsByLane[lane].empty()) {
+        _queuedJobs.push(_queuedJobsByLane[lane].top());
+        _queuedJobsByLane[lane].pop();
+        _jobsChanged.notify_one();
+    }
+}
+
+JobClass JobManager::jobClass(const std::shared_ptr<AbstractJob> &job) {
+    return std::dynamic_pointer_cast<UploadSession>(job) ? JobClassUploadSession : JobClassDefault;
+}
+
+JobLane JobManager::jobLane(const std::shared_ptr<AbstractJob> &job) {
+    if (std::dynamic_pointer_cast<AbstractNetworkJob>(job) || std::dynamic_pointer_cast<UploadSession>(job)) {
+        // Long poll and listings must not wait behind bulk transfers
+        if (std::dynamic_pointer_cast<LongPollJob>(job) || std::dynamic_pointer_cast<CsvFullFileListWithCursorJob>(job) ||
+            std::dynamic_pointer_cast<JsonFullFileListWithCursorJob>(job) ||
+            std::dynamic_pointer_cast<InitFileListWithCursorJob>(job) ||
+            std::dynamic_pointer_cast<ContinueFileListWithCursorJob>(job)) {
+            return JobLaneControl;
         }
+        return JobLaneNetwork;
+    }
+
+    if (std::dynamic_pointer_cast<LocalCopyJob>(job) || std::dynamic_pointer_cast<LocalCreateDirJob>(job) ||
+        std::dynamic_pointer_cast<LocalDeleteJob>(job) || std::dynamic_pointer_cast<LocalMoveJob>(job)) {
+        return JobLaneDiskCpu;
     }
+
+    return JobLaneControl;
 }
 
-void JobManager::startJob(std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority> nextJob) {
-    try {
-        if (nextJob.first->isAborted()) {
-            LOG_DEBUG(Log::instance()->getLogger(), "Job " << nextJob.first->jobId() << " has been canceled");
-            _managedJobs.erase(nextJob.first->jobId());
-        } else {
+int JobManager::maxRunningJobs(JobClass jobClass) {
+    const int capacity = _executor->maxConcurrency(JobLaneNetwork);
+    switch (jobClass) {
+        case JobClassUploadSession:
+            // Each upload session starts its own chunk upload jobs
+            return std::max(1, capacity / 10);
+        default:
+            return capacity;
+    }
+}
+
+bool JobManager::hasUnfinishedParent(const std::shared_ptr<AbstractJob> &job) {
+    return job->hasParentJob() && _managedJobs.find(job->parentJobId()) != _managedJobs.end();
+}
+
+void JobManager::releasePendingJobs(UniqueId finishedJobId, JobClass finishedJobClass) {
+    if (auto childrenIt = _pendingJobsByParent.find(finishedJobId); childrenIt != _pendingJobsByParent.end()) {
+        for (const UniqueId childJobId : childrenIt->second) {
             LOG_DEBUG(Log::instance()->getLogger(),
-                      "Starting job " << nextJob.first->jobId() << " with priority " << nextJob.second);
-            Poco::ThreadPool::defaultPool().startWithPriority(nextJob.second, *nextJob.first);
-            _runningJobs.insert(nextJob.first->jobId());
+                      "Job " << finishedJobId << " has finished, queuing child job " << childJobId << " for execution");
+            queuePendingJob(childJobId);
         }
-    } catch (Poco::NoThreadAvailableException &) {
-        LOG_DEBUG(Log::instance()->getLogger(), "No more thread available, job " << nextJob.first->jobId() << " queued");
-        _queuedJobs.push(nextJob);
-    } catch (std::exception &) {
-        LOG_WARN(Log::instance()->getLogger(), "Job not inserted in running queue.");
+        _pendingJobsByParent.erase(childrenIt);
+    }
+
+    if (finishedJobClass != JobClassEnd && !_pendingJobsByClass[finishedJobClass].empty()) {
+        const UniqueId jobId = _pendingJobsByClass[finishedJobClass].front();
+        _pendingJobsByClass[finishedJobClass].pop();
+        LOG_DEBUG(Log::instance()->getLogger(), "The thread pool has recovered capacity, queuing job " << jobId << " for execution");
+        queuePendingJob(jobId);
     }
 }
 
-bool JobManager::isParentPendingOrRunning(UniqueId jobIb) {
-    if (_managedJobs.find(jobIb) == _managedJobs.end()) {
-        return false;
+void JobManager::queuePendingJob(UniqueId jobId) {
+    auto node = _pendingJobs.extract(jobId);
+    if (node.empty()) {
+        return;
+    }
+
+    if (node.mapped().first->isAborted()) {
+        // The job is aborted, remove it completly from job manager
+        _managedJobs.erase(jobId);
+        releasePendingJobs(jobId, JobClassEnd);
+        return;
     }
 
-    const auto &job = _managedJobs.find(jobIb)->second;
-    return job->hasParentJob() && (_runningJobs.find(job->parentJobId()) != _runningJobs.end() ||
-                                   _pendingJobs.find(job->parentJobId()) != _pendingJobs.end());
+    _queuedJobs.push(node.mapped());
 }
 
-void JobManager::adjustMaxNbThread() {
+void JobManager::adjustLaneConcurrency() {
     auto now = std::chrono::steady_clock::now();
     std::chrono::duration<double> elapsed_seconds = now - _maxNbThreadChrono;
     if (elapsed_seconds.count() < secondsBetweenCpuCalculation) {
@@ -230,67 +325,55 @@ void JobManager::adjustMaxNbThread() {
                              : ParametersCache::instance()->parameters().maxAllowedCpu() / 100.0;
     _maxNbThreadChrono = now;
 
-    double cpuUsage = PerformanceWatcher::instance()->getMovingAverageCpuUsagePercent() / 100.0;
-    int maxTmpNbThread = _maxNbThread;
-
-    if (cpuUsage > _cpuUsageThreshold) {
-        maxTmpNbThread -= _threadAdjustmentStep;
-    } else {
-        maxTmpNbThread += _threadAdjustmentStep;
+    // Between the two thresholds, the concurrency is kept as is so that it does not oscillate around the threshold
+    const double cpuUsage = PerformanceWatcher::instance()->getMovingAverageCpuUsagePercent() / 100.0;
+    const bool cpuOverloaded = cpuUsage > _cpuUsageThreshold;
+    const bool cpuAvailable = cpuUsage < _cpuUsageThreshold - cpuHysteresis;
+
+    // Local operations: back off as soon as the CPU is overloaded, grow while jobs are waiting
+    int diskCpuConcurrency = _executor->maxConcurrency(JobLaneDiskCpu);
+    if (cpuOverloaded) {
+        diskCpuConcurrency--;
+    } else if (cpuAvailable && !_queuedJobsByLane[JobLaneDiskCpu].empty()) {
+        diskCpuConcurrency++;
     }
-
-    maxTmpNbThread = std::max(maxTmpNbThread, threadPoolMinCapacity);
-    int threadMultiplier = _cpuUsageThreshold * 10;
-    _maxNbThread = std::min(maxTmpNbThread, threadMultiplier * static_cast<int>(std::thread::hardware_concurrency()));
-
-    Poco::ThreadPool::defaultPool().addCapacity(_maxNbThread - Poco::ThreadPool::defaultPool().capacity());
-    int pocoThreadCapacity = Poco::ThreadPool::defaultPool().capacity();
-    int pocoThreadAllocated = Poco::ThreadPool::defaultPool().allocated();
-    LOG_INFO(Log::instance()->getLogger(),
-             "With cpu usage : " << cpuUsage * 100 << " % (threshold : " << _cpuUsageThreshold * 100 << " %)");
-    LOG_INFO(Log::instance()->getLogger(), "Running threads : " << _runningJobs.size() << "/" << _maxNbThread << " ("
-                                                                << pocoThreadAllocated << "/" << pocoThreadCapacity << ")");
-}
-
-int JobManager::countUploadSession() {
-    const std::lock_guard<std::mutex> lock(_mutex);
-    int uploadSessionCount = 0;
-    for (UniqueId id : _runningJobs) {
-        const auto &job = _managedJobs[id];
-        if (std::dynamic_pointer_cast<UploadSession>(job)) {
-            uploadSessionCount++;
+    _executor->setMaxConcurrency(JobLaneDiskCpu, std::clamp(diskCpuConcurrency, 1, _executor->nbWorkers(JobLaneDiskCpu)));
+
+    // Transfers: grow while jobs are waiting and the throughput follows, shrink if the CPU is overloaded or the throughput
+    // clearly dropped
+    const uint64_t nbCompletedNetworkJobs = _executor->laneStats(JobLaneNetwork).nbCompleted;
+    const uint64_t networkThroughput = nbCompletedNetworkJobs - _lastNbCompletedNetworkJobs;
+    int networkConcurrency = _executor->maxConcurrency(JobLaneNetwork);
+    if (cpuOverloaded || static_cast<double>(networkThroughput) < _lastNetworkThroughput * throughputDropThreshold) {
+        networkConcurrency -= _threadAdjustmentStep;
+    } else if (cpuAvailable && !_queuedJobsByLane[JobLaneNetwork].empty()) {
+        networkConcurrency += _threadAdjustmentStep;
+    }
+    const int networkNbWorkers = _executor->nbWorkers(JobLaneNetwork);
+    const int networkMinConcurrency = std::min(threadPoolMinCapacity, networkNbWorkers);
+    _executor->setMaxConcurrency(JobLaneNetwork, std::clamp(networkConcurrency, networkMinConcurrency, networkNbWorkers));
+    _lastNbCompletedNetworkJobs = nbCompletedNetworkJobs;
+    _lastNetworkThroughput = networkThroughput;
+
+    // Slots may have been added
+    for (int lane = 0; lane < JobLaneEnd; lane++) {
+        while (!_queuedJobsByLane[lane].empty() && _executor->available(static_cast<JobLane>(lane))) {
+            _queuedJobs.push(_queuedJobsByLane[lane].top());
+            _queuedJobsByLane[lane].pop();
         }
     }
-    return uploadSessionCount;
-}
 
-void JobManager::managePendingJobs(int uploadSessionCount) {
-    const std::lock_guard<std::mutex> lock(_mutex);
-
-    // Check if parent jobs of the pending jobs has finished
-    auto it = _pendingJobs.begin();
-    for (; it != _pendingJobs.end();) {
-        const auto &job = it->second.first;
-        if (!isParentPendingOrRunning(job->jobId()) && !(std::dynamic_pointer_cast<UploadSession>(job) &&
-                                                         uploadSessionCount >= Poco::ThreadPool::defaultPool().capacity() / 10)) {
-            if (job->isAborted()) {
-                // The job is aborted, remove it completly from job manager
-                _managedJobs.erase(it->first);
-            } else {
-                if (job->hasParentJob()) {
-                    LOG_DEBUG(Log::instance()->getLogger(), "Job " << job->parentJobId() << " has finished, queuing child job "
-                                                                   << job->jobId() << " for execution");
-                } else {
-                    LOG_DEBUG(Log::instance()->getLogger(),
-                              "The thread pool has recovered capacity, queuing job " << job->jobId() << " for execution");
-                }
-
-                _queuedJobs.push(it->second);
-            }
-            it = _pendingJobs.erase(it);
-        } else {
-            it++;
-        }
+    LOG_INFO(Log::instance()->getLogger(),
+             "With cpu usage : " << cpuUsage * 100 << " % (threshold : " << _cpuUsageThreshold * 100 << " %)");
+    for (int lane = 0; lane < JobLaneEnd; lane++) {
+        const JobExecutor::LaneStats stats = _executor->laneStats(static_cast<JobLane>(lane));
+        LOG_INFO(Log::instance()->getLogger(),
+                 "Lane " << JobExecutor::laneName(static_cast<JobLane>(lane)).c_str() << " : running " << stats.nbRunning << "/"
+                         << stats.maxConcurrency << " (" << stats.nbWorkers << " threads), queued " << stats.queueDepth
+                         << " + " << _queuedJobsByLane[lane].size() << " waiting, completed " << stats.nbCompleted
+                         << ", stolen " << stats.nbStolen << ", average queue latency "
+                         << (stats.nbCompleted ? stats.totalQueueLatencyUs / stats.nbCompleted : 0) << " us, max "
+                         << stats.maxQueueLatencyUs << " us");
     }
 }
 
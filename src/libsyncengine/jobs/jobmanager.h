@@ -19,14 +19,15 @@
 #pragma once
 
 #include "abstractjob.h"
+#include "jobexecutor.h"
 
 #include <log4cplus/logger.h>
 
 #include <Poco/Thread.h>
-#include <Poco/ThreadPool.h>
 #include <Poco/Net/HTTPSClientSession.h>
-#include <Poco/ThreadPool.h>
 
+#include <array>
+#include <condition_variable>
 #include <list>
 #include <queue>
 #include <thread>
@@ -47,6 +48,19 @@ class JobPriorityCmp {
         }
 };
 
+/**
+ * Jobs sharing a concurrency limit.
+ */
+typedef enum { JobClassDefault = 0, JobClassUploadSession, JobClassEnd } JobClass;
+
+/**
+ * Event-driven scheduler: the scheduling thread sleeps until a job is queued or finishes.
+ * A job with a parent job is parked until its parent completes, a job exceeding the limit of its class is parked until a job of
+ * the same class finishes.
+ * Jobs are executed on the lane of the JobExecutor matching their kind, so that file transfers, local operations and control
+ * jobs (long poll, listings) do not starve each other. The concurrency of the lanes is adjusted to the CPU usage and the
+ * network throughput.
+ */
 class JobManager {
     public:
         static JobManager *instance();
@@ -54,7 +68,7 @@ class JobManager {
         static void clear();
 
         /*
-         * Queue a job to be executed as soon as a thread is available in the default thread pool
+         * Queue a job to be executed as soon as a thread is available in its lane
          * If a callback is passed as argument: JobManager will NOT keep a reference to the job. The caller MUST keep a reference
          * to this job otherwise it could be deleted before or during its execution. Otherwise: JobManager will keep a reference
          * to the job until it is finished. The caller should not keep a reference to this job.
@@ -62,12 +76,13 @@ class JobManager {
         void queueAsyncJob(std::shared_ptr<AbstractJob> job, Poco::Thread::Priority priority = Poco::Thread::PRIO_NORMAL,
                            std::function<void(UniqueId)> externalCallback = nullptr);
 
-        inline bool hasAvailableThread() { return Poco::ThreadPool::defaultPool().available() > 0; }
+        inline bool hasAvailableThread() { return _executor->available(JobLaneNetwork); }
         bool isJobFinished(const UniqueId &jobId);
 
         std::shared_ptr<AbstractJob> getJob(const UniqueId &jobId);
         inline size_t countManagedJobs() { return _managedJobs.size(); }
         inline size_t maxNbThreads() { return _maxNbThread; }
+        inline JobExecutor::LaneStats laneStats(JobLane lane) { return _executor->laneStats(lane); }
 
     private:
         JobManager();
@@ -75,12 +90,17 @@ class JobManager {
         static void defaultCallback(UniqueId jobId);
 
         static void run();
-        static void startJob(std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority> nextJob);
-        static void adjustMaxNbThread();
-        static int countUploadSession();
-        static void managePendingJobs(int uploadSessionCount);
-
-        static bool isParentPendingOrRunning(UniqueId jobIb);
+        static void startJob(std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority> nextJob, JobClass jobClass,
+                             JobLane lane);
+        static void laneTaskFinished(JobLane lane);
+        static void adjustLaneConcurrency();
+
+        static JobClass jobClass(const std::shared_ptr<AbstractJob> &job);
+        static JobLane jobLane(const std::shared_ptr<AbstractJob> &job);
+        static int maxRunningJobs(JobClass jobClass);
+        static bool hasUnfinishedParent(const std::shared_ptr<AbstractJob> &job);
+        static void releasePendingJobs(UniqueId finishedJobId, JobClass finishedJobClass);
+        static void queuePendingJob(UniqueId jobId);
 
         static JobManager *_instance;
         static bool _stop;
@@ -88,18 +108,27 @@ class JobManager {
         static double _cpuUsageThreshold;
         static int _threadAdjustmentStep;
         static std::chrono::time_point<std::chrono::steady_clock> _maxNbThreadChrono;
+        static uint64_t _lastNbCompletedNetworkJobs;
+        static uint64_t _lastNetworkThroughput;  // Network jobs completed during the last adjustment period
 
         log4cplus::Logger _logger;
         std::unique_ptr<std::thread> _thread = nullptr;
 
         static std::unordered_map<UniqueId, std::shared_ptr<AbstractJob>> _managedJobs;  // queued + running + pending jobs
-        static std::priority_queue<std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority>,
-                                   std::vector<std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority>>, JobPriorityCmp>
-            _queuedJobs;                                   // jobs waiting for an available thread
-        static std::unordered_set<UniqueId> _runningJobs;  // jobs currently running in a dedicated thread
+        typedef std::priority_queue<std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority>,
+                                    std::vector<std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority>>, JobPriorityCmp>
+            JobQueue;
+        static JobQueue _queuedJobs;                                 // jobs ready to be dispatched
+        static std::array<JobQueue, JobLaneEnd> _queuedJobsByLane;   // jobs waiting for a free slot in their lane
+        static std::unordered_map<UniqueId, JobClass> _runningJobs;  // jobs currently running in a dedicated thread
         static std::unordered_map<UniqueId, std::pair<std::shared_ptr<AbstractJob>, Poco::Thread::Priority>>
-            _pendingJobs;  // jobs waiting for their parent job to be completed
+            _pendingJobs;  // jobs waiting for their parent job to be completed or for a slot in their class
+        static std::unordered_map<UniqueId, std::vector<UniqueId>> _pendingJobsByParent;
+        static std::array<std::queue<UniqueId>, JobClassEnd> _pendingJobsByClass;
+        static std::array<int, JobClassEnd> _nbRunningJobsByClass;
         static std::mutex _mutex;
+        static std::condition_variable _jobsChanged;
+        static std::unique_ptr<JobExecutor> _executor;
 
         friend class TestJobManager;
 };
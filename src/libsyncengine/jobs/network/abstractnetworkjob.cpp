@@ -17,8 +17,8 @@
  */
 
 #include "abstractnetworkjob.h"
+#include "httpsessionpool.h"
 
-#include "network/proxy.h"
 #include "jobs/network/networkjobsparams.h"
 #include "libcommon/utility/utility.h"
 #include "libcommonserver/utility/utility.h"
@@ -37,10 +37,12 @@
 
 #include <iostream>  // std::ios, std::istream, std::cout, std::cerr
 #include <functional>
+#include <algorithm>
+#include <memory>
 
 #define ABSTRACTNETWORKJOB_NEW_ERROR_MSG "Failed to create AbstractNetworkJob instance!"
 
-#define BUF_SIZE 1024
+#define BUF_SIZE 64 * 1024  // 64KB
 
 #define MAX_TRIALS 5
 
@@ -61,6 +63,7 @@ AbstractNetworkJob::AbstractNetworkJob() {
                 _context =
                     new Poco::Net::Context(Poco::Net::Context::TLS_CLIENT_USE, "", "", "", Poco::Net::Context::VERIFY_NONE);
                 _context->requireMinimumProtocol(Poco::Net::Context::PROTO_TLSV1_2);
+                _context->enableSessionCache(true);  // Resume the TLS sessions of the pooled connections
             } catch (Poco::Exception const &e) {
                 if (trials < _trials) {
                     LOG_INFO(_logger, "Error in Poco::Net::Context constructor: " << e.displayText().c_str() << " (" << e.code()
@@ -228,12 +231,13 @@ void AbstractNetworkJob::runJob() noexcept {
     }
 
     if (!isAborted()) {
-        clearSession();
+        releaseSession();
     }
 }
 
 bool AbstractNetworkJob::hasHttpError() {
-    if (_resHttp.getStatus() == Poco::Net::HTTPResponse::HTTP_OK) {
+    if (_resHttp.getStatus() == Poco::Net::HTTPResponse::HTTP_OK ||
+        _resHttp.getStatus() == Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT) {
         return false;
     }
     return true;
@@ -243,6 +247,10 @@ void AbstractNetworkJob::addRawHeader(const std::string &key, const std::string
     _rawHeaders.insert_or_assign(key, value);
 }
 
+void AbstractNetworkJob::removeRawHeader(const std::string &key) {
+    _rawHeaders.erase(key);
+}
+
 void AbstractNetworkJob::abort() {
     LOG_DEBUG(_logger, "Aborting session for job " << jobId());
 
@@ -265,25 +273,34 @@ void AbstractNetworkJob::getStringFromStream(std::istream &is, std::string &res)
 }
 
 void AbstractNetworkJob::createSession(const Poco::URI &uri) {
-    const std::scoped_lock<std::recursive_mutex> lock(_mutexSession);
-
-    if (_session) {
-        // Redirection case
-        clearSession();
+    {
+        const std::scoped_lock<std::recursive_mutex> lock(_mutexSession);
+        if (_session) {
+            // Redirection case
+            releaseSession();
+        }
     }
 
-    _session.reset(new Poco::Net::HTTPSClientSession(uri.getHost(), uri.getPort(), _context));
+    // May wait for other requests to the drive to finish, the job must remain abortable meanwhile
+    bool reused = false;
+    std::unique_ptr<Poco::Net::HTTPSClientSession> session =
+        HttpSessionPool::instance()->checkOut(uri, _customTimeout, _context, driveDbId(), reused);
 
-    if (_customTimeout) {
-        _session->setTimeout(Poco::Timespan(_customTimeout, 0));
-    }
+    const std::scoped_lock<std::recursive_mutex> lock(_mutexSession);
+    _session = std::move(session);
+    _sessionDriveDbId = driveDbId();
+    _sessionReused = reused;
+    _sessionReusable = false;
+}
 
-    // Set proxy params
-    if (Proxy::instance()->proxyConfig().type() == ProxyTypeHTTP) {
-        _session->setProxy(Proxy::instance()->proxyConfig().hostName(), Proxy::instance()->proxyConfig().port());
-        if (Proxy::instance()->proxyConfig().needsAuth()) {
-            _session->setProxyCredentials(Proxy::instance()->proxyConfig().user(), Proxy::instance()->proxyConfig().token());
-        }
+void AbstractNetworkJob::releaseSession() {
+    const std::scoped_lock<std::recursive_mutex> lock(_mutexSession);
+
+    if (_session && _sessionReusable) {
+        HttpSessionPool::instance()->checkIn(std::move(_session), _sessionDriveDbId, true);
+        _sessionReusable = false;
+    } else {
+        clearSession();
     }
 }
 
@@ -292,7 +309,17 @@ void AbstractNetworkJob::clearSession() {
 
     if (_session) {
         _session->reset();
-        _session = nullptr;
+        HttpSessionPool::instance()->checkIn(std::move(_session), _sessionDriveDbId, false);
+    }
+}
+
+void AbstractNetworkJob::checkSessionReusable(std::istream &inputStream) {
+    // Another request can only be sent on the connection once the response has been fully read
+    try {
+        _sessionReusable = !isAborted() && !inputStream.bad() &&
+                           (inputStream.eof() || inputStream.peek() == std::char_traits<char>::eof());
+    } catch (...) {
+        _sessionReusable = false;
     }
 }
 
@@ -319,7 +346,8 @@ bool AbstractNetworkJob::sendRequest(const Poco::URI &uri) {
         path = "/";
     }
 
-    LOG_DEBUG(_logger, "Sending " << _httpMethod.c_str() << " request " << jobId() << " : " << uri.toString().c_str());
+    LOG_DEBUG(_logger, "Sending " << _httpMethod.c_str() << " request " << jobId() << " : " << uri.toString().c_str()
+                                  << (_sessionReused ? " (reused connection)" : ""));
 
     // Get Content Type
     bool canceled = false;
@@ -339,10 +367,28 @@ bool AbstractNetworkJob::sendRequest(const Poco::URI &uri) {
         req.add(header.first, header.second);
     }
 
-    if (_data.size() != 0) {
-        req.setContentLength(_data.size());
+    const std::string_view data = getData();
+    const uint64_t streamedDataSize = getStreamedDataSize();
+    const uint64_t dataSize = streamedDataSize != 0 ? streamedDataSize : data.size();
+    if (dataSize != 0) {
+        req.setContentLength(static_cast<std::streamsize>(dataSize));
     }
 
+    if (streamedDataSize == 0) {
+        return writeRequest(req, data, dataSize, false);
+    }
+
+    // The source of a streamed body is only open while it is sent
+    if (!openData()) {
+        LOG_WARN(_logger, "Request " << jobId() << ": failed to open data to send");
+        return false;
+    }
+    const bool ret = writeRequest(req, data, dataSize, true);
+    closeData();
+    return ret;
+}
+
+bool AbstractNetworkJob::writeRequest(Poco::Net::HTTPRequest &req, std::string_view data, uint64_t dataSize, bool streamed) {
     // Send request, retrieve an open stream
     std::vector<std::reference_wrapper<std::ostream>> stream;
     try {
@@ -359,17 +405,31 @@ bool AbstractNetworkJob::sendRequest(const Poco::URI &uri) {
         return processSocketError("sendRequest exception", jobId(), e);
     }
 
-    // Send data
-    std::string::const_iterator itBegin = _data.begin();
-    while (itBegin != _data.end()) {
+    // Send data, a streamed body goes through a single buffer
+    std::unique_ptr<char[]> buffer(streamed ? new char[BUF_SIZE] : nullptr);
+    uint64_t sentSize = 0;
+    while (sentSize < dataSize) {
         if (isAborted()) {
             LOG_DEBUG(_logger, "Request " << jobId() << ": aborting HTTPS session");
             return false;
         }
 
-        std::string::const_iterator itEnd = (_data.end() - itBegin > BUF_SIZE ? itBegin + BUF_SIZE : _data.end());
+        const size_t blockSize = static_cast<size_t>(std::min(dataSize - sentSize, static_cast<uint64_t>(BUF_SIZE)));
+        const char *block = nullptr;
+        if (buffer) {
+            if (!readData(buffer.get(), blockSize)) {
+                // The request has been partially sent, the connection cannot be reused
+                LOG_WARN(_logger, "Request " << jobId() << ": failed to read data to send");
+                clearSession();
+                return false;
+            }
+            block = buffer.get();
+        } else {
+            block = data.data() + sentSize;
+        }
+
         try {
-            stream[0].get() << std::string(itBegin, itEnd);
+            stream[0].get().write(block, static_cast<std::streamsize>(blockSize));
             if (ioOrLogicalErrorOccurred(stream[0].get())) {
                 return processSocketError("stream write error", jobId());
             }
@@ -380,10 +440,10 @@ bool AbstractNetworkJob::sendRequest(const Poco::URI &uri) {
         }
 
         if (isProgressTracked()) {
-            _progress += itEnd - itBegin;
+            _progress += blockSize;
         }
 
-        itBegin = itEnd;
+        sentSize += blockSize;
     }
 
     return true;
@@ -415,7 +475,9 @@ bool AbstractNetworkJob::receiveResponse(const Poco::URI &uri) {
 
     bool res = true;
     switch (_resHttp.getStatus()) {
-        case Poco::Net::HTTPResponse::HTTP_OK: {
+        case Poco::Net::HTTPResponse::HTTP_OK:
+        case Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT: {
+            // Partial content is only received in response to a Range request
             bool ok = false;
             try {
                 ok = handleResponse(stream[0].get());
@@ -469,6 +531,8 @@ bool AbstractNetworkJob::receiveResponse(const Poco::URI &uri) {
         }
     }
 
+    checkSessionReusable(stream[0].get());
+
     return res;
 }
 
@@ -502,6 +566,7 @@ bool AbstractNetworkJob::followRedirect(std::istream &inputStream) {
     }
 
     Poco::URI uri(redirectUrl);
+    checkSessionReusable(inputStream);
 
     // Follow redirection
     LOG_DEBUG(_logger, "Request " << jobId() << ", following redirection: " << redirectUrl.c_str());
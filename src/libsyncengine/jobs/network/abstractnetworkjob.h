@@ -21,6 +21,7 @@
 #include "jobs/abstractjob.h"
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <queue>
 
@@ -50,6 +51,7 @@ class AbstractNetworkJob : public AbstractJob {
     protected:
         virtual void runJob() noexcept override;
         virtual void addRawHeader(const std::string &key, const std::string &value) final;
+        virtual void removeRawHeader(const std::string &key) final;
 
         virtual bool handleResponse(std::istream &inputStream) = 0;
         /**
@@ -60,6 +62,24 @@ class AbstractNetworkJob : public AbstractJob {
 
         virtual std::string getSpecificUrl() = 0;
         virtual std::string getUrl() = 0;
+        /** The body of the request. By default, the content of _data.
+         */
+        virtual std::string_view getData() const { return _data; }
+        /** Size of a body streamed by readData instead of being returned by getData, 0 if getData is used.
+         */
+        virtual uint64_t getStreamedDataSize() const { return 0; }
+        /** Opens the source of a streamed body before it is sent, at its beginning. Called for each request, redirections
+         * included.
+         * @return false if it cannot be opened, the request is then not sent.
+         */
+        virtual bool openData() { return true; }
+        /** Reads the next `size` bytes of a streamed body into `buffer`.
+         * @return false if they cannot be read, the request is then interrupted.
+         */
+        virtual bool readData(char * /*buffer*/, size_t /*size*/) { return false; }
+        /** Closes the source of a streamed body once it has been sent, or once its sending has failed.
+         */
+        virtual void closeData() {}
 
         void unzip(std::istream &inputStream, std::stringstream &ss);
         void getStringFromStream(std::istream &inputStream, std::string &res);
@@ -106,13 +126,22 @@ class AbstractNetworkJob : public AbstractJob {
 
         virtual std::string getContentType(bool &canceled) = 0;
 
-        std::unique_ptr<Poco::Net::HTTPSClientSession> _session;
+        std::unique_ptr<Poco::Net::HTTPSClientSession> _session;  // Checked out of the HttpSessionPool
+        int _sessionDriveDbId = 0;  // The drive the session has been checked out for
+        bool _sessionReused = false;
+        bool _sessionReusable = false;  // The response has been fully read, the connection can go back to the pool
         std::recursive_mutex _mutexSession;
 
+        /** The drive of the request, 0 if none. Limits the number of connections checked out for the drive. */
+        virtual int driveDbId() const { return 0; }
+
         void createSession(const Poco::URI &uri);
+        void releaseSession();
         void clearSession();
+        void checkSessionReusable(std::istream &inputStream);
         void abortSession();
         bool sendRequest(const Poco::URI &uri);
+        bool writeRequest(Poco::Net::HTTPRequest &req, std::string_view data, uint64_t dataSize, bool streamed);
         bool receiveResponse(const Poco::URI &uri);
         bool followRedirect(std::istream &inputStream);
         bool processSocketError(const std::string &msg, const UniqueId jobId);
@@ -64,6 +64,7 @@ class AbstractTokenNetworkJob : public AbstractNetworkJob {
 
 
         int userId() const { return _userId; }
+        int driveDbId() const override { return _driveDbId; }
         int driveId() const { return _driveId; }
 
         Poco::JSON::Object::Ptr _jsonRes{nullptr};
@@ -25,8 +25,16 @@
 #include "reconciliation/platform_inconsistency_checker/platforminconsistencycheckerutility.h"
 
 #include <Poco/JSON/Parser.h>
+#include <Poco/InflatingStream.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
 
 #define API_TIMEOUT 900
+#define READ_SIZE 64 * 1024  // 64KB
+#define ITEMS_BATCH_SIZE 1000
 
 namespace KDC {
 
@@ -45,90 +53,19 @@ bool CsvFullFileListWithCursorJob::getItem(SnapshotItem &item, bool &error, bool
     error = false;
     ignore = false;
 
-    std::string line;
-    std::getline(_ss, line);
-    if (line.empty()) {
-        return false;
-    }
-
+    std::string_view record;
     if (_ignoreFirstLine) {
-        std::getline(_ss, line);
-        if (line.empty()) {
+        if (!readRecord(_ss, record) || record.empty()) {
             return false;
         }
         _ignoreFirstLine = false;
     }
 
-    CsvIndex index = CsvIndexId;
-    bool readingDoubleQuotedValue = false;
-    bool prevCharDoubleQuotes = false;
-    bool readNextLine = true;
-    std::string tmp;
-    uint doubleQuoteCount = 0;
-    while (readNextLine) {
-        readNextLine = false;
-
-        for (char &c : line) {
-            if (c == ',' && (!readingDoubleQuotedValue || prevCharDoubleQuotes)) {
-                readingDoubleQuotedValue = false;
-                prevCharDoubleQuotes = false;
-                if (!updateSnapshotItem(tmp, index, item)) {
-                    LOGW_WARN(_logger, L"Error in updateSnapshotItem - line=" << Utility::s2ws(line).c_str());
-                    error = true;
-                    return true;
-                }
-                tmp.clear();
-                index = static_cast<CsvIndex>(static_cast<int>(index) + 1);
-            } else if (c == '"') {
-                doubleQuoteCount++;
-                if (!readingDoubleQuotedValue) {
-                    readingDoubleQuotedValue = true;
-                } else {
-                    if (prevCharDoubleQuotes) {
-                        // Replace 2 successive double quotes by one
-                        prevCharDoubleQuotes = false;
-                        tmp.push_back('"');
-                    } else {
-                        prevCharDoubleQuotes = true;
-                    }
-                }
-            } else {
-                tmp.push_back(c);
-            }
-        }
-
-        if (doubleQuoteCount > 2) {
-            LOGW_WARN(_logger, L"Item name contains double quote, ignoring it.");
-            ignore = true;
-            return true;
-        }
-
-        // File name could have line return in it. If so, read next line and continue parsing
-        if (readingDoubleQuotedValue) {
-            tmp.push_back('\n');
-            readNextLine = true;
-            std::getline(_ss, line);
-            if (line.empty()) {
-                LOGW_WARN(_logger, L"Invalid line");
-                ignore = true;
-                return true;
-            }
-        }
-    }
-
-    if (index < CsvIndexEnd - 1) {
-        LOGW_WARN(_logger, L"Invalid item");
-        ignore = true;
-        return true;
-    }
-
-    // Update last value
-    if (!updateSnapshotItem(tmp, index, item)) {
-        LOGW_WARN(_logger, L"Error in updateSnapshotItem - line=" << Utility::s2ws(line).c_str());
-        error = true;
-        return true;
+    if (!readRecord(_ss, record) || record.empty()) {
+        return false;
     }
 
+    parseRecord(record, item, error, ignore);
     return true;
 }
 
@@ -158,6 +95,14 @@ void CsvFullFileListWithCursorJob::setQueryParameters(Poco::URI &uri, bool &canc
 }
 
 bool CsvFullFileListWithCursorJob::handleResponse(std::istream &is) {
+    if (_itemsCallback) {
+        if (_zip) {
+            Poco::InflatingInputStream inflater(is, Poco::InflatingStreamBuf::STREAM_GZIP);
+            return streamItems(inflater);
+        }
+        return streamItems(is);
+    }
+
     if (_zip) {
         unzip(is, _ss);
     } else {
@@ -191,18 +136,201 @@ bool CsvFullFileListWithCursorJob::handleResponse(std::istream &is) {
     return true;
 }
 
-bool CsvFullFileListWithCursorJob::updateSnapshotItem(const std::string &str, CsvIndex index, SnapshotItem &item) {
+bool CsvFullFileListWithCursorJob::streamItems(std::istream &is) {
+    // The items are parsed as the reply is received and passed by batches, the reply is never held in memory
+    _bufferBegin = 0;
+    _bufferEnd = 0;
+    _truncated = false;
+
+    bool newReply = true;
+    bool header = true;
+    size_t nbItems = 0;
+    uint64_t itemCount = 0;
+    std::string_view record;
+    while (readRecord(is, record) && !record.empty()) {
+        if (header) {
+            header = false;
+            continue;
+        }
+
+        if (nbItems == _batch.size()) {
+            _batch.emplace_back();
+        }
+
+        bool error = false;
+        bool ignore = false;
+        parseRecord(record, _batch[nbItems], error, ignore);
+        if (error) {
+            LOG_WARN(_logger, "Reply " << jobId() << ": failed to parse CSV reply");
+            _exitCode = ExitCodeDataError;
+            _exitCause = ExitCauseUnknown;
+            noRetry();
+            return false;
+        }
+
+        if (ignore) {
+            continue;
+        }
+
+        if (++nbItems == ITEMS_BATCH_SIZE) {
+            if (!_itemsCallback(std::span<SnapshotItem>(_batch.data(), nbItems), newReply)) {
+                LOG_DEBUG(_logger, "Reply " << jobId() << ": parsing stopped");
+                return true;
+            }
+            newReply = false;
+            itemCount += nbItems;
+            nbItems = 0;
+        }
+    }
+
+    if (is.bad() || _truncated) {
+        LOG_WARN(_logger, "Reply " << jobId() << " received with bad content after " << itemCount + nbItems << " items");
+        return false;
+    }
+
+    if (nbItems > 0 || newReply) {
+        _itemsCallback(std::span<SnapshotItem>(_batch.data(), nbItems), newReply);
+        itemCount += nbItems;
+    }
+
+    LOG_DEBUG(_logger, "Reply " << jobId() << " received - " << itemCount << " items");
+    return true;
+}
+
+bool CsvFullFileListWithCursorJob::readRecord(std::istream &is, std::string_view &record) {
+    bool readingDoubleQuotedValue = false;
+    size_t pos = _bufferBegin;
+    while (true) {
+        for (; pos < _bufferEnd; pos++) {
+            const char c = _buffer[pos];
+            if (c == '"') {
+                readingDoubleQuotedValue = !readingDoubleQuotedValue;
+            } else if (c == '\n' && !readingDoubleQuotedValue) {
+                record = std::string_view(_buffer.data() + _bufferBegin, pos - _bufferBegin);
+                _bufferBegin = pos + 1;
+                return true;
+            }
+        }
+
+        // The record is incomplete, move it to the beginning of the buffer and read the next bytes
+        const size_t recordSize = _bufferEnd - _bufferBegin;
+        if (_bufferBegin > 0) {
+            std::memmove(_buffer.data(), _buffer.data() + _bufferBegin, recordSize);
+            _bufferBegin = 0;
+            _bufferEnd = recordSize;
+            pos = recordSize;
+        }
+
+        if (!is) {
+            return readLastRecord(is, readingDoubleQuotedValue, record);
+        }
+
+        if (_buffer.size() < _bufferEnd + READ_SIZE) {
+            _buffer.resize(_bufferEnd + READ_SIZE);
+        }
+        is.read(_buffer.data() + _bufferEnd, READ_SIZE);
+        const std::streamsize readSize = is.gcount();
+        if (readSize <= 0) {
+            return readLastRecord(is, readingDoubleQuotedValue, record);
+        }
+        _bufferEnd += static_cast<size_t>(readSize);
+    }
+}
+
+bool CsvFullFileListWithCursorJob::readLastRecord(std::istream &is, bool readingDoubleQuotedValue, std::string_view &record) {
+    if (_bufferBegin == _bufferEnd) {
+        return false;
+    }
+
+    if (is.bad() || readingDoubleQuotedValue) {
+        _truncated = true;
+        return false;
+    }
+
+    // The last line of the file may not end with a line break
+    record = std::string_view(_buffer.data() + _bufferBegin, _bufferEnd - _bufferBegin);
+    _bufferBegin = _bufferEnd;
+    return true;
+}
+
+void CsvFullFileListWithCursorJob::parseRecord(std::string_view record, SnapshotItem &item, bool &error, bool &ignore) {
+    error = false;
+    ignore = false;
+
+    if (std::count(record.begin(), record.end(), '"') > 2) {
+        LOGW_WARN(_logger, L"Item name contains double quote, ignoring it.");
+        ignore = true;
+        return;
+    }
+
+    // Split the record, additional columns are ignored
+    std::array<std::string_view, CsvIndexEnd> values;
+    size_t nbValues = 0;
+    size_t valueBegin = 0;
+    bool readingDoubleQuotedValue = false;
+    for (size_t pos = 0; pos <= record.size() && nbValues < values.size(); pos++) {
+        if (pos < record.size()) {
+            if (record[pos] == '"') {
+                readingDoubleQuotedValue = !readingDoubleQuotedValue;
+            }
+            if (readingDoubleQuotedValue || record[pos] != ',') {
+                continue;
+            }
+        }
+
+        std::string_view value = record.substr(valueBegin, pos - valueBegin);
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+            value = value.substr(1, value.size() - 2);
+        }
+        values[nbValues++] = value;
+        valueBegin = pos + 1;
+    }
+
+    if (nbValues < CsvIndexEnd) {
+        LOGW_WARN(_logger, L"Invalid item");
+        ignore = true;
+        return;
+    }
+
+    for (size_t index = 0; index < values.size(); index++) {
+        if (!updateSnapshotItem(values[index], static_cast<CsvIndex>(index), item)) {
+            LOGW_WARN(_logger, L"Error in updateSnapshotItem - line=" << Utility::s2ws(std::string(record)).c_str());
+            error = true;
+            return;
+        }
+    }
+}
+
+bool CsvFullFileListWithCursorJob::toInt64(std::string_view str, const char *attribute, int64_t &value) {
+    value = 0;
+    if (str.empty()) {
+        return true;
+    }
+
+    const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec != std::errc()) {
+        LOGW_WARN(_logger, L"Error in SnapshotItem::" << Utility::s2ws(attribute).c_str() << L" - str="
+                                                      << Utility::s2ws(std::string(str)).c_str() << L" err="
+                                                      << (ec == std::errc::result_out_of_range ? L"out_of_range"
+                                                                                                : L"invalid_argument"));
+        return false;
+    }
+
+    return true;
+}
+
+bool CsvFullFileListWithCursorJob::updateSnapshotItem(std::string_view str, CsvIndex index, SnapshotItem &item) {
     switch (index) {
         case CsvIndexId: {
-            item.setId(str);
+            item.setId(NodeId(str));
             break;
         }
         case CsvIndexParentId: {
-            item.setParentId(str);
+            item.setParentId(NodeId(str));
             break;
         }
         case CsvIndexName: {
-            SyncName name = Str2SyncName(str);
+            SyncName name = Str2SyncName(std::string(str));
 #ifdef _WIN32
             SyncName newName;
             if (PlatformInconsistencyCheckerUtility::instance()->fixNameWithBackslash(name, newName)) {
@@ -221,51 +349,27 @@ bool CsvFullFileListWithCursorJob::updateSnapshotItem(const std::string &str, Cs
             break;
         }
         case CsvIndexSize: {
-            try {
-                item.setSize(str.empty() ? 0 : std::stoll(str));
-            } catch (std::invalid_argument const &ex) {
-                LOGW_WARN(_logger, L"Error in SnapshotItem::setSize - str=" << Utility::s2ws(str).c_str()
-                                                                            << L" exc=invalid_argument err="
-                                                                            << Utility::s2ws(ex.what()).c_str());
-                return false;
-            } catch (std::out_of_range const &ex) {
-                LOGW_WARN(_logger, L"Error in SnapshotItem::setSize - str=" << Utility::s2ws(str).c_str()
-                                                                            << L" exc=out_of_range err="
-                                                                            << Utility::s2ws(ex.what()).c_str());
+            int64_t size = 0;
+            if (!toInt64(str, "setSize", size)) {
                 return false;
             }
+            item.setSize(size);
             break;
         }
         case CsvIndexCreatedAt: {
-            try {
-                item.setCreatedAt(str.empty() ? 0 : std::stoll(str));
-            } catch (std::invalid_argument const &ex) {
-                LOGW_WARN(_logger, L"Error in SnapshotItem::setCreatedAt - str=" << Utility::s2ws(str).c_str()
-                                                                                 << L" exc=invalid_argument err="
-                                                                                 << Utility::s2ws(ex.what()).c_str());
-                return false;
-            } catch (std::out_of_range const &ex) {
-                LOGW_WARN(_logger, L"Error in SnapshotItem::setCreatedAt - str=" << Utility::s2ws(str).c_str()
-                                                                                 << L" exc=out_of_range err="
-                                                                                 << Utility::s2ws(ex.what()).c_str());
+            int64_t createdAt = 0;
+            if (!toInt64(str, "setCreatedAt", createdAt)) {
                 return false;
             }
+            item.setCreatedAt(createdAt);
             break;
         }
         case CsvIndexModtime: {
-            try {
-                item.setLastModified(str.empty() ? 0 : std::stoll(str));
-            } catch (std::invalid_argument const &ex) {
-                LOGW_WARN(_logger, L"Error in SnapshotItem::setLastModified - str=" << Utility::s2ws(str).c_str()
-                                                                                    << L" exc=invalid_argument err="
-                                                                                    << Utility::s2ws(ex.what()).c_str());
-                return false;
-            } catch (std::out_of_range const &ex) {
-                LOGW_WARN(_logger, L"Error in SnapshotItem::setLastModified - str=" << Utility::s2ws(str).c_str()
-                                                                                    << L" exc=out_of_range err="
-                                                                                    << Utility::s2ws(ex.what()).c_str());
+            int64_t modtime = 0;
+            if (!toInt64(str, "setLastModified", modtime)) {
                 return false;
             }
+            item.setLastModified(modtime);
             break;
         }
         case CsvIndexCanWrite: {
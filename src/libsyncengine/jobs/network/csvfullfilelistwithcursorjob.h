@@ -21,6 +21,10 @@
 #include "abstracttokennetworkjob.h"
 #include "update_detection/file_system_observer/snapshot/snapshotitem.h"
 
+#include <functional>
+#include <span>
+#include <string_view>
+
 namespace KDC {
 
 class CsvFullFileListWithCursorJob : public AbstractTokenNetworkJob {
@@ -38,10 +42,21 @@ class CsvFullFileListWithCursorJob : public AbstractTokenNetworkJob {
             CsvIndexEnd
         };
 
+        /**
+         * Receives a batch of items parsed from the reply. The items can be modified, they are overwritten by the next batch.
+         * `newReply` is true for the first batch of a reply: the items received from a previous trial are sent again.
+         * Return false to stop parsing.
+         */
+        typedef std::function<bool(std::span<SnapshotItem> items, bool newReply)> ItemsCallback;
+
     public:
         CsvFullFileListWithCursorJob(int driveDbId, const NodeId &dirId, std::unordered_set<NodeId> blacklist = {},
                                      bool zip = true);
 
+        /** The items are passed to `callback` while the reply is received, instead of being kept in memory for getItem().
+         */
+        inline void setItemsCallback(const ItemsCallback &callback) { _itemsCallback = callback; }
+
         /**
          * @brief getItem
          * @param item : item extracted from line of the CSV file
@@ -59,14 +74,33 @@ class CsvFullFileListWithCursorJob : public AbstractTokenNetworkJob {
 
         virtual bool handleResponse(std::istream &is) override;
 
-        bool updateSnapshotItem(const std::string &str, CsvIndex index, SnapshotItem &item);
+        bool streamItems(std::istream &is);
+        /** Reads the next line of the CSV file, a line break in a double quoted value does not end it.
+         * The record is valid until the next call.
+         * @return false at the end of the stream.
+         */
+        bool readRecord(std::istream &is, std::string_view &record);
+        // Called at the end of the stream with the bytes left in the buffer
+        bool readLastRecord(std::istream &is, bool readingDoubleQuotedValue, std::string_view &record);
+        void parseRecord(std::string_view record, SnapshotItem &item, bool &error, bool &ignore);
+        bool updateSnapshotItem(std::string_view str, CsvIndex index, SnapshotItem &item);
+        bool toInt64(std::string_view str, const char *attribute, int64_t &value);
 
         NodeId _dirId;
         std::unordered_set<NodeId> _blacklist;
         bool _zip = true;
         bool _ignoreFirstLine = true;
 
+        ItemsCallback _itemsCallback;
+        std::vector<SnapshotItem> _batch;  // Reused to avoid reallocating the item strings
+        std::vector<char> _buffer;
+        size_t _bufferBegin = 0;  // Beginning of the record being read
+        size_t _bufferEnd = 0;
+        bool _truncated = false;  // The stream ended in the middle of a double quoted value, or with an error
+
         std::stringstream _ss;
+
+        friend class TestNetworkJobs;
 };
 
 }  // namespace KDC
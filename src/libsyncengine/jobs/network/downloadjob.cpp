@@ -29,7 +29,11 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <sstream>
+#include <thread>
 
 #include <Poco/File.h>
 
@@ -40,6 +44,10 @@ namespace KDC {
 #define TRIALS 5
 #define READ_PAUSE_SLEEP_PERIOD 100  // 0.1 s
 #define READ_RETRIES 10
+#define SEGMENTS_WAIT_PERIOD 200  // 0.2 s
+#define TMP_FILE_PREFIX "kdrive_"
+#define TMP_FILE_EXTENSION ".part"
+#define TMP_FILE_EXPIRATION 7  // days
 
 DownloadJob::DownloadJob(int driveDbId, const NodeId &remoteFileId, const SyncPath &localpath, int64_t expectedSize,
                          SyncTime creationTime, SyncTime modtime, bool isCreate)
@@ -170,9 +178,202 @@ void DownloadJob::runJob() noexcept {
         }
     }
 
+    removeOutdatedTmpFiles();
+
+    // Large files are downloaded by ranges in parallel, unless they are hydrated progressively
+    if (_maxSegments > 1 && _expectedSize > downloadSegmentsThreshold && !_vfsUpdateFetchStatus) {
+        if (downloadSegments()) {
+            return;
+        }
+        LOG_INFO(_logger, "Request " << jobId() << ": downloading file " << _remoteFileId.c_str() << " with a single request");
+    }
+
     AbstractTokenNetworkJob::runJob();
 }
 
+void DownloadJob::abort() {
+    AbstractTokenNetworkJob::abort();
+
+    const std::lock_guard<std::mutex> lock(_segmentJobsMutex);
+    for (auto &segmentJob : _segmentJobs) {
+        segmentJob->abort();
+    }
+}
+
+void DownloadJob::setData(bool &canceled) {
+    canceled = false;
+
+    // Resume from the data received by a previous trial or job
+    _resumeOffset = 0;
+    removeRawHeader("Range");
+
+    SyncPath tmpPath;
+    if (!tmpFilePath(false, tmpPath)) {
+        return;
+    }
+
+    std::error_code ec;
+    const std::uintmax_t partialSize = std::filesystem::file_size(tmpPath, ec);
+    if (ec || partialSize == 0) {
+        return;
+    }
+
+    if (_expectedSize >= 0 && static_cast<int64_t>(partialSize) >= _expectedSize) {
+        // Complete but not moved, download it again
+        removeTmpFile(tmpPath);
+        return;
+    }
+
+    LOGW_DEBUG(_logger, L"Resuming download of " << Utility::formatSyncPath(_localpath).c_str() << L" from byte " << partialSize);
+    _resumeOffset = static_cast<int64_t>(partialSize);
+    addRawHeader("Range", "bytes=" + std::to_string(partialSize) + "-");
+}
+
+bool DownloadJob::downloadSegments() {
+    if (!canRun()) {
+        return true;
+    }
+
+    SyncPath tmpPath;
+    if (!tmpFilePath(true, tmpPath)) {
+        _exitCode = ExitCodeSystemError;
+        _exitCause = ExitCauseFileAccessError;
+        return true;
+    }
+
+    // Preallocate the file, each segment writes its range at its offset
+    std::ofstream output(tmpPath.native().c_str(), std::ios::binary | std::ios::trunc);
+    if (!output) {
+        LOGW_WARN(_logger, L"Failed to create file: " << Utility::formatSyncPath(tmpPath).c_str());
+        _exitCode = ExitCodeSystemError;
+        _exitCause = Utility::enoughSpace(tmpPath) ? ExitCauseFileAccessError : ExitCauseNotEnoughDiskSpace;
+        return true;
+    }
+    output.close();
+
+    std::error_code ec;
+    std::filesystem::resize_file(tmpPath, static_cast<std::uintmax_t>(_expectedSize), ec);
+    if (ec) {
+        LOGW_WARN(_logger, L"Failed to preallocate file: " << Utility::formatStdError(tmpPath, ec).c_str());
+        removeTmpFile(tmpPath);
+        _exitCode = ExitCodeSystemError;
+        _exitCause = Utility::enoughSpace(tmpPath) ? ExitCauseFileAccessError : ExitCauseNotEnoughDiskSpace;
+        return true;
+    }
+
+    const int64_t nbSegments = std::clamp(_expectedSize / downloadSegmentMinSize, static_cast<int64_t>(1),
+                                          static_cast<int64_t>(_maxSegments));
+    const int64_t segmentSize = (_expectedSize + nbSegments - 1) / nbSegments;
+    {
+        const std::lock_guard<std::mutex> lock(_segmentJobsMutex);
+        for (int64_t offset = 0; offset < _expectedSize; offset += segmentSize) {
+            _segmentJobs.push_back(std::make_shared<DownloadSegmentJob>(driveDbId(), _remoteFileId, tmpPath, offset,
+                                                                        std::min(segmentSize, _expectedSize - offset),
+                                                                        _expectedSize));
+            if (isAborted()) {
+                _segmentJobs.back()->abort();
+            }
+        }
+    }
+
+    LOG_DEBUG(_logger, "Request " << jobId() << ": downloading file " << _remoteFileId.c_str() << " in " << _segmentJobs.size()
+                                  << " segments");
+
+    // The segments run on their own threads, waiting for jobs queued in the job manager could starve the network lane
+    std::atomic<int> nbRunningSegments = static_cast<int>(_segmentJobs.size());
+    std::vector<std::thread> segmentThreads;
+    bool startError = false;
+    try {
+        for (auto &segmentJob : _segmentJobs) {
+            segmentThreads.emplace_back([segmentJob, &nbRunningSegments]() {
+                segmentJob->runSynchronously();
+                nbRunningSegments--;
+            });
+        }
+    } catch (std::system_error &e) {
+        LOG_WARN(_logger, "Failed to start segment download: " << e.what());
+        startError = true;
+        nbRunningSegments -= static_cast<int>(_segmentJobs.size() - segmentThreads.size());
+
+        const std::lock_guard<std::mutex> lock(_segmentJobsMutex);
+        for (auto &segmentJob : _segmentJobs) {
+            segmentJob->abort();
+        }
+    }
+
+    _progress = 0;
+    while (nbRunningSegments > 0) {
+        Utility::msleep(SEGMENTS_WAIT_PERIOD);
+
+        int64_t progress = 0;
+        for (const auto &segmentJob : _segmentJobs) {
+            progress += segmentJob->written();
+        }
+        _progress = progress;
+    }
+
+    for (auto &segmentThread : segmentThreads) {
+        segmentThread.join();
+    }
+
+    bool rangeNotSupported = false;
+    std::shared_ptr<DownloadSegmentJob> failedSegmentJob;
+    _progress = 0;
+    {
+        const std::lock_guard<std::mutex> lock(_segmentJobsMutex);
+        for (const auto &segmentJob : _segmentJobs) {
+            _progress += segmentJob->written();
+            if (segmentJob->rangeNotSupported()) {
+                rangeNotSupported = true;
+            } else if (segmentJob->exitCode() != ExitCodeOk) {
+                failedSegmentJob = segmentJob;
+            }
+        }
+        _segmentJobs.clear();
+    }
+
+    _responseHandlingCanceled = true;
+    if (isAborted()) {
+        removeTmpFile(tmpPath);
+        _exitCode = ExitCodeOk;
+        return true;
+    }
+
+    if (rangeNotSupported || startError) {
+        removeTmpFile(tmpPath);
+        _responseHandlingCanceled = false;
+        return false;
+    }
+
+    if (failedSegmentJob) {
+        LOG_WARN(_logger, "Request " << jobId() << ": failed to download segment at offset " << failedSegmentJob->offset());
+        removeTmpFile(tmpPath);
+        _exitCode = failedSegmentJob->exitCode();
+        _exitCause = failedSegmentJob->exitCause();
+        return true;
+    }
+
+    if (!verifyTmpFile(tmpPath, _expectedSize)) {
+        removeTmpFile(tmpPath);
+        _exitCode = ExitCodeBackError;
+        _exitCause = ExitCauseInvalidSize;
+        return true;
+    }
+
+    bool restartSync = false;
+    if (!moveTmpFile(tmpPath, restartSync) || restartSync) {
+        LOGW_WARN(_logger, L"Failed to replace file by tmp one: " << Utility::formatSyncPath(tmpPath).c_str());
+        removeTmpFile(tmpPath);
+        _exitCode = ExitCodeSystemError;
+        _exitCause = ExitCauseFileAccessError;
+        return true;
+    }
+
+    _responseHandlingCanceled = false;
+    finalizeDownload(false);
+    return true;
+}
+
 bool DownloadJob::handleResponse(std::istream &is) {
     // Get Mime type
     std::string contentType;
@@ -208,24 +409,37 @@ bool DownloadJob::handleResponse(std::istream &is) {
         }
     } else {
         // Create/fetch normal file
-#ifdef _WIN32
-        const std::string tmpFileName = tmpnam(nullptr);
-#else
-        const std::string tmpFileName = "kdrive_" + CommonUtility::generateRandomStringAlphaNum();
-#endif
-
         SyncPath tmpPath;
-        IoError ioError = IoErrorSuccess;
-        if (!IoHelper::tempDirectoryPath(tmpPath, ioError)) {
-            LOGW_WARN(_logger, L"Failed to get temporary directory path: " << Utility::formatIoError(tmpPath, ioError).c_str());
+        if (!tmpFilePath(false, tmpPath)) {
             _exitCode = ExitCodeSystemError;
             _exitCause = ExitCauseFileAccessError;
             return false;
         }
 
-        tmpPath /= tmpFileName;
+        // A partial content is appended to the data received by a previous trial or job
+        std::streamsize expectedSize = _resHttp.getContentLength();
+        int64_t totalSize = expectedSize;
+        int64_t offset = 0;
+        if (getStatusCode() == Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT) {
+            std::string contentRange;
+            try {
+                contentRange = _resHttp.get("Content-Range");
+            } catch (...) {
+                // No Content-Range
+            }
+
+            int64_t rangeEnd = 0;
+            if (!DownloadSegmentJob::parseContentRange(contentRange, offset, rangeEnd, totalSize) || offset != _resumeOffset) {
+                LOG_WARN(_logger, "Request " << jobId() << ": unexpected range \"" << contentRange.c_str()
+                                             << "\", restarting download");
+                removeTmpFile(tmpPath);
+                _exitCode = ExitCodeBackError;
+                _exitCause = ExitCauseInvalidSize;
+                return false;
+            }
+        }
 
-        std::ofstream output(tmpPath.native().c_str(), std::ios::binary);
+        std::ofstream output(tmpPath.native().c_str(), offset > 0 ? std::ios::binary | std::ios::app : std::ios::binary);
         if (!output) {
             LOGW_WARN(_logger, L"Failed to create file: " << Utility::formatSyncPath(tmpPath).c_str());
             _exitCode = ExitCodeSystemError;
@@ -235,13 +449,12 @@ bool DownloadJob::handleResponse(std::istream &is) {
 
         std::chrono::steady_clock::time_point fileProgressTimer = std::chrono::steady_clock::now();
 
-        std::streamsize expectedSize = _resHttp.getContentLength();
         bool readError = false;
         bool writeError = false;
         bool fetchCanceled = false;
         bool fetchFinished = false;
         bool fetchError = false;
-        _progress = 0;
+        _progress = offset;
         if (expectedSize == Poco::Net::HTTPMessage::UNKNOWN_CONTENT_LENGTH || expectedSize > 0) {
             std::unique_ptr<char[]> buffer(new char[BUF_SIZE]);
             bool done = false;
@@ -272,20 +485,13 @@ bool DownloadJob::handleResponse(std::istream &is) {
                             writeError = true;
                             break;
                         }
-                        output.flush();
-                        if (output.bad()) {
-                            // Read/writing error or logical error
-                            LOG_WARN(_logger,
-                                     "Request " << jobId() << ": error after flushing " << _progress << " bytes to tmp file");
-                            writeError = true;
-                            break;
-                        }
                         retryCount = 0;
                     }
 
                     if (is.eof()) {
                         // End of stream
-                        if (expectedSize == Poco::Net::HTTPMessage::UNKNOWN_CONTENT_LENGTH || _progress == expectedSize) {
+                        if (expectedSize == Poco::Net::HTTPMessage::UNKNOWN_CONTENT_LENGTH ||
+                            _progress - offset == expectedSize) {
                             done = true;
                         } else {
                             // Expected size hasn't be read
@@ -334,6 +540,7 @@ bool DownloadJob::handleResponse(std::istream &is) {
         _responseHandlingCanceled = isAborted() || readError || writeError || fetchCanceled || fetchError;
 
         bool restartSync = false;
+        bool invalidContent = false;
         if (!_responseHandlingCanceled) {
             if (_vfsUpdateFetchStatus && !fetchFinished) {
                 // Update fetch status
@@ -348,22 +555,28 @@ bool DownloadJob::handleResponse(std::istream &is) {
 
                 _responseHandlingCanceled = fetchCanceled || fetchError || (!fetchFinished);
             } else if (!_vfsUpdateFetchStatus) {
+                // Check the content before replacing the file
+                invalidContent = !verifyTmpFile(tmpPath, totalSize);
+
                 // Replace file by tmp one
                 bool replaceError = false;
-                if (!moveTmpFile(tmpPath, restartSync)) {
+                if (!invalidContent && !moveTmpFile(tmpPath, restartSync)) {
                     LOGW_WARN(_logger, L"Failed to replace file by tmp one: " << Utility::formatSyncPath(tmpPath).c_str());
                     replaceError = true;
                 }
 
-                _responseHandlingCanceled = replaceError || restartSync;
+                _responseHandlingCanceled = invalidContent || replaceError || restartSync;
             }
         }
 
         if (_responseHandlingCanceled) {
             // NB: VFS reset is done in the destructor
 
-            // Remove tmp file
-            if (!removeTmpFile(tmpPath)) {
+            // Keep the data received so far if the download can be resumed, otherwise remove tmp file
+            const bool resumable = (readError || isAborted()) && !writeError && !fetchCanceled && !fetchError && !invalidContent;
+            if (resumable) {
+                LOGW_DEBUG(_logger, L"Keeping partial file to resume download: " << Utility::formatSyncPath(tmpPath).c_str());
+            } else if (!removeTmpFile(tmpPath)) {
                 LOGW_WARN(_logger, L"Failed to remove tmp file: " << Utility::formatSyncPath(tmpPath).c_str());
             }
 
@@ -371,7 +584,7 @@ bool DownloadJob::handleResponse(std::istream &is) {
                 // Download aborted or canceled by the user
                 _exitCode = ExitCodeOk;
                 return true;
-            } else if (readError) {
+            } else if (readError || invalidContent) {
                 // Download issue
                 _exitCode = ExitCodeBackError;
                 _exitCause = ExitCauseInvalidSize;
@@ -385,6 +598,10 @@ bool DownloadJob::handleResponse(std::istream &is) {
         }
     }
 
+    return finalizeDownload(isLink);
+}
+
+bool DownloadJob::finalizeDownload(bool isLink) {
     if (!_ignoreDateTime) {
         bool exists = false;
         if (!Utility::setFileDates(_localpath, std::make_optional<KDC::SyncTime>(_creationTime),
@@ -392,8 +609,8 @@ bool DownloadJob::handleResponse(std::istream &is) {
             LOGW_WARN(_logger, L"Error in Utility::setFileDates: " << Utility::formatSyncPath(_localpath).c_str());
             // Do nothing (remote file will be updated during the next sync)
 #ifdef NDEBUG
-            sentry_capture_event(
-                sentry_value_new_message_event(SENTRY_LEVEL_WARNING, "DownloadJob::handleResponse", "Unable to set file dates"));
+            sentry_capture_event(sentry_value_new_message_event(SENTRY_LEVEL_WARNING, "DownloadJob::finalizeDownload",
+                                                                "Unable to set file dates"));
 #endif
         } else if (!exists) {
             LOGW_INFO(_logger, L"Item does not exist anymore. Restarting sync: " << Utility::formatSyncPath(_localpath).c_str());
@@ -502,6 +719,98 @@ bool DownloadJob::createLink(const std::string &mimeType, const std::string &dat
     return true;
 }
 
+bool DownloadJob::tmpFilePath(bool segmented, SyncPath &path) {
+    IoError ioError = IoErrorSuccess;
+    if (!IoHelper::tempDirectoryPath(path, ioError)) {
+        LOGW_WARN(_logger, L"Failed to get temporary directory path: " << Utility::formatIoError(path, ioError).c_str());
+        return false;
+    }
+
+    std::stringstream fileName;
+    fileName << tmpFilePrefix() << _expectedSize << "_" << _modtimeIn << (segmented ? ".segments" : "") << TMP_FILE_EXTENSION;
+    path /= fileName.str();
+    return true;
+}
+
+std::string DownloadJob::tmpFilePrefix() const {
+    std::stringstream prefix;
+    prefix << TMP_FILE_PREFIX << _remoteFileId << "_" << std::filesystem::hash_value(_localpath) << "_";
+    return prefix.str();
+}
+
+void DownloadJob::removeOutdatedTmpFiles() {
+    SyncPath tmpPath;
+    SyncPath segmentedTmpPath;
+    if (!tmpFilePath(false, tmpPath) || !tmpFilePath(true, segmentedTmpPath)) {
+        return;
+    }
+
+    // The temporary files of the other versions of the file cannot be resumed anymore
+    const SyncName prefix = Str2SyncName(tmpFilePrefix());
+    std::error_code ec;
+    for (auto dirIt = std::filesystem::directory_iterator(tmpPath.parent_path(), ec);
+         !ec && dirIt != std::filesystem::directory_iterator(); dirIt.increment(ec)) {
+        const SyncPath &path = dirIt->path();
+        if (path != tmpPath && path != segmentedTmpPath && path.filename().native().starts_with(prefix)) {
+            LOGW_DEBUG(_logger, L"Removing outdated partial download: " << Utility::formatSyncPath(path).c_str());
+            removeTmpFile(path);
+        }
+    }
+}
+
+void DownloadJob::removeOldTmpFiles() {
+    const log4cplus::Logger logger = Log::instance()->getLogger();
+    SyncPath tmpDirPath;
+    IoError ioError = IoErrorSuccess;
+    if (!IoHelper::tempDirectoryPath(tmpDirPath, ioError)) {
+        LOGW_WARN(logger, L"Failed to get temporary directory path: " << Utility::formatIoError(tmpDirPath, ioError).c_str());
+        return;
+    }
+
+    // The downloads interrupted for a while are not resumed: the file has likely been changed or downloaded to another place
+    const auto expirationTime = std::filesystem::file_time_type::clock::now() - std::chrono::hours(TMP_FILE_EXPIRATION * 24);
+    const SyncName prefix = Str2SyncName(std::string(TMP_FILE_PREFIX));
+    const SyncName extension = Str2SyncName(std::string(TMP_FILE_EXTENSION));
+    std::error_code ec;
+    for (auto dirIt = std::filesystem::directory_iterator(tmpDirPath, ec); !ec && dirIt != std::filesystem::directory_iterator();
+         dirIt.increment(ec)) {
+        const SyncName fileName = dirIt->path().filename().native();
+        if (!fileName.starts_with(prefix) || !fileName.ends_with(extension)) {
+            continue;
+        }
+
+        std::error_code fileEc;
+        const auto lastWriteTime = dirIt->last_write_time(fileEc);
+        if (fileEc || lastWriteTime >= expirationTime) {
+            continue;
+        }
+
+        LOGW_INFO(logger, L"Removing old partial download: " << Utility::formatSyncPath(dirIt->path()).c_str());
+        if (!std::filesystem::remove(dirIt->path(), fileEc) && fileEc) {
+            LOGW_WARN(logger, L"Failed to remove: " << Utility::formatStdError(dirIt->path(), fileEc).c_str());
+        }
+    }
+}
+
+bool DownloadJob::verifyTmpFile(const SyncPath &path, int64_t expectedSize) {
+    std::error_code ec;
+    const std::uintmax_t fileSize = std::filesystem::file_size(path, ec);
+    if (ec) {
+        LOGW_WARN(_logger, L"Failed to get file size: " << Utility::formatStdError(path, ec).c_str());
+        return false;
+    }
+
+    // The file must contain exactly what has been received, and what the server announced
+    if (static_cast<int64_t>(fileSize) != _progress || (expectedSize >= 0 && static_cast<int64_t>(fileSize) != expectedSize)) {
+        LOGW_WARN(_logger, L"Invalid size for downloaded file " << Utility::formatSyncPath(_localpath).c_str() << L": "
+                                                                << fileSize << L" bytes, " << _progress << L" received, "
+                                                                << expectedSize << L" expected");
+        return false;
+    }
+
+    return true;
+}
+
 bool DownloadJob::removeTmpFile(const SyncPath &path) {
     std::error_code ec;
     if (!std::filesystem::remove_all(path, ec)) {
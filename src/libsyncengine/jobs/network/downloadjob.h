@@ -19,8 +19,11 @@
 #pragma once
 
 #include "abstracttokennetworkjob.h"
+#include "downloadsegmentjob.h"
 #include "jobs/network/networkjobsparams.h"
 
+#include <mutex>
+
 namespace KDC {
 
 class DownloadJob : public AbstractTokenNetworkJob {
@@ -36,16 +39,39 @@ class DownloadJob : public AbstractTokenNetworkJob {
         inline const NodeId &localNodeId() const { return _localNodeId; }
         inline SyncTime modtime() const { return _modtimeIn; }
 
+        /** Max. number of ranges of a large file downloaded in parallel, 1 to always download a file with a single request.
+         */
+        inline void setMaxSegments(int maxSegments) { _maxSegments = maxSegments; }
+
+        virtual void abort() override;
+
+        /** Removes the temporary files of the downloads interrupted several days ago. To be called at startup.
+         */
+        static void removeOldTmpFiles();
+
     private:
         virtual std::string getSpecificUrl() override;
         virtual void setQueryParameters(Poco::URI &, bool &) override {}
-        virtual void setData(bool &canceled) override { canceled = false; }
+        virtual void setData(bool &canceled) override;
 
         virtual bool canRun() override;
         virtual void runJob() noexcept override;
         virtual bool handleResponse(std::istream &is) override;
 
+        /** @return false if the file cannot be downloaded by ranges and must be downloaded with a single request.
+         */
+        bool downloadSegments();
+        bool finalizeDownload(bool isLink);
+
         bool createLink(const std::string &mimeType, const std::string &data);
+        /** The temporary file is named after the downloaded file version, so that a partial download can be resumed.
+         */
+        bool tmpFilePath(bool segmented, SyncPath &path);
+        std::string tmpFilePrefix() const;
+        /** Removes the temporary files of the other versions of the file, downloaded to the same path.
+         */
+        void removeOutdatedTmpFiles();
+        bool verifyTmpFile(const SyncPath &path, int64_t expectedSize);
         bool removeTmpFile(const SyncPath &path);
         bool moveTmpFile(const SyncPath &path, bool &restartSync);
 
@@ -57,8 +83,14 @@ class DownloadJob : public AbstractTokenNetworkJob {
         bool _isCreate = false;
         bool _ignoreDateTime = false;
         bool _responseHandlingCanceled = false;
+        int64_t _resumeOffset = 0;
+        int _maxSegments = downloadMaxSegments;
+        std::vector<std::shared_ptr<DownloadSegmentJob>> _segmentJobs;
+        std::mutex _segmentJobsMutex;
 
         NodeId _localNodeId;
+
+        friend class TestNetworkJobs;
 };
 
 }  // namespace KDC
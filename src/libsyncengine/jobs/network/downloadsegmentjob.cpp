@@ -0,0 +1,158 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "downloadsegmentjob.h"
+
+#include "libcommonserver/utility/utility.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace KDC {
+
+#define BUF_SIZE 4096 * 1000  // 4MB
+#define TRIALS 5
+
+DownloadSegmentJob::DownloadSegmentJob(int driveDbId, const NodeId &remoteFileId, const SyncPath &filePath, int64_t offset,
+                                       int64_t length, int64_t totalSize)
+    : AbstractTokenNetworkJob(ApiDrive, 0, 0, driveDbId, 0, false),
+      _remoteFileId(remoteFileId),
+      _filePath(filePath),
+      _offset(offset),
+      _length(length),
+      _totalSize(totalSize) {
+    _httpMethod = Poco::Net::HTTPRequest::HTTP_GET;
+    _customTimeout = 60;
+    _trials = TRIALS;
+    _progress = 0;
+}
+
+bool DownloadSegmentJob::parseContentRange(const std::string &value, int64_t &start, int64_t &end, int64_t &total) {
+    static const std::string unit = "bytes ";
+    if (value.rfind(unit, 0) != 0) {
+        return false;
+    }
+
+    const size_t dashPos = value.find('-', unit.size());
+    const size_t slashPos = dashPos == std::string::npos ? std::string::npos : value.find('/', dashPos);
+    if (slashPos == std::string::npos) {
+        return false;
+    }
+
+    try {
+        start = std::stoll(value.substr(unit.size(), dashPos - unit.size()));
+        end = std::stoll(value.substr(dashPos + 1, slashPos - dashPos - 1));
+        const std::string totalStr = value.substr(slashPos + 1);
+        total = totalStr == "*" ? -1 : std::stoll(totalStr);
+    } catch (std::exception &) {
+        return false;
+    }
+
+    return start >= 0 && start <= end;
+}
+
+std::string DownloadSegmentJob::getSpecificUrl() {
+    std::string str = AbstractTokenNetworkJob::getSpecificUrl();
+    str += "/files/";
+    str += _remoteFileId;
+    str += "/download";
+    return str;
+}
+
+void DownloadSegmentJob::setData(bool &canceled) {
+    canceled = false;
+
+    // Only request the part of the range that has not been written by a previous trial
+    addRawHeader("Range", "bytes=" + std::to_string(_offset + _written) + "-" + std::to_string(_offset + _length - 1));
+}
+
+bool DownloadSegmentJob::handleResponse(std::istream &is) {
+    std::string contentRange;
+    try {
+        contentRange = _resHttp.get("Content-Range");
+    } catch (...) {
+        // No Content-Range
+    }
+
+    int64_t start = 0;
+    int64_t end = 0;
+    int64_t total = 0;
+    if (getStatusCode() != Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT ||
+        !parseContentRange(contentRange, start, end, total) || start != _offset + _written || end != _offset + _length - 1 ||
+        total != _totalSize) {
+        LOG_INFO(_logger, "Request " << jobId() << ": unexpected range \"" << contentRange.c_str() << "\" for file "
+                                     << _remoteFileId.c_str() << ", segmented download not possible");
+        _rangeNotSupported = true;
+        _exitCode = ExitCodeBackError;
+        _exitCause = ExitCauseApiErr;
+        return true;
+    }
+
+    // The file is preallocated, it must not be truncated
+    std::ofstream output(_filePath.native().c_str(), std::ios::binary | std::ios::in | std::ios::out);
+    if (!output) {
+        LOGW_WARN(_logger, L"Failed to open file: " << Utility::formatSyncPath(_filePath).c_str());
+        _exitCode = ExitCodeSystemError;
+        _exitCause = ExitCauseFileAccessError;
+        return false;
+    }
+
+    output.seekp(_offset + _written);
+    std::unique_ptr<char[]> buffer(new char[BUF_SIZE]);
+    while (_written < _length) {
+        if (isAborted()) {
+            LOG_DEBUG(_logger, "Request " << jobId() << ": aborted");
+            return true;
+        }
+
+        is.read(buffer.get(), static_cast<std::streamsize>(std::min(static_cast<int64_t>(BUF_SIZE), _length - _written)));
+        const std::streamsize readSize = is.gcount();
+        if (readSize > 0) {
+            output.write(buffer.get(), readSize);
+            if (output.bad()) {
+                LOG_WARN(_logger,
+                         "Request " << jobId() << ": error after writing " << _written << " bytes at offset " << _offset);
+                _exitCode = ExitCodeSystemError;
+                _exitCause = ExitCauseFileAccessError;
+                return false;
+            }
+            _written += readSize;
+            _progress = _written;
+        }
+
+        if (!is && _written < _length) {
+            // The bytes already written are not requested again by the next trial
+            LOG_WARN(_logger, "Request " << jobId() << ": error after reading " << _written << " bytes at offset " << _offset);
+            _exitCode = ExitCodeNetworkError;
+            return false;
+        }
+    }
+
+    output.close();
+    if (output.bad()) {
+        LOG_WARN(_logger, "Request " << jobId() << ": error after closing file");
+        _exitCode = ExitCodeSystemError;
+        _exitCause = ExitCauseFileAccessError;
+        return false;
+    }
+
+    _exitCode = ExitCodeOk;
+    return true;
+}
+
+}  // namespace KDC
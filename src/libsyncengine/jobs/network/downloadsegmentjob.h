@@ -0,0 +1,61 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "abstracttokennetworkjob.h"
+
+namespace KDC {
+
+/**
+ * Downloads the byte range [offset, offset + length) of a file into a preallocated file, at the same offset.
+ * Each segment writes through its own file handle, so segments can run in parallel.
+ */
+class DownloadSegmentJob : public AbstractTokenNetworkJob {
+    public:
+        DownloadSegmentJob(int driveDbId, const NodeId &remoteFileId, const SyncPath &filePath, int64_t offset, int64_t length,
+                           int64_t totalSize);
+
+        inline int64_t offset() const { return _offset; }
+        inline int64_t length() const { return _length; }
+        inline int64_t written() const { return _written; }
+        /** True if the server ignored the Range header or the file size changed. The whole file must then be downloaded at once.
+         */
+        inline bool rangeNotSupported() const { return _rangeNotSupported; }
+
+        /** Parses a `Content-Range: bytes <start>-<end>/<total>` header value. The total is -1 if unknown (`*`).
+         */
+        static bool parseContentRange(const std::string &value, int64_t &start, int64_t &end, int64_t &total);
+
+    private:
+        virtual std::string getSpecificUrl() override;
+        virtual void setQueryParameters(Poco::URI &, bool &) override {}
+        virtual void setData(bool &canceled) override;
+
+        virtual bool handleResponse(std::istream &is) override;
+
+        NodeId _remoteFileId;
+        SyncPath _filePath;
+        int64_t _offset = 0;
+        int64_t _length = 0;
+        int64_t _totalSize = 0;
+        int64_t _written = 0;  // Kept across trials to only request the missing part of the range
+        bool _rangeNotSupported = false;
+};
+
+}  // namespace KDC
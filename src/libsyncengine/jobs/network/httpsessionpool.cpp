@@ -0,0 +1,201 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpsessionpool.h"
+#include "jobs/network/networkjobsparams.h"
+#include "libcommonserver/network/proxy.h"
+
+#include <Poco/Net/Socket.h>
+
+namespace KDC {
+
+HttpSessionPool *HttpSessionPool::_instance = nullptr;
+
+HttpSessionPool *HttpSessionPool::instance() {
+    static std::once_flag once;
+    std::call_once(once, [] { _instance = new HttpSessionPool(); });
+    return _instance;
+}
+
+std::unique_ptr<Poco::Net::HTTPSClientSession> HttpSessionPool::checkOut(const Poco::URI &uri, int timeout,
+                                                                         Poco::Net::Context::Ptr context, int driveDbId,
+                                                                         bool &reused) {
+    const ProxyConfig proxyConfig = Proxy::instance()->proxyConfig();
+    const bool useProxy = proxyConfig.type() == ProxyTypeHTTP;
+    const int sessionTimeout = timeout ? timeout : sessionDefaultTimeout;
+    const std::string proxyHost = useProxy ? proxyConfig.hostName() : "";
+    const uint16_t proxyPort = useProxy ? static_cast<uint16_t>(proxyConfig.port()) : 0;
+    const std::string proxyUser = useProxy && proxyConfig.needsAuth() ? proxyConfig.user() : "";
+    const std::string key = sessionKey(uri.getHost(), uri.getPort(), sessionTimeout, proxyHost, proxyPort, proxyUser);
+    const std::string proxySignature = std::to_string(static_cast<int>(proxyConfig.type())) + "/" + proxyConfig.hostName() + ":" +
+                                       std::to_string(proxyConfig.port()) + "/" + proxyConfig.user() + "/" +
+                                       std::to_string(std::hash<std::string>()(proxyConfig.token()));
+
+    // Closing a connection may shut down TLS on the network: the closed connections are destroyed once the mutex is released
+    std::vector<std::unique_ptr<Poco::Net::HTTPSClientSession>> closedSessions;
+    Poco::Net::Session::Ptr tlsSession;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (driveDbId) {
+            _sessionCheckedIn.wait(lock, [this, driveDbId] {
+                return _nbActiveSessionsByDrive[driveDbId] < sessionPoolMaxActivePerDrive;
+            });
+            _nbActiveSessionsByDrive[driveDbId]++;
+        }
+
+        if (proxySignature != _proxySignature) {
+            // The connections opened with the previous proxy settings must not be reused
+            for (auto &[idleKey, idleSessions] : _idleSessions) {
+                for (IdleSession &idleSession : idleSessions) {
+                    closedSessions.push_back(std::move(idleSession.session));
+                }
+            }
+            _idleSessions.clear();
+            _tlsSessions.clear();
+            _proxySignature = proxySignature;
+        }
+        evictIdleSessions(closedSessions);
+
+        auto idleSessionsIt = _idleSessions.find(key);
+        while (idleSessionsIt != _idleSessions.end() && !idleSessionsIt->second.empty()) {
+            std::unique_ptr<Poco::Net::HTTPSClientSession> session = std::move(idleSessionsIt->second.back().session);
+            idleSessionsIt->second.pop_back();
+            if (isStale(*session)) {
+                closedSessions.push_back(std::move(session));
+                continue;
+            }
+
+            reused = true;
+            _nbReusedSessions++;
+            return session;
+        }
+
+        if (const auto tlsSessionIt = _tlsSessions.find(key); tlsSessionIt != _tlsSessions.end()) {
+            tlsSession = tlsSessionIt->second;
+        }
+    }
+
+    reused = false;
+    _nbCreatedSessions++;
+    std::unique_ptr<Poco::Net::HTTPSClientSession> session;
+    try {
+        if (tlsSession) {
+            session.reset(new Poco::Net::HTTPSClientSession(uri.getHost(), uri.getPort(), context, tlsSession));
+        } else {
+            session.reset(new Poco::Net::HTTPSClientSession(uri.getHost(), uri.getPort(), context));
+        }
+    } catch (...) {
+        // Free the slot of the drive
+        checkIn(nullptr, driveDbId, false);
+        throw;
+    }
+    session->setKeepAlive(true);
+    session->setTimeout(Poco::Timespan(sessionTimeout, 0));
+
+    // Set proxy params
+    if (useProxy) {
+        session->setProxy(proxyHost, proxyPort);
+        if (proxyConfig.needsAuth()) {
+            session->setProxyCredentials(proxyConfig.user(), proxyConfig.token());
+        }
+    }
+
+    return session;
+}
+
+void HttpSessionPool::checkIn(std::unique_ptr<Poco::Net::HTTPSClientSession> session, int driveDbId, bool reusable) {
+    if (driveDbId) {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        if (--_nbActiveSessionsByDrive[driveDbId] <= 0) {
+            _nbActiveSessionsByDrive.erase(driveDbId);
+        }
+        _sessionCheckedIn.notify_all();
+    }
+
+    if (!session || !reusable) {
+        return;
+    }
+
+    const std::string key =
+        sessionKey(session->getHost(), session->getPort(), static_cast<int>(session->getTimeout().totalSeconds()),
+                   session->getProxyHost(), session->getProxyPort(), session->getProxyUsername());
+
+    std::unique_ptr<Poco::Net::HTTPSClientSession> closedSession;
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        if (Poco::Net::Session::Ptr tlsSession = session->sslSession()) {
+            _tlsSessions[key] = tlsSession;
+        }
+
+        std::deque<IdleSession> &idleSessions = _idleSessions[key];
+        if (idleSessions.size() >= sessionPoolMaxIdlePerHost) {
+            // Enough connections to this host are kept, close this one once the mutex is released
+            closedSession = std::move(session);
+        } else {
+            idleSessions.push_back(IdleSession{std::move(session), std::chrono::steady_clock::now()});
+        }
+    }
+}
+
+void HttpSessionPool::clear() {
+    std::unordered_map<std::string, std::deque<IdleSession>> closedSessions;
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        closedSessions.swap(_idleSessions);
+        _tlsSessions.clear();
+    }
+}
+
+size_t HttpSessionPool::nbIdleSessions() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    size_t nbSessions = 0;
+    for (const auto &[key, idleSessions] : _idleSessions) {
+        nbSessions += idleSessions.size();
+    }
+    return nbSessions;
+}
+
+std::string HttpSessionPool::sessionKey(const std::string &host, uint16_t port, int timeout, const std::string &proxyHost,
+                                        uint16_t proxyPort, const std::string &proxyUser) {
+    // Without a proxy, the proxy port of a session is still the default one of Poco, not 0
+    return host + ":" + std::to_string(port) + "/" + std::to_string(timeout) + "/" + proxyUser + "@" + proxyHost + ":" +
+           std::to_string(proxyHost.empty() ? 0 : proxyPort);
+}
+
+bool HttpSessionPool::isStale(Poco::Net::HTTPSClientSession &session) {
+    try {
+        // An idle connection is only readable if the server has closed it
+        return !session.connected() || session.socket().poll(Poco::Timespan(0), Poco::Net::Socket::SELECT_READ);
+    } catch (Poco::Exception &) {
+        return true;
+    }
+}
+
+void HttpSessionPool::evictIdleSessions(std::vector<std::unique_ptr<Poco::Net::HTTPSClientSession>> &evictedSessions) {
+    const auto idleLimit = std::chrono::steady_clock::now() - std::chrono::seconds(sessionPoolIdleTimeout);
+    for (auto it = _idleSessions.begin(); it != _idleSessions.end();) {
+        std::deque<IdleSession> &idleSessions = it->second;
+        while (!idleSessions.empty() && idleSessions.front().idleSince < idleLimit) {
+            evictedSessions.push_back(std::move(idleSessions.front().session));
+            idleSessions.pop_front();
+        }
+        it = idleSessions.empty() ? _idleSessions.erase(it) : std::next(it);
+    }
+}
+
+}  // namespace KDC
@@ -0,0 +1,93 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Poco/Net/Context.h>
+#include <Poco/Net/HTTPSClientSession.h>
+#include <Poco/URI.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace KDC {
+
+/**
+ * Process-wide pool of keep-alive HTTPS connections, shared by all the network jobs.
+ * Connections are pooled per host, port, timeout, proxy and proxy user. The pooled connections are closed when the proxy
+ * settings change. An idle connection is closed after `sessionPoolIdleTimeout` and at most `sessionPoolMaxIdlePerHost` idle
+ * connections are kept per host. The TLS session of the last connection to a host is reused by the new connections to that
+ * host, to avoid full handshakes.
+ * At most `sessionPoolMaxActivePerDrive` connections are checked out per drive, a caller waits when the limit is reached.
+ */
+class HttpSessionPool {
+    public:
+        static HttpSessionPool *instance();
+
+        /** Gets an idle connection to the host of `uri`, or a new one.
+         * Waits until the drive has less than `sessionPoolMaxActivePerDrive` connections checked out.
+         * @param timeout the timeout of the connection (s), 0 for the default one.
+         * @param driveDbId the drive the connection is used for, 0 if none: the number of connections is then not limited.
+         * @param reused true if the connection has already been used by other requests.
+         */
+        std::unique_ptr<Poco::Net::HTTPSClientSession> checkOut(const Poco::URI &uri, int timeout,
+                                                                Poco::Net::Context::Ptr context, int driveDbId, bool &reused);
+        /** Gives back a checked out connection. It is pooled if `reusable`, i.e. if its last response has been fully read,
+         * otherwise closed.
+         */
+        void checkIn(std::unique_ptr<Poco::Net::HTTPSClientSession> session, int driveDbId, bool reusable);
+        void clear();
+
+        inline uint64_t nbCreatedSessions() const { return _nbCreatedSessions; }
+        inline uint64_t nbReusedSessions() const { return _nbReusedSessions; }
+        size_t nbIdleSessions();
+
+    private:
+        HttpSessionPool() = default;
+
+        struct IdleSession {
+                std::unique_ptr<Poco::Net::HTTPSClientSession> session;
+                std::chrono::steady_clock::time_point idleSince;
+        };
+
+        static std::string sessionKey(const std::string &host, uint16_t port, int timeout, const std::string &proxyHost,
+                                      uint16_t proxyPort, const std::string &proxyUser);
+        static bool isStale(Poco::Net::HTTPSClientSession &session);
+        /** Moves the connections idle for too long to `evictedSessions`, to be destroyed once the mutex is released. */
+        void evictIdleSessions(std::vector<std::unique_ptr<Poco::Net::HTTPSClientSession>> &evictedSessions);
+
+        static HttpSessionPool *_instance;
+
+        std::unordered_map<std::string, std::deque<IdleSession>> _idleSessions;  // Most recently used last
+        std::unordered_map<std::string, Poco::Net::Session::Ptr> _tlsSessions;
+        std::string _proxySignature;  // Proxy settings of the pooled connections
+        std::unordered_map<int, int> _nbActiveSessionsByDrive;  // Checked out connections
+        std::mutex _mutex;
+        std::condition_variable _sessionCheckedIn;
+        std::atomic<uint64_t> _nbCreatedSessions = 0;
+        std::atomic<uint64_t> _nbReusedSessions = 0;
+};
+
+}  // namespace KDC
@@ -28,6 +28,16 @@ static const uint64_t chunkMinSize = 10 * 1024 * 1024;                // 10MB
 static const uint64_t useUploadSessionThreshold = 100 * 1024 * 1024;  // if file size > 100MB -> start upload session
 static const uint64_t optimalTotalChunks = 200;
 static const uint64_t maxTotalChunks = 10000;  // Theoretical max. file size 10'000 * 100MB = 1TB
+static const uint64_t uploadBufferPoolDefaultSize = 5 * chunkMaxSize;  // Max. memory used by the chunks being uploaded
+static const int uploadBufferIdleTimeout = 30;                         // A free chunk buffer is released after 30s
+static const int64_t uploadSessionMaxResumeDelay = 24 * 3600;        // An older upload session is not resumed (s)
+static const int64_t downloadSegmentsThreshold = 100 * 1024 * 1024;   // if file size > 100MB -> download ranges in parallel
+static const int64_t downloadSegmentMinSize = 25 * 1024 * 1024;       // 25MB
+static const int downloadMaxSegments = 4;
+static const int sessionDefaultTimeout = 60;   // HTTPS connection timeout when a job does not set one (s)
+static const int sessionPoolIdleTimeout = 10;  // An idle pooled connection is closed after 10s
+static const size_t sessionPoolMaxIdlePerHost = 16;
+static const int sessionPoolMaxActivePerDrive = 32;  // More requests to a drive wait for a connection to be checked in
 
 /*
  * Static string
@@ -0,0 +1,153 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "chunkbufferpool.h"
+#include "jobs/network/networkjobsparams.h"
+#include "libcommon/utility/utility.h"
+
+#include <algorithm>
+
+namespace KDC {
+
+ChunkBufferPool *ChunkBufferPool::_instance = nullptr;
+
+ChunkBufferPool *ChunkBufferPool::instance() {
+    static std::once_flag once;
+    std::call_once(once, [] { _instance = new ChunkBufferPool(); });
+    return _instance;
+}
+
+ChunkBufferPool::ChunkBufferPool() : _budget(uploadBufferPoolDefaultSize) {
+    const std::string budgetStr = CommonUtility::envVarValue("KDRIVE_UPLOAD_BUFFER_POOL_MB");
+    if (!budgetStr.empty()) {
+        try {
+            setBudget(std::stoull(budgetStr) * 1024 * 1024);
+        } catch (std::exception &) {
+            // Keep the default budget
+        }
+    }
+}
+
+std::shared_ptr<ChunkBuffer> ChunkBufferPool::acquire(uint64_t size, std::chrono::milliseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(_mutex);
+    freeIdleBuffers();
+    ChunkBuffer *buffer = nullptr;
+    while (!buffer) {
+        // Reuse the smallest free buffer that is large enough
+        auto bestIt = _freeBuffers.end();
+        for (auto it = _freeBuffers.begin(); it != _freeBuffers.end(); it++) {
+            const uint64_t capacity = it->_buffer->capacity();
+            if (capacity >= size && (bestIt == _freeBuffers.end() || capacity < bestIt->_buffer->capacity())) {
+                bestIt = it;
+            }
+        }
+        if (bestIt != _freeBuffers.end()) {
+            buffer = bestIt->_buffer.release();
+            _freeBuffers.erase(bestIt);
+            break;
+        }
+
+        // A buffer larger than the budget is allowed when no other buffer is in use, otherwise nothing could be uploaded
+        if (_usedSize + size <= _budget || _usedSize == 0) {
+            // Free buffers are too small, release them until the new one fits
+            while (_allocatedSize + size > _budget && !_freeBuffers.empty()) {
+                freeLastBuffer();
+            }
+            buffer = new ChunkBuffer(size);
+            _allocatedSize += size;
+            break;
+        }
+
+        if (_bufferReleased.wait_until(lock, deadline) == std::cv_status::timeout) {
+            return nullptr;
+        }
+    }
+
+    _usedSize += buffer->capacity();
+    buffer->setSize(0);
+    return std::shared_ptr<ChunkBuffer>(buffer, [this](ChunkBuffer *releasedBuffer) { release(releasedBuffer); });
+}
+
+void ChunkBufferPool::sessionStarted() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _nbSessions++;
+}
+
+void ChunkBufferPool::sessionFinished() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _nbSessions--;
+    if (_nbSessions == 0) {
+        // The buffers still used by the chunk jobs of the session are freed when released
+        while (!_freeBuffers.empty()) {
+            freeLastBuffer();
+        }
+    }
+}
+
+void ChunkBufferPool::setBudget(uint64_t budget) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _budget = std::max(budget, chunkMinSize);
+    while (_allocatedSize > _budget && !_freeBuffers.empty()) {
+        freeLastBuffer();
+    }
+    _bufferReleased.notify_all();
+}
+
+uint64_t ChunkBufferPool::allocatedSize() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _allocatedSize;
+}
+
+uint64_t ChunkBufferPool::usedSize() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _usedSize;
+}
+
+void ChunkBufferPool::release(ChunkBuffer *buffer) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _usedSize -= buffer->capacity();
+    if (_allocatedSize > _budget || _nbSessions == 0) {
+        // The budget has been lowered or exceeded by an oversized buffer, or no session needs it anymore
+        _allocatedSize -= buffer->capacity();
+        delete buffer;
+    } else {
+        _freeBuffers.push_back(FreeBuffer{std::unique_ptr<ChunkBuffer>(buffer), std::chrono::steady_clock::now()});
+    }
+    freeIdleBuffers();
+    _bufferReleased.notify_all();
+}
+
+void ChunkBufferPool::freeIdleBuffers() {
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = _freeBuffers.begin(); it != _freeBuffers.end();) {
+        if (now - it->_releaseTime > std::chrono::seconds(uploadBufferIdleTimeout)) {
+            _allocatedSize -= it->_buffer->capacity();
+            it = _freeBuffers.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void ChunkBufferPool::freeLastBuffer() {
+    _allocatedSize -= _freeBuffers.back()._buffer->capacity();
+    _freeBuffers.pop_back();
+}
+
+}  // namespace KDC
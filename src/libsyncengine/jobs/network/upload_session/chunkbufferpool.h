@@ -0,0 +1,98 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace KDC {
+
+/**
+ * A chunk of file content. The buffer goes back to its pool when the last reference is released.
+ */
+class ChunkBuffer {
+    public:
+        explicit ChunkBuffer(uint64_t capacity) : _data(new char[capacity]), _capacity(capacity) {}
+
+        inline char *data() { return _data.get(); }
+        inline uint64_t capacity() const { return _capacity; }
+        inline uint64_t size() const { return _size; }
+        inline void setSize(uint64_t size) { _size = size; }
+        inline std::string_view view() const { return std::string_view(_data.get(), _size); }
+
+    private:
+        std::unique_ptr<char[]> _data;
+        uint64_t _capacity = 0;
+        uint64_t _size = 0;
+};
+
+/**
+ * Process-wide pool of the buffers used to upload file chunks.
+ * The total size of the buffers, in use or free, never exceeds the pool budget: callers wait for a buffer to be released
+ * when the budget is reached. The budget can be set with the KDRIVE_UPLOAD_BUFFER_POOL_MB environment variable.
+ * Free buffers are kept for the running upload sessions only: they are freed once idle for too long or once the last
+ * session has finished.
+ */
+class ChunkBufferPool {
+    public:
+        static ChunkBufferPool *instance();
+
+        /** Gets a buffer of at least `size` bytes, waiting at most `timeout` for other buffers to be released.
+         * @return nullptr if the timeout expired.
+         */
+        std::shared_ptr<ChunkBuffer> acquire(uint64_t size, std::chrono::milliseconds timeout);
+
+        /** To call around the upload of the chunks of a session. */
+        void sessionStarted();
+        void sessionFinished();
+
+        inline uint64_t budget() const { return _budget; }
+        void setBudget(uint64_t budget);
+        uint64_t allocatedSize();
+        uint64_t usedSize();
+
+    private:
+        ChunkBufferPool();
+
+        struct FreeBuffer {
+                std::unique_ptr<ChunkBuffer> _buffer;
+                std::chrono::steady_clock::time_point _releaseTime;
+        };
+
+        void release(ChunkBuffer *buffer);
+        // Called with the mutex held
+        void freeIdleBuffers();
+        void freeLastBuffer();
+
+        static ChunkBufferPool *_instance;
+
+        uint64_t _budget = 0;
+        uint64_t _allocatedSize = 0;  // In use + free
+        uint64_t _usedSize = 0;
+        int _nbSessions = 0;
+        std::vector<FreeBuffer> _freeBuffers;
+        std::mutex _mutex;
+        std::condition_variable _bufferReleased;
+};
+
+}  // namespace KDC
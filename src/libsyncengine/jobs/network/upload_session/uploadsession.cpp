@@ -19,6 +19,7 @@
 #include "uploadsession.h"
 
 #include "uploadsessionchunkjob.h"
+#include "chunkbufferpool.h"
 #include "uploadsessionfinishjob.h"
 #include "uploadsessionstartjob.h"
 #include "uploadsessioncanceljob.h"
@@ -32,6 +33,7 @@
 
 #include <log4cplus/loggingmacros.h>
 
+#include <algorithm>
 #include <fstream>
 
 #include <xxhash.h>
@@ -88,11 +90,12 @@ void UploadSession::runJob() {
 
     bool ok = true;
 
+    ChunkBufferPool::instance()->sessionStarted();
     while (_state != StateFinished) {
         switch (_state) {
             case StateInitChunk: {
                 ok = initChunks();
-                _state = StateStartUploadSession;
+                _state = ok && resumeSession() ? StateUploadChunks : StateStartUploadSession;
                 break;
             }
             case StateStartUploadSession: {
@@ -102,6 +105,14 @@ void UploadSession::runJob() {
             }
             case StateUploadChunks: {
                 ok = sendChunks();
+                if (!ok && _resumed && _exitCode != ExitCodeNetworkError && !isAborted()) {
+                    // The server may have dropped the session in the meantime
+                    LOG_INFO(_logger, "Failed to resume upload session " << _sessionToken.c_str() << ", starting a new one");
+                    restartSession();
+                    ok = true;
+                    _state = StateStartUploadSession;
+                    break;
+                }
                 _state = StateStopUploadSession;
                 break;
             }
@@ -115,10 +126,15 @@ void UploadSession::runJob() {
         }
 
         if (!ok || isAborted()) {
+            if (!ok && _exitCode != ExitCodeNetworkError) {
+                // The session cannot be resumed
+                _resumable = false;
+            }
             abort();
             break;
         }
     }
+    ChunkBufferPool::instance()->sessionFinished();
 
     auto end = std::chrono::steady_clock::now();
     std::chrono::duration<double> elapsed_seconds = end - start;
@@ -135,6 +151,13 @@ void UploadSession::uploadChunkCallback(UniqueId jobId) {
             _exitCode = jobInfo.mapped()->exitCode();
             _exitCause = jobInfo.mapped()->exitCause();
             _jobExecutionError = true;
+        } else if (jobInfo.mapped() && (jobInfo.mapped()->isAborted() || isAborted())) {
+            // An aborted request ends without error, but the chunk may have been cut: it will be sent again on resume
+            LOG_INFO(_logger, "Chunk " << jobInfo.mapped()->chunkNb() << " of session " << _sessionToken.c_str() << " aborted");
+        } else if (jobInfo.mapped() && _resumable &&
+                   !_syncDb->insertUploadSessionChunk(_uploadSessionTokenDbId, jobInfo.mapped()->chunkNb(),
+                                                      jobInfo.mapped()->chunkHash())) {
+            LOG_WARN(_logger, "Error in SyncDb::insertUploadSessionChunk");
         }
 
         _threadCounter--;
@@ -146,6 +169,12 @@ void UploadSession::uploadChunkCallback(UniqueId jobId) {
 
 void UploadSession::abort() {
     AbstractJob::abort();
+    if (_resumable) {
+        // Keep the session to resume it on next sync
+        LOG_INFO(_logger, "Upload session " << _sessionToken.c_str() << " interrupted, it will be resumed");
+        abortChunkJobs();
+        return;
+    }
     cancelSession();
 }
 
@@ -197,6 +226,73 @@ bool UploadSession::initChunks() {
     return true;
 }
 
+bool UploadSession::resumeSession() {
+    if (!_syncDb) {
+        return false;
+    }
+
+    UploadSessionInfo uploadSessionInfo;
+    bool found = false;
+    if (!_syncDb->selectUploadSessionInfo(_filePath, uploadSessionInfo, found)) {
+        LOG_WARN(_logger, "Error in SyncDb::selectUploadSessionInfo");
+        return false;
+    }
+    if (!found) {
+        return false;
+    }
+
+    const SyncTime now =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (uploadSessionInfo.size() != static_cast<int64_t>(_filesize) || uploadSessionInfo.modtime() != _modtimeIn ||
+        uploadSessionInfo.fileName() != _filename || uploadSessionInfo.remoteParentDirId() != _remoteParentDirId ||
+        uploadSessionInfo.chunkSize() != static_cast<int64_t>(_chunkSize) ||
+        uploadSessionInfo.totalChunks() != static_cast<int64_t>(_totalChunks) ||
+        now - uploadSessionInfo.creationTime() > uploadSessionMaxResumeDelay) {
+        // The file has changed or the session is too old
+        LOGW_DEBUG(_logger, L"Upload session of file " << Path2WStr(_filePath.filename()).c_str() << L" cannot be resumed");
+        bool deleted = false;
+        if (!_syncDb->deleteUploadSessionTokenByDbId(uploadSessionInfo.tokenDbId(), deleted)) {
+            LOG_WARN(_logger, "Error in SyncDb::deleteUploadSessionTokenByDbId");
+        }
+        try {
+            UploadSessionCancelJob cancelJob(_driveDbId, _filePath, uploadSessionInfo.token());
+            cancelJob.runSynchronously();
+        } catch (std::exception const &e) {
+            LOG_WARN(_logger, "Error in UploadSessionCancelJob: " << e.what());
+        }
+        return false;
+    }
+
+    _sessionToken = uploadSessionInfo.token();
+    _uploadSessionTokenDbId = uploadSessionInfo.tokenDbId();
+    _uploadedChunkHashes = uploadSessionInfo.chunkHashes();
+    _sessionStarted = true;
+    _resumable = true;
+    _resumed = true;
+
+    LOG_INFO(_logger, "Resuming upload session " << _sessionToken.c_str() << ": " << _uploadedChunkHashes.size() << "/"
+                                                 << _totalChunks << " chunks already uploaded");
+    return true;
+}
+
+void UploadSession::restartSession() {
+    bool found = false;
+    if (_syncDb && !_syncDb->deleteUploadSessionTokenByDbId(_uploadSessionTokenDbId, found)) {
+        LOG_WARN(_logger, "Error in SyncDb::deleteUploadSessionTokenByDbId");
+    }
+
+    _sessionToken.clear();
+    _uploadSessionTokenDbId = 0;
+    _uploadedChunkHashes.clear();
+    _sessionStarted = false;
+    _resumable = false;
+    _resumed = false;
+    _jobExecutionError = false;
+    _exitCode = ExitCodeOk;
+    _exitCause = ExitCauseUnknown;
+    _progress = 0;
+}
+
 bool UploadSession::startSession() {
     try {
         UploadSessionStartJob startJob(_driveDbId, _filename, _filesize, _remoteParentDirId, _totalChunks);
@@ -230,6 +326,20 @@ bool UploadSession::startSession() {
         }
         _uploadSessionTokenDbId = uploadSessionTokenDbId;
         _sessionStarted = true;
+
+        // Record the file being uploaded so that the session can be resumed if it is interrupted
+        if (_syncDb) {
+            const SyncTime now =
+                std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            UploadSessionInfo uploadSessionInfo(_uploadSessionTokenDbId, _filePath, _filename, _remoteParentDirId,
+                                                static_cast<int64_t>(_filesize), _modtimeIn, static_cast<int64_t>(_chunkSize),
+                                                static_cast<int64_t>(_totalChunks), now);
+            if (_syncDb->insertUploadSessionInfo(uploadSessionInfo)) {
+                _resumable = true;
+            } else {
+                LOG_WARN(_logger, "Error in SyncDb::insertUploadSessionInfo");
+            }
+        }
     } catch (std::exception const &e) {
         LOG_WARN(_logger, "Error in UploadSessionStartJob: " << e.what());
         _exitCode = ExitCodeDataError;
@@ -277,14 +387,41 @@ bool UploadSession::sendChunks() {
         return false;
     }
 
+    bool seekNeeded = false;
     for (uint64_t chunkNb = 1; chunkNb <= _totalChunks; chunkNb++) {
         if (isAborted() || _jobExecutionError) {
             LOG_DEBUG(_logger, "Request " << jobId() << ": aborted");
             break;
         }
 
-        std::unique_ptr<char[]> memblock(new char[_chunkSize]);
-        file.read(memblock.get(), (std::streamsize)_chunkSize);
+        if (auto uploadedChunkIt = _uploadedChunkHashes.find(chunkNb); uploadedChunkIt != _uploadedChunkHashes.end()) {
+            // Already uploaded before the session was interrupted
+            if (XXH3_64bits_update(state, uploadedChunkIt->second.data(), uploadedChunkIt->second.length()) == XXH_ERROR) {
+                LOGW_WARN(_logger, L"Checksum computation " << jobId() << L" failed for file " << Path2WStr(_filePath).c_str());
+                checksumError = true;
+                break;
+            }
+            _progress += std::min(_chunkSize, _filesize - (chunkNb - 1) * _chunkSize);
+            seekNeeded = true;
+            continue;
+        }
+
+        if (seekNeeded) {
+            file.seekg(static_cast<std::streamoff>((chunkNb - 1) * _chunkSize));
+            seekNeeded = false;
+        }
+
+        // Wait for the chunks being uploaded to release enough memory
+        std::shared_ptr<ChunkBuffer> chunk;
+        while (!chunk && !isAborted() && !_jobExecutionError) {
+            chunk = ChunkBufferPool::instance()->acquire(_chunkSize, std::chrono::milliseconds(200));
+        }
+        if (!chunk) {
+            LOG_DEBUG(_logger, "Request " << jobId() << ": aborted");
+            break;
+        }
+
+        file.read(chunk->data(), (std::streamsize)_chunkSize);
         if (file.bad() && !file.fail()) {
             // Read/writing error and not logical error
             LOGW_WARN(_logger, L"Failed to read chunk - path=" << Path2WStr(_filePath).c_str());
@@ -302,12 +439,11 @@ bool UploadSession::sendChunks() {
             break;
         }
 
-        const auto chunkContent = std::string(memblock.get(), actualChunkSize);
+        chunk->setSize(actualChunkSize);
 
         std::shared_ptr<UploadSessionChunkJob> chunkJob;
         try {
-            chunkJob = std::make_shared<UploadSessionChunkJob>(_driveDbId, _filePath, _sessionToken, chunkContent, chunkNb,
-                                                               actualChunkSize, jobId());
+            chunkJob = std::make_shared<UploadSessionChunkJob>(_driveDbId, _filePath, _sessionToken, chunk, chunkNb, jobId());
         } catch (std::exception const &e) {
             LOG_ERROR(_logger, "Error in UploadSessionChunkJob::UploadSessionChunkJob: " << e.what());
             jobCreationError = true;
@@ -352,6 +488,15 @@ bool UploadSession::sendChunks() {
                 break;
             }
 
+            if (chunkJob->isAborted() || isAborted()) {
+                // The chunk may have been cut, it will be sent again on resume
+                break;
+            }
+
+            if (_resumable && !_syncDb->insertUploadSessionChunk(_uploadSessionTokenDbId, chunkNb, chunkJob->chunkHash())) {
+                LOG_WARN(_logger, "Error in SyncDb::insertUploadSessionChunk");
+            }
+
             _progress += actualChunkSize;
         }
     }
@@ -452,15 +597,7 @@ bool UploadSession::cancelSession() {
         return false;
     }
 
-    // Cancel all ongoing chunk jobs
-    _mutex.lock();
-    std::unordered_map<UniqueId, std::shared_ptr<UploadSessionChunkJob>>::iterator it = _ongoingChunkJobs.begin();
-    for (; it != _ongoingChunkJobs.end(); it++) {
-        if (it->second->sessionToken() == _sessionToken) {
-            it->second->abort();
-        }
-    }
-    _mutex.unlock();
+    abortChunkJobs();
 
     try {
         UploadSessionCancelJob cancelJob(_driveDbId, _filePath, _sessionToken);
@@ -493,6 +630,15 @@ bool UploadSession::cancelSession() {
     return true;
 }
 
+void UploadSession::abortChunkJobs() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &[chunkJobId, chunkJob] : _ongoingChunkJobs) {
+        if (chunkJob->sessionToken() == _sessionToken) {
+            chunkJob->abort();
+        }
+    }
+}
+
 void UploadSession::waitForJobsToComplete(bool all) {
     while (_threadCounter > (all ? 0 : _nbParalleleThread) && !isAborted() && !_jobExecutionError) {
         if (isExtendedLog()) {
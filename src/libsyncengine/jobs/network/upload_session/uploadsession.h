@@ -24,6 +24,7 @@
 
 #include <log4cplus/logger.h>
 
+#include <map>
 #include <unordered_map>
 
 namespace KDC {
@@ -56,10 +57,13 @@ class UploadSession : public AbstractJob {
         virtual void runJob() override;
 
         bool initChunks();
+        bool resumeSession();
         bool startSession();
         bool sendChunks();
         bool closeSession();
         bool cancelSession();
+        void abortChunkJobs();
+        void restartSession();
         void waitForJobsToComplete(bool all);
 
         log4cplus::Logger _logger;
@@ -79,6 +83,8 @@ class UploadSession : public AbstractJob {
         bool _sessionStarted = false;
         bool _sessionCancelled = false;
         bool _jobExecutionError = false;
+        bool _resumable = false;  // The session is recorded in the sync DB and is kept on interruption
+        bool _resumed = false;
 
         std::string _sessionToken;
 
@@ -86,6 +92,7 @@ class UploadSession : public AbstractJob {
         uint64_t _chunkSize = 0;
         uint64_t _totalChunks = 0;
         std::string _totalChunkHash;  // This is not a content checksum. It is the hash of all the chunk hash concatenated
+        std::map<int64_t, std::string> _uploadedChunkHashes;  // Chunks uploaded before the session was interrupted
 
         NodeId _nodeId;
         SyncTime _modtimeOut = 0;
@@ -24,22 +24,32 @@
 namespace KDC {
 
 UploadSessionChunkJob::UploadSessionChunkJob(int driveDbId, const SyncPath &filepath, const std::string &sessionToken,
-                                             const std::string &chunkContent, uint64_t chunkNb, uint64_t chunkSize,
-                                             UniqueId sessionJobId)
+                                             std::shared_ptr<ChunkBuffer> chunk, uint64_t chunkNb, UniqueId sessionJobId)
     : AbstractUploadSessionJob(driveDbId, filepath, sessionToken),
+      _chunk(chunk),
       _chunkNb(chunkNb),
-      _chunkSize(chunkSize),
+      _chunkSize(chunk->size()),
       _sessionJobId(sessionJobId) {
     _httpMethod = Poco::Net::HTTPRequest::HTTP_POST;
     _customTimeout = 60;
     _trials = TRIALS;
 
-    _data = chunkContent;
-    _chunkHash = Utility::computeXxHash(_data);
+    _chunkHash = Utility::computeXxHash(_chunk->data(), _chunk->size());
 }
 
 UploadSessionChunkJob::~UploadSessionChunkJob() {}
 
+void UploadSessionChunkJob::runJob() noexcept {
+    AbstractUploadSessionJob::runJob();
+
+    // Give the buffer back to the pool without waiting for the job to be destroyed
+    _chunk.reset();
+}
+
+std::string_view UploadSessionChunkJob::getData() const {
+    return _chunk ? _chunk->view() : std::string_view();
+}
+
 std::string UploadSessionChunkJob::getSpecificUrl() {
     std::string str = AbstractTokenNetworkJob::getSpecificUrl();
     str += "/upload/session/";
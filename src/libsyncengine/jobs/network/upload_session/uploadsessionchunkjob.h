@@ -19,26 +19,35 @@
 #pragma once
 
 #include "jobs/network/upload_session/abstractuploadsessionjob.h"
+#include "jobs/network/upload_session/chunkbufferpool.h"
 #include "jobs/network/networkjobsparams.h"
 
 namespace KDC {
 
 class UploadSessionChunkJob : public AbstractUploadSessionJob {
     public:
+        /** The chunk is hashed and sent directly from the buffer, which is released as soon as the request is done.
+         */
         UploadSessionChunkJob(int driveDbId, const SyncPath &filepath, const std::string &sessionToken,
-                              const std::string &chunkContent, uint64_t chunkNb, uint64_t chunkSize, UniqueId sessionJobId);
+                              std::shared_ptr<ChunkBuffer> chunk, uint64_t chunkNb, UniqueId sessionJobId);
         ~UploadSessionChunkJob();
 
         inline const std::string &chunkHash() const { return _chunkHash; }
         inline UniqueId sessionJobId() const { return _sessionJobId; }
+        inline uint64_t chunkNb() const { return _chunkNb; }
         inline uint64_t chunkSize() const { return _chunkSize; }
 
+    protected:
+        virtual void runJob() noexcept override;
+        virtual std::string_view getData() const override;
+
     private:
         virtual std::string getSpecificUrl() override;
         virtual std::string getContentType(bool &canceled) override;
         virtual void setQueryParameters(Poco::URI &, bool &canceled) override;
         virtual void setData(bool &) override {}
 
+        std::shared_ptr<ChunkBuffer> _chunk;
         std::string _chunkHash;
         uint64_t _chunkNb = 0;
         uint64_t _chunkSize = 0;
@@ -22,9 +22,12 @@
 #include "libcommonserver/utility/utility.h"
 #include "utility/jsonparserutility.h"
 
-#include <fstream>
+#include <memory>
+
+#include <xxhash.h>
 
 #define TRIALS 5
+#define READ_BUFFER_SIZE (1024 * 1024)  // 1MB
 
 namespace KDC {
 
@@ -131,7 +134,7 @@ void UploadJob::setQueryParameters(Poco::URI &uri, bool &canceled) {
         uri.addQueryParameter("file_id", _fileId);
     }
 
-    uri.addQueryParameter("total_size", std::to_string(_data.size()));
+    uri.addQueryParameter("total_size", std::to_string(_isFileStreamed ? _fileSize : _data.size()));
 
     uri.addQueryParameter("total_chunk_hash", "xxh3:" + _contentHash);
     uri.addQueryParameter(lastModifiedAtKey, std::to_string(_modtimeIn));
@@ -164,6 +167,7 @@ void UploadJob::setData(bool &canceled) {
 
     _linkType = itemType.linkType;
     _targetType = itemType.targetType;
+    _isFileStreamed = false;
 
     if (IoHelper::isLink(_linkType)) {
         LOG_DEBUG(_logger, "Read link data - type=" << _linkType);
@@ -173,7 +177,9 @@ void UploadJob::setData(bool &canceled) {
         if (!readFile()) return;
     }
 
-    _contentHash = Utility::computeXxHash(_data);
+    if (!_isFileStreamed) {
+        _contentHash = Utility::computeXxHash(_data);
+    }
 
     canceled = false;
 }
@@ -203,46 +209,73 @@ bool UploadJob::readFile() {
         return false;
     }
 
-    std::ostringstream ostrm;
-    ostrm << file.rdbuf();
-    if (ostrm.bad()) {
-        // Read/writing error or logical error
-        LOGW_WARN(_logger, L"Failed to insert file content into string stream - path=" << Path2WStr(_filePath).c_str());
+    // The hash is sent before the content: it is computed in a first pass over the file
+    std::unique_ptr<XXH3_state_t, decltype(&XXH3_freeState)> state(XXH3_createState(), &XXH3_freeState);
+    if (!state || XXH3_64bits_reset(state.get()) == XXH_ERROR) {
+        LOGW_WARN(_logger, L"Failed to create hash state - path=" << Path2WStr(_filePath).c_str());
         _exitCode = ExitCodeSystemError;
-        _exitCause = ExitCauseFileAccessError;
+        _exitCause = ExitCauseNotEnoughtMemory;
         return false;
     }
 
-    ostrm.flush();
-    if (ostrm.bad()) {
-        // Read/writing error or logical error
-        LOGW_WARN(_logger, L"Failed to flush string stream - path=" << Path2WStr(_filePath).c_str());
+    std::unique_ptr<char[]> buffer(new char[READ_BUFFER_SIZE]);
+    _fileSize = 0;
+    while (file.read(buffer.get(), READ_BUFFER_SIZE) || file.gcount() > 0) {
+        if (XXH3_64bits_update(state.get(), buffer.get(), static_cast<size_t>(file.gcount())) == XXH_ERROR) {
+            LOGW_WARN(_logger, L"Failed to hash file content - path=" << Path2WStr(_filePath).c_str());
+            _exitCode = ExitCodeSystemError;
+            _exitCause = ExitCauseUnknown;
+            return false;
+        }
+        _fileSize += static_cast<uint64_t>(file.gcount());
+    }
+
+    if (file.bad()) {
+        LOGW_WARN(_logger, L"Failed to read file - path=" << Path2WStr(_filePath).c_str());
         _exitCode = ExitCodeSystemError;
         _exitCause = ExitCauseFileAccessError;
         return false;
     }
 
-    file.close();
-    if (file.bad()) {
-        // Read/writing error or logical error
-        LOGW_WARN(_logger, L"Failed to close file - path=" << Path2WStr(_filePath).c_str());
+    _contentHash = Utility::xxHashToStr(XXH3_64bits_digest(state.get()));
+    _isFileStreamed = true;
+
+    return true;
+}
+
+bool UploadJob::openData() {
+    // Opened again for each request, so that the file is not locked between them and a redirection sends it from its beginning
+    closeData();
+    _file.clear();
+    _file.open(_filePath, std::ios_base::in | std::ios_base::binary);
+    if (!_file.is_open()) {
+        LOGW_WARN(_logger, L"Failed to open file - path=" << Path2WStr(_filePath).c_str());
         _exitCode = ExitCodeSystemError;
         _exitCause = ExitCauseFileAccessError;
         return false;
     }
 
-    try {
-        _data = ostrm.str();
-    } catch (const std::bad_alloc &) {
-        LOGW_WARN(_logger, L"Memory allocation error when setting data content - path=" << Path2WStr(_filePath).c_str());
+    return true;
+}
+
+bool UploadJob::readData(char *buffer, size_t size) {
+    if (!_file.read(buffer, static_cast<std::streamsize>(size))) {
+        // The file has been truncated since it was hashed
+        LOGW_WARN(_logger, L"Failed to read file content - path=" << Path2WStr(_filePath).c_str());
         _exitCode = ExitCodeSystemError;
-        _exitCause = ExitCauseNotEnoughtMemory;
+        _exitCause = ExitCauseFileAccessError;
         return false;
     }
 
     return true;
 }
 
+void UploadJob::closeData() {
+    if (_file.is_open()) {
+        _file.close();
+    }
+}
+
 bool UploadJob::readLink() {
     if (_linkType == LinkTypeSymlink) {
         std::error_code ec;
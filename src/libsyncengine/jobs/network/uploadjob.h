@@ -21,6 +21,8 @@
 #include "utility/types.h"
 #include "abstracttokennetworkjob.h"
 
+#include <fstream>
+
 /**
  * WARNING:
  * Do not use this class to upload a file larger than 1GB. Instead, create an upload session and attach chunks.
@@ -50,6 +52,10 @@ class UploadJob : public AbstractTokenNetworkJob {
         virtual void setQueryParameters(Poco::URI &, bool &canceled) override;
         virtual void setData(bool &canceled) override;
         virtual std::string getContentType(bool &canceled) override;
+        virtual uint64_t getStreamedDataSize() const override { return _isFileStreamed ? _fileSize : 0; }
+        virtual bool openData() override;
+        virtual bool readData(char *buffer, size_t size) override;
+        virtual void closeData() override;
 
         bool readFile();
         bool readLink();
@@ -59,6 +65,10 @@ class UploadJob : public AbstractTokenNetworkJob {
         NodeId _fileId;
         NodeId _remoteParentDirId;
         std::string _contentHash;
+        // The content of a file is hashed by readFile, then streamed from it, instead of being loaded into _data
+        bool _isFileStreamed = false;
+        std::ifstream _file;  // Only open while the request is sent
+        uint64_t _fileSize = 0;
         SyncTime _modtimeIn = 0;
 
         NodeId _nodeIdOut;
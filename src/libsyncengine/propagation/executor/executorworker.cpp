@@ -48,6 +48,8 @@ namespace KDC {
 
 #define SEND_PROGRESS_DELAY 1                // 1 sec
 #define SNAPSHOT_INVALIDATION_THRESHOLD 100  // Changes
+#define DB_BATCH_MAX_ROWS 1000
+#define DB_BATCH_MAX_DELAY 500  // ms
 
 ExecutorWorker::ExecutorWorker(std::shared_ptr<SyncPal> syncPal, const std::string &name, const std::string &shortName)
     : OperationProcessor(syncPal, name, shortName) {}
@@ -75,12 +77,15 @@ void ExecutorWorker::execute() {
 
     initProgressManager();
 
+    // Group the DB writes of the propagated operations into a few transactions
+    _syncPal->_syncDb->startBatch(DB_BATCH_MAX_ROWS, std::chrono::milliseconds(DB_BATCH_MAX_DELAY));
+
     uint64_t changesCounter = 0;
     bool hasError = false;
     while (!_opList.empty()) {  // Same loop twice because we might reschedule the jobs after a pause TODO : refactor double loop
         // Create all the jobs
         while (!_opList.empty()) {
-            if (!deleteFinishedAsyncJobs()) {
+            if (!deleteFinishedAsyncJobs() || !commitDbBatchIfDue()) {
                 hasError = true;
                 cancelAllOngoingJobs();
                 break;
@@ -184,6 +189,13 @@ void ExecutorWorker::execute() {
         waitForAllJobsToFinish(hasError);
     }
 
+    if (!_syncPal->_syncDb->endBatch() && !hasError) {
+        LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::endBatch");
+        _executorExitCode = ExitCodeDbError;
+        _executorExitCause = ExitCauseDbAccessError;
+        hasError = true;
+    }
+
     if (!hasError) {
         _executorExitCode = ExitCodeOk;
     }
@@ -197,6 +209,12 @@ void ExecutorWorker::execute() {
         _snapshotToInvalidate = true;
     }
 
+    if (_executorExitCode == ExitCodeDbError) {
+        // Some changes propagated in this sync may be missing from the DB, the next comparison must find them again
+        _syncPal->snapshot(ReplicaSideLocal, true)->invalidateDirtyIds();
+        _syncPal->snapshot(ReplicaSideRemote, true)->invalidateDirtyIds();
+    }
+
     if (_snapshotToInvalidate) {
         LOG_SYNCPAL_INFO(_logger, "Invalidate local snapshot");
         _syncPal->_localFSObserverWorker->invalidateSnapshot();
@@ -1580,7 +1598,7 @@ void ExecutorWorker::waitForAllJobsToFinish(bool &hasError) {
             }
         }
 
-        if (!deleteFinishedAsyncJobs()) {
+        if (!deleteFinishedAsyncJobs() || !commitDbBatchIfDue()) {
             hasError = true;
             cancelAllOngoingJobs();
             break;
@@ -1590,6 +1608,16 @@ void ExecutorWorker::waitForAllJobsToFinish(bool &hasError) {
     }
 }
 
+bool ExecutorWorker::commitDbBatchIfDue() {
+    if (!_syncPal->_syncDb->commitBatchIfDue()) {
+        LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::commitBatchIfDue");
+        _executorExitCode = ExitCodeDbError;
+        _executorExitCause = ExitCauseDbAccessError;
+        return false;
+    }
+    return true;
+}
+
 bool ExecutorWorker::deleteFinishedAsyncJobs() {
     const std::lock_guard<std::mutex> lock(_mutex);
 
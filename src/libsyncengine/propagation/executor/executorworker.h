@@ -69,6 +69,7 @@ class ExecutorWorker : public OperationProcessor {
         bool enoughLocalSpace(SyncOpPtr syncOp);
 
         void waitForAllJobsToFinish(bool &hasError);
+        bool commitDbBatchIfDue();
         bool deleteFinishedAsyncJobs();
         bool handleManagedBackError(ExitCause jobExitCause, SyncOpPtr syncOp, bool isInconsistencyIssue, bool downloadImpossible);
         bool handleFinishedJob(std::shared_ptr<AbstractJob> job, SyncOpPtr syncOp, const SyncPath &relativeLocalPath);
@@ -22,6 +22,10 @@
 #include "libcommonserver/utility/utility.h"
 #include "requests/parameterscache.h"
 
+#include <algorithm>
+#include <queue>
+#include <tuple>
+
 namespace KDC {
 
 OperationSorterWorker::OperationSorterWorker(std::shared_ptr<SyncPal> syncPal, const std::string name,
@@ -49,49 +53,44 @@ ExitCode OperationSorterWorker::sortOperations() {
     _syncPal->_syncOps->startUpdate();
     // Keep a copy of the unsorted list
     _unsortedList = *_syncPal->_syncOps;
-    std::list<SyncOperationList> completeCycles;
-    while (true) {
-        if (stopAsked()) {
-            return ExitCodeOk;
-        }
-        while (pauseAsked() || isPaused()) {
-            if (!isPaused()) {
-                setPauseDone();
-            }
-            Utility::msleep(LOOP_PAUSE_SLEEP_PERIOD);
-        }
-
-        _hasOrderChanged = false;
-        fixDeleteBeforeMove();
-        fixMoveBeforeCreate();
-        fixMoveBeforeDelete();
-        fixCreateBeforeMove();
-        fixDeleteBeforeCreate();
-        fixMoveBeforeMoveOccupied();
-        fixCreateBeforeCreate();
-        fixEditBeforeMove();
-        fixMoveBeforeMoveHierarchyFlip();
-        if (!_hasOrderChanged) {
-            break;
-        }
+    _dependencies.clear();
+    _hasOrderChanged = false;
 
-        completeCycles = findCompleteCycles();
-        if (completeCycles.size() > 0) {
-            break;
+    if (stopAsked()) {
+        return ExitCodeOk;
+    }
+    while (pauseAsked() || isPaused()) {
+        if (!isPaused()) {
+            setPauseDone();
         }
+        Utility::msleep(LOOP_PAUSE_SLEEP_PERIOD);
     }
 
-    if (completeCycles.size() > 0) {
-        SyncOpPtr resolutionOperation = std::make_shared<SyncOperation>();
-        if (breakCycle(completeCycles.front(), resolutionOperation)) {
-            _syncPal->_syncOps->setOpList({resolutionOperation});
+    // All the dependencies are collected first, then the operations are sorted once
+    fixDeleteBeforeMove();
+    fixMoveBeforeCreate();
+    fixMoveBeforeDelete();
+    fixCreateBeforeMove();
+    fixDeleteBeforeCreate();
+    fixMoveBeforeMoveOccupied();
+    fixCreateBeforeCreate();
+    fixEditBeforeMove();
+    fixMoveBeforeMoveHierarchyFlip();
+
+    if (!sortByDependencies()) {
+        std::list<SyncOperationList> completeCycles = findCompleteCycles();
+        if (completeCycles.size() > 0) {
+            SyncOpPtr resolutionOperation = std::make_shared<SyncOperation>();
+            if (breakCycle(completeCycles.front(), resolutionOperation)) {
+                _syncPal->_syncOps->setOpList({resolutionOperation});
 
-            _hasOrderChanged = true;
+                _hasOrderChanged = true;
 
-            // If a cycle is discover, the sync must be restarted after the execution of the operation in _syncOrderedOps
-            _syncPal->_restart = true;
+                // If a cycle is discover, the sync must be restarted after the execution of the operation in _syncOrderedOps
+                _syncPal->_restart = true;
 
-            return ExitCodeOk;
+                return ExitCodeOk;
+            }
         }
     }
 
@@ -116,6 +115,22 @@ void OperationSorterWorker::fixDeleteBeforeMove() {
     LOG_SYNCPAL_DEBUG(_logger, "Start fixDeleteBeforeMove");
     const std::unordered_set<UniqueId> deleteOps = _unsortedList.opListIdByType(OperationTypeDelete);
     const std::unordered_set<UniqueId> moveOps = _unsortedList.opListIdByType(OperationTypeMove);
+
+    // Move operations by target side, destination parent ID and name
+    std::map<std::tuple<ReplicaSide, NodeId, SyncName>, std::list<SyncOpPtr>> moveOpsByDestination;
+    for (const auto &moveOpId : moveOps) {
+        SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
+        std::shared_ptr<Node> moveNode = moveOp->affectedNode();
+        if (moveNode->parentNode() == nullptr) {
+            continue;
+        }
+        if (!moveNode->parentNode()->id().has_value()) {
+            LOGW_SYNCPAL_WARN(_logger, L"Node without id: " << SyncName2WStr(moveNode->parentNode()->name()).c_str());
+            continue;
+        }
+        moveOpsByDestination[{moveOp->targetSide(), *moveNode->parentNode()->id(), moveNode->name()}].push_back(moveOp);
+    }
+
     for (const auto &deleteOpId : deleteOps) {
         SyncOpPtr deleteOp = _unsortedList.getOp(deleteOpId);
 
@@ -134,7 +149,7 @@ void OperationSorterWorker::fixDeleteBeforeMove() {
         if (!found) {
             LOGW_SYNCPAL_INFO(_logger, L"Node not found for id = " << Utility::s2ws(*deleteNode->id()).c_str() << L" and name="
                                                                    << SyncName2WStr(deleteNode->name()).c_str());
-            break;
+            continue;
         }
 
         std::optional<NodeId> deleteParentNodeId;
@@ -142,32 +157,18 @@ void OperationSorterWorker::fixDeleteBeforeMove() {
             LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::id");
             return;
         }
-        if (!found) {
+        if (!found || !deleteParentNodeId.has_value()) {
             LOGW_SYNCPAL_INFO(_logger, L"Node not found for path = " << Path2WStr(path.parent_path()).c_str());
-            break;
+            continue;
         }
 
-        for (const auto &moveOpId : moveOps) {
-            SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
-            if (moveOp->targetSide() != deleteOp->targetSide()) {
-                continue;
-            }
-
-            // get the parent of the op nodes list
-            std::shared_ptr<Node> moveNode = moveOp->affectedNode();
-            if (!moveNode->parentNode()->id().has_value()) {
-                LOGW_SYNCPAL_WARN(_logger, L"Node without id: " << SyncName2WStr(moveNode->parentNode()->name()).c_str());
-                continue;
-            }
-
-            NodeId moveParentNodeId = *moveNode->parentNode()->id();
-            if (deleteParentNodeId == moveParentNodeId) {
-                if (deleteNode->name() == moveNode->name()) {
-                    // move only if moveOp is before op
-                    // moveOp depends on op
-                    moveFirstAfterSecond(moveOp, deleteOp);
-                }
-            }
+        auto moveOpsIt = moveOpsByDestination.find({deleteOp->targetSide(), *deleteParentNodeId, deleteNode->name()});
+        if (moveOpsIt == moveOpsByDestination.end()) {
+            continue;
+        }
+        for (const auto &moveOp : moveOpsIt->second) {
+            // moveOp depends on deleteOp
+            addDependency(moveOp, deleteOp);
         }
     }
     LOG_SYNCPAL_DEBUG(_logger, "End fixDeleteBeforeMove");
@@ -183,56 +184,63 @@ void OperationSorterWorker::fixMoveBeforeCreate() {
     LOG_SYNCPAL_DEBUG(_logger, "Start fixMoveBeforeCreate");
     const std::unordered_set<UniqueId> moveOps = _unsortedList.opListIdByType(OperationTypeMove);
     const std::unordered_set<UniqueId> createOps = _unsortedList.opListIdByType(OperationTypeCreate);
-    for (const auto &moveOpId : moveOps) {
-        SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
 
-        for (const auto &createOpId : createOps) {
-            SyncOpPtr createOp = _unsortedList.getOp(createOpId);
-            if (createOp->targetSide() != moveOp->targetSide()) {
+    // Create operations by target side, parent ID and name, and by target side and final local name
+    std::map<std::tuple<ReplicaSide, NodeId, SyncName>, std::list<SyncOpPtr>> createOpsByParent;
+    std::map<std::pair<ReplicaSide, SyncName>, std::list<SyncOpPtr>> createOpsByFinalName;
+    for (const auto &createOpId : createOps) {
+        SyncOpPtr createOp = _unsortedList.getOp(createOpId);
+        std::shared_ptr<Node> createNode = createOp->affectedNode();
+        if (createNode->parentNode() != nullptr) {
+            if (!createNode->parentNode()->id().has_value()) {
+                LOGW_SYNCPAL_WARN(_logger, L"Node without id: " << SyncName2WStr(createNode->parentNode()->name()).c_str());
                 continue;
             }
+            createOpsByParent[{createOp->targetSide(), *createNode->parentNode()->id(), createNode->name()}].push_back(createOp);
+        }
+        createOpsByFinalName[{createOp->targetSide(), createNode->finalLocalName()}].push_back(createOp);
+    }
 
-            bool found;
-            std::shared_ptr<Node> moveNode = moveOp->affectedNode();
-            std::optional<NodeId> sourceParentId;
-            // get with path or with idb
-            // TODO : check if it's better with moveOriginParentId
-            if (!_syncPal->_syncDb->id(moveNode->side(), moveNode->moveOrigin()->parent_path(), sourceParentId, found)) {
-                LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::id");
-                return;
-            }
-            if (!found) {
-                LOGW_SYNCPAL_INFO(_logger,
-                                  L"Node not found for path = " << Path2WStr(moveNode->moveOrigin()->parent_path()).c_str());
-                break;
-            }
+    for (const auto &moveOpId : moveOps) {
+        SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
+        std::shared_ptr<Node> moveNode = moveOp->affectedNode();
+        if (!moveNode->moveOrigin().has_value()) {
+            LOG_SYNCPAL_WARN(_logger, "Missing origin path");
+            continue;
+        }
 
-            std::shared_ptr<Node> createNode = createOp->affectedNode();
-            if (createNode->parentNode() != nullptr) {
-                if (!createNode->parentNode()->id().has_value()) {
-                    LOGW_SYNCPAL_WARN(_logger, L"Node without id: " << SyncName2WStr(createNode->parentNode()->name()).c_str());
-                    continue;
-                }
+        bool found;
+        std::optional<NodeId> sourceParentId;
+        // get with path or with idb
+        // TODO : check if it's better with moveOriginParentId
+        if (!_syncPal->_syncDb->id(moveNode->side(), moveNode->moveOrigin()->parent_path(), sourceParentId, found)) {
+            LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::id");
+            return;
+        }
+        if (!found) {
+            LOGW_SYNCPAL_INFO(_logger, L"Node not found for path = " << Path2WStr(moveNode->moveOrigin()->parent_path()).c_str());
+            continue;
+        }
 
-                NodeId createParentId = *createNode->parentNode()->id();
-                if (sourceParentId == createParentId) {
-                    if (moveNode->name() == createNode->name()) {
-                        // move only if createOp is before op
-                        moveFirstAfterSecond(createOp, moveOp);
-                        continue;
-                    }
+        if (sourceParentId.has_value()) {
+            auto createOpsIt = createOpsByParent.find({moveOp->targetSide(), *sourceParentId, moveNode->name()});
+            if (createOpsIt != createOpsByParent.end()) {
+                for (const auto &createOp : createOpsIt->second) {
+                    addDependency(createOp, moveOp);
                 }
             }
+        }
 
-            std::shared_ptr<Node> correspondingNode = correspondingNodeInOtherTree(moveNode);
-            if (correspondingNode) {
-                if (correspondingNode->finalLocalName() == createOp->affectedNode()->finalLocalName()) {
-                    moveFirstAfterSecond(createOp, moveOp);
-                    continue;
-                }
-            } else {
-                LOGW_SYNCPAL_WARN(_logger, L"Failed to get corresponding node: " << SyncName2WStr(moveNode->name()).c_str());
-                continue;
+        std::shared_ptr<Node> correspondingNode = correspondingNodeInOtherTree(moveNode);
+        if (!correspondingNode) {
+            LOGW_SYNCPAL_WARN(_logger, L"Failed to get corresponding node: " << SyncName2WStr(moveNode->name()).c_str());
+            continue;
+        }
+
+        auto createOpsIt = createOpsByFinalName.find({moveOp->targetSide(), correspondingNode->finalLocalName()});
+        if (createOpsIt != createOpsByFinalName.end()) {
+            for (const auto &createOp : createOpsIt->second) {
+                addDependency(createOp, moveOp);
             }
         }
     }
@@ -249,6 +257,9 @@ void OperationSorterWorker::fixMoveBeforeDelete() {
     LOG_SYNCPAL_DEBUG(_logger, "Start fixMoveBeforeDelete");
     const std::unordered_set<UniqueId> deleteOps = _unsortedList.opListIdByType(OperationTypeDelete);
     const std::unordered_set<UniqueId> moveOps = _unsortedList.opListIdByType(OperationTypeMove);
+
+    // Directory delete operations by target side and DB path
+    std::map<std::pair<ReplicaSide, SyncPath>, std::list<SyncOpPtr>> deleteOpsByPath;
     for (const auto &deleteOpId : deleteOps) {
         SyncOpPtr deleteOp = _unsortedList.getOp(deleteOpId);
         if (deleteOp->affectedNode()->type() != NodeTypeDirectory) {
@@ -261,35 +272,43 @@ void OperationSorterWorker::fixMoveBeforeDelete() {
             continue;
         }
 
-        for (const auto &moveOpId : moveOps) {
-            SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
-            if (moveOp->targetSide() != deleteOp->targetSide()) {
-                continue;
-            }
+        bool found = false;
+        SyncPath deleteDirPath;
+        if (!_syncPal->_syncDb->path(deleteNode->side(), *deleteNode->id(), deleteDirPath, found)) {
+            LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::path");
+            return;
+        }
+        if (!found) {
+            LOGW_SYNCPAL_INFO(_logger, L"Node not found for id = " << Utility::s2ws(*deleteNode->id()).c_str() << L" and name="
+                                                                   << SyncName2WStr(deleteNode->name()).c_str());
+            continue;
+        }
 
-            bool found = false;
-            SyncPath deleteDirPath;
-            if (!_syncPal->_syncDb->path(deleteNode->side(), *deleteNode->id(), deleteDirPath, found)) {
-                LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::path");
-                return;
-            }
-            if (!found) {
-                LOGW_SYNCPAL_INFO(_logger, L"Node not found for id = " << Utility::s2ws(*deleteNode->id()).c_str()
-                                                                       << L" and name="
-                                                                       << SyncName2WStr(deleteNode->name()).c_str());
-                continue;
-            }
+        deleteOpsByPath[{deleteOp->targetSide(), deleteDirPath.lexically_normal()}].push_back(deleteOp);
+    }
 
-            if (!moveOp->affectedNode()->moveOrigin().has_value()) {
-                LOG_SYNCPAL_WARN(_logger, "Missing origin path");
-                return;
-            }
+    if (deleteOpsByPath.empty()) {
+        LOG_SYNCPAL_DEBUG(_logger, "End fixMoveBeforeDelete");
+        return;
+    }
 
-            SyncPath sourcePath = moveOp->affectedNode()->moveOrigin().value();
-            if (Utility::startsWith(sourcePath.lexically_normal(),
-                                    SyncPath(deleteDirPath.native() + Str("/")).lexically_normal())) {
-                // move only if op is before moveOp
-                moveFirstAfterSecond(deleteOp, moveOp);
+    for (const auto &moveOpId : moveOps) {
+        SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
+        if (!moveOp->affectedNode()->moveOrigin().has_value()) {
+            LOG_SYNCPAL_WARN(_logger, "Missing origin path");
+            continue;
+        }
+
+        // The deleted directories that contained the item before the move
+        SyncPath ancestorPath = moveOp->affectedNode()->moveOrigin()->lexically_normal();
+        while (ancestorPath.has_parent_path() && ancestorPath.parent_path() != ancestorPath) {
+            ancestorPath = ancestorPath.parent_path();
+            auto deleteOpsIt = deleteOpsByPath.find({moveOp->targetSide(), ancestorPath});
+            if (deleteOpsIt == deleteOpsByPath.end()) {
+                continue;
+            }
+            for (const auto &deleteOp : deleteOpsIt->second) {
+                addDependency(deleteOp, moveOp);
             }
         }
     }
@@ -306,6 +325,9 @@ void OperationSorterWorker::fixCreateBeforeMove() {
     LOG_SYNCPAL_DEBUG(_logger, "Start fixCreateBeforeMove");
     const std::unordered_set<UniqueId> createOps = _unsortedList.opListIdByType(OperationTypeCreate);
     const std::unordered_set<UniqueId> moveOps = _unsortedList.opListIdByType(OperationTypeMove);
+
+    // Directory create operations by target side and node ID
+    std::map<std::pair<ReplicaSide, NodeId>, std::list<SyncOpPtr>> createOpsById;
     for (const auto &createOpId : createOps) {
         SyncOpPtr createOp = _unsortedList.getOp(createOpId);
         if (createOp->affectedNode()->type() != NodeTypeDirectory) {
@@ -317,22 +339,23 @@ void OperationSorterWorker::fixCreateBeforeMove() {
             continue;
         }
 
-        for (const auto &moveOpId : moveOps) {
-            SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
-            if (moveOp->targetSide() != createOp->targetSide()) {
-                continue;
-            }
-            std::shared_ptr<Node> moveNode = moveOp->affectedNode();
-            if (moveNode->parentNode() != nullptr) {
-                std::optional<NodeId> moveDestParentId = moveNode->parentNode()->id();
-                if (moveDestParentId) {
-                    if (*moveDestParentId == *createOp->affectedNode()->id()) {
-                        // move only if moveOp is before op
-                        moveFirstAfterSecond(moveOp, createOp);
-                        continue;
-                    }
-                }
-            }
+        createOpsById[{createOp->targetSide(), *createOp->affectedNode()->id()}].push_back(createOp);
+    }
+
+    for (const auto &moveOpId : moveOps) {
+        SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
+        std::shared_ptr<Node> moveNode = moveOp->affectedNode();
+        if (moveNode->parentNode() == nullptr || !moveNode->parentNode()->id().has_value()) {
+            continue;
+        }
+
+        auto createOpsIt = createOpsById.find({moveOp->targetSide(), *moveNode->parentNode()->id()});
+        if (createOpsIt == createOpsById.end()) {
+            continue;
+        }
+        for (const auto &createOp : createOpsIt->second) {
+            // moveOp depends on createOp
+            addDependency(moveOp, createOp);
         }
     }
     LOG_SYNCPAL_DEBUG(_logger, "End fixCreateBeforeMove");
@@ -348,6 +371,25 @@ void OperationSorterWorker::fixDeleteBeforeCreate() {
     LOG_SYNCPAL_DEBUG(_logger, "Start fixDeleteBeforeCreate");
     const std::unordered_set<UniqueId> deleteOps = _unsortedList.opListIdByType(OperationTypeDelete);
     const std::unordered_set<UniqueId> createOps = _unsortedList.opListIdByType(OperationTypeCreate);
+
+    // Create operations by target side, parent ID and final local name, and by target side and node ID
+    std::map<std::tuple<ReplicaSide, NodeId, SyncName>, std::list<SyncOpPtr>> createOpsByParent;
+    std::map<std::pair<ReplicaSide, NodeId>, std::list<SyncOpPtr>> createOpsById;
+    for (const auto &createOpId : createOps) {
+        SyncOpPtr createOp = _unsortedList.getOp(createOpId);
+        std::shared_ptr<Node> createNode = createOp->affectedNode();
+        if (!createNode->id().has_value()) {
+            LOGW_SYNCPAL_WARN(_logger, L"Node without id: " << SyncName2WStr(createNode->name()).c_str());
+            continue;
+        }
+
+        createOpsById[{createOp->targetSide(), *createNode->id()}].push_back(createOp);
+        if (createNode->parentNode() != nullptr && createNode->parentNode()->id().has_value()) {
+            createOpsByParent[{createOp->targetSide(), *createNode->parentNode()->id(), createNode->finalLocalName()}].push_back(
+                createOp);
+        }
+    }
+
     for (const auto &deleteOpId : deleteOps) {
         SyncOpPtr deleteOp = _unsortedList.getOp(deleteOpId);
 
@@ -357,65 +399,75 @@ void OperationSorterWorker::fixDeleteBeforeCreate() {
             continue;
         }
 
-        for (const auto &createOpId : createOps) {
-            SyncOpPtr createOp = _unsortedList.getOp(createOpId);
-            if (createOp->targetSide() != deleteOp->targetSide()) {
-                continue;
-            }
-
-            std::shared_ptr<Node> createNode = createOp->affectedNode();
-            if (!createNode->id().has_value()) {
-                LOGW_SYNCPAL_WARN(_logger, L"Node without id: " << SyncName2WStr(createNode->name()).c_str());
-                continue;
-            }
-
-            bool found = false;
-            NodeId deleteNodeId = deleteNode->id().value();
-            if (createNode->id().value() == deleteNode->id().value()) {
-                if (!deleteNode->previousId().has_value()) {
-                    LOGW_SYNCPAL_WARN(_logger, L"Node without previousId: " << SyncName2WStr(deleteNode->name()).c_str());
-                    continue;
+        // A create operation on a node with the same ID replaces the deleted item: its DB entry is found with the previous ID
+        std::optional<NodeId> deleteParentId;
+        if (!dbParentId(deleteNode, *deleteNode->id(), deleteParentId)) {
+            return;
+        }
+        if (deleteParentId.has_value()) {
+            auto createOpsIt = createOpsByParent.find({deleteOp->targetSide(), *deleteParentId, deleteNode->finalLocalName()});
+            if (createOpsIt != createOpsByParent.end()) {
+                for (const auto &createOp : createOpsIt->second) {
+                    if (*createOp->affectedNode()->id() != *deleteNode->id()) {
+                        addDependency(createOp, deleteOp);
+                    }
                 }
-
-                deleteNodeId = deleteNode->previousId().value();
-            }
-
-            SyncPath deletePath;
-            if (!_syncPal->_syncDb->path(deleteNode->side(), deleteNodeId, deletePath, found)) {
-                LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::path");
-                return;
-            }
-            if (!found) {
-                LOGW_SYNCPAL_INFO(_logger, L"Node not found for id = " << Utility::s2ws(*deleteNode->id()).c_str()
-                                                                       << L" and name="
-                                                                       << SyncName2WStr(deleteNode->name()).c_str());
-                continue;
             }
+        }
 
-            std::optional<NodeId> deleteParentId;
-            if (!_syncPal->_syncDb->id(deleteNode->side(), deletePath.parent_path(), deleteParentId, found)) {
-                LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::id");
-                return;
-            }
-            if (!found) {
-                LOGW_SYNCPAL_INFO(_logger, L"Node not found for path = " << Path2WStr(deletePath.parent_path()).c_str());
-                break;
-            }
+        auto sameIdCreateOpsIt = createOpsById.find({deleteOp->targetSide(), *deleteNode->id()});
+        if (sameIdCreateOpsIt == createOpsById.end()) {
+            continue;
+        }
+        if (!deleteNode->previousId().has_value()) {
+            LOGW_SYNCPAL_WARN(_logger, L"Node without previousId: " << SyncName2WStr(deleteNode->name()).c_str());
+            continue;
+        }
 
-            if (createNode->parentNode() != nullptr) {
-                std::optional<NodeId> createParentId = createNode->parentNode()->id();
-                if (deleteParentId == createParentId) {
-                    if (createNode->finalLocalName() == deleteNode->finalLocalName()) {
-                        // move only if createOp is before op
-                        moveFirstAfterSecond(createOp, deleteOp);
-                    }
-                }
+        std::optional<NodeId> previousParentId;
+        if (!dbParentId(deleteNode, *deleteNode->previousId(), previousParentId)) {
+            return;
+        }
+        if (!previousParentId.has_value()) {
+            continue;
+        }
+        for (const auto &createOp : sameIdCreateOpsIt->second) {
+            std::shared_ptr<Node> createNode = createOp->affectedNode();
+            if (createNode->parentNode() != nullptr && createNode->parentNode()->id() == previousParentId &&
+                createNode->finalLocalName() == deleteNode->finalLocalName()) {
+                addDependency(createOp, deleteOp);
             }
         }
     }
     LOG_SYNCPAL_DEBUG(_logger, "End fixDeleteBeforeCreate");
 }
 
+bool OperationSorterWorker::dbParentId(std::shared_ptr<Node> node, const NodeId &nodeId, std::optional<NodeId> &parentId) {
+    parentId = std::nullopt;
+
+    bool found = false;
+    SyncPath path;
+    if (!_syncPal->_syncDb->path(node->side(), nodeId, path, found)) {
+        LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::path");
+        return false;
+    }
+    if (!found) {
+        LOGW_SYNCPAL_INFO(_logger, L"Node not found for id = " << Utility::s2ws(nodeId).c_str() << L" and name="
+                                                               << SyncName2WStr(node->name()).c_str());
+        return true;
+    }
+
+    if (!_syncPal->_syncDb->id(node->side(), path.parent_path(), parentId, found)) {
+        LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::id");
+        return false;
+    }
+    if (!found) {
+        LOGW_SYNCPAL_INFO(_logger, L"Node not found for path = " << Path2WStr(path.parent_path()).c_str());
+        parentId = std::nullopt;
+    }
+    return true;
+}
+
 /**
  * In case of a MoveOccupied Operation affected by a Move Operation
  * The Move Operation will be moved before the MoveOccupied Operation
@@ -424,85 +476,74 @@ void OperationSorterWorker::fixDeleteBeforeCreate() {
  */
 void OperationSorterWorker::fixMoveBeforeMoveOccupied() {
     LOG_SYNCPAL_DEBUG(_logger, "Start fixMoveBeforeMoveOccupied");
-    std::unordered_set<UniqueId> moveOps = _unsortedList.opListIdByType(OperationTypeMove);
-    std::unordered_set<UniqueId> moveOps2 = moveOps;
+    const std::unordered_set<UniqueId> moveOps = _unsortedList.opListIdByType(OperationTypeMove);
+
+    // Move operations by target side, destination parent ID and name
+    std::map<std::tuple<ReplicaSide, NodeId, SyncName>, std::list<SyncOpPtr>> moveOpsByDestination;
     for (const auto &moveOpId : moveOps) {
         SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
+        std::shared_ptr<Node> moveNode = moveOp->affectedNode();
+        if (moveNode->parentNode() != nullptr && moveNode->parentNode()->id().has_value()) {
+            moveOpsByDestination[{moveOp->targetSide(), *moveNode->parentNode()->id(), moveNode->name()}].push_back(moveOp);
+        }
+    }
 
-        for (const auto &moveOpId2 : moveOps2) {
-            SyncOpPtr moveOp2 = _unsortedList.getOp(moveOpId2);
-            if (moveOp == moveOp2 || moveOp2->targetSide() != moveOp->targetSide()) {
-                continue;
-            }
-
-            std::shared_ptr<Node> moveNode = moveOp2->affectedNode();
-
-            if (!moveOp2->affectedNode()->moveOrigin().has_value()) {
-                LOG_SYNCPAL_WARN(_logger, "Missing origin path");
-                return;
-            }
+    for (const auto &moveOpId : moveOps) {
+        SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
+        std::shared_ptr<Node> moveNode = moveOp->affectedNode();
+        if (!moveNode->moveOrigin().has_value()) {
+            LOG_SYNCPAL_WARN(_logger, "Missing origin path");
+            continue;
+        }
 
-            SyncPath sourcePath = *moveOp2->affectedNode()->moveOrigin();
-            bool found;
-            std::optional<NodeId> sourceParentId;
-            if (!_syncPal->_syncDb->id(moveNode->side(), sourcePath.parent_path(), sourceParentId, found)) {
-                LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::id");
-                return;
-            }
-            if (!found) {
-                LOGW_SYNCPAL_DEBUG(_logger, L"Node not found for path = " << Path2WStr(sourcePath.parent_path()).c_str());
-                break;
-            }
+        SyncPath sourcePath = *moveNode->moveOrigin();
+        bool found;
+        std::optional<NodeId> sourceParentId;
+        if (!_syncPal->_syncDb->id(moveNode->side(), sourcePath.parent_path(), sourceParentId, found)) {
+            LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::id");
+            return;
+        }
+        if (!found || !sourceParentId.has_value()) {
+            LOGW_SYNCPAL_DEBUG(_logger, L"Node not found for path = " << Path2WStr(sourcePath.parent_path()).c_str());
+            continue;
+        }
 
-            std::shared_ptr<Node> otherMoveNode = moveOp->affectedNode();
-            if (otherMoveNode->parentNode() != nullptr) {
-                std::optional<NodeId> moveDestParentId = otherMoveNode->parentNode()->id();
-                if (sourceParentId == moveDestParentId) {
-                    if (moveNode->name() == otherMoveNode->name()) {
-                        // move only if moveOp is before op
-                        moveFirstAfterSecond(moveOp2, moveOp);
-                    }
-                }
+        // The other move operations going to the place this one leaves
+        auto otherMoveOpsIt = moveOpsByDestination.find({moveOp->targetSide(), *sourceParentId, moveNode->name()});
+        if (otherMoveOpsIt == moveOpsByDestination.end()) {
+            continue;
+        }
+        for (const auto &otherMoveOp : otherMoveOpsIt->second) {
+            if (otherMoveOp != moveOp) {
+                addDependency(moveOp, otherMoveOp);
             }
         }
-        moveOps2.erase(moveOpId);
     }
     LOG_SYNCPAL_DEBUG(_logger, "End fixMoveBeforeMoveOccupied");
 }
 
-class SyncOpDepthCmp {
-    public:
-        bool operator()(const std::tuple<SyncOpPtr, SyncOpPtr, int> &a, const std::tuple<SyncOpPtr, SyncOpPtr, int> &b) {
-            if (std::get<2>(a) == std::get<2>(b)) {
-                // If depth are equal, put op to move with lowest ID first
-                return std::get<0>(a)->id() > std::get<0>(b)->id();
-            }
-            return std::get<2>(a) < std::get<2>(b);
-        }
-};
-
+/**
+ * An operation on an item located in a created directory
+ * The Create Operation of the directory will be moved before the operation
+ */
 void OperationSorterWorker::fixCreateBeforeCreate() {
     LOG_SYNCPAL_DEBUG(_logger, "Start fixCreateBeforeCreate");
-    std::priority_queue<std::tuple<SyncOpPtr, SyncOpPtr, int>, std::vector<std::tuple<SyncOpPtr, SyncOpPtr, int>>, SyncOpDepthCmp>
-        opsToMove;
-
-    std::unordered_map<UniqueId, int> indexMap;
-    _syncPal->_syncOps->getMapIndexToOp(indexMap, OperationTypeCreate);
-
     for (const auto &opId : _syncPal->_syncOps->opSortedList()) {
-        SyncOpPtr createOp = _syncPal->_syncOps->getOp(opId);
-        int createOpIndex = indexMap[opId];
-        SyncOpPtr ancestorOp = nullptr;
-        int relativeDepth = 0;
-        if (hasParentWithHigherIndex(indexMap, createOp, createOpIndex, ancestorOp, relativeDepth)) {
-            opsToMove.push(std::make_tuple(createOp, ancestorOp, relativeDepth));
+        SyncOpPtr op = _syncPal->_syncOps->getOp(opId);
+        std::shared_ptr<Node> parentNode = op->affectedNode()->parentNode();
+        if (parentNode == nullptr || !parentNode->id().has_value()) {
+            continue;
         }
-    }
 
-    while (!opsToMove.empty()) {
-        std::tuple<SyncOpPtr, SyncOpPtr, int> opTuple = opsToMove.top();
-        moveFirstAfterSecond(std::get<0>(opTuple), std::get<1>(opTuple));
-        opsToMove.pop();
+        // The ancestors are handled transitively through the create operation of the parent
+        std::list<UniqueId> parentOpList = _syncPal->_syncOps->getOpIdsFromNodeId(*parentNode->id());
+        for (const auto &parentOpId : parentOpList) {
+            SyncOpPtr parentOp = _syncPal->_syncOps->getOp(parentOpId);
+            if (parentOp->type() == OperationTypeCreate) {
+                addDependency(op, parentOp);
+                break;
+            }
+        }
     }
     LOG_SYNCPAL_DEBUG(_logger, "End fixCreateBeforeCreate");
 }
@@ -511,96 +552,72 @@ void OperationSorterWorker::fixEditBeforeMove() {
     LOG_SYNCPAL_DEBUG(_logger, "Start fixEditBeforeMove");
     const std::unordered_set<UniqueId> editOps = _unsortedList.opListIdByType(OperationTypeEdit);
     const std::unordered_set<UniqueId> moveOps = _unsortedList.opListIdByType(OperationTypeMove);
+
+    // Move operations by target side and node ID
+    std::map<std::pair<ReplicaSide, NodeId>, std::list<SyncOpPtr>> moveOpsById;
+    for (const auto &moveOpId : moveOps) {
+        SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
+        if (moveOp->affectedNode()->id().has_value()) {
+            moveOpsById[{moveOp->targetSide(), *moveOp->affectedNode()->id()}].push_back(moveOp);
+        }
+    }
+
     for (const auto &editOpId : editOps) {
         SyncOpPtr editOp = _unsortedList.getOp(editOpId);
+        if (!editOp->affectedNode()->id().has_value()) {
+            continue;
+        }
 
-        for (const auto &moveOpId : moveOps) {
-            SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
-            if (moveOp->targetSide() != editOp->targetSide() || moveOp->affectedNode()->id() != editOp->affectedNode()->id()) {
-                continue;
-            }
-
+        auto moveOpsIt = moveOpsById.find({editOp->targetSide(), *editOp->affectedNode()->id()});
+        if (moveOpsIt == moveOpsById.end()) {
+            continue;
+        }
+        for (const auto &moveOp : moveOpsIt->second) {
             // Since in case of move op, the node contains already the new name
             // we always want to execute move operation first
-            moveFirstAfterSecond(editOp, moveOp);
+            addDependency(editOp, moveOp);
         }
     }
     LOG_SYNCPAL_DEBUG(_logger, "End fixEditBeforeMove");
 }
 
-bool OperationSorterWorker::hasParentWithHigherIndex(const std::unordered_map<UniqueId, int> &indexMap, const SyncOpPtr op,
-                                                     const int createOpIndex, SyncOpPtr &ancestorOp, int &depth) {
-    // Move createOp after the ancestor operation on the highest level (if needed)
-
-    // Retrieve parent Op
-    std::shared_ptr<Node> createNode = op->affectedNode();
-    std::shared_ptr<Node> parentNode = createNode->parentNode();
-
-    if (!parentNode->id().has_value()) {
-        return false;
-    }
-
-    std::list<UniqueId> parentOpList = _syncPal->_syncOps->getOpIdsFromNodeId(*parentNode->id());
-    for (const auto &parentOpId : parentOpList) {
-        SyncOpPtr parentOp = _syncPal->_syncOps->getOp(parentOpId);
-        // Check that parent has been just created
-        if (parentOp->type() == OperationTypeCreate) {
-            // Check that index of parentOp is lower than index of createOp
-            int parentOpIndex = indexMap.at(parentOpId);
-            if (parentOpIndex > createOpIndex) {
-                // Update ancestor
-                ancestorOp = parentOp;
-            }
-
-            // We need to check higher level ancestors anyway, even if direct parent index is correct
-            hasParentWithHigherIndex(indexMap, parentOp, parentOpIndex, ancestorOp, ++depth);
-            break;
-        }
-    }
-
-    if (ancestorOp == nullptr) {
-        return false;
-    } else {
-        return true;
-    }
-}
-
 void OperationSorterWorker::fixMoveBeforeMoveHierarchyFlip() {
     LOG_SYNCPAL_DEBUG(_logger, "Start fixMoveBeforeMoveHierarchyFlip");
     std::unordered_set<UniqueId> moveOps = _unsortedList.opListIdByType(OperationTypeMove);
-    for (const auto &xOpId : moveOps) {
-        SyncOpPtr xOp = _unsortedList.getOp(xOpId);
-        if (xOp->affectedNode()->type() != NodeTypeDirectory) {
-            continue;
-        }
 
-        std::shared_ptr<Node> xNode = xOp->affectedNode();
-        SyncPath xDestPath = xNode->getPath();
-        if (!xNode->moveOrigin().has_value()) {
+    // Directory move operations by target side and destination path
+    std::map<std::pair<ReplicaSide, SyncPath>, std::list<SyncOpPtr>> moveOpsByDestPath;
+    std::unordered_map<UniqueId, SyncPath> destPaths;
+    for (const auto &moveOpId : moveOps) {
+        SyncOpPtr moveOp = _unsortedList.getOp(moveOpId);
+        if (moveOp->affectedNode()->type() != NodeTypeDirectory || !moveOp->affectedNode()->moveOrigin().has_value()) {
             continue;
         }
-        SyncPath xSourcePath = *xNode->moveOrigin();
 
-        for (const auto &yOpId : moveOps) {
-            SyncOpPtr yOp = _unsortedList.getOp(yOpId);
-            if (yOp->affectedNode()->type() != NodeTypeDirectory || xOp == yOp || xOp->targetSide() != yOp->targetSide()) {
-                continue;
-            }
+        SyncPath destPath = moveOp->affectedNode()->getPath().lexically_normal();
+        moveOpsByDestPath[{moveOp->targetSide(), destPath}].push_back(moveOp);
+        destPaths.insert({moveOpId, destPath});
+    }
 
-            std::shared_ptr<Node> yNode = yOp->affectedNode();
-            SyncPath yDestPath = yNode->getPath();
-            if (!yNode->moveOrigin().has_value()) {
+    for (const auto &[xOpId, xDestPath] : destPaths) {
+        SyncOpPtr xOp = _unsortedList.getOp(xOpId);
+        SyncPath xSourcePath = *xOp->affectedNode()->moveOrigin();
+
+        // Y is moved to an ancestor of the destination of X
+        SyncPath yDestPath = xDestPath;
+        while (yDestPath.has_parent_path() && yDestPath.parent_path() != yDestPath) {
+            yDestPath = yDestPath.parent_path();
+            auto yOpsIt = moveOpsByDestPath.find({xOp->targetSide(), yDestPath});
+            if (yOpsIt == moveOpsByDestPath.end()) {
                 continue;
             }
-            SyncPath ySourcePath = *yNode->moveOrigin();
 
-            bool isXBelowY =
-                Utility::startsWith(xDestPath.lexically_normal(), SyncPath(yDestPath.native() + Str("/")).lexically_normal());
-            if (isXBelowY) {
+            for (const auto &yOp : yOpsIt->second) {
+                SyncPath ySourcePath = *yOp->affectedNode()->moveOrigin();
                 bool isYBelowXInDb = Utility::startsWith(ySourcePath.lexically_normal(),
                                                          SyncPath(xSourcePath.native() + Str("/")).lexically_normal());
                 if (isYBelowXInDb) {
-                    moveFirstAfterSecond(xOp, yOp);
+                    addDependency(xOp, yOp);
                 }
             }
         }
@@ -684,35 +701,56 @@ std::optional<SyncOperationList> OperationSorterWorker::fixImpossibleFirstMoveOp
 std::list<SyncOperationList> OperationSorterWorker::findCompleteCycles() {
     std::list<SyncOperationList> completeCycles;
 
-    for (auto &pair : _reorderings) {
-        std::list<std::pair<SyncOpPtr, SyncOpPtr>> l1;
-        std::list<SyncOpPtr> l2;
-        l1 = _reorderings;
-        l1.remove(pair);
-        l2.push_back(pair.first);
-        l2.push_back(pair.second);
-        SyncOpPtr opToFind = pair.first;
-        SyncOpPtr opTmp = l2.back();
-        for (std::list<std::pair<SyncOpPtr, SyncOpPtr>>::iterator it = l1.begin(); it != l1.end(); it++) {
-            SyncOpPtr opF = it->first;
-            if (opF == opTmp) {
-                l2.push_back(it->second);
-                opTmp = l2.back();
-                if (it->second == opToFind) {
-                    break;
-                }
-                it = l1.erase(it);
+    std::vector<SyncOpPtr> ops;
+    std::unordered_map<UniqueId, size_t> positions;
+    listOperations(ops, positions);
+
+    std::vector<size_t> sortedPositions;
+    topologicalOrder(ops, positions, sortedPositions);
+    if (sortedPositions.size() == ops.size()) {
+        return completeCycles;
+    }
+
+    std::vector<bool> isSorted(ops.size(), false);
+    for (const auto &position : sortedPositions) {
+        isSorted[position] = true;
+    }
+
+    // Each unsorted operation has an unsorted dependency, following them always ends up in a cycle
+    size_t position = 0;
+    while (isSorted[position]) {
+        position++;
+    }
+
+    std::vector<size_t> walk;
+    std::unordered_map<size_t, size_t> walkIndex;
+    while (walkIndex.find(position) == walkIndex.end()) {
+        walkIndex.insert({position, walk.size()});
+        walk.push_back(position);
+
+        size_t nextPosition = ops.size();
+        for (const auto &dependencyId : _dependencies[ops[position]->id()]) {
+            auto positionIt = positions.find(dependencyId);
+            if (positionIt != positions.end() && !isSorted[positionIt->second] && positionIt->second < nextPosition) {
+                nextPosition = positionIt->second;
             }
         }
+        position = nextPosition;
+    }
 
-        if (l2.front() == l2.back()) {
-            l2.pop_back();
-            SyncOperationList cycle;
-            cycle.setOpList(l2);
-            completeCycles.push_back(cycle);
-            break;
-        }
+    // List the cycle in execution order, starting with its first operation in the current order
+    std::vector<size_t> cyclePositions(walk.begin() + walkIndex[position], walk.end());
+    std::reverse(cyclePositions.begin(), cyclePositions.end());
+    std::rotate(cyclePositions.begin(), std::min_element(cyclePositions.begin(), cyclePositions.end()), cyclePositions.end());
+
+    std::list<SyncOpPtr> cycleOps;
+    for (const auto &cyclePosition : cyclePositions) {
+        cycleOps.push_back(ops[cyclePosition]);
     }
+    SyncOperationList cycle;
+    cycle.setOpList(cycleOps);
+    completeCycles.push_back(cycle);
+
     return completeCycles;
 }
 
@@ -767,54 +805,127 @@ bool OperationSorterWorker::breakCycle(SyncOperationList &cycle, SyncOpPtr renam
     return true;
 }
 
-void OperationSorterWorker::moveFirstAfterSecond(SyncOpPtr opFirst, SyncOpPtr opSecond) {
-    std::list<UniqueId>::const_iterator firstIt;
-    std::list<UniqueId>::const_iterator secondIt;
-    bool firstFound = false;
-    for (std::list<UniqueId>::const_iterator it = _syncPal->_syncOps->opSortedList().begin();
-         it != _syncPal->_syncOps->opSortedList().end(); ++it) {
-        SyncOpPtr op = _syncPal->_syncOps->getOp(*it);
-        if (op == opSecond) {
-            if (firstFound) {
-                secondIt = it;
-            }
-            break;
-        }
-        if (op == opFirst) {
-            firstFound = true;
-            firstIt = it;
+void OperationSorterWorker::addDependency(SyncOpPtr op, SyncOpPtr dependency) {
+    if (!_dependencies[op->id()].insert(dependency->id()).second) {
+        return;
+    }
+
+    if (ParametersCache::isExtendedLogEnabled()) {
+        LOGW_SYNCPAL_DEBUG(_logger, L"Operation " << op->id() << L" (" << Utility::s2ws(Utility::opType2Str(op->type())).c_str()
+                                                  << L" " << SyncName2WStr(op->affectedNode()->name()).c_str()
+                                                  << L") depends on operation " << dependency->id() << L" ("
+                                                  << Utility::s2ws(Utility::opType2Str(dependency->type())).c_str() << L" "
+                                                  << SyncName2WStr(dependency->affectedNode()->name()).c_str() << L")");
+    }
+}
+
+bool OperationSorterWorker::sortByDependencies() {
+    std::vector<SyncOpPtr> ops;
+    std::unordered_map<UniqueId, size_t> positions;
+    listOperations(ops, positions);
+
+    std::vector<size_t> sortedPositions;
+    topologicalOrder(ops, positions, sortedPositions);
+    if (sortedPositions.size() < ops.size()) {
+        LOG_SYNCPAL_INFO(_logger, "Cycle found in operation dependencies");
+        return false;
+    }
+
+    bool orderChanged = false;
+    std::vector<size_t> newPositions(ops.size());
+    for (size_t i = 0; i < sortedPositions.size(); i++) {
+        newPositions[sortedPositions[i]] = i;
+        if (sortedPositions[i] != i) {
+            orderChanged = true;
         }
     }
 
-    // Make sure that opFirst is finished before starting opSecond, even if they are in the correct order
-    opFirst->setParentId(opSecond->id());
+    // Make sure that an operation is not started before its dependencies are finished, even if they are in the correct order.
+    // The job of an operation can wait for only one other job: the one of the last dependency.
+    for (size_t i = 0; i < ops.size(); i++) {
+        auto dependenciesIt = _dependencies.find(ops[i]->id());
+        if (dependenciesIt == _dependencies.end()) {
+            continue;
+        }
 
-    if (firstFound) {
-        // make sure opSecond is executed after opFirst
-        if (ParametersCache::isExtendedLogEnabled()) {
-            LOGW_SYNCPAL_DEBUG(_logger, L"Operation " << opFirst->id() << L" ("
-                                                      << Utility::s2ws(Utility::opType2Str(opFirst->type())).c_str() << L" "
-                                                      << SyncName2WStr(opFirst->affectedNode()->name()).c_str()
-                                                      << L") moved after operation " << opSecond->id() << L" ("
-                                                      << Utility::s2ws(Utility::opType2Str(opSecond->type())).c_str() << L" "
-                                                      << SyncName2WStr(opSecond->affectedNode()->name()).c_str() << L")");
+        std::optional<size_t> lastDependencyPosition;
+        for (const auto &dependencyId : dependenciesIt->second) {
+            auto positionIt = positions.find(dependencyId);
+            if (positionIt == positions.end()) {
+                continue;
+            }
+            if (!lastDependencyPosition || newPositions[positionIt->second] > newPositions[*lastDependencyPosition]) {
+                lastDependencyPosition = positionIt->second;
+            }
         }
+        if (lastDependencyPosition) {
+            ops[i]->setParentId(ops[*lastDependencyPosition]->id());
+        }
+    }
 
-        _syncPal->_syncOps->deleteOp(firstIt);
-        _syncPal->_syncOps->insertOp(++secondIt, opFirst);
+    if (orderChanged) {
+        std::list<SyncOpPtr> sortedOps;
+        for (const auto &position : sortedPositions) {
+            sortedOps.push_back(ops[position]);
+        }
+        _syncPal->_syncOps->setOpList(sortedOps);
         _hasOrderChanged = true;
-        addPairToReoderings(opSecond, opFirst);
     }
+
+    return true;
 }
 
-void OperationSorterWorker::addPairToReoderings(SyncOpPtr op, SyncOpPtr opOnFirstDepends) {
-    std::pair<SyncOpPtr, SyncOpPtr> pair = std::make_pair(op, opOnFirstDepends);
-    for (auto opPair : _reorderings) {
-        if (opPair == pair) {
-            return;
+void OperationSorterWorker::listOperations(std::vector<SyncOpPtr> &ops, std::unordered_map<UniqueId, size_t> &positions) {
+    ops.reserve(_syncPal->_syncOps->size());
+    for (const auto &opId : _syncPal->_syncOps->opSortedList()) {
+        SyncOpPtr op = _syncPal->_syncOps->getOp(opId);
+        if (op != nullptr) {
+            positions.insert({opId, ops.size()});
+            ops.push_back(op);
+        }
+    }
+}
+
+void OperationSorterWorker::topologicalOrder(const std::vector<SyncOpPtr> &ops,
+                                             const std::unordered_map<UniqueId, size_t> &positions,
+                                             std::vector<size_t> &sortedPositions) {
+    std::vector<size_t> nbPendingDependencies(ops.size(), 0);
+    std::vector<std::vector<size_t>> dependents(ops.size());
+    for (size_t i = 0; i < ops.size(); i++) {
+        auto dependenciesIt = _dependencies.find(ops[i]->id());
+        if (dependenciesIt == _dependencies.end()) {
+            continue;
+        }
+        for (const auto &dependencyId : dependenciesIt->second) {
+            auto positionIt = positions.find(dependencyId);
+            if (positionIt != positions.end()) {
+                dependents[positionIt->second].push_back(i);
+                nbPendingDependencies[i]++;
+            }
+        }
+    }
+
+    // Among the operations whose dependencies are sorted, the first one in the current order goes next
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> readyPositions;
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (nbPendingDependencies[i] == 0) {
+            readyPositions.push(i);
+        }
+    }
+
+    sortedPositions.clear();
+    sortedPositions.reserve(ops.size());
+    while (!readyPositions.empty()) {
+        const size_t position = readyPositions.top();
+        readyPositions.pop();
+        sortedPositions.push_back(position);
+
+        for (const auto &dependentPosition : dependents[position]) {
+            if (--nbPendingDependencies[dependentPosition] == 0) {
+                readyPositions.push(dependentPosition);
+            }
         }
     }
-    _reorderings.push_back(pair);
 }
 
 }  // namespace KDC
@@ -24,6 +24,9 @@
 
 #include <list>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace KDC {
 
@@ -38,10 +41,12 @@ class OperationSorterWorker : public OperationProcessor {
     private:
         SyncOperationList _unsortedList;
 
-        std::list<std::pair<SyncOpPtr, SyncOpPtr>> _reorderings;
+        // Operation ID -> IDs of the operations that must be executed before it
+        std::unordered_map<UniqueId, std::unordered_set<UniqueId>> _dependencies;
         bool _hasOrderChanged;
 
         ExitCode sortOperations();
+        // Each fix method adds the dependencies required by one ordering rule, the operations are reordered by sortByDependencies
         void fixDeleteBeforeMove();
         void fixMoveBeforeCreate();
         void fixMoveBeforeDelete();
@@ -54,11 +59,18 @@ class OperationSorterWorker : public OperationProcessor {
         std::optional<SyncOperationList> fixImpossibleFirstMoveOp();
         std::list<SyncOperationList> findCompleteCycles();
         bool breakCycle(SyncOperationList &cycle, SyncOpPtr renameResolutionOp);
-        void moveFirstAfterSecond(SyncOpPtr opFirst, SyncOpPtr opSecond);
-        void addPairToReoderings(SyncOpPtr op, std::shared_ptr<SyncOperation> opOnFirstDepends);
+        void addDependency(SyncOpPtr op, SyncOpPtr dependency);
 
-        bool hasParentWithHigherIndex(const std::unordered_map<UniqueId, int> &indexMap, const SyncOpPtr op,
-                                      const int createOpIndex, SyncOpPtr &ancestorOp, int &depth);
+        /** Reorders the operations so that each one comes after its dependencies, keeping the current relative order otherwise.
+         * @return false if the dependencies contain a cycle, the order is then left unchanged.
+         */
+        bool sortByDependencies();
+        void listOperations(std::vector<SyncOpPtr> &ops, std::unordered_map<UniqueId, size_t> &positions);
+        void topologicalOrder(const std::vector<SyncOpPtr> &ops, const std::unordered_map<UniqueId, size_t> &positions,
+                              std::vector<size_t> &sortedPositions);
+
+        // Parent ID, in DB, of the item with the given node ID. Returns false on DB error
+        bool dbParentId(std::shared_ptr<Node> node, const NodeId &nodeId, std::optional<NodeId> &parentId);
 
         friend class TestOperationSorterWorker;
 };
@@ -71,60 +71,14 @@ void ExclusionTemplateCache::populateUndeletedExclusionTemplates() {
         }
     }
 
-    updateRegexPatterns();
+    updateMatcher();
 }
 
-void ExclusionTemplateCache::updateRegexPatterns() {
+void ExclusionTemplateCache::updateMatcher() {
     const std::lock_guard<std::mutex> lock(_mutex);
-    _regexPatterns.clear();
-
-    for (const auto &exclPattern : exclusionTemplates()) {
-        std::string templateTest = exclPattern.templ();
-        escapeRegexSpecialChar(templateTest);
-
-        // Replace all * by .*? to accept any characters. ? for lazy matching (matches as few characters as possible)
-        std::string regexPattern;
-        if (templateTest[0] == '*') {
-            regexPattern += ".*?";
-        } else {
-            regexPattern += "^";  // Start of string
-        }
-
-        std::vector<std::string> splitStr = Utility::splitStr(templateTest, '*');
-        for (auto it = splitStr.begin(); it != splitStr.end();) {
-            if (it->empty()) {
-                it++;
-                continue;
-            }
-            regexPattern += *it;
-
-            it++;
-            if (it != splitStr.end()) {
-                regexPattern += ".*?";
-            }
-        }
-
-        if (templateTest[templateTest.size() - 1] == '*') {
-            regexPattern += ".*?";
-        } else {
-            regexPattern += "$";  // End of string
-        }
-
-        _regexPatterns.emplace_back(std::regex(regexPattern), exclPattern);
-    }
-}
-
-void ExclusionTemplateCache::escapeRegexSpecialChar(std::string &in) {
-    std::string out;
-    static const char metacharacters[] = R"(\.^$-+()[]{}|?)";
-    out.reserve(in.size());
-    for (const auto ch : in) {
-        if (std::strchr(metacharacters, ch)) {
-            out.push_back('\\');
-        }
-        out.push_back(ch);
-    }
-    in = out;
+    auto matcher = std::make_shared<const ExclusionTemplateMatcher>(exclusionTemplates());
+    const std::lock_guard<std::mutex> matcherLock(_matcherMutex);
+    _matcher = std::move(matcher);
 }
 
 ExitCode ExclusionTemplateCache::update(bool def, const std::vector<ExclusionTemplate> &exclusionTemplates) {
@@ -193,71 +147,38 @@ bool ExclusionTemplateCache::checkIfIsExcludedBecauseHidden(const SyncPath &base
 }
 
 bool ExclusionTemplateCache::isExcludedByTemplate(const SyncPath &relativePath, bool &isWarning) noexcept {
-    const std::lock_guard<std::mutex> lock(_mutex);
+    isWarning = false;
+
+    std::shared_ptr<const ExclusionTemplateMatcher> matcher;
+    {
+        const std::lock_guard<std::mutex> lock(_matcherMutex);
+        matcher = _matcher;
+    }
+    if (!matcher) {
+        return false;
+    }
+
+#ifdef _WIN32
     const std::string fileName = SyncName2Str(relativePath.filename().native());
-    for (const auto &pattern : _regexPatterns) {
-        const std::string &patternStr = pattern.second.templ();
-        isWarning = pattern.second.warning();
-
-        switch (pattern.second.complexity()) {
-            case ExclusionTemplateComplexitySimplest: {
-                if (fileName == patternStr) {
-                    if (ParametersCache::isExtendedLogEnabled()) {
-                        LOGW_INFO(Log::instance()->getLogger(),
-                                  L"Item \"" << Path2WStr(relativePath).c_str() << L"\" rejected because of rule \""
-                                             << Utility::s2ws(pattern.second.templ()).c_str() << L"\"");
-                    }
-                    return true;  // Filename match exactly the pattern
-                }
-                break;
-            }
-            case ExclusionTemplateComplexitySimple: {
-                std::string tmpStr = patternStr;
-                bool atBegining = tmpStr[0] == '*';
-                bool atEnd = tmpStr[tmpStr.length() - 1] == '*';
-                std::string::size_type n = tmpStr.find('*');
-                while (n != std::string::npos) {
-                    tmpStr.erase(n, 1);
-                    n = tmpStr.find('*');
-                }
-
-                bool exclude = false;
-                if (atBegining && atEnd) {
-                    // Template can be anywhere
-                    exclude = fileName.find(tmpStr) != std::string::npos;
-                } else if (atBegining) {
-                    // Must be at the end only
-                    exclude = Utility::endsWith(fileName, tmpStr);
-                } else {
-                    // Must be at the beginning only
-                    exclude = Utility::startsWith(fileName, tmpStr);
-                }
-
-                if (exclude) {
-                    if (ParametersCache::isExtendedLogEnabled()) {
-                        LOGW_INFO(Log::instance()->getLogger(),
-                                  L"Item \"" << Path2WStr(relativePath).c_str() << L"\" rejected because of rule \""
-                                             << Utility::s2ws(pattern.second.templ()).c_str() << L"\"");
-                    }
-                    return true;  // Filename contains the pattern
-                }
-                break;
-            }
-            case ExclusionTemplateComplexityComplex:
-            default: {
-                if (std::regex_match(fileName, pattern.first)) {
-                    if (ParametersCache::isExtendedLogEnabled()) {
-                        LOGW_INFO(Log::instance()->getLogger(),
-                                  L"Item \"" << Path2WStr(relativePath).c_str() << L"\" rejected because of rule \""
-                                             << Utility::s2ws(pattern.second.templ()).c_str() << L"\"");
-                    }
-                    return true;
-                }
-                break;
-            }
-        }
+#else
+    // Same as relativePath.filename(), without copy
+    std::string_view fileName = relativePath.native();
+    if (const size_t separatorPos = fileName.find_last_of('/'); separatorPos != std::string_view::npos) {
+        fileName.remove_prefix(separatorPos + 1);
+    }
+#endif
+
+    const ExclusionTemplate *exclusionTemplate = matcher->match(fileName);
+    if (!exclusionTemplate) {
+        return false;
     }
-    return false;
+
+    isWarning = exclusionTemplate->warning();
+    if (ParametersCache::isExtendedLogEnabled()) {
+        LOGW_INFO(Log::instance()->getLogger(), L"Item \"" << Path2WStr(relativePath).c_str() << L"\" rejected because of rule \""
+                                                           << Utility::s2ws(exclusionTemplate->templ()).c_str() << L"\"");
+    }
+    return true;
 }
 
 }  // namespace KDC
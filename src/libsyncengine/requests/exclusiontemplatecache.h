@@ -19,12 +19,12 @@
 #pragma once
 
 #include "syncenginelib.h"
+#include "exclusiontemplatematcher.h"
 #include "libparms/db/exclusiontemplate.h"
 #include "libcommon/utility/types.h"
 
 #include <memory>
 #include <vector>
-#include <regex>
 #include <string>
 #include <mutex>
 
@@ -59,7 +59,9 @@ class SYNCENGINE_EXPORT ExclusionTemplateCache {
         std::vector<ExclusionTemplate> _undeletedExclusionTemplates;
         std::vector<ExclusionTemplate> _defExclusionTemplates;
         std::vector<ExclusionTemplate> _userExclusionTemplates;
-        std::vector<std::pair<std::regex, ExclusionTemplate>> _regexPatterns;
+        // Replaced on update, readers keep using the instance they copied while it is replaced
+        std::shared_ptr<const ExclusionTemplateMatcher> _matcher;
+        std::mutex _matcherMutex;  // Only held to copy or replace the pointer
 
         std::mutex _mutex;
 
@@ -67,9 +69,7 @@ class SYNCENGINE_EXPORT ExclusionTemplateCache {
 
         void populateUndeletedExclusionTemplates();
 
-        void updateRegexPatterns();
-
-        void escapeRegexSpecialChar(std::string &in);
+        void updateMatcher();
 };
 
 }  // namespace KDC
@@ -0,0 +1,173 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "exclusiontemplatematcher.h"
+#include "libcommonserver/utility/utility.h"
+
+#include <algorithm>
+
+namespace KDC {
+
+ExclusionTemplateMatcher::ExclusionTemplateMatcher(const std::vector<ExclusionTemplate> &exclusionTemplates)
+    : _exclusionTemplates(exclusionTemplates) {
+    for (size_t index = 0; index < _exclusionTemplates.size(); index++) {
+        const std::string &templ = _exclusionTemplates[index].templ();
+        switch (_exclusionTemplates[index].complexity()) {
+            case ExclusionTemplateComplexitySimplest: {
+                // The first template wins if several are identical
+                _exactNames.emplace(templ, index);
+                break;
+            }
+            case ExclusionTemplateComplexitySimple: {
+                const bool atBeginning = templ[0] == '*';
+                const bool atEnd = templ[templ.length() - 1] == '*';
+                std::string str = templ;
+                str.erase(std::remove(str.begin(), str.end(), '*'), str.end());
+
+                if (atBeginning && atEnd) {
+                    // Template can be anywhere
+                    _substrings.emplace_back(str, index);
+                } else if (atBeginning) {
+                    // Must be at the end only
+                    insertByLength(_suffixesByLength, str, index);
+                } else {
+                    // Must be at the beginning only
+                    insertByLength(_prefixesByLength, str, index);
+                }
+                break;
+            }
+            case ExclusionTemplateComplexityComplex:
+            default: {
+                GlobTemplate globTemplate;
+                globTemplate.index = index;
+                globTemplate.anchoredAtBeginning = templ.empty() || templ[0] != '*';
+                globTemplate.anchoredAtEnd = templ.empty() || templ[templ.length() - 1] != '*';
+                for (auto &segment : Utility::splitStr(templ, '*')) {
+                    if (!segment.empty()) {
+                        globTemplate.segments.push_back(std::move(segment));
+                    }
+                }
+                _globTemplates.push_back(std::move(globTemplate));
+                break;
+            }
+        }
+    }
+}
+
+const ExclusionTemplate *ExclusionTemplateMatcher::match(std::string_view fileName) const {
+    size_t bestIndex = _exclusionTemplates.size();
+
+    if (auto it = _exactNames.find(fileName); it != _exactNames.end()) {
+        bestIndex = it->second;
+    }
+
+    for (const auto &[length, prefixes] : _prefixesByLength) {
+        if (length > fileName.length()) {
+            continue;
+        }
+        if (auto it = prefixes.find(fileName.substr(0, length)); it != prefixes.end()) {
+            bestIndex = std::min(bestIndex, it->second);
+        }
+    }
+
+    for (const auto &[length, suffixes] : _suffixesByLength) {
+        if (length > fileName.length()) {
+            continue;
+        }
+        if (auto it = suffixes.find(fileName.substr(fileName.length() - length)); it != suffixes.end()) {
+            bestIndex = std::min(bestIndex, it->second);
+        }
+    }
+
+    for (const auto &[substring, index] : _substrings) {
+        if (index < bestIndex && fileName.find(substring) != std::string_view::npos) {
+            bestIndex = index;
+        }
+    }
+
+    // Glob templates are sorted by index
+    for (const auto &globTemplate : _globTemplates) {
+        if (globTemplate.index >= bestIndex) {
+            break;
+        }
+        if (globMatch(globTemplate, fileName)) {
+            bestIndex = globTemplate.index;
+            break;
+        }
+    }
+
+    return bestIndex < _exclusionTemplates.size() ? &_exclusionTemplates[bestIndex] : nullptr;
+}
+
+void ExclusionTemplateMatcher::insertByLength(std::vector<std::pair<size_t, IndexByString>> &stringsByLength,
+                                              const std::string &str, size_t index) {
+    auto it = std::find_if(stringsByLength.begin(), stringsByLength.end(),
+                           [&str](const std::pair<size_t, IndexByString> &strings) { return strings.first == str.length(); });
+    if (it == stringsByLength.end()) {
+        stringsByLength.emplace_back(str.length(), IndexByString());
+        it = std::prev(stringsByLength.end());
+    }
+    it->second.emplace(str, index);
+}
+
+bool ExclusionTemplateMatcher::globMatch(const GlobTemplate &globTemplate, std::string_view fileName) {
+    const std::vector<std::string> &segments = globTemplate.segments;
+    if (segments.empty()) {
+        // Only '*'
+        return !globTemplate.anchoredAtBeginning || fileName.empty();
+    }
+
+    size_t first = 0;
+    size_t last = segments.size();
+    size_t begin = 0;
+    size_t end = fileName.length();
+
+    if (globTemplate.anchoredAtBeginning) {
+        if (fileName.substr(0, segments[first].length()) != segments[first]) {
+            return false;
+        }
+        begin = segments[first].length();
+        first++;
+    }
+
+    if (globTemplate.anchoredAtEnd && first < last) {
+        const std::string &lastSegment = segments[last - 1];
+        if (lastSegment.length() > end - begin || fileName.substr(end - lastSegment.length()) != lastSegment) {
+            return false;
+        }
+        end -= lastSegment.length();
+        last--;
+    } else if (globTemplate.anchoredAtEnd && begin != end) {
+        // A single segment anchored at both ends
+        return false;
+    }
+
+    // The other segments are searched in order, each as early as possible
+    const std::string_view middle = fileName.substr(begin, end - begin);
+    size_t pos = 0;
+    for (size_t i = first; i < last; i++) {
+        pos = middle.find(segments[i], pos);
+        if (pos == std::string_view::npos) {
+            return false;
+        }
+        pos += segments[i].length();
+    }
+    return true;
+}
+
+}  // namespace KDC
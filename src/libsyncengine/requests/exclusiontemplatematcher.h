@@ -0,0 +1,71 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "syncenginelib.h"
+#include "libparms/db/exclusiontemplate.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace KDC {
+
+/**
+ * Exclusion templates compiled for fast file name matching. Immutable once built, it can be used by several threads.
+ * Exact names and templates with a '*' only at the beginning and/or at the end are looked up in hash tables, the other
+ * templates are matched segment by segment.
+ */
+class SYNCENGINE_EXPORT ExclusionTemplateMatcher {
+    public:
+        explicit ExclusionTemplateMatcher(const std::vector<ExclusionTemplate> &exclusionTemplates);
+
+        /** @return the first template, in list order, matching the file name, or nullptr if none.
+         */
+        const ExclusionTemplate *match(std::string_view fileName) const;
+
+    private:
+        struct StringHash {
+                using is_transparent = void;
+                size_t operator()(std::string_view str) const { return std::hash<std::string_view>()(str); }
+        };
+        typedef std::unordered_map<std::string, size_t, StringHash, std::equal_to<>> IndexByString;
+
+        // Templates with a '*' elsewhere than at the beginning or at the end
+        struct GlobTemplate {
+                size_t index = 0;
+                std::vector<std::string> segments;  // Parts between the '*'
+                bool anchoredAtBeginning = true;
+                bool anchoredAtEnd = true;
+        };
+
+        std::vector<ExclusionTemplate> _exclusionTemplates;
+        IndexByString _exactNames;
+        std::vector<std::pair<size_t, IndexByString>> _prefixesByLength;
+        std::vector<std::pair<size_t, IndexByString>> _suffixesByLength;
+        std::vector<std::pair<std::string, size_t>> _substrings;
+        std::vector<GlobTemplate> _globTemplates;
+
+        static void insertByLength(std::vector<std::pair<size_t, IndexByString>> &stringsByLength, const std::string &str,
+                                   size_t index);
+        static bool globMatch(const GlobTemplate &globTemplate, std::string_view fileName);
+};
+
+}  // namespace KDC
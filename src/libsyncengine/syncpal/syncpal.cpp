@@ -43,11 +43,13 @@
 #include "requests/syncnodecache.h"
 #include "requests/parameterscache.h"
 #include "jobs/network/downloadjob.h"
+#include "jobs/network/networkjobsparams.h"
 #include "jobs/network/upload_session/uploadsessioncanceljob.h"
 #include "jobs/local/localmovejob.h"
 #include "jobs/local/localdeletejob.h"
 #include "jobs/jobmanager.h"
 #include "libcommon/utility/utility.h"
+#include "libcommonserver/io/iohelper.h"
 #include "libcommonserver/utility/utility.h"
 #include "tmpblacklistmanager.h"
 
@@ -350,6 +352,7 @@ void SyncPal::syncPalStartCallback([[maybe_unused]] UniqueId jobId) {
 }
 
 void SyncPal::addError(const Error &error) {
+    _syncHasItemErrors = true;
     if (_addError) {
         _addError(error);
     }
@@ -687,6 +690,9 @@ void SyncPal::setProgress(const SyncPath &relativePath, int64_t current) {
 }
 
 void SyncPal::setProgressComplete(const SyncPath &relativeLocalPath, SyncFileStatus status) {
+    if (status == SyncFileStatusError) {
+        _syncHasItemErrors = true;
+    }
     _progressInfo->setProgressComplete(relativeLocalPath, status);
     vfsFileStatusChanged(_localPath / relativeLocalPath, status);
 
@@ -1272,6 +1278,12 @@ ExitCode SyncPal::cleanOldUploadSessionTokens() {
     }
 
     for (auto &uploadSessionToken : uploadSessionTokenList) {
+        if (isUploadSessionResumable(uploadSessionToken)) {
+            // The session will be resumed by the next upload of the file
+            LOG_SYNCPAL_DEBUG(_logger, "Upload Session Token: " << uploadSessionToken.token().c_str() << " kept for resume");
+            continue;
+        }
+
         try {
             auto job = std::make_shared<UploadSessionCancelJob>(_driveDbId, "", uploadSessionToken.token());
             ExitCode exitCode = job->runSynchronously();
@@ -1290,16 +1302,39 @@ ExitCode SyncPal::cleanOldUploadSessionTokens() {
             LOG_WARN(_logger, "Error in UploadSessionCancelJob: " << e.what());
             return ExitCodeBackError;
         }
-    }
 
-    if (!_syncDb->deleteAllUploadSessionToken()) {
-        LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::selectAllUploadSessionTokens");
-        return ExitCodeDbError;
+        bool found = false;
+        if (!_syncDb->deleteUploadSessionTokenByDbId(uploadSessionToken.dbId(), found)) {
+            LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::deleteUploadSessionTokenByDbId");
+            return ExitCodeDbError;
+        }
     }
 
     return ExitCodeOk;
 }
 
+bool SyncPal::isUploadSessionResumable(const UploadSessionToken &uploadSessionToken) {
+    UploadSessionInfo uploadSessionInfo;
+    bool found = false;
+    if (!_syncDb->selectUploadSessionInfo(uploadSessionToken.dbId(), uploadSessionInfo, found) || !found) {
+        return false;
+    }
+
+    const SyncTime now =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (now - uploadSessionInfo.creationTime() > uploadSessionMaxResumeDelay) {
+        return false;
+    }
+
+    uint64_t fileSize = 0;
+    IoError ioError = IoErrorSuccess;
+    if (!IoHelper::getFileSize(uploadSessionInfo.filePath(), fileSize, ioError) || ioError != IoErrorSuccess) {
+        return false;
+    }
+
+    return fileSize == static_cast<uint64_t>(uploadSessionInfo.size());
+}
+
 bool SyncPal::isDownloadOngoing(const SyncPath &localPath) {
     if (_syncPathToDownloadJobMap.find(localPath) != _syncPathToDownloadJobMap.end()) {
         return true;
@@ -1445,6 +1480,7 @@ void SyncPal::fixNodeTableDeleteItemsWithNullParentNodeId() {
 }
 
 void SyncPal::increaseErrorCount(const NodeId &nodeId, NodeType type, const SyncPath &relativePath, ReplicaSide side) {
+    _syncHasItemErrors = true;
     _tmpBlacklistManager->increaseErrorCount(nodeId, type, relativePath, side);
 }
 
@@ -1453,6 +1489,7 @@ int SyncPal::getErrorCount(const NodeId &nodeId, ReplicaSide side) const noexcep
 }
 
 void SyncPal::blacklistTemporarily(const NodeId &nodeId, const SyncPath &relativePath, ReplicaSide side) {
+    _syncHasItemErrors = true;
     _tmpBlacklistManager->blacklistItem(nodeId, relativePath, side);
 }
 
@@ -1465,8 +1502,9 @@ void SyncPal::removeItemFromTmpBlacklist(const NodeId &nodeId, ReplicaSide side)
 }
 
 void SyncPal::copySnapshots() {
-    _localSnapshotCopy = _localSnapshot;
-    _remoteSnapshotCopy = _remoteSnapshot;
+    // Constant time: the copies share their items with the real time snapshots (copy-on-write)
+    *_localSnapshotCopy = *_localSnapshot;
+    *_remoteSnapshotCopy = *_remoteSnapshot;
 }
 
 }  // namespace KDC
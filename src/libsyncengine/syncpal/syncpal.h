@@ -31,6 +31,7 @@
 #include "libcommon/utility/types.h"
 #include "libparms/db/parmsdb.h"
 
+#include <atomic>
 #include <memory>
 #include <filesystem>
 
@@ -206,6 +207,7 @@ class SYNCENGINE_EXPORT SyncPal : public std::enable_shared_from_this<SyncPal> {
         ExitCode cancelDlDirectJobs(const std::list<SyncPath> &fileList);
         ExitCode cancelAllDlDirectJobs(bool quit);
         ExitCode cleanOldUploadSessionTokens();
+        bool isUploadSessionResumable(const UploadSessionToken &uploadSessionToken);
         bool isDownloadOngoing(const SyncPath &localPath);
 
         inline bool syncHasFullyCompleted() const { return _syncHasFullyCompleted; }
@@ -243,6 +245,8 @@ class SYNCENGINE_EXPORT SyncPal : public std::enable_shared_from_this<SyncPal> {
         bool _restart{false};
         bool _isPaused{false};
         bool _syncHasFullyCompleted;
+        // An item of the current sync has not been propagated because of an error, or has been blacklisted
+        std::atomic<bool> _syncHasItemErrors{false};
 
         std::shared_ptr<ExcludeListPropagator> _excludeListPropagator = nullptr;
         std::shared_ptr<BlacklistPropagator> _blacklistPropagator = nullptr;
@@ -347,6 +351,7 @@ class SYNCENGINE_EXPORT SyncPal : public std::enable_shared_from_this<SyncPal> {
         friend class LocalFileSystemObserverWorker_win;
         friend class RemoteFileSystemObserverWorker;
         friend class ComputeFSOperationWorker;
+        friend class ContentChecksumWorker;
         friend class UpdateTreeWorker;
         friend class PlatformInconsistencyCheckerWorker;
         friend class OperationProcessor;
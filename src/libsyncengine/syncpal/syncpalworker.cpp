@@ -31,6 +31,7 @@
 #include <log4cplus/loggingmacros.h>
 
 #define UPDATE_PROGRESS_DELAY 1
+#define CHECKSUM_CACHE_CLEANUP_PERIOD 3600  // s
 
 namespace KDC {
 
@@ -281,6 +282,7 @@ void SyncPalWorker::initStep(SyncStep step, std::shared_ptr<ISyncWorker> (&worke
             inputSharedObject[0] = _syncPal->snapshot(ReplicaSideLocal, true);
             inputSharedObject[1] = _syncPal->snapshot(ReplicaSideRemote, true);
             _syncPal->_restart = false;
+            _syncPal->_syncHasItemErrors = false;
             break;
         case SyncStepUpdateDetection2:
             workers[0] = _syncPal->_localUpdateTreeWorker;
@@ -331,8 +333,22 @@ void SyncPalWorker::initStep(SyncStep step, std::shared_ptr<ISyncWorker> (&worke
             inputSharedObject[0] = nullptr;
             inputSharedObject[1] = nullptr;
             _syncPal->stopEstimateUpdates();
+            _syncPal->snapshot(ReplicaSideLocal)->resetLockStats();
+            _syncPal->snapshot(ReplicaSideRemote)->resetLockStats();
             if (!_syncPal->_restart) {
                 _syncPal->setSyncHasFullyCompleted(true);
+
+                if (_syncPal->_syncHasItemErrors) {
+                    // Some of the changes compared in this sync are not in the DB, the next comparison must find them again
+                    _syncPal->snapshot(ReplicaSideLocal, true)->invalidateDirtyIds();
+                    _syncPal->snapshot(ReplicaSideRemote, true)->invalidateDirtyIds();
+                } else {
+                    // The changes compared in this sync are now in the DB
+                    _syncPal->snapshot(ReplicaSideLocal, true)->clearDirtyIds();
+                    _syncPal->snapshot(ReplicaSideRemote, true)->clearDirtyIds();
+                }
+
+                cleanUpChecksumCache();
             }
             break;
         default:
@@ -511,6 +527,22 @@ void SyncPalWorker::unpauseAllWorkers(std::shared_ptr<ISyncWorker> workers[2]) {
     LOG_SYNCPAL_INFO(_logger, "***** Resume done");
 }
 
+void SyncPalWorker::cleanUpChecksumCache() {
+    // The whole cache is scanned, not after every sync
+    const auto now = std::chrono::steady_clock::now();
+    if (now - _lastChecksumCacheCleanup < std::chrono::seconds(CHECKSUM_CACHE_CLEANUP_PERIOD)) {
+        return;
+    }
+    _lastChecksumCacheCleanup = now;
+
+    int nbDeleted = 0;
+    if (!_syncPal->_syncDb->deleteOrphanCachedChecksums(nbDeleted)) {
+        LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::deleteOrphanCachedChecksums");
+        return;
+    }
+    LOG_SYNCPAL_DEBUG(_logger, nbDeleted << " cached checksums of deleted files removed");
+}
+
 bool SyncPalWorker::resetVfsFilesStatus() {
     bool ok = true;
     try {
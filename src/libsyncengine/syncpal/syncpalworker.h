@@ -38,6 +38,7 @@ class SyncPalWorker : public ISyncWorker {
     private:
         SyncStep _step;
         std::chrono::time_point<std::chrono::system_clock> _pauseTime;
+        std::chrono::steady_clock::time_point _lastChecksumCacheCleanup;
 
         void initStep(SyncStep step, std::shared_ptr<ISyncWorker> (&workers)[2],
                       std::shared_ptr<SharedObject> (&inputSharedObject)[2]);
@@ -53,6 +54,8 @@ class SyncPalWorker : public ISyncWorker {
         void pauseAllWorkers(std::shared_ptr<ISyncWorker> workers[2]);
         void unpauseAllWorkers(std::shared_ptr<ISyncWorker> workers[2]);
         bool resetVfsFilesStatus();
+        /** Periodically deletes the cached checksums of the files that are not synced anymore. */
+        void cleanUpChecksumCache();
 };
 
 }  // namespace KDC
@@ -17,6 +17,8 @@
  */
 
 #include "computechecksumjob.h"
+#include "libcommonserver/io/filestat.h"
+#include "libcommonserver/io/iohelper.h"
 #include "libcommonserver/log/log.h"
 #include "libcommonserver/utility/utility.h"
 #include "requests/parameterscache.h"
@@ -25,75 +27,174 @@
 
 #include <xxhash.h>
 
+#ifdef _WIN32
+#include <cstdio>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define READ_BUFFER_SIZE (1024 * 1024)  // 1MB
+
 namespace KDC {
 
-ComputeChecksumJob::ComputeChecksumJob(const NodeId &nodeId, const SyncPath &filepath, std::shared_ptr<Snapshot> localSnapshot)
-    : _logger(Log::instance()->getLogger()), _nodeId(nodeId), _filePath(filepath), _localSnapshot(localSnapshot) {}
+ComputeChecksumJob::ComputeChecksumJob(const NodeId &nodeId, const SyncPath &filepath, std::shared_ptr<Snapshot> localSnapshot,
+                                       std::shared_ptr<SyncDb> syncDb /*= nullptr*/)
+    : _logger(Log::instance()->getLogger()),
+      _nodeId(nodeId),
+      _filePath(filepath),
+      _localSnapshot(localSnapshot),
+      _syncDb(syncDb) {}
 
 void ComputeChecksumJob::runJob() {
     if (isExtendedLog()) {
         LOGW_DEBUG(_logger, L"Checksum job started: id: " << jobId() << L", path: " << Path2WStr(_filePath).c_str());
     }
 
+    FileStat fileStat;
+    IoError ioError = IoErrorSuccess;
+    if (!IoHelper::getFileStat(_filePath, &fileStat, ioError) || ioError != IoErrorSuccess) {
+        LOGW_DEBUG(_logger, L"Item does not exist anymore - path=" << Path2WStr(_filePath).c_str());
+        return;
+    }
+
+    // An unchanged file is not read again
+    std::string checksum;
+    bool found = false;
+    if (_syncDb &&
+        !_syncDb->selectCachedChecksum(fileStat.inode, fileStat.size, fileStat.modtime, fileStat.creationTime, checksum, found)) {
+        LOG_WARN(_logger, "Error in SyncDb::selectCachedChecksum");
+        found = false;
+    }
+    if (found) {
+        _localSnapshot->setContentChecksum(_nodeId, checksum);
+        if (isExtendedLog()) {
+            LOGW_DEBUG(_logger, L"Checksum of file " << Path2WStr(_filePath).c_str() << L" found in cache");
+        }
+        return;
+    }
+
     auto start = std::chrono::steady_clock::now();
-    bool stopped = false;
+    uint64_t readSize = 0;
+    if (!computeChecksum(checksum, readSize)) {
+        return;
+    }
 
-    // Create a hash stat
-    XXH3_state_t *const state = XXH3_createState();
-    if (!state) {
-        LOGW_WARN(_logger, L"Checksum computation " << jobId() << L" failed for file " << Path2WStr(_filePath).c_str());
+    if (isAborted()) {
+        LOGW_WARN(_logger, L"Checksum computation " << jobId() << L" aborted for file " << Path2WStr(_filePath).c_str());
         return;
     }
 
-    // Initialize state with selected seed
-    if (XXH3_64bits_reset(state) == XXH_ERROR) {
+    _localSnapshot->setContentChecksum(_nodeId, checksum);
+
+    std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
+    if (isExtendedLog()) {
+        const double throughput = elapsed_seconds.count() > 0 ? readSize / elapsed_seconds.count() / (1024 * 1024) : 0;
+        LOGW_DEBUG(_logger, L"Checksum computation " << jobId() << L" for file " << Path2WStr(_filePath).c_str() << L" took "
+                                                     << elapsed_seconds.count() << L"s (" << throughput << L" MB/s)");
+    }
+
+    // Cache the checksum only if the file has not been modified while it was read
+    FileStat newFileStat;
+    if (_syncDb && IoHelper::getFileStat(_filePath, &newFileStat, ioError) && ioError == IoErrorSuccess &&
+        newFileStat.inode == fileStat.inode && newFileStat.size == fileStat.size && newFileStat.modtime == fileStat.modtime &&
+        newFileStat.creationTime == fileStat.creationTime) {
+        if (!_syncDb->insertCachedChecksum(fileStat.inode, fileStat.size, fileStat.modtime, fileStat.creationTime, checksum)) {
+            LOG_WARN(_logger, "Error in SyncDb::insertCachedChecksum");
+        }
+    }
+
+    if (isExtendedLog()) {
+        LOG_DEBUG(_logger, "Checksum job finished: id=" << jobId());
+    }
+}
+
+bool ComputeChecksumJob::computeChecksum(std::string &checksum, uint64_t &readSize) {
+    // Create a hash state
+    std::unique_ptr<XXH3_state_t, decltype(&XXH3_freeState)> state(XXH3_createState(), &XXH3_freeState);
+    if (!state || XXH3_64bits_reset(state.get()) == XXH_ERROR) {
         LOGW_WARN(_logger, L"Checksum computation " << jobId() << L" failed for file " << Path2WStr(_filePath).c_str());
-        return;
+        return false;
     }
 
-    try {
-        FILE *f = fopen(SyncName2Str(_filePath.native()).c_str(), "rb");
-        if (f) {
-            std::size_t len;
-            unsigned char buf[BUFSIZ];
-            do {
-                len = fread(buf, 1, BUFSIZ, f);
-                if (XXH3_64bits_update(state, buf, len) == XXH_ERROR) {
-                    LOGW_WARN(_logger,
-                              L"Checksum computation " << jobId() << L" failed for file " << Path2WStr(_filePath).c_str());
-                    return;
-                }
-            } while (len == BUFSIZ);
-
-            if (!stopped) {
-                // Produce the final hash value
-                XXH64_hash_t const hash = XXH3_64bits_digest(state);
-                _localSnapshot->setContentChecksum(_nodeId, Utility::xxHashToStr(hash));
-            }
+    // Large reads, at offsets aligned on the buffer size
+    std::unique_ptr<char[]> buf(new char[READ_BUFFER_SIZE]);
+    readSize = 0;
 
-            XXH3_freeState(state);
+#ifdef _WIN32
+    FILE *f = _wfopen(_filePath.native().c_str(), L"rbS");  // S: optimized for sequential access
+    if (!f) {
+        LOGW_DEBUG(_logger, L"File " << Path2WStr(_filePath).c_str() << L" is not readable");
+        return false;
+    }
 
+    std::size_t len;
+    do {
+        len = fread(buf.get(), 1, READ_BUFFER_SIZE, f);
+        if (XXH3_64bits_update(state.get(), buf.get(), len) == XXH_ERROR) {
+            LOGW_WARN(_logger, L"Checksum computation " << jobId() << L" failed for file " << Path2WStr(_filePath).c_str());
             fclose(f);
+            return false;
+        }
+        readSize += len;
+    } while (len == READ_BUFFER_SIZE && !isAborted());
+
+    const bool readError = ferror(f) != 0;
+    fclose(f);
+#else
+    const int fd = open(_filePath.native().c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGW_DEBUG(_logger, L"File " << Path2WStr(_filePath).c_str() << L" is not readable");
+        return false;
+    }
 
-            if (stopped) {
-                LOGW_WARN(_logger, L"Checksum computation " << jobId() << L" aborted for file " << Path2WStr(_filePath).c_str());
-            } else {
-                std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
-                if (isExtendedLog()) {
-                    LOGW_DEBUG(_logger, L"Checksum computation " << jobId() << L" for file " << Path2WStr(_filePath).c_str()
-                                                                 << L" took " << elapsed_seconds.count() << L"s");
-                }
+    // The file is read once: read ahead and do not keep its pages in cache
+#ifdef __APPLE__
+    fcntl(fd, F_NOCACHE, 1);
+    fcntl(fd, F_RDAHEAD, 1);
+#else
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    ssize_t len;
+    bool readError = false;
+    while (!isAborted()) {
+        len = read(fd, buf.get(), READ_BUFFER_SIZE);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
             }
-        } else {
-            LOGW_DEBUG(_logger, L"Item does not exist anymore - path=" << Path2WStr(_filePath).c_str());
+            readError = true;
+            break;
         }
-    } catch (...) {
-        LOGW_DEBUG(_logger, L"File " << Path2WStr(_filePath).c_str() << L" is not readable");
+        if (len == 0) {
+            break;
+        }
+
+        if (XXH3_64bits_update(state.get(), buf.get(), static_cast<size_t>(len)) == XXH_ERROR) {
+            LOGW_WARN(_logger, L"Checksum computation " << jobId() << L" failed for file " << Path2WStr(_filePath).c_str());
+            close(fd);
+            return false;
+        }
+
+#ifndef __APPLE__
+        posix_fadvise(fd, static_cast<off_t>(readSize), len, POSIX_FADV_DONTNEED);
+#endif
+        readSize += static_cast<uint64_t>(len);
     }
 
-    if (isExtendedLog()) {
-        LOG_DEBUG(_logger, "Checksum job finished: id=" << jobId());
+    close(fd);
+#endif
+
+    if (readError) {
+        LOGW_DEBUG(_logger, L"File " << Path2WStr(_filePath).c_str() << L" is not readable");
+        return false;
     }
+
+    // Produce the final hash value
+    checksum = Utility::xxHashToStr(XXH3_64bits_digest(state.get()));
+    return true;
 }
 
 }  // namespace KDC
@@ -19,25 +19,34 @@
 #pragma once
 
 #include "jobs/abstractjob.h"
+#include "db/syncdb.h"
 #include "update_detection/file_system_observer/snapshot/snapshot.h"
 
 #include <log4cplus/logger.h>
 
 namespace KDC {
 
+/**
+ * Computes the content checksum of a local file. Checksums are cached in the sync DB, keyed by the inode, size, modtime and
+ * creation time of the file, so that an unchanged file is not read again.
+ */
 class ComputeChecksumJob : public AbstractJob {
     public:
-        ComputeChecksumJob(const NodeId &nodeId, const SyncPath &filepath, std::shared_ptr<Snapshot> localSnapshot);
+        ComputeChecksumJob(const NodeId &nodeId, const SyncPath &filepath, std::shared_ptr<Snapshot> localSnapshot,
+                           std::shared_ptr<SyncDb> syncDb = nullptr);
 
     protected:
         virtual void runJob() override;
 
     private:
+        bool computeChecksum(std::string &checksum, uint64_t &readSize);
+
         log4cplus::Logger _logger;
 
         NodeId _nodeId;
         SyncPath _filePath;
         std::shared_ptr<Snapshot> _localSnapshot;
+        std::shared_ptr<SyncDb> _syncDb;
 };
 
 }  // namespace KDC
@@ -89,7 +89,8 @@ void ContentChecksumWorker::execute() {
             if (_threadPool.available()) {
                 const std::lock_guard<std::mutex> lock(_checksumMutex);
                 std::shared_ptr<ComputeChecksumJob> job =
-                    std::make_shared<ComputeChecksumJob>(_toCompute.front().first, _toCompute.front().second, _localSnapshot);
+                    std::make_shared<ComputeChecksumJob>(_toCompute.front().first, _toCompute.front().second,
+                                                         _localSnapshot, _syncPal ? _syncPal->_syncDb : nullptr);
                 _runningJobs.insert({job->jobId(), job});
                 job->setMainCallback(callback);
                 _threadPool.start(*job);
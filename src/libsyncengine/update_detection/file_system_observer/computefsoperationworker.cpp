@@ -22,11 +22,18 @@
 #include "requests/exclusiontemplatecache.h"
 #include "libcommon/utility/utility.h"
 #include "libcommonserver/utility/utility.h"
+#include "libcommonserver/io/filestat.h"
 #include "libcommonserver/io/iohelper.h"
 #include "reconciliation/platform_inconsistency_checker/platforminconsistencycheckerutility.h"
 
 #include "localfilesystemobserverworker.h"
 
+#include <limits>
+#include <set>
+
+#define DB_SCAN_PAGE_SIZE 10000
+#define FULL_COMPARISON_PERIOD 3600  // s
+
 namespace KDC {
 
 ComputeFSOperationWorker::ComputeFSOperationWorker(std::shared_ptr<SyncPal> syncPal, const std::string &name,
@@ -82,18 +89,25 @@ void ComputeFSOperationWorker::execute() {
 
     _fileSizeMismatchMap.clear();
 
+    std::unordered_set<NodeId> localDirtyIds;
+    std::unordered_set<NodeId> remoteDirtyIds;
+    const bool incremental = isIncrementalComparison(localDirtyIds, remoteDirtyIds);
+
     std::unordered_set<NodeId> localIdsSet;
     std::unordered_set<NodeId> remoteIdsSet;
     if (ok && !stopAsked()) {
-        exitCode = exploreDbTree(localIdsSet, remoteIdsSet);
+        exitCode = incremental ? exploreDirtyDbNodes(localDirtyIds, remoteDirtyIds, localIdsSet, remoteIdsSet)
+                               : exploreDbTree(localIdsSet, remoteIdsSet);
         ok = exitCode == ExitCodeOk;
     }
 
     if (ok && !stopAsked()) {
-        exitCode = exploreSnapshotTree(ReplicaSideLocal, localIdsSet);
+        exitCode = incremental ? exploreSnapshotItems(ReplicaSideLocal, localIdsSet, localDirtyIds)
+                               : exploreSnapshotTree(ReplicaSideLocal, localIdsSet);
         ok = exitCode == ExitCodeOk;
         if (ok) {
-            exitCode = exploreSnapshotTree(ReplicaSideRemote, remoteIdsSet);
+            exitCode = incremental ? exploreSnapshotItems(ReplicaSideRemote, remoteIdsSet, remoteDirtyIds)
+                                   : exploreSnapshotTree(ReplicaSideRemote, remoteIdsSet);
         }
     }
 
@@ -107,322 +121,533 @@ void ComputeFSOperationWorker::execute() {
 
     std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
     LOG_SYNCPAL_INFO(_logger, "FS operation sets generated in: " << elapsed_seconds.count() << "s");
+    for (const auto &snapshot : {_localSnapshot, _remoteSnapshot}) {
+        const Snapshot::LockStats lockStats = snapshot->lockStats();
+        LOG_SYNCPAL_DEBUG(_logger, Utility::side2Str(snapshot->side()).c_str()
+                                       << " snapshot lock contention: reads=" << lockStats.nbContendedReads
+                                       << " writes=" << lockStats.nbContendedWrites << " wait=" << lockStats.waitTimeUs << "us");
+    }
 
     setDone(exitCode);
     LOG_SYNCPAL_DEBUG(_logger, "Worker stopped: name=" << name().c_str());
 }
 
+bool ComputeFSOperationWorker::isIncrementalComparison(std::unordered_set<NodeId> &localDirtyIds,
+                                                       std::unordered_set<NodeId> &remoteDirtyIds) {
+    const std::shared_ptr<Snapshot> localSnapshot = _syncPal->snapshot(ReplicaSideLocal, true);
+    const std::shared_ptr<Snapshot> remoteSnapshot = _syncPal->snapshot(ReplicaSideRemote, true);
+
+    // Items can be (un)synced without being changed
+    const bool unsyncedListsChanged =
+        _remoteUnsyncedList != _lastRemoteUnsyncedList || _localTmpUnsyncedList != _lastLocalTmpUnsyncedList;
+    _lastRemoteUnsyncedList = _remoteUnsyncedList;
+    _lastLocalTmpUnsyncedList = _localTmpUnsyncedList;
+
+    // A full comparison is still done periodically, in case a change was not reported by an observer
+    const auto now = std::chrono::steady_clock::now();
+    bool incremental = !unsyncedListsChanged && now - _lastFullComparison < std::chrono::seconds(FULL_COMPARISON_PERIOD);
+    incremental = localSnapshot->dirtyIds(localDirtyIds) && incremental;
+    incremental = remoteSnapshot->dirtyIds(remoteDirtyIds) && incremental;
+
+    if (incremental) {
+        LOG_SYNCPAL_DEBUG(_logger, "Incremental comparison of " << localDirtyIds.size() << " local and " << remoteDirtyIds.size()
+                                                                << " remote changed items");
+    } else {
+        LOG_SYNCPAL_DEBUG(_logger, "Full comparison");
+
+        // The next comparisons must be full as well until the sync completes
+        localSnapshot->invalidateDirtyIds();
+        remoteSnapshot->invalidateDirtyIds();
+        _lastFullComparison = now;
+    }
+
+    return incremental;
+}
+
 ExitCode ComputeFSOperationWorker::exploreDbTree(std::unordered_set<NodeId> &localIdsSet,
                                                  std::unordered_set<NodeId> &remoteIdsSet) {
-    bool found = false;
-    std::unordered_set<DbNodeId> remainingDbIds;
-    if (!_syncDb->dbIds(remainingDbIds, found)) {
-        LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::ids");
-        setExitCause(ExitCauseDbAccessError);
-        return ExitCodeDbError;
-    } else if (!found) {
+    // Scan the node table twice, by pages:
+    // First collect the IDs of all items and keep the directories, to resolve paths and parents in memory
+    // Then compute operations for files
+    _dirPathToDeleteSet.clear();
+
+    std::map<DbNodeId, DbNode> dirNodes;
+    ExitCode exitCode = scanDbNodes([&localIdsSet, &remoteIdsSet, &dirNodes](DbNode &dbNode) {
+        if (dbNode.nodeIdLocal().has_value()) {
+            localIdsSet.insert(*dbNode.nodeIdLocal());
+        }
+        if (dbNode.nodeIdRemote().has_value()) {
+            remoteIdsSet.insert(*dbNode.nodeIdRemote());
+        }
+        if (dbNode.type() == NodeTypeDirectory) {
+            dirNodes.emplace(dbNode.nodeId(), std::move(dbNode));
+        }
+        return ExitCodeOk;
+    });
+    if (exitCode != ExitCodeOk || stopAsked()) {
+        return exitCode;
+    }
+
+    if (dirNodes.empty()) {
         LOG_SYNCPAL_DEBUG(_logger, "No items found in db");
         return ExitCodeOk;
     }
 
-    // Explore the tree twice:
-    // First compute operations only for directories
-    // Then compute operations for files
-    _dirPathToDeleteSet.clear();
-    for (int i = 0; i <= 1; i++) {
-        bool checkOnlyDir = i == 0;
+    // Compute operations for directories
+    std::unordered_map<DbNodeId, std::pair<SyncPath, SyncPath>> dirPaths;
+    for (const auto &[dbId, dbNode] : dirNodes) {
+        if (dbId == _syncPal->_syncDb->rootNode().nodeId()) {
+            // Ignore root folder
+            continue;
+        }
 
-        auto dbIt = remainingDbIds.begin();
-        while (dbIt != remainingDbIds.end()) {
-            DbNodeId dbId = *dbIt;
+        if (stopAsked()) {
+            return ExitCodeOk;
+        }
 
-            if (dbId == _syncPal->_syncDb->rootNode().nodeId()) {
-                // Ignore root folder
-                dbIt = remainingDbIds.erase(dbIt);
+        waitWhilePaused();
+
+        if (exitCode = exploreDbNode(dbNode, dirNodes, dirPaths); exitCode != ExitCodeOk) {
+            return exitCode;
+        }
+    }
+
+    // Compute operations for files
+    return scanDbNodes([this, &dirNodes, &dirPaths](DbNode &dbNode) {
+        if (dbNode.type() == NodeTypeDirectory) {
+            return ExitCodeOk;
+        }
+        return exploreDbNode(dbNode, dirNodes, dirPaths);
+    });
+}
+
+ExitCode ComputeFSOperationWorker::exploreDirtyDbNodes(const std::unordered_set<NodeId> &localDirtyIds,
+                                                      const std::unordered_set<NodeId> &remoteDirtyIds,
+                                                      std::unordered_set<NodeId> &localIdsSet,
+                                                      std::unordered_set<NodeId> &remoteIdsSet) {
+    _dirPathToDeleteSet.clear();
+
+    // DB IDs of the changed items, and of the subtrees of the deleted ones
+    std::set<DbNodeId> dirtyDbIds;
+    for (const ReplicaSide side : {ReplicaSideLocal, ReplicaSideRemote}) {
+        const std::shared_ptr<Snapshot> snapshot = _syncPal->snapshot(side, true);
+        for (const NodeId &nodeId : side == ReplicaSideLocal ? localDirtyIds : remoteDirtyIds) {
+            DbNodeId dbNodeId;
+            bool found = false;
+            if (!_syncDb->dbId(side, nodeId, dbNodeId, found)) {
+                LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::dbId");
+                setExitCause(ExitCauseDbAccessError);
+                return ExitCodeDbError;
+            }
+            if (!found) {
+                // New item
                 continue;
             }
+            dirtyDbIds.insert(dbNodeId);
 
-            if (stopAsked()) {
-                return ExitCodeOk;
+            if (!snapshot->exists(nodeId)) {
+                std::unordered_set<DbNodeId> childDbIds;
+                if (!_syncDb->pushChildDbIds(dbNodeId, childDbIds)) {
+                    LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::pushChildDbIds");
+                    setExitCause(ExitCauseDbAccessError);
+                    return ExitCodeDbError;
+                }
+                dirtyDbIds.insert(childDbIds.begin(), childDbIds.end());
             }
+        }
+    }
 
-            while (pauseAsked() || isPaused()) {
-                if (!isPaused()) {
-                    setPauseDone();
-                }
+    // Read the changed nodes and their ancestors
+    std::map<DbNodeId, DbNode> dirNodes;
+    std::map<DbNodeId, DbNode> fileNodes;
+    std::vector<DbNodeId> dirtyDirDbIds;
+    for (const DbNodeId dbNodeId : dirtyDbIds) {
+        DbNode dbNode;
+        bool found = false;
+        if (!_syncDb->node(dbNodeId, dbNode, found)) {
+            LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::node");
+            setExitCause(ExitCauseDbAccessError);
+            return ExitCodeDbError;
+        }
+        if (!found) {
+            LOG_SYNCPAL_DEBUG(_logger, "Failed to retrieve node for dbId=" << dbNodeId);
+            setExitCause(ExitCauseDbEntryNotFound);
+            return ExitCodeDataError;
+        }
 
-                Utility::msleep(LOOP_PAUSE_SLEEP_PERIOD);
+        if (dbNode.nodeIdLocal().has_value()) {
+            localIdsSet.insert(*dbNode.nodeIdLocal());
+        }
+        if (dbNode.nodeIdRemote().has_value()) {
+            remoteIdsSet.insert(*dbNode.nodeIdRemote());
+        }
 
-                if (unpauseAsked()) {
-                    setUnpauseDone();
-                }
-            }
+        std::optional<DbNodeId> parentDbId = dbNode.parentNodeId();
+        if (dbNode.type() == NodeTypeDirectory) {
+            dirtyDirDbIds.push_back(dbNodeId);
+            dirNodes.insert_or_assign(dbNodeId, std::move(dbNode));
+        } else {
+            fileNodes.emplace(dbNodeId, std::move(dbNode));
+        }
 
-            DbNode dbNode;
-            if (!_syncDb->node(dbId, dbNode, found)) {
+        while (parentDbId.has_value() && dirNodes.find(*parentDbId) == dirNodes.end()) {
+            DbNode parentDbNode;
+            if (!_syncDb->node(*parentDbId, parentDbNode, found)) {
                 LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::node");
                 setExitCause(ExitCauseDbAccessError);
                 return ExitCodeDbError;
             }
             if (!found) {
-                LOG_SYNCPAL_DEBUG(_logger, "Failed to retrieve node for dbId=" << dbId);
-                setExitCause(ExitCauseDbEntryNotFound);
-                return ExitCodeDataError;
+                // Reported by exploreDbNode
+                break;
             }
+            parentDbId = parentDbNode.parentNodeId();
+            dirNodes.emplace(parentDbNode.nodeId(), std::move(parentDbNode));
+        }
+    }
 
-            if (dbNode.nodeIdLocal().has_value()) {
-                localIdsSet.insert(*dbNode.nodeIdLocal());
-            }
-            if (dbNode.nodeIdRemote().has_value()) {
-                remoteIdsSet.insert(*dbNode.nodeIdRemote());
-            }
+    // Compute operations for directories, then for files
+    std::unordered_map<DbNodeId, std::pair<SyncPath, SyncPath>> dirPaths;
+    for (const DbNodeId dbNodeId : dirtyDirDbIds) {
+        if (dbNodeId == _syncDb->rootNode().nodeId()) {
+            // Ignore root folder
+            continue;
+        }
 
-            if (checkOnlyDir && dbNode.type() != NodeTypeDirectory) {
-                // In first loop, we check only directory
-                dbIt++;
-                continue;
-            }
+        if (stopAsked()) {
+            return ExitCodeOk;
+        }
 
-            // Remove directory ID from list so 2nd iteration will be a bit faster
-            dbIt = remainingDbIds.erase(dbIt);
+        waitWhilePaused();
 
-            SyncPath localDbPath;
-            SyncPath remoteDbPath;
-            if (!_syncDb->path(dbId, localDbPath, remoteDbPath, found)) {
-                LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::path");
-                setExitCause(ExitCauseDbAccessError);
-                return ExitCodeDbError;
+        if (const ExitCode exitCode = exploreDbNode(dirNodes.at(dbNodeId), dirNodes, dirPaths); exitCode != ExitCodeOk) {
+            return exitCode;
+        }
+    }
+
+    for (const auto &[dbNodeId, dbNode] : fileNodes) {
+        if (stopAsked()) {
+            return ExitCodeOk;
+        }
+
+        waitWhilePaused();
+
+        if (const ExitCode exitCode = exploreDbNode(dbNode, dirNodes, dirPaths); exitCode != ExitCodeOk) {
+            return exitCode;
+        }
+    }
+
+    return ExitCodeOk;
+}
+
+ExitCode ComputeFSOperationWorker::scanDbNodes(const std::function<ExitCode(DbNode &dbNode)> &callback) {
+    std::vector<DbNode> dbNodes;
+    DbNodeId lastDbNodeId = std::numeric_limits<DbNodeId>::min();
+    do {
+        if (!_syncDb->selectNodes(lastDbNodeId, DB_SCAN_PAGE_SIZE, dbNodes)) {
+            LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::selectNodes");
+            setExitCause(ExitCauseDbAccessError);
+            return ExitCodeDbError;
+        }
+        if (dbNodes.empty()) {
+            break;
+        }
+        lastDbNodeId = dbNodes.back().nodeId();
+
+        for (DbNode &dbNode : dbNodes) {
+            if (stopAsked()) {
+                return ExitCodeOk;
             }
-            if (!found) {
-                LOG_SYNCPAL_DEBUG(_logger, "Failed to retrieve node for dbId=" << dbId);
-                setExitCause(ExitCauseDbEntryNotFound);
-                return ExitCodeDataError;
+
+            waitWhilePaused();
+
+            if (const ExitCode exitCode = callback(dbNode); exitCode != ExitCodeOk) {
+                return exitCode;
             }
+        }
+    } while (dbNodes.size() == DB_SCAN_PAGE_SIZE);
 
-            for (int j = 0; j <= 1; j++) {
-                ReplicaSide side = j == 0 ? ReplicaSideLocal : ReplicaSideRemote;
-                SyncTime dbLastModified = 0;
-                NodeId nodeId;
-                if (side == ReplicaSideLocal) {
-                    dbLastModified = dbNode.lastModifiedLocal().has_value() ? dbNode.lastModifiedLocal().value() : 0;
-                    nodeId = dbNode.nodeIdLocal().has_value() ? dbNode.nodeIdLocal().value() : "";
-                } else {
-                    dbLastModified = dbNode.lastModifiedRemote().has_value() ? dbNode.lastModifiedRemote().value() : 0;
-                    nodeId = dbNode.nodeIdRemote().has_value() ? dbNode.nodeIdRemote().value() : "";
-                }
-                if (nodeId.empty()) {
-                    LOGW_SYNCPAL_WARN(_logger, Utility::s2ws(Utility::side2Str(side)).c_str()
-                                                   << L" node ID empty for for dbId=" << dbId);
-                    setExitCause(ExitCauseDbEntryNotFound);
-                    return ExitCodeDataError;
-                }
+    return ExitCodeOk;
+}
 
-                SyncName dbName = side == ReplicaSideLocal ? dbNode.nameLocal() : dbNode.nameRemote();
-                const SyncPath &dbPath = side == ReplicaSideLocal ? localDbPath : remoteDbPath;
-                const std::shared_ptr<Snapshot> snapshot = _syncPal->snapshot(side, true);
-                std::shared_ptr<FSOperationSet> opSet = _syncPal->operationSet(side);
+void ComputeFSOperationWorker::waitWhilePaused() {
+    while (pauseAsked() || isPaused()) {
+        if (!isPaused()) {
+            setPauseDone();
+        }
 
-                NodeId parentId;
-                if (!_syncDb->parent(side, nodeId, parentId, found)) {
-                    LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::parent");
-                    setExitCause(ExitCauseDbAccessError);
-                    return ExitCodeDbError;
-                }
-                if (!found) {
-                    LOG_SYNCPAL_DEBUG(_logger, "Failed to retrieve node for dbId=" << nodeId.c_str());
-                    setExitCause(ExitCauseDbEntryNotFound);
-                    return ExitCodeDataError;
-                }
+        Utility::msleep(LOOP_PAUSE_SLEEP_PERIOD);
 
-                bool remoteItemUnsynced = false;
-                bool movedIntoUnsyncedFolder = false;
-                if (side == ReplicaSideRemote) {
-                    // In case of a move inside an excluded folder, the item must be removed in this sync
-                    if (isInUnsyncedList(nodeId, ReplicaSideRemote)) {
-                        remoteItemUnsynced = true;
-                        if (parentId != snapshot->parentId(nodeId)) {
-                            movedIntoUnsyncedFolder = true;
-                        }
-                    }
-                } else {
-                    if (isInUnsyncedList(nodeId, ReplicaSideLocal)) {
-                        continue;
-                    }
-                }
+        if (unpauseAsked()) {
+            setUnpauseDone();
+        }
+    }
+}
 
-                if (!snapshot->exists(nodeId) || movedIntoUnsyncedFolder) {
-                    if (!pathInDeletedFolder(dbPath)) {
-                        // Check that the file/directory really does not exist on replica
-                        bool isExcluded = false;
-                        if (const ExitCode exitCode = checkIfOkToDelete(side, dbPath, nodeId, isExcluded);
-                            exitCode != ExitCodeOk) {
-                            if (exitCode == ExitCodeNoWritePermission) {
-                                // Blacklist node
-                                _syncPal->blacklistTemporarily(nodeId, dbPath, side);
-                                Error error(_syncPal->_syncDbId, "", "", NodeTypeDirectory, dbPath, ConflictTypeNone,
-                                            InconsistencyTypeNone, CancelTypeNone, "", ExitCodeSystemError,
-                                            ExitCauseFileAccessError);
-                                _syncPal->addError(error);
-
-                                // Update unsynced list cache
-                                updateUnsyncedList();
-                                continue;
-                            } else {
-                                return exitCode;
-                            }
-                        }
-
-                        if (isExcluded) continue;  // Never generate operation on excluded file
-                    }
+bool ComputeFSOperationWorker::dbNodePath(const DbNode &dbNode, const std::map<DbNodeId, DbNode> &dirNodes,
+                                          std::unordered_map<DbNodeId, std::pair<SyncPath, SyncPath>> &dirPaths,
+                                          SyncPath &localPath, SyncPath &remotePath) {
+    if (!dbNode.parentNodeId().has_value()) {
+        // Root node
+        localPath.clear();
+        remotePath.clear();
+        return true;
+    }
 
-                    if (isInUnsyncedList(snapshot, nodeId, side, true)) {
-                        // Ignore operation
-                        continue;
-                    }
+    const DbNodeId parentDbId = dbNode.parentNodeId().value();
+    auto pathIt = dirPaths.find(parentDbId);
+    if (pathIt == dirPaths.end()) {
+        const auto parentIt = dirNodes.find(parentDbId);
+        if (parentIt == dirNodes.end()) {
+            return false;
+        }
 
-                    bool checkTemplate = side == ReplicaSideRemote;
-                    if (side == ReplicaSideLocal) {
-                        SyncPath localPath = _syncPal->_localPath / dbPath;
-
-                        // Do not propagate delete if path too long
-                        size_t pathSize = localPath.native().size();
-                        if (PlatformInconsistencyCheckerUtility::instance()->checkPathLength(pathSize, dbNode.type())) {
-                            LOGW_SYNCPAL_WARN(_logger, L"Path length too big (" << pathSize << L" characters) for item "
-                                                                                << Path2WStr(localPath).c_str()
-                                                                                << L". Item is ignored.");
-                            continue;
-                        }
-
-                        if (!snapshot->exists(nodeId)) {
-                            bool exists = false;
-
-                            if (IoError ioError = IoErrorSuccess; !IoHelper::checkIfPathExists(localPath, exists, ioError)) {
-                                LOGW_WARN(_logger, L"Error in IoHelper::checkIfPathExists: "
-                                                       << Utility::formatIoError(localPath, ioError).c_str());
-                                return ExitCodeSystemError;
-                            }
-                            checkTemplate = exists;
-                        }
-                    }
+        SyncPath parentLocalPath;
+        SyncPath parentRemotePath;
+        if (!dbNodePath(parentIt->second, dirNodes, dirPaths, parentLocalPath, parentRemotePath)) {
+            return false;
+        }
+        pathIt = dirPaths.emplace(parentDbId, std::make_pair(parentLocalPath, parentRemotePath)).first;
+    }
 
-                    if (checkTemplate) {
-                        IoError ioError = IoErrorSuccess;
-                        bool warn = false;
-                        bool isExcluded = false;
-                        const bool success = ExclusionTemplateCache::instance()->checkIfIsExcluded(_syncPal->_localPath, dbPath,
-                                                                                                   warn, isExcluded, ioError);
-                        if (!success) {
-                            LOGW_WARN(_logger, L"Error in ExclusionTemplateCache::checkIfIsExcluded: "
-                                                   << Utility::formatIoError(dbPath, ioError).c_str());
-                            return ExitCodeSystemError;
-                        }
-                        if (isExcluded) {
-                            // The item is excluded
-                            continue;
-                        }
-                    }
+    localPath = pathIt->second.first / dbNode.nameLocal();
+    remotePath = pathIt->second.second / dbNode.nameRemote();
+    return true;
+}
 
-                    // Delete operation
-                    FSOpPtr fsOp = std::make_shared<FSOperation>(OperationType::OperationTypeDelete, nodeId, dbNode.type(),
-                                                                 dbNode.created().has_value() ? dbNode.created().value() : 0,
-                                                                 dbLastModified, dbNode.size(), dbPath);
-                    opSet->insertOp(fsOp);
-                    logOperationGeneration(snapshot->side(), fsOp);
+ExitCode ComputeFSOperationWorker::exploreDbNode(const DbNode &dbNode, const std::map<DbNodeId, DbNode> &dirNodes,
+                                                 std::unordered_map<DbNodeId, std::pair<SyncPath, SyncPath>> &dirPaths) {
+    // The path and the parent are resolved from the directories read in the first scan
+    SyncPath localDbPath;
+    SyncPath remoteDbPath;
+    const auto parentIt = dbNode.parentNodeId().has_value() ? dirNodes.find(dbNode.parentNodeId().value()) : dirNodes.end();
+    if (parentIt == dirNodes.end() || !dbNodePath(dbNode, dirNodes, dirPaths, localDbPath, remoteDbPath)) {
+        LOG_SYNCPAL_DEBUG(_logger, "Failed to retrieve node for dbId=" << dbNode.nodeId());
+        setExitCause(ExitCauseDbEntryNotFound);
+        return ExitCodeDataError;
+    }
+    const DbNode *parentDbNode = &parentIt->second;
+
+    for (int j = 0; j <= 1; j++) {
+        ReplicaSide side = j == 0 ? ReplicaSideLocal : ReplicaSideRemote;
+        SyncTime dbLastModified = 0;
+        NodeId nodeId;
+        if (side == ReplicaSideLocal) {
+            dbLastModified = dbNode.lastModifiedLocal().has_value() ? dbNode.lastModifiedLocal().value() : 0;
+            nodeId = dbNode.nodeIdLocal().has_value() ? dbNode.nodeIdLocal().value() : "";
+        } else {
+            dbLastModified = dbNode.lastModifiedRemote().has_value() ? dbNode.lastModifiedRemote().value() : 0;
+            nodeId = dbNode.nodeIdRemote().has_value() ? dbNode.nodeIdRemote().value() : "";
+        }
+        if (nodeId.empty()) {
+            LOGW_SYNCPAL_WARN(_logger, Utility::s2ws(Utility::side2Str(side)).c_str()
+                                           << L" node ID empty for for dbId=" << dbNode.nodeId());
+            setExitCause(ExitCauseDbEntryNotFound);
+            return ExitCodeDataError;
+        }
 
-                    if (dbNode.type() == NodeTypeDirectory) {
-                        addFolderToDelete(dbPath);
-                    }
-                    continue;
+        SyncName dbName = side == ReplicaSideLocal ? dbNode.nameLocal() : dbNode.nameRemote();
+        const SyncPath &dbPath = side == ReplicaSideLocal ? localDbPath : remoteDbPath;
+        const std::shared_ptr<Snapshot> snapshot = _syncPal->snapshot(side, true);
+        std::shared_ptr<FSOperationSet> opSet = _syncPal->operationSet(side);
+
+        const std::optional<NodeId> &parentNodeId =
+            side == ReplicaSideLocal ? parentDbNode->nodeIdLocal() : parentDbNode->nodeIdRemote();
+        const NodeId parentId = parentNodeId.has_value() ? parentNodeId.value() : "";
+
+        bool remoteItemUnsynced = false;
+        bool movedIntoUnsyncedFolder = false;
+        if (side == ReplicaSideRemote) {
+            // In case of a move inside an excluded folder, the item must be removed in this sync
+            if (isInUnsyncedList(nodeId, ReplicaSideRemote)) {
+                remoteItemUnsynced = true;
+                if (parentId != snapshot->parentId(nodeId)) {
+                    movedIntoUnsyncedFolder = true;
                 }
+            }
+        } else {
+            if (isInUnsyncedList(nodeId, ReplicaSideLocal)) {
+                continue;
+            }
+        }
 
-                if (remoteItemUnsynced) {
-                    // Ignore operations on unsynced items
-                    continue;
+        if (!snapshot->exists(nodeId) || movedIntoUnsyncedFolder) {
+            if (!pathInDeletedFolder(dbPath)) {
+                // Check that the file/directory really does not exist on replica
+                bool isExcluded = false;
+                if (const ExitCode exitCode = checkIfOkToDelete(side, dbPath, nodeId, isExcluded);
+                    exitCode != ExitCodeOk) {
+                    if (exitCode == ExitCodeNoWritePermission) {
+                        // Blacklist node
+                        _syncPal->blacklistTemporarily(nodeId, dbPath, side);
+                        Error error(_syncPal->_syncDbId, "", "", NodeTypeDirectory, dbPath, ConflictTypeNone,
+                                    InconsistencyTypeNone, CancelTypeNone, "", ExitCodeSystemError,
+                                    ExitCauseFileAccessError);
+                        _syncPal->addError(error);
+
+                        // Update unsynced list cache
+                        updateUnsyncedList();
+                        continue;
+                    } else {
+                        return exitCode;
+                    }
                 }
 
-                SyncPath snapPath;
-                if (!snapshot->path(nodeId, snapPath)) {
-                    LOGW_SYNCPAL_WARN(_logger, L"Failed to retrieve path from snapshot for item "
-                                                   << SyncName2WStr(dbName).c_str() << L" (" << Utility::s2ws(nodeId).c_str()
-                                                   << L")");
-                    setExitCause(ExitCauseInvalidSnapshot);
-                    return ExitCodeDataError;
+                if (isExcluded) continue;  // Never generate operation on excluded file
+            }
+
+            if (isInUnsyncedList(snapshot, nodeId, side, true)) {
+                // Ignore operation
+                continue;
+            }
+
+            bool checkTemplate = side == ReplicaSideRemote;
+            if (side == ReplicaSideLocal) {
+                SyncPath localPath = _syncPal->_localPath / dbPath;
+
+                // Do not propagate delete if path too long
+                size_t pathSize = localPath.native().size();
+                if (PlatformInconsistencyCheckerUtility::instance()->checkPathLength(pathSize, dbNode.type())) {
+                    LOGW_SYNCPAL_WARN(_logger, L"Path length too big (" << pathSize << L" characters) for item "
+                                                                        << Path2WStr(localPath).c_str()
+                                                                        << L". Item is ignored.");
+                    continue;
                 }
 
-                if (side == ReplicaSideLocal && !_testing) {
-                    // OS might fail to notify all delete events, therefore we check that the file still exists.
-                    SyncPath absolutePath = _syncPal->_localPath / snapPath;
+                if (!snapshot->exists(nodeId)) {
                     bool exists = false;
-                    if (IoError ioError = IoErrorSuccess; !IoHelper::checkIfPathExists(absolutePath, exists, ioError)) {
+
+                    if (IoError ioError = IoErrorSuccess; !IoHelper::checkIfPathExists(localPath, exists, ioError)) {
                         LOGW_WARN(_logger, L"Error in IoHelper::checkIfPathExists: "
-                                               << Utility::formatIoError(absolutePath, ioError).c_str());
+                                               << Utility::formatIoError(localPath, ioError).c_str());
                         return ExitCodeSystemError;
                     }
-                    if (!exists) {
-                        LOGW_DEBUG(_logger, L"Item does not exist anymore on local replica. Snapshot will be rebuilt - path="
-                                                << Path2WStr(absolutePath).c_str());
-                        setExitCause(ExitCauseInvalidSnapshot);
-                        return ExitCodeDataError;
-                    }
-                } else {
-                    // Check path length
-                    if (isPathTooLong(snapPath, nodeId, snapshot->type(nodeId))) {
-                        continue;
-                    }
+                    checkTemplate = exists;
                 }
+            }
 
-                const SyncTime snapshotLastModified = snapshot->lastModified(nodeId);
-                if (snapshotLastModified != dbLastModified && dbNode.type() == NodeType::NodeTypeFile) {
-                    // Edit operation
-                    FSOpPtr fsOp = std::make_shared<FSOperation>(OperationType::OperationTypeEdit, nodeId, NodeType::NodeTypeFile,
-                                                                 snapshot->createdAt(nodeId), snapshotLastModified,
-                                                                 snapshot->size(nodeId), snapPath);
-                    opSet->insertOp(fsOp);
-                    logOperationGeneration(snapshot->side(), fsOp);
+            if (checkTemplate) {
+                IoError ioError = IoErrorSuccess;
+                bool warn = false;
+                bool isExcluded = false;
+                const bool success = ExclusionTemplateCache::instance()->checkIfIsExcluded(_syncPal->_localPath, dbPath,
+                                                                                           warn, isExcluded, ioError);
+                if (!success) {
+                    LOGW_WARN(_logger, L"Error in ExclusionTemplateCache::checkIfIsExcluded: "
+                                           << Utility::formatIoError(dbPath, ioError).c_str());
+                    return ExitCodeSystemError;
                 }
+                if (isExcluded) {
+                    // The item is excluded
+                    continue;
+                }
+            }
 
-                bool movedOrRenamed = dbName != snapshot->name(nodeId) || parentId != snapshot->parentId(nodeId);
-                if (movedOrRenamed) {
-                    FSOpPtr fsOp = nullptr;
-                    if (isInUnsyncedList(snapshot, nodeId, side)) {
-                        // Delete operation
-                        fsOp = std::make_shared<FSOperation>(OperationType::OperationTypeDelete, nodeId, dbNode.type(),
-                                                             snapshot->createdAt(nodeId), snapshotLastModified,
-                                                             snapshot->size(nodeId),
-                                                             remoteDbPath  // We use the remotePath anyway here to display
-                                                             // notifications with the real (remote) name
-                                                             ,
-                                                             snapPath);
-                    } else {
-                        // Move operation
-                        fsOp = std::make_shared<FSOperation>(OperationType::OperationTypeMove, nodeId, dbNode.type(),
-                                                             snapshot->createdAt(nodeId), snapshotLastModified,
-                                                             snapshot->size(nodeId),
-                                                             remoteDbPath  // We use the remotePath anyway here to display
-                                                             // notifications with the real (remote) name
-                                                             ,
-                                                             snapPath);
-                    }
+            // Delete operation
+            FSOpPtr fsOp = std::make_shared<FSOperation>(OperationType::OperationTypeDelete, nodeId, dbNode.type(),
+                                                         dbNode.created().has_value() ? dbNode.created().value() : 0,
+                                                         dbLastModified, dbNode.size(), dbPath);
+            opSet->insertOp(fsOp);
+            logOperationGeneration(snapshot->side(), fsOp);
+
+            if (dbNode.type() == NodeTypeDirectory) {
+                addFolderToDelete(dbPath);
+            }
+            continue;
+        }
+
+        if (remoteItemUnsynced) {
+            // Ignore operations on unsynced items
+            continue;
+        }
+
+        SyncPath snapPath;
+        if (!snapshot->path(nodeId, snapPath)) {
+            LOGW_SYNCPAL_WARN(_logger, L"Failed to retrieve path from snapshot for item "
+                                           << SyncName2WStr(dbName).c_str() << L" (" << Utility::s2ws(nodeId).c_str()
+                                           << L")");
+            setExitCause(ExitCauseInvalidSnapshot);
+            return ExitCodeDataError;
+        }
+
+        if (side == ReplicaSideLocal && !_testing) {
+            // OS might fail to notify all delete events, therefore we check that the file still exists.
+            SyncPath absolutePath = _syncPal->_localPath / snapPath;
+            bool exists = false;
+            if (IoError ioError = IoErrorSuccess; !IoHelper::checkIfPathExists(absolutePath, exists, ioError)) {
+                LOGW_WARN(_logger, L"Error in IoHelper::checkIfPathExists: "
+                                       << Utility::formatIoError(absolutePath, ioError).c_str());
+                return ExitCodeSystemError;
+            }
+            if (!exists) {
+                LOGW_DEBUG(_logger, L"Item does not exist anymore on local replica. Snapshot will be rebuilt - path="
+                                        << Path2WStr(absolutePath).c_str());
+                setExitCause(ExitCauseInvalidSnapshot);
+                return ExitCodeDataError;
+            }
+        } else {
+            // Check path length
+            if (isPathTooLong(snapPath, nodeId, snapshot->type(nodeId))) {
+                continue;
+            }
+        }
 
-                    opSet->insertOp(fsOp);
-                    logOperationGeneration(snapshot->side(), fsOp);
+        const SyncTime snapshotLastModified = snapshot->lastModified(nodeId);
+        if (snapshotLastModified != dbLastModified && dbNode.type() == NodeType::NodeTypeFile) {
+            if (side == ReplicaSideLocal && !_testing &&
+                isContentUnchanged(dbNode, _syncPal->_localPath / snapPath, snapshot->size(nodeId), snapshotLastModified)) {
+                // Record the new modification date so that the content is not checked again at the next syncs
+                DbNode updatedDbNode(dbNode);
+                updatedDbNode.setLastModifiedLocal(snapshotLastModified);
+                bool found = false;
+                if (!_syncDb->updateNode(updatedDbNode, found)) {
+                    LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::updateNode");
+                    return ExitCodeDbError;
                 }
+            } else {
+                // Edit operation
+                FSOpPtr fsOp = std::make_shared<FSOperation>(OperationType::OperationTypeEdit, nodeId, NodeType::NodeTypeFile,
+                                                             snapshot->createdAt(nodeId), snapshotLastModified,
+                                                             snapshot->size(nodeId), snapPath);
+                opSet->insertOp(fsOp);
+                logOperationGeneration(snapshot->side(), fsOp);
             }
+        }
 
-            // Check file integrity
-            ExitCode fileIntegrityOk = checkFileIntegrity(dbNode);
-            if (fileIntegrityOk != ExitCodeOk) {
-                return fileIntegrityOk;
+        bool movedOrRenamed = dbName != snapshot->name(nodeId) || parentId != snapshot->parentId(nodeId);
+        if (movedOrRenamed) {
+            FSOpPtr fsOp = nullptr;
+            if (isInUnsyncedList(snapshot, nodeId, side)) {
+                // Delete operation
+                fsOp = std::make_shared<FSOperation>(OperationType::OperationTypeDelete, nodeId, dbNode.type(),
+                                                     snapshot->createdAt(nodeId), snapshotLastModified,
+                                                     snapshot->size(nodeId),
+                                                     remoteDbPath  // We use the remotePath anyway here to display
+                                                     // notifications with the real (remote) name
+                                                     ,
+                                                     snapPath);
+            } else {
+                // Move operation
+                fsOp = std::make_shared<FSOperation>(OperationType::OperationTypeMove, nodeId, dbNode.type(),
+                                                     snapshot->createdAt(nodeId), snapshotLastModified,
+                                                     snapshot->size(nodeId),
+                                                     remoteDbPath  // We use the remotePath anyway here to display
+                                                     // notifications with the real (remote) name
+                                                     ,
+                                                     snapPath);
             }
+
+            opSet->insertOp(fsOp);
+            logOperationGeneration(snapshot->side(), fsOp);
         }
     }
 
-    return ExitCodeOk;
+    // Check file integrity
+    return checkFileIntegrity(dbNode);
 }
 
 ExitCode ComputeFSOperationWorker::exploreSnapshotTree(ReplicaSide side, const std::unordered_set<NodeId> &idsSet) {
     const std::shared_ptr<Snapshot> snapshot = _syncPal->snapshot(side, true);
-    std::shared_ptr<FSOperationSet> opSet = _syncPal->operationSet(side);
 
     std::unordered_set<NodeId> remainingDbIds;
     snapshot->ids(remainingDbIds);
@@ -431,6 +656,14 @@ ExitCode ComputeFSOperationWorker::exploreSnapshotTree(ReplicaSide side, const s
         return ExitCodeOk;
     }
 
+    return exploreSnapshotItems(side, idsSet, remainingDbIds);
+}
+
+ExitCode ComputeFSOperationWorker::exploreSnapshotItems(ReplicaSide side, const std::unordered_set<NodeId> &idsSet,
+                                                        std::unordered_set<NodeId> &remainingDbIds) {
+    const std::shared_ptr<Snapshot> snapshot = _syncPal->snapshot(side, true);
+    std::shared_ptr<FSOperationSet> opSet = _syncPal->operationSet(side);
+
     // Explore the tree twice:
     // First compute operations only for directories
     // Then compute operations for files
@@ -794,6 +1027,39 @@ bool ComputeFSOperationWorker::isTooBig(const std::shared_ptr<Snapshot> remoteSn
     return false;
 }
 
+bool ComputeFSOperationWorker::isContentUnchanged(const DbNode &dbNode, const SyncPath &absolutePath, int64_t size,
+                                                  SyncTime lastModified) {
+    if (!dbNode.checksum().has_value() || dbNode.checksum()->empty() || dbNode.size() != size) {
+        return false;
+    }
+
+    FileStat fileStat;
+    IoError ioError = IoErrorSuccess;
+    if (!IoHelper::getFileStat(absolutePath, &fileStat, ioError) || ioError != IoErrorSuccess) {
+        return false;
+    }
+
+    if (fileStat.modtime != lastModified) {
+        // Changed again since the snapshot has been copied, checked at the next sync
+        return false;
+    }
+
+    std::string checksum;
+    bool found = false;
+    if (!_syncDb->selectCachedChecksum(fileStat.inode, fileStat.size, fileStat.modtime, fileStat.creationTime, checksum,
+                                       found)) {
+        LOG_SYNCPAL_WARN(_logger, "Error in SyncDb::selectCachedChecksum");
+        return false;
+    }
+
+    if (!found || checksum != dbNode.checksum().value()) {
+        return false;
+    }
+
+    LOGW_SYNCPAL_DEBUG(_logger, L"Content of " << Path2WStr(absolutePath).c_str() << L" unchanged, only updating its modtime");
+    return true;
+}
+
 bool ComputeFSOperationWorker::isPathTooLong(const SyncPath &path, const NodeId &nodeId, NodeType type) {
     SyncPath absolutePath = _syncPal->_localPath / path;
     size_t pathSize = absolutePath.native().size();
@@ -22,6 +22,10 @@
 #include "db/syncdb.h"
 #include "syncpal/syncpal.h"
 
+#include <chrono>
+#include <functional>
+#include <map>
+
 namespace KDC {
 
 class ComputeFSOperationWorker : public ISyncWorker {
@@ -45,8 +49,26 @@ class ComputeFSOperationWorker : public ISyncWorker {
         virtual void execute() override;
 
     private:
+        // Whether only the items changed since the last completed sync need to be compared
+        bool isIncrementalComparison(std::unordered_set<NodeId> &localDirtyIds, std::unordered_set<NodeId> &remoteDirtyIds);
         ExitCode exploreDbTree(std::unordered_set<NodeId> &localIdsSet, std::unordered_set<NodeId> &remoteIdsSet);
+        // Calls `callback` for every node of the DB, read by pages in a single ordered scan
+        ExitCode scanDbNodes(const std::function<ExitCode(DbNode &dbNode)> &callback);
+        ExitCode exploreDbNode(const DbNode &dbNode, const std::map<DbNodeId, DbNode> &dirNodes,
+                               std::unordered_map<DbNodeId, std::pair<SyncPath, SyncPath>> &dirPaths);
+        // Local and remote paths of a node, built from the paths of its ancestors, computed once
+        bool dbNodePath(const DbNode &dbNode, const std::map<DbNodeId, DbNode> &dirNodes,
+                        std::unordered_map<DbNodeId, std::pair<SyncPath, SyncPath>> &dirPaths, SyncPath &localPath,
+                        SyncPath &remotePath);
+        // Same as exploreDbTree for the changed items only. Their ancestors are read to build the paths.
+        ExitCode exploreDirtyDbNodes(const std::unordered_set<NodeId> &localDirtyIds,
+                                     const std::unordered_set<NodeId> &remoteDirtyIds, std::unordered_set<NodeId> &localIdsSet,
+                                     std::unordered_set<NodeId> &remoteIdsSet);
+        void waitWhilePaused();
         ExitCode exploreSnapshotTree(ReplicaSide side, const std::unordered_set<NodeId> &idsSet);
+        // Generates the create operations for the items of `remainingIds` that are not in `idsSet`
+        ExitCode exploreSnapshotItems(ReplicaSide side, const std::unordered_set<NodeId> &idsSet,
+                                      std::unordered_set<NodeId> &remainingIds);
         ExitCode checkFileIntegrity(const DbNode &dbNode);
 
         bool isExcludedFromSync(const std::shared_ptr<Snapshot> snapshot, const ReplicaSide side, const NodeId &nodeId,
@@ -57,6 +79,8 @@ class ComputeFSOperationWorker : public ISyncWorker {
         bool isWhitelisted(const std::shared_ptr<Snapshot> snapshot, const NodeId &nodeId);
         bool isTooBig(const std::shared_ptr<Snapshot> remoteSnapshot, const NodeId &remoteNodeId, int64_t size);
         bool isPathTooLong(const SyncPath &path, const NodeId &nodeId, NodeType type);
+        // Only the modification date of the local file changed, according to the checksum cache
+        bool isContentUnchanged(const DbNode &dbNode, const SyncPath &absolutePath, int64_t size, SyncTime lastModified);
 
         ExitCode checkIfOkToDelete(ReplicaSide side, const SyncPath &relativePath, const NodeId &nodeId, bool &isExcluded);
 
@@ -76,6 +100,11 @@ class ComputeFSOperationWorker : public ISyncWorker {
         std::unordered_set<NodeId> _remoteTmpUnsyncedList;
         std::unordered_set<NodeId> _localTmpUnsyncedList;
 
+        // Unsynced lists of the previous comparison, and time of the last full one
+        std::unordered_set<NodeId> _lastRemoteUnsyncedList;
+        std::unordered_set<NodeId> _lastLocalTmpUnsyncedList;
+        std::chrono::steady_clock::time_point _lastFullComparison;
+
         std::unordered_set<SyncPath, hashPathFunction> _dirPathToDeleteSet;
 
         std::unordered_map<NodeId, SyncPath> _fileSizeMismatchMap;
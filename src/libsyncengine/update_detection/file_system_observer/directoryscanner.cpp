@@ -0,0 +1,276 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "directoryscanner.h"
+
+#include <algorithm>
+#include <string_view>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace KDC {
+
+// A change made in the same clock tick as a read leaves the timestamps unchanged, the tick of many kernels is a few ms
+#define RACY_TIMESTAMP_WINDOW 1000000000  // ns
+
+static int64_t toNanoseconds(const struct timespec &time) {
+    return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+DirectoryScanner::DirectoryScanner(std::chrono::milliseconds minInterval, std::chrono::milliseconds maxInterval,
+                                   std::chrono::milliseconds fullCheckInterval)
+    : _minInterval(minInterval), _maxInterval(std::max(maxInterval, minInterval)), _fullCheckInterval(fullCheckInterval) {}
+
+bool DirectoryScanner::add(const SyncPath &dirPath, TimePoint now) {
+    const int64_t readTime = wallClockTime();
+    struct stat dirStat;
+    if (lstat(dirPath.c_str(), &dirStat) != 0 || !S_ISDIR(dirStat.st_mode)) {
+        return false;
+    }
+
+    Directory directory;
+    if (!readEntries(dirPath.native(), directory.entries)) {
+        return false;
+    }
+    directory.modtime = toNanoseconds(dirStat.st_mtim);
+    directory.changeTime = toNanoseconds(dirStat.st_ctim);
+    directory.isRacy = isRacy(directory.modtime, directory.changeTime, readTime);
+    directory.interval = _minInterval;
+    directory.nextCheck = now + _minInterval;
+    // Spread the full checks, the directories are often added all at once
+    directory.nextFullCheck = now + _fullCheckInterval +
+                              std::chrono::milliseconds(std::hash<SyncName>()(dirPath.native()) %
+                                                        static_cast<size_t>(std::max<int64_t>(_fullCheckInterval.count(), 1)));
+
+    _checkQueue.emplace(directory.nextCheck, dirPath.native());
+    _directories.insert_or_assign(dirPath.native(), std::move(directory));
+    return true;
+}
+
+void DirectoryScanner::remove(const SyncPath &dirPath) {
+    _directories.erase(dirPath.native());
+}
+
+void DirectoryScanner::removeBelow(const SyncPath &dirPath) {
+    const SyncName &dirName = dirPath.native();
+    const SyncName dirNameSlash = dirName + '/';
+
+    // Order is 'foo', 'foo bar', 'foo/bar'
+    auto dirIt = _directories.lower_bound(dirName);
+    while (dirIt != _directories.end() && std::string_view(dirIt->first).starts_with(dirName)) {
+        if (dirIt->first == dirName || std::string_view(dirIt->first).starts_with(dirNameSlash)) {
+            dirIt = _directories.erase(dirIt);
+        } else {
+            dirIt++;
+        }
+    }
+}
+
+void DirectoryScanner::clear() {
+    _directories.clear();
+    _checkQueue = {};
+}
+
+DirectoryScanner::TimePoint DirectoryScanner::nextCheckTime() {
+    while (!_checkQueue.empty()) {
+        const auto &[time, dirPath] = _checkQueue.top();
+        auto dirIt = _directories.find(dirPath);
+        if (dirIt != _directories.end() && dirIt->second.nextCheck == time) {
+            return time;
+        }
+        _checkQueue.pop();
+    }
+
+    return TimePoint::max();
+}
+
+void DirectoryScanner::checkDueDirectories(TimePoint now, size_t maxCount, ScanResult &result) {
+    size_t count = 0;
+    while (count < maxCount && nextCheckTime() <= now) {
+        const SyncName dirPath = _checkQueue.top().second;
+        _checkQueue.pop();
+
+        auto dirIt = _directories.find(dirPath);
+        const bool full = now >= dirIt->second.nextFullCheck;
+        checkAndSchedule(dirIt, now, full, result);
+        count++;
+    }
+}
+
+void DirectoryScanner::check(const SyncPath &dirPath, TimePoint now, ScanResult &result) {
+    auto dirIt = _directories.find(dirPath.native());
+    if (dirIt != _directories.end()) {
+        checkAndSchedule(dirIt, now, true, result);
+    }
+}
+
+std::chrono::milliseconds DirectoryScanner::averageLatency() const {
+    if (_detectedChangeCount == 0) {
+        return std::chrono::milliseconds(0);
+    }
+    return _totalLatency / _detectedChangeCount;
+}
+
+void DirectoryScanner::checkAndSchedule(std::map<SyncName, Directory>::iterator dirIt, TimePoint now, bool full,
+                                        ScanResult &result) {
+    const SyncName &dirPath = dirIt->first;
+    Directory &directory = dirIt->second;
+
+    bool exists = true;
+    const bool changed = checkDirectory(dirPath, directory, full, result, exists);
+    if (!exists) {
+        // The deletion is reported by the parent directory
+        _directories.erase(dirIt);
+        return;
+    }
+
+    if (full) {
+        directory.nextFullCheck = now + _fullCheckInterval;
+    }
+
+    if (changed) {
+        directory.interval = _minInterval;
+        result.changedDirs.emplace_back(dirPath);
+    } else {
+        directory.interval = std::min(directory.interval * 2, _maxInterval);
+    }
+    directory.nextCheck = now + directory.interval;
+    _checkQueue.emplace(directory.nextCheck, dirPath);
+}
+
+bool DirectoryScanner::checkDirectory(const SyncName &dirPath, Directory &directory, bool full, ScanResult &result,
+                                      bool &exists) {
+    const int64_t readTime = wallClockTime();
+    struct stat dirStat;
+    if (lstat(dirPath.c_str(), &dirStat) != 0) {
+        exists = !(errno == ENOENT || errno == ENOTDIR);
+        return false;
+    }
+    if (!S_ISDIR(dirStat.st_mode)) {
+        exists = false;
+        return false;
+    }
+
+    _checkCount++;
+    const int64_t modtime = toNanoseconds(dirStat.st_mtim);
+    const int64_t changeTime = toNanoseconds(dirStat.st_ctim);
+    if (!full && !directory.isRacy && modtime == directory.modtime && changeTime == directory.changeTime) {
+        return false;
+    }
+
+    std::vector<Entry> entries;
+    if (!readEntries(dirPath, entries)) {
+        return false;
+    }
+
+    // Both lists are sorted by name
+    const SyncPath dirSyncPath(dirPath);
+    const size_t changeCount = result.changes.size();
+    auto oldIt = directory.entries.cbegin();
+    auto newIt = entries.cbegin();
+    while (oldIt != directory.entries.cend() || newIt != entries.cend()) {
+        const bool isCreated = oldIt == directory.entries.cend() || (newIt != entries.cend() && newIt->name < oldIt->name);
+        const bool isDeleted = !isCreated && (newIt == entries.cend() || oldIt->name < newIt->name);
+        const bool isReplaced =
+            !isCreated && !isDeleted && (newIt->inode != oldIt->inode || newIt->isDirectory != oldIt->isDirectory);
+
+        if (isDeleted || isReplaced) {
+            addChange(dirSyncPath / oldIt->name, OperationTypeDelete, modtime, result);
+            if (oldIt->isDirectory) {
+                result.deletedDirs.emplace_back(dirSyncPath / oldIt->name);
+            }
+        }
+        if (isCreated || isReplaced) {
+            addChange(dirSyncPath / newIt->name, OperationTypeCreate, modtime, result);
+            if (newIt->isDirectory) {
+                result.createdDirs.emplace_back(dirSyncPath / newIt->name);
+            }
+        }
+        if (!isCreated && !isDeleted && !isReplaced && !newIt->isDirectory &&
+            (newIt->size != oldIt->size || newIt->modtime != oldIt->modtime)) {
+            addChange(dirSyncPath / newIt->name, OperationTypeEdit, newIt->modtime, result);
+        }
+
+        if (!isCreated) {
+            oldIt++;
+        }
+        if (!isDeleted) {
+            newIt++;
+        }
+    }
+
+    directory.modtime = modtime;
+    directory.changeTime = changeTime;
+    directory.isRacy = isRacy(modtime, changeTime, readTime);
+    directory.entries = std::move(entries);
+    return result.changes.size() != changeCount;
+}
+
+void DirectoryScanner::addChange(const SyncPath &path, OperationType opType, int64_t modtime, ScanResult &result) {
+    result.changes.emplace_back(path, opType);
+
+    const auto latency = std::chrono::milliseconds(std::max<int64_t>(wallClockTime() - modtime, 0) / 1000000);
+    _detectedChangeCount++;
+    _totalLatency += latency;
+    _maxLatency = std::max(_maxLatency, latency);
+}
+
+bool DirectoryScanner::readEntries(const SyncName &dirPath, std::vector<Entry> &entries) {
+    DIR *dir = opendir(dirPath.c_str());
+    if (!dir) {
+        return false;
+    }
+
+    const int dirFd = dirfd(dir);
+    while (const struct dirent *dirEntry = readdir(dir)) {
+        const std::string_view name(dirEntry->d_name);
+        if (name == "." || name == "..") {
+            continue;
+        }
+
+        struct stat entryStat;
+        if (fstatat(dirFd, dirEntry->d_name, &entryStat, AT_SYMLINK_NOFOLLOW) != 0) {
+            // Deleted in the meantime
+            continue;
+        }
+
+        Entry entry;
+        entry.name = name;
+        entry.inode = entryStat.st_ino;
+        entry.size = entryStat.st_size;
+        entry.modtime = toNanoseconds(entryStat.st_mtim);
+        entry.isDirectory = S_ISDIR(entryStat.st_mode);
+        entries.push_back(std::move(entry));
+    }
+    closedir(dir);
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &lhs, const Entry &rhs) { return lhs.name < rhs.name; });
+    return true;
+}
+
+int64_t DirectoryScanner::wallClockTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool DirectoryScanner::isRacy(int64_t modtime, int64_t changeTime, int64_t readTime) {
+    return std::max(modtime, changeTime) + RACY_TIMESTAMP_WINDOW >= readTime;
+}
+
+}  // namespace KDC
@@ -0,0 +1,121 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "libcommon/utility/types.h"
+
+#include <chrono>
+#include <functional>
+#include <list>
+#include <map>
+#include <queue>
+#include <vector>
+
+namespace KDC {
+
+/**
+ * Detects the changes in directories that are not watched by the OS, by polling the modification time of their inode.
+ * A directory that does not change is checked less and less often, up to the maximum interval. Its entries are compared
+ * only if its modification time changed, or during the full check done every `fullCheckInterval`, which finds the files
+ * edited in place. As the timestamps are coarse, they are also compared while they are close to the time of the last read.
+ */
+class DirectoryScanner {
+    public:
+        typedef std::chrono::steady_clock::time_point TimePoint;
+
+        struct ScanResult {
+                std::list<std::pair<SyncPath, OperationType>> changes;
+                std::vector<SyncPath> changedDirs;  // Checked directories whose entries changed
+                std::vector<SyncPath> createdDirs;
+                std::vector<SyncPath> deletedDirs;
+        };
+
+        DirectoryScanner(std::chrono::milliseconds minInterval, std::chrono::milliseconds maxInterval,
+                         std::chrono::milliseconds fullCheckInterval);
+
+        /** Starts checking a directory, its current entries are the reference.
+         * @return false if the directory could not be read.
+         */
+        bool add(const SyncPath &dirPath, TimePoint now = std::chrono::steady_clock::now());
+        void remove(const SyncPath &dirPath);
+        // Stops checking the directory and all the directories below it
+        void removeBelow(const SyncPath &dirPath);
+        inline bool contains(const SyncPath &dirPath) const { return _directories.contains(dirPath.native()); }
+        inline bool isEmpty() const { return _directories.empty(); }
+        inline size_t size() const { return _directories.size(); }
+        void clear();
+
+        // Only meaningful if not empty
+        TimePoint nextCheckTime();
+        // Checks at most `maxCount` of the directories whose check is due
+        void checkDueDirectories(TimePoint now, size_t maxCount, ScanResult &result);
+        // Compares the entries of a directory right away
+        void check(const SyncPath &dirPath, TimePoint now, ScanResult &result);
+
+        // Statistics
+        inline uint64_t checkCount() const { return _checkCount; }
+        inline uint64_t detectedChangeCount() const { return _detectedChangeCount; }
+        // Delay between the modification on disk and its detection
+        std::chrono::milliseconds averageLatency() const;
+        inline std::chrono::milliseconds maxLatency() const { return _maxLatency; }
+
+    private:
+        struct Entry {
+                SyncName name;
+                uint64_t inode = 0;
+                int64_t size = 0;
+                int64_t modtime = 0;  // ns
+                bool isDirectory = false;
+        };
+
+        struct Directory {
+                int64_t modtime = 0;     // ns
+                int64_t changeTime = 0;  // ns
+                // The timestamps were too recent when the entries were read: a later change may have left them unchanged
+                bool isRacy = false;
+                std::vector<Entry> entries;  // Sorted by name
+                std::chrono::milliseconds interval;
+                TimePoint nextCheck;
+                TimePoint nextFullCheck;
+        };
+
+        std::chrono::milliseconds _minInterval;
+        std::chrono::milliseconds _maxInterval;
+        std::chrono::milliseconds _fullCheckInterval;
+
+        std::map<SyncName, Directory> _directories;
+        // Checks to do, an item is ignored if its directory has been removed or rescheduled
+        std::priority_queue<std::pair<TimePoint, SyncName>, std::vector<std::pair<TimePoint, SyncName>>, std::greater<>>
+            _checkQueue;
+
+        uint64_t _checkCount = 0;
+        uint64_t _detectedChangeCount = 0;
+        std::chrono::milliseconds _totalLatency = std::chrono::milliseconds(0);
+        std::chrono::milliseconds _maxLatency = std::chrono::milliseconds(0);
+
+        void checkAndSchedule(std::map<SyncName, Directory>::iterator dirIt, TimePoint now, bool full, ScanResult &result);
+        // Returns true if the entries changed
+        bool checkDirectory(const SyncName &dirPath, Directory &directory, bool full, ScanResult &result, bool &exists);
+        void addChange(const SyncPath &path, OperationType opType, int64_t modtime, ScanResult &result);
+        static bool readEntries(const SyncName &dirPath, std::vector<Entry> &entries);
+        static int64_t wallClockTime();  // ns
+        static bool isRacy(int64_t modtime, int64_t changeTime, int64_t readTime);
+};
+
+}  // namespace KDC
@@ -0,0 +1,70 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fileeventcoalescer.h"
+
+#include <algorithm>
+
+namespace KDC {
+
+FileEventCoalescer::FileEventCoalescer(std::chrono::milliseconds quietDelay, std::chrono::milliseconds maxDelay)
+    : _quietDelay(quietDelay), _maxDelay(maxDelay) {}
+
+void FileEventCoalescer::push(const SyncPath &path, OperationType opType, TimePoint now) {
+    _rawEventCount++;
+    if (_events.empty()) {
+        _firstEventTime = now;
+    }
+    _lastEventTime = now;
+
+    auto lastEventIt = _lastEventByPath.find(path.native());
+    if (lastEventIt != _lastEventByPath.end()) {
+        OperationType &lastOpType = lastEventIt->second->second;
+        if (opType == OperationTypeDelete) {
+            if (lastOpType != OperationTypeDelete) {
+                // The item is gone, the previous changes do not matter anymore
+                lastOpType = OperationTypeDelete;
+            }
+            return;
+        }
+
+        if (lastOpType != OperationTypeDelete) {
+            if (lastOpType == OperationTypeEdit) {
+                lastOpType = opType;
+            }
+            return;
+        }
+    }
+
+    _events.emplace_back(path, opType);
+    _lastEventByPath[path.native()] = std::prev(_events.end());
+}
+
+FileEventCoalescer::TimePoint FileEventCoalescer::deadline() const {
+    return std::min(_lastEventTime + _quietDelay, _firstEventTime + _maxDelay);
+}
+
+std::list<std::pair<SyncPath, OperationType>> FileEventCoalescer::take() {
+    std::list<std::pair<SyncPath, OperationType>> events;
+    events.swap(_events);
+    _lastEventByPath.clear();
+    _deliveredEventCount += events.size();
+    return events;
+}
+
+}  // namespace KDC
@@ -0,0 +1,69 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "libcommon/utility/types.h"
+
+#include <chrono>
+#include <list>
+#include <unordered_map>
+
+namespace KDC {
+
+/**
+ * Merges the file system events received within a short time on the same path, before they are handed to the observer.
+ * The observer checks the item on disk anyway, so only the operation type that matters most is kept: a create or a move wins
+ * over an edit. A delete is never merged with a later event on the same path, so that a replaced item is still seen as
+ * deleted, then created.
+ */
+class FileEventCoalescer {
+    public:
+        typedef std::chrono::steady_clock::time_point TimePoint;
+
+        /** The events are delivered once no new event has been received for `quietDelay`, or at the latest `maxDelay` after
+         * the first one.
+         */
+        FileEventCoalescer(std::chrono::milliseconds quietDelay, std::chrono::milliseconds maxDelay);
+
+        void push(const SyncPath &path, OperationType opType, TimePoint now = std::chrono::steady_clock::now());
+
+        inline bool isEmpty() const { return _events.empty(); }
+        // Only meaningful if not empty
+        TimePoint deadline() const;
+        inline TimePoint firstEventTime() const { return _firstEventTime; }
+        // Returns the merged events in order of first occurrence, and clears them
+        std::list<std::pair<SyncPath, OperationType>> take();
+
+        inline uint64_t rawEventCount() const { return _rawEventCount; }
+        inline uint64_t deliveredEventCount() const { return _deliveredEventCount; }
+
+    private:
+        std::chrono::milliseconds _quietDelay;
+        std::chrono::milliseconds _maxDelay;
+
+        std::list<std::pair<SyncPath, OperationType>> _events;
+        std::unordered_map<SyncName, std::list<std::pair<SyncPath, OperationType>>::iterator> _lastEventByPath;
+        TimePoint _firstEventTime;
+        TimePoint _lastEventTime;
+
+        uint64_t _rawEventCount = 0;
+        uint64_t _deliveredEventCount = 0;
+};
+
+}  // namespace KDC
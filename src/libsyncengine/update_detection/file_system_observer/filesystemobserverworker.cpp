@@ -19,6 +19,10 @@
 #include "filesystemobserverworker.h"
 #include "libcommonserver/utility/utility.h"
 
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+
 #include <log4cplus/loggingmacros.h>
 
 namespace KDC {
@@ -37,6 +41,66 @@ void FileSystemObserverWorker::invalidateSnapshot() {
     }
 }
 
+SyncPath FileSystemObserverWorker::snapshotFilePath() const {
+    SyncPath filePath = _syncDb->dbPath();
+    filePath.replace_filename(filePath.filename().native() +
+                              (getSnapshotType() == ReplicaSideLocal ? Str(".local.snapshot") : Str(".remote.snapshot")));
+    return filePath;
+}
+
+void FileSystemObserverWorker::saveSnapshot(const std::string &cursor /*= std::string()*/) {
+    const std::string consistencyToken = snapshotConsistencyToken();
+    if (!_snapshot->isValid() || consistencyToken.empty()) {
+        return;
+    }
+
+    SnapshotFile::Metadata metadata;
+    metadata.cursor = cursor;
+    metadata.consistencyToken = consistencyToken;
+    metadata.savedAt = std::time(nullptr);
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool saved = _snapshot->save(snapshotFilePath(), metadata);
+    const std::chrono::duration<double> elapsedSeconds = std::chrono::steady_clock::now() - start;
+    if (saved) {
+        LOG_SYNCPAL_INFO(_logger, (getSnapshotType() == ReplicaSideLocal ? "Local" : "Remote")
+                                      << " snapshot saved in: " << elapsedSeconds.count() << "s for " << _snapshot->nbItems()
+                                      << " items");
+    } else {
+        LOG_SYNCPAL_WARN(_logger, "Failed to save " << (getSnapshotType() == ReplicaSideLocal ? "local" : "remote") << " snapshot");
+    }
+}
+
+bool FileSystemObserverWorker::restoreSnapshot(SnapshotFile::Metadata &metadata) {
+    const SyncPath filePath = snapshotFilePath();
+    std::error_code ec;
+    if (!std::filesystem::exists(filePath, ec)) {
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool loaded = _snapshot->load(filePath, metadata);
+    SnapshotFile(filePath).remove();
+    if (!loaded) {
+        LOG_SYNCPAL_WARN(_logger, "Unable to load saved " << (getSnapshotType() == ReplicaSideLocal ? "local" : "remote")
+                                                          << " snapshot");
+        return false;
+    }
+
+    if (metadata.consistencyToken != snapshotConsistencyToken()) {
+        LOG_SYNCPAL_INFO(_logger, "Saved " << (getSnapshotType() == ReplicaSideLocal ? "local" : "remote")
+                                           << " snapshot is outdated");
+        _snapshot->init();
+        return false;
+    }
+
+    const std::chrono::duration<double> elapsedSeconds = std::chrono::steady_clock::now() - start;
+    LOG_SYNCPAL_INFO(_logger, (getSnapshotType() == ReplicaSideLocal ? "Local" : "Remote")
+                                  << " snapshot restored in: " << elapsedSeconds.count() << "s for " << _snapshot->nbItems()
+                                  << " items, saved at " << metadata.savedAt);
+    return true;
+}
+
 void FileSystemObserverWorker::forceUpdate() {
     const std::lock_guard<std::mutex> lock(_mutex);
     _updating = true;
@@ -53,6 +53,21 @@ class FileSystemObserverWorker : public ISyncWorker {
 
         virtual bool isFolderWatcherReliable() const { return true; }
 
+        /** Identifies what the snapshot depends on besides its replica. An empty token disables the saving of the snapshot.
+         */
+        virtual std::string snapshotConsistencyToken() { return std::string(); }
+        /** File in which the snapshot is kept between two runs, next to the sync DB.
+         */
+        SyncPath snapshotFilePath() const;
+        /** Saves the snapshot, if valid, so that the next start does not rebuild it from scratch.
+         */
+        void saveSnapshot(const std::string &cursor = std::string());
+        /** Loads the snapshot saved by the last run if it is still consistent. The file is removed: if the application does not
+         * stop properly, the next start rebuilds the snapshot from scratch.
+         * @return true if the snapshot has been loaded. It is still invalid and has to be checked against the replica.
+         */
+        bool restoreSnapshot(SnapshotFile::Metadata &metadata);
+
     private:
         static void *executeFunc(void *thisWorker);
         virtual ReplicaSide getSnapshotType() const = 0;
@@ -19,12 +19,16 @@
 #include "folderwatcher_linux.h"
 #include "localfilesystemobserverworker.h"
 #include "libcommon/utility/types.h"
+#include "libcommon/utility/utility.h"
 #include "libcommonserver/io/iohelper.h"
 #include "libcommonserver/utility/utility.h"
 #include "requests/parameterscache.h"
 
+#include <algorithm>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/inotify.h>
-#include <sys/ioctl.h>
 #include <unistd.h>
 #include <string.h>
 
@@ -32,99 +36,296 @@ namespace KDC {
 
 #define EVENT_SIZE (sizeof(struct inotify_event))
 #define BUF_LEN (1024 * (EVENT_SIZE + 16))
-#define SLEEP_TIME 100  // 100ms
+#define COALESCING_QUIET_DELAY 50  // ms
+#define COALESCING_MAX_DELAY 500   // ms
+#define INOTIFY_WATCH_MASK                                                                                               \
+    (IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE | IN_CREATE | IN_DELETE | IN_MODIFY | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | \
+     IN_ONLYDIR | IN_DONT_FOLLOW)
+#define SCAN_MIN_INTERVAL 2000           // ms
+#define SCAN_MAX_INTERVAL 60000          // ms
+#define SCAN_FULL_CHECK_INTERVAL 300000  // ms
+#define SCAN_BATCH_SIZE 200              // Directories checked between two reads of the inotify events
+#define STATISTICS_LOG_INTERVAL 600      // s
 
 FolderWatcher_linux::FolderWatcher_linux(LocalFileSystemObserverWorker *parent, const SyncPath &path)
-    : FolderWatcher(parent, path) {}
+    : FolderWatcher(parent, path),
+      _coalescer(std::chrono::milliseconds(COALESCING_QUIET_DELAY), std::chrono::milliseconds(COALESCING_MAX_DELAY)),
+      _scanner(std::chrono::milliseconds(SCAN_MIN_INTERVAL), std::chrono::milliseconds(SCAN_MAX_INTERVAL),
+               std::chrono::milliseconds(SCAN_FULL_CHECK_INTERVAL)) {
+    // Created here so that stopWatching can be called before the watching thread starts
+    _stopEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_stopEventFd == -1) {
+        LOG4CPLUS_WARN(_logger, "eventfd() failed: " << strerror(errno));
+    }
+
+    const std::string budgetStr = CommonUtility::envVarValue("KDRIVE_INOTIFY_WATCH_BUDGET");
+    if (!budgetStr.empty()) {
+        try {
+            _watchBudget = std::stoull(budgetStr);
+        } catch (std::exception &) {
+            // Keep the limit of the system
+        }
+    }
+}
+
+FolderWatcher_linux::~FolderWatcher_linux() {
+    // The thread must be stopped while the stop event can still be signaled
+    stop();
 
-FolderWatcher_linux::~FolderWatcher_linux() {}
+    if (_stopEventFd != -1) {
+        close(_stopEventFd);
+    }
+}
 
 void FolderWatcher_linux::startWatching() {
     LOG4CPLUS_DEBUG(_logger, L"Start watching folder: " << Path2WStr(_folder).c_str());
     LOG4CPLUS_DEBUG(_logger, "File system format: " << Utility::fileSystemName(_folder).c_str());
 
-    _fileDescriptor = inotify_init();
+    if (_stopEventFd == -1) {
+        return;
+    }
+
+    // Reset the stop event of a previous run, the watches of a previous run are lost with its inotify instance
+    uint64_t value = 0;
+    while (read(_stopEventFd, &value, sizeof(value)) > 0) {
+    }
+    _watchToPath.clear();
+    _pathToWatch.clear();
+    _activeWatches.clear();
+    _scanner.clear();
+    _nextStatisticsTime = std::chrono::steady_clock::now() + std::chrono::seconds(STATISTICS_LOG_INTERVAL);
+
+    _fileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
     if (_fileDescriptor == -1) {
-        LOG4CPLUS_WARN(_logger, "inotify_init() failed: " << strerror(errno));
+        LOG4CPLUS_WARN(_logger, "inotify_init1() failed: " << strerror(errno));
         return;
     }
 
-    if (!addFolderRecursive(_folder)) {
+    const int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd == -1) {
+        LOG4CPLUS_WARN(_logger, "epoll_create1() failed: " << strerror(errno));
+        close(_fileDescriptor);
+        _fileDescriptor = -1;
         return;
     }
 
+    struct epoll_event inotifyEvent = {};
+    inotifyEvent.events = EPOLLIN;
+    inotifyEvent.data.fd = _fileDescriptor;
+    struct epoll_event stopEvent = {};
+    stopEvent.events = EPOLLIN;
+    stopEvent.data.fd = _stopEventFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, _fileDescriptor, &inotifyEvent) == -1 ||
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, _stopEventFd, &stopEvent) == -1) {
+        LOG4CPLUS_WARN(_logger, "epoll_ctl() failed: " << strerror(errno));
+        _stop = true;
+    }
+
+    if (!_stop && addFolderRecursive(_folder)) {
+        while (!_stop) {
+            // Sleep until an event arrives, until the pending changes must be delivered or until directories must be checked
+            auto wakeUpTime = std::chrono::steady_clock::time_point::max();
+            if (!_coalescer.isEmpty()) {
+                wakeUpTime = _coalescer.deadline();
+            }
+            if (!_scanner.isEmpty()) {
+                wakeUpTime = std::min(wakeUpTime, _scanner.nextCheckTime());
+            }
+            int timeout = -1;
+            if (wakeUpTime != std::chrono::steady_clock::time_point::max()) {
+                timeout = static_cast<int>(std::max<int64_t>(
+                    std::chrono::ceil<std::chrono::milliseconds>(wakeUpTime - std::chrono::steady_clock::now()).count(), 0));
+            }
+
+            struct epoll_event events[2];
+            const int nbEvents = epoll_wait(epollFd, events, 2, timeout);
+            if (nbEvents == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG4CPLUS_WARN(_logger, "epoll_wait() failed: " << strerror(errno));
+                break;
+            }
+
+            for (int i = 0; i < nbEvents && !_stop; i++) {
+                if (events[i].data.fd == _fileDescriptor && !readEvents()) {
+                    _stop = true;
+                }
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            if (!_stop && !_scanner.isEmpty() && now >= _scanner.nextCheckTime()) {
+                scanDirectories();
+            }
+
+            if (!_stop && !_coalescer.isEmpty() && now >= _coalescer.deadline()) {
+                deliverChanges();
+            }
+
+            if (!_scanner.isEmpty() && now >= _nextStatisticsTime) {
+                logStatistics();
+                _nextStatisticsTime = now + std::chrono::seconds(STATISTICS_LOG_INTERVAL);
+            }
+        }
+    }
+
+    logStatistics();
+
+    close(epollFd);
+    close(_fileDescriptor);
+    _fileDescriptor = -1;
+}
+
+bool FolderWatcher_linux::readEvents() {
+    char buffer[BUF_LEN] __attribute__((aligned(__alignof__(struct inotify_event))));
     while (!_stop) {
-        unsigned int avail;
-        ioctl(_fileDescriptor, FIONREAD,
-              &avail);  // Since read() is blocking until something has changed, we use ioctl to check if there is changes
-        if (avail > 0) {
-            char buffer[BUF_LEN];
-            ssize_t len = read(_fileDescriptor, buffer, BUF_LEN);
-            if (len == -1) {
-                LOG_WARN(_logger, "Error reading file descriptor " << errno);
+        const ssize_t len = read(_fileDescriptor, buffer, BUF_LEN);
+        if (len == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // All the available events have been read
+                return true;
+            }
+            if (errno == EINTR) {
                 continue;
             }
-            // iterate events in buffer
-            unsigned int offset = 0;
-            while (offset < len) {
-                if (_stop) {
-                    break;
+            LOG_WARN(_logger, "Error reading file descriptor " << errno);
+            return false;
+        }
+
+        // iterate events in buffer
+        ssize_t offset = 0;
+        while (offset < len && !_stop) {
+            struct inotify_event *event = (inotify_event *)(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_IGNORED) {
+                // The watch has been removed, by us or because the directory is gone
+                forgetWatch(event->wd);
+                continue;
+            }
+
+            OperationType opType = OperationTypeNone;
+            if (event->mask & IN_CREATE) {
+                opType = OperationTypeCreate;
+            } else if (event->mask & IN_DELETE || event->mask & IN_MOVED_FROM) {
+                opType = OperationTypeDelete;
+            } else if (event->mask & IN_MOVED_TO) {
+                opType = OperationTypeMove;
+            } else if (event->mask & (IN_MODIFY | IN_ATTRIB)) {
+                opType = OperationTypeEdit;
+            } else {
+                // Ignore all other events
+                continue;
+            }
+
+            auto watchIt = _watchToPath.find(event->wd);
+            if (watchIt == _watchToPath.end()) {
+                continue;
+            }
+
+            if (watchIt->second.active) {
+                _activeWatches.splice(_activeWatches.begin(), _activeWatches, watchIt->second.lruIt);
+            }
+
+            const SyncPath path = watchIt->second.path / SyncName(event->name);
+            if (ParametersCache::isExtendedLogEnabled()) {
+                LOGW_DEBUG(_logger, L"Operation " << Utility::s2ws(Utility::opType2Str(opType)).c_str() << L" detected on item "
+                                                  << Path2WStr(path).c_str());
+            }
+
+            _coalescer.push(path, opType);
+
+            // Watches are updated right away, not to miss the events in new directories
+            if (event->mask & (IN_MOVED_TO | IN_CREATE)) {
+                bool isDirectory = false;
+                IoError ioError = IoErrorSuccess;
+                const bool isDirSuccess = IoHelper::checkIfIsDirectory(path, isDirectory, ioError);
+                if (!isDirSuccess) {
+                    LOGW_WARN(_logger,
+                              L"Error in IoHelper::checkIfIsDirectory: " << Utility::formatIoError(path, ioError).c_str());
+                    continue;
                 }
-                struct inotify_event *event = (inotify_event *)(buffer + offset);
-
-                OperationType opType = OperationTypeNone;
-                bool skip = false;
-                if (event->mask & IN_CREATE) {
-                    opType = OperationTypeCreate;
-                } else if (event->mask & IN_DELETE || event->mask & IN_MOVED_FROM) {
-                    opType = OperationTypeDelete;
-                } else if (event->mask & IN_MOVED_TO) {
-                    opType = OperationTypeMove;
-                } else if (event->mask & (IN_MODIFY | IN_ATTRIB)) {
-                    opType = OperationTypeEdit;
-                } else {
-                    // Ignore all other events
-                    skip = true;
+
+                if (ioError == IoErrorAccessDenied) {
+                    LOGW_WARN(_logger, L"The item misses search/exec permission - path=" << Path2WStr(path).c_str());
                 }
 
-                if (!skip && !_stop) {
-                    if (_watchToPath.find(event->wd) != _watchToPath.end()) {
-                        const SyncPath path = _watchToPath[event->wd] / SyncName(event->name);
-                        if (ParametersCache::isExtendedLogEnabled()) {
-                            LOGW_DEBUG(_logger, L"Operation " << Utility::s2ws(Utility::opType2Str(opType)).c_str()
-                                                              << L" detected on item " << Path2WStr(path).c_str());
-                        }
-
-                        changeDetected(path, opType);
-                        bool isDirectory = false;
-                        IoError ioError = IoErrorSuccess;
-                        const bool isDirSuccess = IoHelper::checkIfIsDirectory(path, isDirectory, ioError);
-                        if (!isDirSuccess) {
-                            LOGW_WARN(_logger, L"Error in IoHelper::checkIfIsDirectory: "
-                                                   << Utility::formatIoError(path, ioError).c_str());
-                            continue;
-                        }
-
-                        if (ioError == IoErrorAccessDenied) {
-                            LOGW_WARN(_logger, L"The item misses search/exec permission - path=" << Path2WStr(path).c_str());
-                        }
-
-                        if ((event->mask & (IN_MOVED_TO | IN_CREATE)) && isDirectory) {
-                            addFolderRecursive(path);
-                        }
-
-                        if (event->mask & (IN_MOVED_FROM | IN_DELETE)) {
-                            removeFoldersBelow(path);
-                        }
-                    }
+                if (isDirectory) {
+                    addFolderRecursive(path);
                 }
+            }
 
-                offset += sizeof(inotify_event) + event->len;
+            if (event->mask & (IN_MOVED_FROM | IN_DELETE)) {
+                removeFoldersBelow(path);
             }
-        } else {
-            Utility::msleep(SLEEP_TIME);
         }
     }
+
+    return true;
+}
+
+void FolderWatcher_linux::scanDirectories() {
+    DirectoryScanner::ScanResult result;
+    _scanner.checkDueDirectories(std::chrono::steady_clock::now(), SCAN_BATCH_SIZE, result);
+    processScanResult(result);
+}
+
+void FolderWatcher_linux::processScanResult(const DirectoryScanner::ScanResult &result) {
+    for (const auto &[path, opType] : result.changes) {
+        if (ParametersCache::isExtendedLogEnabled()) {
+            LOGW_DEBUG(_logger, L"Operation " << Utility::s2ws(Utility::opType2Str(opType)).c_str()
+                                              << L" detected by polling on item " << Path2WStr(path).c_str());
+        }
+        _coalescer.push(path, opType);
+    }
+
+    for (const auto &dirPath : result.deletedDirs) {
+        removeFoldersBelow(dirPath);
+    }
+
+    for (const auto &dirPath : result.createdDirs) {
+        addFolderRecursive(dirPath);
+    }
+
+    // A directory that changes is likely to change again soon
+    for (const auto &dirPath : result.changedDirs) {
+        promoteFolder(dirPath);
+    }
+}
+
+void FolderWatcher_linux::deliverChanges() {
+    const auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                             _coalescer.firstEventTime());
+    _deliveryCount++;
+    _totalDeliveryDelay += delay;
+    _maxDeliveryDelay = std::max(_maxDeliveryDelay, delay);
+
+    const uint64_t rawEventCount = _coalescer.rawEventCount();
+    const uint64_t deliveredEventCount = _coalescer.deliveredEventCount();
+    std::list<std::pair<SyncPath, OperationType>> changes = _coalescer.take();
+    if (ParametersCache::isExtendedLogEnabled()) {
+        LOG4CPLUS_DEBUG(_logger, "Delivering " << changes.size() << " changes (total: " << rawEventCount
+                                               << " inotify events, " << deliveredEventCount + changes.size()
+                                               << " changes delivered)");
+    }
+
+    _parent->changesDetected(changes);
+}
+
+void FolderWatcher_linux::logStatistics() {
+    const size_t watchedCount = _pathToWatch.size();
+    const size_t scannedCount = _scanner.size();
+    LOG4CPLUS_INFO(_logger, "Directories watched: " << watchedCount << ", checked by polling: " << scannedCount << " ("
+                                                    << 100 * watchedCount / std::max<size_t>(watchedCount + scannedCount, 1)
+                                                    << "% watched, budget: " << _watchBudget << ", evictions: "
+                                                    << _evictionCount << ", promotions: " << _promotionCount << ")");
+    LOG4CPLUS_INFO(_logger, "Detection latency with inotify: "
+                                << (_deliveryCount > 0 ? _totalDeliveryDelay.count() / _deliveryCount : 0) << " ms avg, "
+                                << _maxDeliveryDelay.count() << " ms max; by polling: " << _scanner.averageLatency().count()
+                                << " ms avg, " << _scanner.maxLatency().count() << " ms max over "
+                                << _scanner.detectedChangeCount() << " changes and " << _scanner.checkCount() << " checks");
+    LOG4CPLUS_DEBUG(_logger, "Events received: " << _coalescer.rawEventCount()
+                                                        << ", changes delivered: " << _coalescer.deliveredEventCount());
 }
 
 bool FolderWatcher_linux::findSubFolders(const SyncPath &dir, std::list<SyncPath> &fullList) {
@@ -142,20 +343,26 @@ bool FolderWatcher_linux::findSubFolders(const SyncPath &dir, std::list<SyncPath
     } else {
         try {
             std::error_code ec;
-            const auto dirIt = std::filesystem::recursive_directory_iterator(
+            auto dirIt = std::filesystem::recursive_directory_iterator(
                 dir, std::filesystem::directory_options::skip_permission_denied, ec);
             if (ec) {
                 LOG4CPLUS_WARN(_logger, "Error in findSubFolders: " << Utility::formatStdError(ec).c_str());
                 return false;
             }
 
-            if (dirIt != std::filesystem::recursive_directory_iterator() &&
-                (dirIt->is_symlink() || !dirIt->is_directory())) {  // TODO : check for hidden files
-                return ok;
-            }
+            for (; dirIt != std::filesystem::recursive_directory_iterator(); dirIt.increment(ec)) {
+                if (ec) {
+                    LOG4CPLUS_WARN(_logger, "Error in findSubFolders: " << Utility::formatStdError(ec).c_str());
+                    ok = false;
+                    break;
+                }
 
-            fullList.push_back(dirIt->path());
+                if (dirIt->is_symlink() || !dirIt->is_directory()) {  // TODO : check for hidden files
+                    continue;
+                }
 
+                fullList.push_back(dirIt->path());
+            }
         } catch (std::filesystem::filesystem_error &e) {
             LOG4CPLUS_WARN(_logger, L"Error caught in findSubFolders: " << e.code() << " - " << e.what());
             ok = false;
@@ -168,7 +375,7 @@ bool FolderWatcher_linux::findSubFolders(const SyncPath &dir, std::list<SyncPath
     return ok;
 }
 
-bool FolderWatcher_linux::inotifyRegisterPath(const SyncPath &path) {
+bool FolderWatcher_linux::inotifyRegisterPath(const SyncPath &path, bool evict) {
     std::error_code ec;
     if (!std::filesystem::exists(path, ec)) {
         if (ec.value() != 0) {
@@ -179,28 +386,79 @@ bool FolderWatcher_linux::inotifyRegisterPath(const SyncPath &path) {
         return false;
     }
 
-    int wd = inotify_add_watch(_fileDescriptor, path.string().c_str(),
-                               IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE | IN_CREATE | IN_DELETE | IN_MODIFY | IN_DELETE_SELF |
-                                   IN_MOVE_SELF | IN_UNMOUNT | IN_ONLYDIR | IN_DONT_FOLLOW);
+    if (_watchBudget > 0 && _pathToWatch.size() >= _watchBudget && !(evict && evictLeastActiveWatch())) {
+        return false;
+    }
 
-    if (wd > -1) {
-        _watchToPath.insert({wd, path});
-        _pathToWatch.insert({path, wd});
-    } else {
-        // If we're running out of memory or inotify watches, become
-        // unreliable.
-        if (_isReliable && (errno == ENOMEM || errno == ENOSPC)) {
-            _isReliable = false;
-            LOG4CPLUS_ERROR(_logger, "Out of memory or limit number of inotify watches reached!");  // TODO : notify the user?
-            return false;
+    int wd = inotify_add_watch(_fileDescriptor, path.string().c_str(), INOTIFY_WATCH_MASK);
+    if (wd == -1 && (errno == ENOMEM || errno == ENOSPC)) {
+        if (_watchBudget == 0 || _pathToWatch.size() < _watchBudget) {
+            // The limit of the system is reached first, it becomes the budget
+            _watchBudget = std::max<size_t>(_pathToWatch.size(), 1);
+            LOG4CPLUS_WARN(_logger, "Limit number of inotify watches reached with "
+                                        << _watchBudget << " watches, the other directories are checked by polling");
         }
+        if (evict && evictLeastActiveWatch()) {
+            wd = inotify_add_watch(_fileDescriptor, path.string().c_str(), INOTIFY_WATCH_MASK);
+        }
+    }
+
+    if (wd == -1) {
+        return false;
+    }
+
+    if (_watchToPath.contains(wd)) {
+        // Same directory reached by another path
+        forgetWatch(wd);
+    }
+    _activeWatches.push_front(wd);
+    _watchToPath[wd] = Watch{path, _activeWatches.begin()};
+    _pathToWatch[path.string()] = wd;
+    return true;
+}
+
+bool FolderWatcher_linux::evictLeastActiveWatch() {
+    if (_activeWatches.empty()) {
+        return false;
     }
 
+    const int wd = _activeWatches.back();
+    Watch &watch = _watchToPath[wd];
+
+    // The reference entries are read before the watch is removed, the changes in between are still reported by inotify
+    _scanner.add(watch.path);
+    inotify_rm_watch(_fileDescriptor, wd);
+    _activeWatches.pop_back();
+    _pathToWatch.erase(watch.path.string());
+    watch.active = false;
+    _evictionCount++;
     return true;
 }
 
+void FolderWatcher_linux::forgetWatch(int wd) {
+    auto watchIt = _watchToPath.find(wd);
+    if (watchIt == _watchToPath.end()) {
+        return;
+    }
+
+    if (watchIt->second.active) {
+        _activeWatches.erase(watchIt->second.lruIt);
+        auto pathIt = _pathToWatch.find(watchIt->second.path.string());
+        if (pathIt != _pathToWatch.end() && pathIt->second == wd) {
+            _pathToWatch.erase(pathIt);
+        }
+    }
+    _watchToPath.erase(watchIt);
+}
+
+void FolderWatcher_linux::watchFolder(const SyncPath &path, bool evict) {
+    if (!inotifyRegisterPath(path, evict)) {
+        _scanner.add(path);
+    }
+}
+
 bool FolderWatcher_linux::addFolderRecursive(const SyncPath &path) {
-    if (_pathToWatch.find(path) != _pathToWatch.end()) {
+    if (_pathToWatch.find(path) != _pathToWatch.end() || _scanner.contains(path)) {
         // This path is already watched
         return true;
     }
@@ -208,7 +466,8 @@ bool FolderWatcher_linux::addFolderRecursive(const SyncPath &path) {
     int subdirs = 0;
     LOG4CPLUS_DEBUG(_logger, L"(+) Watcher:" << Path2WStr(path));
 
-    inotifyRegisterPath(path);
+    // A new directory is active, it can take the watch of a less active one
+    watchFolder(path, true);
 
     std::list<SyncPath> allSubFolders;
     if (!findSubFolders(path, allSubFolders)) {
@@ -218,10 +477,11 @@ bool FolderWatcher_linux::addFolderRecursive(const SyncPath &path) {
 
     for (const auto &subDirPath : allSubFolders) {
         std::error_code ec;
-        if (std::filesystem::exists(subDirPath, ec) && _pathToWatch.find(subDirPath) == _pathToWatch.end()) {
+        if (std::filesystem::exists(subDirPath, ec) && _pathToWatch.find(subDirPath) == _pathToWatch.end() &&
+            !_scanner.contains(subDirPath)) {
             subdirs++;
 
-            inotifyRegisterPath(subDirPath);
+            watchFolder(subDirPath, false);
         } else {
             if (ec.value() != 0) {
                 LOG4CPLUS_WARN(_logger, L"Failed to check if path exists " << Path2WStr(path).c_str() << L": "
@@ -239,49 +499,58 @@ bool FolderWatcher_linux::addFolderRecursive(const SyncPath &path) {
     return true;
 }
 
-void FolderWatcher_linux::removeFoldersBelow(const SyncPath &dirPath) {
-    auto it = _pathToWatch.find(dirPath.string());
-    if (it == _pathToWatch.end()) {
+void FolderWatcher_linux::promoteFolder(const SyncPath &dirPath) {
+    if (!_scanner.contains(dirPath) || !inotifyRegisterPath(dirPath, true)) {
         return;
     }
 
-    std::string pathSlash = dirPath.string() + '/';
+    // Report the changes made before the watch was added
+    DirectoryScanner::ScanResult result;
+    _scanner.check(dirPath, std::chrono::steady_clock::now(), result);
+    _scanner.remove(dirPath);
+    _promotionCount++;
+    processScanResult(result);
+}
 
-    // Remove the entry and all subentries
-    while (it != _pathToWatch.end()) {
-        auto itPath = it->first;
-        if (Utility::startsWith(itPath, dirPath)) {
-            break;
-        }
+void FolderWatcher_linux::removeFoldersBelow(const SyncPath &dirPath) {
+    _scanner.removeBelow(dirPath);
+
+    const std::string dirPathStr = dirPath.string();
+    const std::string pathSlash = dirPathStr + '/';
 
-        if (itPath != dirPath && Utility::startsWith(itPath, pathSlash)) {
-            // order is 'foo', 'foo bar', 'foo/bar'
+    // Remove the entry and all subentries, order is 'foo', 'foo bar', 'foo/bar'
+    auto it = _pathToWatch.lower_bound(dirPathStr);
+    while (it != _pathToWatch.end() && Utility::startsWith(it->first, dirPathStr)) {
+        if (it->first != dirPathStr && !Utility::startsWith(it->first, pathSlash)) {
             ++it;
             continue;
         }
 
-        auto wid = it->second;
-        int wd = inotify_rm_watch(_fileDescriptor, wid);
-        if (wd > -1) {
-            _watchToPath.erase(wid);
-            it = _pathToWatch.erase(it);
-            LOG4CPLUS_DEBUG(_logger, "Removed watch on" << itPath.c_str());
-        } else {
-            LOG4CPLUS_ERROR(_logger, "Error in inotify_rm_watch :" << errno);
+        // The watch is forgotten when the kernel acknowledges its removal with IN_IGNORED
+        const int wd = it->second;
+        if (inotify_rm_watch(_fileDescriptor, wd) == -1) {
+            // The watch of a deleted directory is already removed
+            LOG4CPLUS_DEBUG(_logger, "Error in inotify_rm_watch: " << errno);
+        }
+        auto watchIt = _watchToPath.find(wd);
+        if (watchIt != _watchToPath.end() && watchIt->second.active) {
+            _activeWatches.erase(watchIt->second.lruIt);
+            watchIt->second.active = false;
         }
+        LOG4CPLUS_DEBUG(_logger, "Removed watch on " << it->first.c_str());
+        it = _pathToWatch.erase(it);
     }
 }
 
-void FolderWatcher_linux::changeDetected(const SyncPath &path, OperationType opType) {
-    std::list<std::pair<SyncPath, OperationType>> list;
-    list.push_back({path, opType});
-    _parent->changesDetected(list);
-}
-
 void KDC::FolderWatcher_linux::stopWatching() {
     LOG4CPLUS_DEBUG(_logger, L"Stop watching folder: " << Path2WStr(_folder).c_str());
 
-    close(_fileDescriptor);
+    if (_stopEventFd != -1) {
+        const uint64_t value = 1;
+        if (write(_stopEventFd, &value, sizeof(value)) == -1) {
+            LOG4CPLUS_WARN(_logger, "Failed to wake up the watching thread: " << strerror(errno));
+        }
+    }
 }
 
 }  // namespace KDC
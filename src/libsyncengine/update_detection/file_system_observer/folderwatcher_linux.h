@@ -19,6 +19,8 @@
 #pragma once
 
 #include "folderwatcher.h"
+#include "fileeventcoalescer.h"
+#include "directoryscanner.h"
 
 #include <map>
 
@@ -38,17 +40,48 @@ class FolderWatcher_linux : public FolderWatcher {
         bool _ready = true;
 
     private:
+        struct Watch {
+                SyncPath path;
+                std::list<int>::iterator lruIt;
+                bool active = true;  // False once removed, until the kernel acknowledges it with IN_IGNORED
+        };
+
         int _fileDescriptor = -1;
+        int _stopEventFd = -1;  // Written to wake the watching thread up when it must stop
+
+        FileEventCoalescer _coalescer;
+
+        // At most _watchBudget directories are watched, the most recently active ones. The others are checked by _scanner.
+        size_t _watchBudget = 0;  // 0: as many as the system allows
+        std::list<int> _activeWatches;  // Most recently active first
+        DirectoryScanner _scanner;
+
+        // Statistics
+        uint64_t _evictionCount = 0;
+        uint64_t _promotionCount = 0;
+        uint64_t _deliveryCount = 0;
+        std::chrono::milliseconds _totalDeliveryDelay = std::chrono::milliseconds(0);
+        std::chrono::milliseconds _maxDeliveryDelay = std::chrono::milliseconds(0);
+        std::chrono::steady_clock::time_point _nextStatisticsTime;
+
+        bool readEvents();
+        void scanDirectories();
+        void processScanResult(const DirectoryScanner::ScanResult &result);
+        void deliverChanges();
+        void logStatistics();
 
         bool findSubFolders(const SyncPath &dir, std::list<SyncPath> &fullList);
-        bool inotifyRegisterPath(const SyncPath &path);
+        // Returns false if the directory is not watched, `evict` allows to take the watch of the least active directory
+        bool inotifyRegisterPath(const SyncPath &path, bool evict);
+        bool evictLeastActiveWatch();
+        void forgetWatch(int wd);
+        void watchFolder(const SyncPath &path, bool evict);
         bool addFolderRecursive(const SyncPath &path);
+        void promoteFolder(const SyncPath &dirPath);
         void removeFoldersBelow(const SyncPath &dirPath);
 
-        void changeDetected(const SyncPath &path, OperationType opType);
-
-        std::unordered_map<int, SyncPath> _watchToPath;
-        std::map<std::string, int> _pathToWatch;
+        std::unordered_map<int, Watch> _watchToPath;
+        std::map<std::string, int> _pathToWatch;  // Active watches only
 };
 
 }  // namespace KDC
@@ -23,12 +23,21 @@
 #include "libcommonserver/utility/utility.h"
 #include "requests/parameterscache.h"
 #include "requests/exclusiontemplatecache.h"
+#if defined(__linux__)
+#include "paralleltreewalker.h"
+#endif
 
 #include <log4cplus/loggingmacros.h>
 
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 
+#if defined(__linux__)
+#include <string.h>
+#include <sys/stat.h>
+#endif
+
 namespace KDC {
 
 static const int defaultDiscoveryInterval = 60000;  // 60sec
@@ -427,6 +436,7 @@ void LocalFileSystemObserverWorker::execute() {
     for (;;) {
         if (stopAsked()) {
             exitCode = ExitCodeOk;
+            saveSnapshot();
             invalidateSnapshot();
             break;
         }
@@ -476,7 +486,18 @@ ExitCode LocalFileSystemObserverWorker::generateInitialSnapshot() {
     _snapshot->init();
     _updating = true;
 
-    ExitCode res = exploreDir(_rootFolder);
+    ExitCode res = ExitCodeUnknown;
+    SnapshotFile::Metadata metadata;
+    if (restoreSnapshot(metadata)) {
+        res = exploreDir(_rootFolder, metadata.savedAt);
+        if (res != ExitCodeOk && !stopAsked()) {
+            LOG_SYNCPAL_WARN(_logger, "Unable to check the restored local snapshot, rebuilding it");
+            _snapshot->init();
+            res = exploreDir(_rootFolder);
+        }
+    } else {
+        res = exploreDir(_rootFolder);
+    }
 
     std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
     if (res == ExitCodeOk && !stopAsked()) {
@@ -502,6 +523,19 @@ ExitCode LocalFileSystemObserverWorker::generateInitialSnapshot() {
     return res;
 }
 
+std::string LocalFileSystemObserverWorker::snapshotConsistencyToken() {
+#if defined(__linux__)
+    // A saved snapshot is only checked by the parallel walk. It is not used if the sync folder has been replaced.
+    struct stat rootStat;
+    if (stat(_rootFolder.c_str(), &rootStat) != 0) {
+        return std::string();
+    }
+    return _rootFolder.native() + ":" + std::to_string(rootStat.st_dev) + ":" + std::to_string(rootStat.st_ino);
+#else
+    return std::string();
+#endif
+}
+
 bool LocalFileSystemObserverWorker::canComputeChecksum(const SyncPath &absolutePath) {
     bool isPlaceholder = false;
     bool isHydrated = false;
@@ -604,7 +638,7 @@ void LocalFileSystemObserverWorker::sendAccessDeniedError(const SyncPath &absolu
     _syncPal->addError(error);
 }
 
-ExitCode LocalFileSystemObserverWorker::exploreDir(const SyncPath &absoluteParentDirPath) {
+ExitCode LocalFileSystemObserverWorker::exploreDir(const SyncPath &absoluteParentDirPath, SyncTime savedAt /*= 0*/) {
     // Check if root dir exists
     bool readPermission = false;
     bool writePermission = false;
@@ -655,6 +689,11 @@ ExitCode LocalFileSystemObserverWorker::exploreDir(const SyncPath &absoluteParen
         return ExitCodeOk;
     }
 
+#if defined(__linux__)
+    return exploreDirInParallel(absoluteParentDirPath, savedAt);
+#else
+    (void)savedAt;  // Snapshots are only restored on Linux
+
     // Process all files
     try {
         std::error_code ec;
@@ -866,6 +905,178 @@ ExitCode LocalFileSystemObserverWorker::exploreDir(const SyncPath &absoluteParen
     }
 
     return ExitCodeOk;
+#endif
 }
 
+#if defined(__linux__)
+ExitCode LocalFileSystemObserverWorker::exploreDirInParallel(const SyncPath &absoluteParentDirPath, SyncTime savedAt) {
+    const NodeId rootNodeId = *_syncPal->_syncDb->rootNode().nodeIdLocal();
+    const size_t maxPathLength = CommonUtility::maxPathLength();
+
+    ParallelTreeWalker walker;
+    // One list per thread. The items are inserted in the snapshot by batches, the other actions are done once the walk is over.
+    std::vector<std::vector<SnapshotItem>> items(walker.nbThreads());
+    std::vector<std::vector<SyncPath>> excludedPaths(walker.nbThreads());
+    std::vector<std::vector<SyncPath>> accessDeniedPaths(walker.nbThreads());
+    // Restored snapshot only: items to remove, and directories in which entries may have been removed since it was saved
+    std::vector<std::vector<NodeId>> removedIds(walker.nbThreads());
+    std::vector<std::vector<std::pair<NodeId, SyncPath>>> changedDirs(walker.nbThreads());
+    const auto rejectEntry = [&](const ParallelTreeWalker::DirEntry &entry, size_t threadIndex) {
+        if (savedAt) {
+            removedIds[threadIndex].push_back(std::to_string(entry.stat.st_ino));
+        }
+        return false;
+    };
+
+    const ParallelTreeWalker::Visitor visit = [&](const ParallelTreeWalker::DirEntry &entry, size_t threadIndex) {
+        const SyncPath absolutePath = entry.dirPath / entry.name;
+        if (ParametersCache::isExtendedLogEnabled()) {
+            LOGW_SYNCPAL_DEBUG(_logger, L"Item: " << Utility::formatSyncPath(absolutePath).c_str() << L" found");
+        }
+
+        // Check if the directory entry is managed
+        const bool isLink = S_ISLNK(entry.stat.st_mode);
+        if ((!isLink && !S_ISDIR(entry.stat.st_mode) && !S_ISREG(entry.stat.st_mode)) ||
+            absolutePath.native().length() > maxPathLength) {
+            LOGW_SYNCPAL_DEBUG(_logger, L"Directory entry is not managed: " << Utility::formatSyncPath(absolutePath).c_str());
+            excludedPaths[threadIndex].push_back(absolutePath);
+            return rejectEntry(entry, threadIndex);
+        }
+
+        // Check template exclusion
+        const SyncPath relativePath = CommonUtility::relativePath(_syncPal->_localPath, absolutePath);
+        bool isWarning = false;
+        bool isExcluded = false;
+        IoError ioError = IoErrorSuccess;
+        if (!ExclusionTemplateCache::instance()->checkIfIsExcluded(_syncPal->_localPath, relativePath, isWarning, isExcluded,
+                                                                   ioError)) {
+            LOGW_SYNCPAL_DEBUG(_logger, L"Error in ExclusionTemplateCache::isExcluded: "
+                                            << Utility::formatIoError(absolutePath, ioError).c_str());
+            return false;
+        }
+        if (isExcluded) {
+            LOGW_SYNCPAL_INFO(_logger,
+                              L"Item: " << Utility::formatSyncPath(absolutePath).c_str() << L" rejected because it's excluded");
+            excludedPaths[threadIndex].push_back(absolutePath);
+            return rejectEntry(entry, threadIndex);
+        }
+
+        // Check access permissions, of the target for a link
+        mode_t mode = entry.stat.st_mode;
+        if (isLink) {
+            struct stat targetStat;
+            if (fstatat(entry.dirFd, entry.name, &targetStat, 0) == 0) {
+                mode = targetStat.st_mode;
+            } else if (errno == ENOENT || errno == ENOTDIR) {
+                LOGW_SYNCPAL_DEBUG(_logger,
+                                   L"Directory entry does not exist anymore: " << Utility::formatSyncPath(absolutePath).c_str());
+                return rejectEntry(entry, threadIndex);
+            } else {
+                mode = 0;
+            }
+        }
+        if (!(mode & S_IRUSR) || !(mode & S_IWUSR) || (S_ISDIR(mode) && !(mode & S_IXUSR))) {
+            LOGW_SYNCPAL_INFO(_logger, L"Item: " << Utility::formatSyncPath(absolutePath).c_str()
+                                                 << L" rejected because access is denied");
+            accessDeniedPaths[threadIndex].push_back(absolutePath);
+            excludedPaths[threadIndex].push_back(absolutePath);
+            return rejectEntry(entry, threadIndex);
+        }
+
+        const NodeId parentNodeId = entry.dirPath.native() == _rootFolder.native() ? rootNodeId : std::to_string(entry.dirInode);
+        const NodeType nodeType = !isLink && S_ISDIR(entry.stat.st_mode) ? NodeTypeDirectory : NodeTypeFile;
+        SnapshotItem item(std::to_string(entry.stat.st_ino), parentNodeId, SyncName(entry.name), entry.stat.st_ctime,
+                          entry.stat.st_mtime, nodeType, entry.stat.st_size, isLink);
+        if (savedAt) {
+            SnapshotItem savedItem;
+            const bool isSaved = _snapshot->getItem(item.id(), savedItem);
+            // An entry added or removed changes the modification time of its directory. The timestamps have a resolution of
+            // a second: a directory modified during the second of the save is checked too. The change time is compared as
+            // well since tools like rsync or tar restore the modification time, but cannot set the change time.
+            if (nodeType == NodeTypeDirectory &&
+                (!isSaved || savedItem.lastModified() != item.lastModified() || savedItem.createdAt() != item.createdAt() ||
+                 std::max(entry.stat.st_mtime, entry.stat.st_ctime) + 1 >= savedAt)) {
+                changedDirs[threadIndex].emplace_back(item.id(), absolutePath);
+            }
+            if (isSaved && savedItem.parentId() == item.parentId() && savedItem.name() == item.name() &&
+                savedItem.createdAt() == item.createdAt() && savedItem.lastModified() == item.lastModified() &&
+                savedItem.type() == item.type() && savedItem.size() == item.size() && savedItem.isLink() == item.isLink()) {
+                return true;
+            }
+        }
+        items[threadIndex].push_back(std::move(item));
+        return true;
+    };
+
+    const ParallelTreeWalker::Flusher flush = [&](size_t threadIndex) {
+        const uint64_t nbUpdated = _snapshot->updateItems(items[threadIndex]);
+        if (nbUpdated != items[threadIndex].size()) {
+            LOG_SYNCPAL_WARN(_logger,
+                             "Failed to insert " << items[threadIndex].size() - nbUpdated << " items into local snapshot!!!");
+        }
+        items[threadIndex].clear();
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool success = walker.walk(absoluteParentDirPath, visit, flush, [this] { return stopAsked(); });
+    const std::chrono::duration<double> elapsedSeconds = std::chrono::steady_clock::now() - start;
+
+    for (const auto &threadPaths : accessDeniedPaths) {
+        for (const auto &absolutePath : threadPaths) {
+            sendAccessDeniedError(absolutePath);
+        }
+    }
+    for (const auto &threadPaths : excludedPaths) {
+        for (const auto &absolutePath : threadPaths) {
+            if (!_syncPal->vfsExclude(
+                    absolutePath)) {  // TODO : This class should never set any attribute or change anything on a file
+                LOGW_SYNCPAL_WARN(_logger, L"Error in vfsExclude : " << Utility::formatSyncPath(absolutePath).c_str());
+            }
+        }
+    }
+
+    if (stopAsked()) {
+        return ExitCodeOk;
+    }
+
+    if (!success) {
+        LOGW_SYNCPAL_WARN(_logger, L"Error in exploreDir: " << Utility::formatSyncPath(walker.errorPath()).c_str() << L" - "
+                                                            << Utility::s2ws(strerror(walker.error())).c_str());
+        setExitCause(ExitCauseFileAccessError);
+        return ExitCodeSystemError;
+    }
+
+    if (savedAt) {
+        // The items found have been updated, remove the ones that are not in the directory anymore
+        for (const auto &threadIds : removedIds) {
+            for (const auto &nodeId : threadIds) {
+                _snapshot->removeItem(nodeId);
+            }
+        }
+
+        changedDirs[0].emplace_back(rootNodeId, absoluteParentDirPath);
+        uint64_t nbRemoved = 0;
+        for (const auto &threadDirs : changedDirs) {
+            for (const auto &[dirNodeId, dirPath] : threadDirs) {
+                std::unordered_set<NodeId> childIds;
+                _snapshot->getChildrenIds(dirNodeId, childIds);
+                for (const auto &childId : childIds) {
+                    struct stat childStat;
+                    const SyncPath childPath = dirPath / _snapshot->name(childId);
+                    if (lstat(childPath.c_str(), &childStat) != 0 || std::to_string(childStat.st_ino) != childId) {
+                        _snapshot->removeItem(childId);
+                        nbRemoved++;
+                    }
+                }
+            }
+        }
+        LOG_SYNCPAL_DEBUG(_logger, "Restored snapshot checked, " << nbRemoved << " items removed");
+    }
+
+    LOG_SYNCPAL_DEBUG(_logger, "Explored " << walker.nbDirectories() << " directories in " << elapsedSeconds.count() << "s with "
+                                           << walker.nbThreads() << " threads (" << walker.nbSteals() << " steals)");
+    return ExitCodeOk;
+}
+#endif
+
 }  // namespace KDC
@@ -38,7 +38,10 @@ class LocalFileSystemObserverWorker : public FileSystemObserverWorker {
 
     protected:
         virtual void execute() override;
-        ExitCode exploreDir(const SyncPath &absoluteParentDirPath);
+        /** @param savedAt If not 0, the snapshot has been restored from a file saved at that time and is only updated where
+         * the directory differs from it.
+         */
+        ExitCode exploreDir(const SyncPath &absoluteParentDirPath, SyncTime savedAt = 0);
 
         SyncPath _rootFolder;
         //    std::unique_ptr<ContentChecksumWorker> _checksumWorker = nullptr;
@@ -47,9 +50,14 @@ class LocalFileSystemObserverWorker : public FileSystemObserverWorker {
     private:
         virtual ExitCode generateInitialSnapshot() override;
         virtual ReplicaSide getSnapshotType() const override { return ReplicaSide::ReplicaSideLocal; }
+        virtual std::string snapshotConsistencyToken() override;
 
         bool canComputeChecksum(const SyncPath &absolutePath);
 
+#if defined(__linux__)
+        ExitCode exploreDirInParallel(const SyncPath &absoluteParentDirPath, SyncTime savedAt);
+#endif
+
 #ifdef __APPLE__
         ExitCode isEditValid(const NodeId &nodeId, const SyncPath &path, SyncTime lastModifiedLocal, bool &valid) const;
 #endif
@@ -0,0 +1,227 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "paralleltreewalker.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace KDC {
+
+#define PARALLEL_WALK_MAX_THREADS 16
+#define PARALLEL_WALK_IDLE_WAIT 1  // ms
+
+ParallelTreeWalker::ParallelTreeWalker(size_t nbThreads, size_t batchSize)
+    : _nbThreads(std::max<size_t>(nbThreads, 1)), _batchSize(std::max<size_t>(batchSize, 1)), _queues(_nbThreads) {}
+
+size_t ParallelTreeWalker::defaultThreadCount() {
+    return std::clamp<size_t>(std::thread::hardware_concurrency(), 1, PARALLEL_WALK_MAX_THREADS);
+}
+
+bool ParallelTreeWalker::walk(const SyncPath &rootPath, const Visitor &visitor, const Flusher &flush,
+                              const std::function<bool()> &stopAsked) {
+    _visitor = &visitor;
+    _flush = &flush;
+    _stopAsked = stopAsked ? &stopAsked : nullptr;
+    _error = 0;
+    _errorPath.clear();
+    _done = false;
+    _nbDirectories = 0;
+    _nbSteals = 0;
+
+    struct stat rootStat;
+    if (stat(rootPath.c_str(), &rootStat) != 0) {
+        setError(errno, rootPath);
+        return false;
+    }
+
+    _nbPendingDirectories = 1;
+    _queues[0].directories.push_back(Directory{rootPath, rootStat.st_ino});
+
+    std::vector<std::thread> threads;
+    for (size_t threadIndex = 1; threadIndex < _nbThreads; threadIndex++) {
+        threads.emplace_back(&ParallelTreeWalker::run, this, threadIndex);
+    }
+    run(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // Not empty if the walk has been interrupted
+    for (auto &queue : _queues) {
+        queue.directories.clear();
+    }
+
+    return _error == 0 && _nbPendingDirectories == 0;
+}
+
+void ParallelTreeWalker::run(size_t threadIndex) {
+    std::vector<Directory> subDirectories;
+    size_t nbVisited = 0;
+    Directory directory;
+    while (!_done) {
+        if (_stopAsked && (*_stopAsked)()) {
+            _done = true;
+            _workAvailable.notify_all();
+            break;
+        }
+
+        if (!take(threadIndex, directory)) {
+            if (!subDirectories.empty()) {
+                // Our queue has been emptied by other threads since the last walked directory: the directories kept for the
+                // current batch are the only work left to this thread, and possibly to the whole walk
+                (*_flush)(threadIndex);
+                nbVisited = 0;
+                publish(threadIndex, subDirectories);
+                continue;
+            }
+
+            // Wait for other threads to publish directories, or for the end of the walk
+            std::unique_lock<std::mutex> lock(_idleMutex);
+            _workAvailable.wait_for(lock, std::chrono::milliseconds(PARALLEL_WALK_IDLE_WAIT));
+            continue;
+        }
+
+        nbVisited += walkDirectory(directory, threadIndex, subDirectories);
+
+        bool isQueueEmpty = false;
+        {
+            const std::lock_guard<std::mutex> lock(_queues[threadIndex].mutex);
+            isQueueEmpty = _queues[threadIndex].directories.empty();
+        }
+        if (nbVisited >= _batchSize || isQueueEmpty) {
+            // The entries are flushed before their subdirectories are walked
+            (*_flush)(threadIndex);
+            nbVisited = 0;
+            publish(threadIndex, subDirectories);
+        }
+
+        // The subdirectories have been counted already
+        if (--_nbPendingDirectories == 0) {
+            _done = true;
+            _workAvailable.notify_all();
+        }
+    }
+
+    if (nbVisited > 0) {
+        (*_flush)(threadIndex);
+    }
+}
+
+bool ParallelTreeWalker::take(size_t threadIndex, Directory &directory) {
+    {
+        WorkQueue &queue = _queues[threadIndex];
+        const std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.directories.empty()) {
+            directory = std::move(queue.directories.back());
+            queue.directories.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < _nbThreads; i++) {
+        WorkQueue &queue = _queues[(threadIndex + i) % _nbThreads];
+        const std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.directories.empty()) {
+            // The oldest directories are the closest to the root, they likely have the largest subtrees
+            directory = std::move(queue.directories.front());
+            queue.directories.pop_front();
+            _nbSteals++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ParallelTreeWalker::publish(size_t threadIndex, std::vector<Directory> &directories) {
+    if (directories.empty()) {
+        return;
+    }
+
+    {
+        WorkQueue &queue = _queues[threadIndex];
+        const std::lock_guard<std::mutex> lock(queue.mutex);
+        std::move(directories.begin(), directories.end(), std::back_inserter(queue.directories));
+    }
+    directories.clear();
+    _workAvailable.notify_all();
+}
+
+size_t ParallelTreeWalker::walkDirectory(const Directory &directory, size_t threadIndex,
+                                         std::vector<Directory> &subDirectories) {
+    const int dirFd = open(directory.path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (dirFd == -1) {
+        // Same as std::filesystem::directory_options::skip_permission_denied, and the directory may have been deleted or replaced
+        if (errno != EACCES && errno != EPERM && errno != ENOENT && errno != ENOTDIR && errno != ELOOP) {
+            setError(errno, directory.path);
+        }
+        return 0;
+    }
+
+    DIR *dir = fdopendir(dirFd);
+    if (!dir) {
+        setError(errno, directory.path);
+        close(dirFd);
+        return 0;
+    }
+    _nbDirectories++;
+
+    size_t nbVisited = 0;
+    errno = 0;
+    while (const struct dirent *dirEntry = readdir(dir)) {
+        if (strcmp(dirEntry->d_name, ".") != 0 && strcmp(dirEntry->d_name, "..") != 0) {
+            struct stat entryStat;
+            // An entry deleted in the meantime is skipped
+            if (fstatat(dirFd, dirEntry->d_name, &entryStat, AT_SYMLINK_NOFOLLOW) == 0) {
+                nbVisited++;
+                const DirEntry entry{dirFd, directory.path, directory.inode, dirEntry->d_name, entryStat};
+                if ((*_visitor)(entry, threadIndex) && S_ISDIR(entryStat.st_mode)) {
+                    subDirectories.push_back(Directory{directory.path / dirEntry->d_name, entryStat.st_ino});
+                    _nbPendingDirectories++;
+                }
+            }
+        }
+        errno = 0;
+    }
+    if (errno != 0) {
+        setError(errno, directory.path);
+    }
+    closedir(dir);
+
+    return nbVisited;
+}
+
+void ParallelTreeWalker::setError(int error, const SyncPath &path) {
+    {
+        const std::lock_guard<std::mutex> lock(_errorMutex);
+        if (_error == 0) {
+            _error = error;
+            _errorPath = path;
+        }
+    }
+    _done = true;
+    _workAvailable.notify_all();
+}
+
+}  // namespace KDC
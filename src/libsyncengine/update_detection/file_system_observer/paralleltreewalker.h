@@ -0,0 +1,111 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "libcommon/utility/types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace KDC {
+
+/**
+ * Walks a directory tree with several threads. Each thread has its own queue of directories to read and takes work from the
+ * queues of the others when its own is empty. The entries are read and stat'ed relative to their directory, so that a path
+ * is resolved once per directory instead of once per entry.
+ * Symbolic links are not followed.
+ */
+class ParallelTreeWalker {
+    public:
+        struct DirEntry {
+                int dirFd;
+                const SyncPath &dirPath;
+                uint64_t dirInode;
+                const char *name;
+                const struct stat &stat;  // Of the entry itself, not of the target of a link
+        };
+
+        // Called concurrently by the threads. Returns true to walk the entry, if it is a directory.
+        typedef std::function<bool(const DirEntry &entry, size_t threadIndex)> Visitor;
+        // Called by a thread with the entries it visited since its last call, before the directories found among them are walked
+        typedef std::function<void(size_t threadIndex)> Flusher;
+
+        explicit ParallelTreeWalker(size_t nbThreads = defaultThreadCount(), size_t batchSize = 256);
+
+        inline size_t nbThreads() const { return _nbThreads; }
+        static size_t defaultThreadCount();
+
+        /** The directories that cannot be read because of their permissions or because they have been deleted are skipped.
+         * @return false if another error occurred, or if the walk has been stopped.
+         */
+        bool walk(const SyncPath &rootPath, const Visitor &visitor, const Flusher &flush,
+                  const std::function<bool()> &stopAsked = nullptr);
+
+        inline int error() const { return _error; }  // errno of the first error
+        inline const SyncPath &errorPath() const { return _errorPath; }
+        inline uint64_t nbDirectories() const { return _nbDirectories; }
+        inline uint64_t nbSteals() const { return _nbSteals; }
+
+    private:
+        struct Directory {
+                SyncPath path;
+                uint64_t inode = 0;
+        };
+
+        struct WorkQueue {
+                std::mutex mutex;
+                std::deque<Directory> directories;  // The owner takes from the back, the other threads from the front
+        };
+
+        size_t _nbThreads;
+        size_t _batchSize;
+
+        const Visitor *_visitor = nullptr;
+        const Flusher *_flush = nullptr;
+        const std::function<bool()> *_stopAsked = nullptr;
+
+        std::vector<WorkQueue> _queues;
+        // Directories found and not yet walked, published or not
+        std::atomic<uint64_t> _nbPendingDirectories = 0;
+        std::atomic<bool> _done = false;
+        std::mutex _idleMutex;
+        std::condition_variable _workAvailable;
+
+        std::mutex _errorMutex;
+        int _error = 0;
+        SyncPath _errorPath;
+
+        std::atomic<uint64_t> _nbDirectories = 0;
+        std::atomic<uint64_t> _nbSteals = 0;
+
+        void run(size_t threadIndex);
+        bool take(size_t threadIndex, Directory &directory);
+        void publish(size_t threadIndex, std::vector<Directory> &directories);
+        // Returns the number of entries visited
+        size_t walkDirectory(const Directory &directory, size_t threadIndex, std::vector<Directory> &subDirectories);
+        void setError(int error, const SyncPath &path);
+};
+
+}  // namespace KDC
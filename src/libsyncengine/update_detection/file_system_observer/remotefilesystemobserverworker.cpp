@@ -41,6 +41,7 @@
 #include <Poco/JSON/Array.h>
 #include <Poco/Dynamic/Var.h>
 
+#include <algorithm>
 #include <queue>
 
 namespace KDC {
@@ -62,6 +63,7 @@ void RemoteFileSystemObserverWorker::execute() {
     for (;;) {
         if (stopAsked()) {
             exitCode = ExitCodeOk;
+            saveSnapshot(_cursor);
             invalidateSnapshot();
             break;
         }
@@ -95,6 +97,20 @@ ExitCode RemoteFileSystemObserverWorker::generateInitialSnapshot() {
     _snapshot->init();
     _updating = true;
 
+    SnapshotFile::Metadata metadata;
+    if (restoreSnapshot(metadata)) {
+        int64_t timestamp = 0;
+        if (_syncPal->listingCursor(_cursor, timestamp) == ExitCodeOk && !_cursor.empty() && _cursor == metadata.cursor) {
+            // Brought up to date by a listing/continue request sent right away (_updating is kept), no listing/full needed
+            _snapshot->setValid(true);
+            _snapshotRestored = true;
+            return ExitCodeOk;
+        }
+
+        LOG_SYNCPAL_INFO(_logger, "Saved remote snapshot does not match the listing cursor");
+        _snapshot->init();
+    }
+
     {
         auto listingFullTimerEnd = std::chrono::steady_clock::now();
         std::chrono::duration<double> elapsedTime = listingFullTimerEnd - _listingFullTimer;
@@ -253,11 +269,35 @@ ExitCode RemoteFileSystemObserverWorker::processEvents() {
         }
     }
 
+    if (_snapshotRestored && exitCode != ExitCodeOk) {
+        // The saved cursor may have expired
+        LOG_SYNCPAL_WARN(_logger, "Unable to update the restored remote snapshot, a full listing is needed");
+        invalidateSnapshot();
+    }
+    _snapshotRestored = false;
+
     _updating = false;
 
     return ExitCodeOk;
 }
 
+std::string RemoteFileSystemObserverWorker::snapshotConsistencyToken() {
+    // The listing depends on the black list and on the exclusion templates
+    std::unordered_set<NodeId> blackList;
+    SyncNodeCache::instance()->syncNodes(_syncPal->syncDbId(), SyncNodeTypeBlackList, blackList);
+    std::vector<std::string> parts(blackList.begin(), blackList.end());
+    std::sort(parts.begin(), parts.end());
+    for (const auto &exclusionTemplate : ExclusionTemplateCache::instance()->exclusionTemplates()) {
+        parts.push_back(exclusionTemplate.templ());
+    }
+
+    std::string token = std::to_string(_driveDbId);
+    for (const auto &part : parts) {
+        token.append("\n").append(part);
+    }
+    return std::to_string(SnapshotFile::hash(token.data(), token.size()));
+}
+
 ExitCode RemoteFileSystemObserverWorker::initWithCursor() {
     if (stopAsked()) {
         return ExitCodeOk;
@@ -291,9 +331,84 @@ ExitCode RemoteFileSystemObserverWorker::getItemsInDir(const NodeId &dirId, cons
         return ExitCodeDataError;
     }
 
+    // The reply is parsed while it is received, the items are inserted in the snapshot by batches
+    std::unordered_set<SyncName> existingFiles;
+    uint64_t itemCount = 0;
+    job->setItemsCallback([this, &existingFiles, &itemCount](std::span<SnapshotItem> items, bool newReply) {
+        if (newReply) {
+            // The request has been retried
+            existingFiles.clear();
+        }
+
+        if (stopAsked()) {
+            return false;
+        }
+
+        itemCount += items.size();
+
+        // Move the accepted items to the front of the batch
+        size_t nbAccepted = 0;
+        for (size_t i = 0; i < items.size(); i++) {
+            SnapshotItem &item = items[i];
+
+            bool isWarning = false;
+            if (ExclusionTemplateCache::instance()->isExcludedByTemplate(item.name(), isWarning)) {
+                continue;
+            }
+
+            // Check unsupported characters
+            if (hasUnsupportedCharacters(item.name(), item.id(), item.type())) {
+                continue;
+            }
+
+            auto insertInfo = existingFiles.insert(Str2SyncName(item.parentId()) + item.name());
+            if (!insertInfo.second) {
+                // Item with exact same name already exist in parent folder
+                LOGW_SYNCPAL_DEBUG(Log::instance()->getLogger(),
+                                   L"Item \"" << SyncName2WStr(item.name()).c_str() << L"\" already exist in directory \""
+                                              << SyncName2WStr(_snapshot->name(item.parentId())).c_str() << L"\"");
+
+                SyncPath path;
+                _snapshot->path(item.parentId(), path);
+                path /= item.name();
+
+                Error err(_syncPal->syncDbId(), "", item.id(), NodeTypeDirectory, path, ConflictTypeNone, InconsistencyTypeNone,
+                          CancelTypeAlreadyExistLocal);
+                _syncPal->addError(err);
+
+                continue;
+            }
+
+            if (ParametersCache::isExtendedLogEnabled()) {
+                LOGW_SYNCPAL_DEBUG(_logger, L"Item inserted in remote snapshot: name:"
+                                                << SyncName2WStr(item.name()).c_str() << L", inode:"
+                                                << Utility::s2ws(item.id()).c_str() << L", parent inode:"
+                                                << Utility::s2ws(item.parentId()).c_str() << L", createdAt:" << item.createdAt()
+                                                << L", modtime:" << item.lastModified() << L", isDir:"
+                                                << (item.type() == NodeTypeDirectory) << L", size:" << item.size());
+            }
+
+            if (i != nbAccepted) {
+                std::swap(items[nbAccepted], item);
+            }
+            nbAccepted++;
+        }
+
+        _snapshot->updateItems(items.first(nbAccepted));
+        return true;
+    });
+
+    LOG_SYNCPAL_DEBUG(_logger, "Begin reply parsing");
+    auto start = std::chrono::steady_clock::now();
+
     JobManager::instance()->queueAsyncJob(job, Poco::Thread::PRIO_HIGHEST);
     while (!JobManager::instance()->isJobFinished(job->jobId())) {
         if (stopAsked()) {
+            // Wait for the job to stop, the items callback must not be called after return
+            job->abort();
+            while (!JobManager::instance()->isJobFinished(job->jobId())) {
+                Utility::msleep(10);
+            }
             return ExitCodeOk;
         }
 
@@ -301,6 +416,10 @@ ExitCode RemoteFileSystemObserverWorker::getItemsInDir(const NodeId &dirId, cons
         Utility::msleep(100);
     }
 
+    if (stopAsked()) {
+        return ExitCodeOk;
+    }
+
     if (job->exitCode() != ExitCodeOk) {
         LOG_SYNCPAL_WARN(_logger, "Error in GetFileListWithCursorJob::runSynchronously : " << job->exitCode());
         setExitCause(job->getExitCause());
@@ -322,84 +441,10 @@ ExitCode RemoteFileSystemObserverWorker::getItemsInDir(const NodeId &dirId, cons
         }
     }
 
-    // Parse reply
-    LOG_SYNCPAL_DEBUG(_logger, "Begin reply parsing");
-    auto start = std::chrono::steady_clock::now();
-    SnapshotItem item;
-    bool error = false;
-    bool ignore = false;
-    std::unordered_set<SyncName> existingFiles;
-    uint64_t itemCount = 0;
-    while (job->getItem(item, error, ignore)) {
-        if (ignore) {
-            continue;
-        }
-
-        itemCount++;
-
-        if (error) {
-            LOG_SYNCPAL_WARN(_logger, "Failed to parse CSV reply");
-            setExitCause(ExitCauseUnknown);
-            return ExitCodeDataError;
-        }
-
-        if (stopAsked()) {
-            return ExitCodeOk;
-        }
-
-        bool isWarning = false;
-        if (ExclusionTemplateCache::instance()->isExcludedByTemplate(item.name(), isWarning)) {
-            continue;
-        }
-
-        // Check unsupported characters
-        if (hasUnsupportedCharacters(item.name(), item.id(), item.type())) {
-            continue;
-        }
-
-        auto insertInfo = existingFiles.insert(Str2SyncName(item.parentId()) + item.name());
-        if (!insertInfo.second) {
-            // Item with exact same name already exist in parent folder
-            LOGW_SYNCPAL_DEBUG(Log::instance()->getLogger(),
-                               L"Item \"" << SyncName2WStr(item.name()).c_str() << L"\" already exist in directory \""
-                                          << SyncName2WStr(_snapshot->name(item.parentId())).c_str() << L"\"");
-
-            SyncPath path;
-            _snapshot->path(item.parentId(), path);
-            path /= item.name();
-
-            Error err(_syncPal->syncDbId(), "", item.id(), NodeTypeDirectory, path, ConflictTypeNone, InconsistencyTypeNone,
-                      CancelTypeAlreadyExistLocal);
-            _syncPal->addError(err);
-
-            continue;
-        }
-
-        if (_snapshot->updateItem(item)) {
-            if (ParametersCache::isExtendedLogEnabled()) {
-                LOGW_SYNCPAL_DEBUG(_logger, L"Item inserted in remote snapshot: name:"
-                                                << SyncName2WStr(item.name()).c_str() << L", inode:"
-                                                << Utility::s2ws(item.id()).c_str() << L", parent inode:"
-                                                << Utility::s2ws(item.parentId()).c_str() << L", createdAt:" << item.createdAt()
-                                                << L", modtime:" << item.lastModified() << L", isDir:"
-                                                << (item.type() == NodeTypeDirectory) << L", size:" << item.size());
-            }
-        }
-    }
-
     // Delete orphans
-    std::unordered_set<NodeId> nodeIds;
-    _snapshot->ids(nodeIds);
-    auto nodeIdIt = nodeIds.begin();
-    while (nodeIdIt != nodeIds.end()) {
-        if (_snapshot->isOrphan(*nodeIdIt)) {
-            LOGW_SYNCPAL_DEBUG(_logger, L"Node '" << SyncName2WStr(_snapshot->name(*nodeIdIt)).c_str() << L"' ("
-                                                  << Utility::s2ws(*nodeIdIt).c_str() << L") is orphan. Removing it from "
-                                                  << Utility::s2ws(Utility::side2Str(_snapshot->side())).c_str()
-                                                  << L" snapshot.");
-            _snapshot->removeItem(*nodeIdIt);
-        }
-        nodeIdIt++;
+    const uint64_t nbOrphans = _snapshot->removeOrphans();
+    if (nbOrphans > 0) {
+        LOG_SYNCPAL_DEBUG(_logger, nbOrphans << " orphan items removed from remote snapshot");
     }
 
     std::chrono::duration<double> elapsed_seconds = std::chrono::steady_clock::now() - start;
@@ -486,6 +531,8 @@ ExitCode RemoteFileSystemObserverWorker::processActions(Poco::JSON::Array::Ptr a
 
     for (auto it = actionArray->begin(); it != actionArray->end(); ++it) {
         if (stopAsked()) {
+            // The cursor is already past these actions, the snapshot must not be saved
+            invalidateSnapshot();
             return ExitCodeOk;
         }
 
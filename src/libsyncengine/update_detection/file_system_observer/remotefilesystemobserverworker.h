@@ -38,6 +38,7 @@ class RemoteFileSystemObserverWorker : public FileSystemObserverWorker {
         virtual ExitCode generateInitialSnapshot() override;
         virtual ExitCode processEvents() override;
         virtual ReplicaSide getSnapshotType() const override { return ReplicaSide::ReplicaSideRemote; }
+        virtual std::string snapshotConsistencyToken() override;
 
         ExitCode initWithCursor();
         ExitCode exploreDirectory(const NodeId &nodeId);
@@ -68,6 +69,8 @@ class RemoteFileSystemObserverWorker : public FileSystemObserverWorker {
 
         int _driveDbId = -1;
         std::string _cursor;
+        // The snapshot has been restored and not yet brought up to date from its cursor
+        bool _snapshotRestored = false;
 
         int _listingFullCounter = 0;
         std::chrono::steady_clock::time_point _listingFullTimer = std::chrono::steady_clock::now();
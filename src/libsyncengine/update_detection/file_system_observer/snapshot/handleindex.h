@@ -0,0 +1,176 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace KDC {
+
+/**
+ * Hash index of 32-bit handles.
+ * The keys are not stored: the caller provides the hash of the key and an equality predicate that resolves a handle
+ * back to its key. The index is split into shards so that a rehash only ever touches a fraction of the entries.
+ * Shards are shared between copies of the index and are only duplicated when a copy modifies them (copy-on-write).
+ */
+class HandleIndex {
+    public:
+        typedef uint32_t Handle;
+        static constexpr Handle invalidHandle = UINT32_MAX;
+
+        void clear() {
+            for (auto &shard : _shards) {
+                shard.reset();
+            }
+            _size = 0;
+        }
+
+        inline uint64_t size() const { return _size; }
+
+        template <class Equal>
+        Handle find(uint32_t hash, Equal equal) const {
+            const Shard *shard = _shards[shardIndex(hash)].get();
+            if (!shard) {
+                return invalidHandle;
+            }
+
+            const uint32_t mask = static_cast<uint32_t>(shard->slots.size()) - 1;
+            for (uint32_t pos = hash & mask;; pos = (pos + 1) & mask) {
+                const Slot &slot = shard->slots[pos];
+                if (slot.handle == invalidHandle) {
+                    return invalidHandle;
+                }
+                if (slot.hash == hash && equal(slot.handle)) {
+                    return slot.handle;
+                }
+            }
+        }
+
+        void insert(uint32_t hash, Handle handle) {
+            Shard &shard = mutableShard(shardIndex(hash));
+            if ((shard.count + 1) * 4 > shard.slots.size() * 3) {
+                grow(shard);
+            }
+            insertSlot(shard, Slot{hash, handle});
+            shard.count++;
+            _size++;
+        }
+
+        bool erase(uint32_t hash, Handle handle) {
+            if (!_shards[shardIndex(hash)]) {
+                return false;
+            }
+
+            Shard &shard = mutableShard(shardIndex(hash));
+            const uint32_t mask = static_cast<uint32_t>(shard.slots.size()) - 1;
+            uint32_t pos = hash & mask;
+            for (;; pos = (pos + 1) & mask) {
+                const Slot &slot = shard.slots[pos];
+                if (slot.handle == invalidHandle) {
+                    return false;
+                }
+                if (slot.handle == handle) {
+                    break;
+                }
+            }
+
+            // Backward shift deletion: no tombstones are left behind
+            uint32_t next = pos;
+            while (true) {
+                next = (next + 1) & mask;
+                const Slot &slot = shard.slots[next];
+                if (slot.handle == invalidHandle) {
+                    break;
+                }
+                const uint32_t home = slot.hash & mask;
+                const bool movable = pos <= next ? (home <= pos || home > next) : (home <= pos && home > next);
+                if (movable) {
+                    shard.slots[pos] = slot;
+                    pos = next;
+                }
+            }
+            shard.slots[pos] = Slot();
+            shard.count--;
+            _size--;
+            return true;
+        }
+
+        uint64_t memoryUsage() const {
+            uint64_t ret = sizeof(*this);
+            for (const auto &shard : _shards) {
+                if (shard) {
+                    ret += sizeof(Shard) + shard->slots.capacity() * sizeof(Slot);
+                }
+            }
+            return ret;
+        }
+
+    private:
+        static constexpr uint32_t shardBits = 6;
+        static constexpr uint32_t minShardCapacity = 16;
+
+        struct Slot {
+                uint32_t hash = 0;
+                Handle handle = invalidHandle;
+        };
+
+        struct Shard {
+                std::vector<Slot> slots;
+                uint32_t count = 0;
+        };
+
+        static inline uint32_t shardIndex(uint32_t hash) { return hash >> (32 - shardBits); }
+
+        Shard &mutableShard(uint32_t index) {
+            std::shared_ptr<Shard> &shard = _shards[index];
+            if (!shard) {
+                shard = std::make_shared<Shard>();
+            } else if (shard.use_count() > 1) {
+                shard = std::make_shared<Shard>(*shard);
+            }
+            return *shard;
+        }
+
+        static void insertSlot(Shard &shard, const Slot &newSlot) {
+            const uint32_t mask = static_cast<uint32_t>(shard.slots.size()) - 1;
+            uint32_t pos = newSlot.hash & mask;
+            while (shard.slots[pos].handle != invalidHandle) {
+                pos = (pos + 1) & mask;
+            }
+            shard.slots[pos] = newSlot;
+        }
+
+        static void grow(Shard &shard) {
+            std::vector<Slot> oldSlots;
+            oldSlots.swap(shard.slots);
+            shard.slots.resize(oldSlots.empty() ? minShardCapacity : oldSlots.size() * 2);
+            for (const Slot &slot : oldSlots) {
+                if (slot.handle != invalidHandle) {
+                    insertSlot(shard, slot);
+                }
+            }
+        }
+
+        std::array<std::shared_ptr<Shard>, 1 << shardBits> _shards;
+        uint64_t _size = 0;
+};
+
+}  // namespace KDC
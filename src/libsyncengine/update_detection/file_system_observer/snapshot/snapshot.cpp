@@ -18,25 +18,30 @@
 
 #include "snapshot.h"
 #include "libcommonserver/log/log.h"
+#include "libcommonserver/utility/utility.h"
 #include "requests/parameterscache.h"
 
+#include <chrono>
 #include <filesystem>
 #include <queue>
 #include <vector>
 #include <clocale>
+#include <cstring>
 
 #include <log4cplus/loggingmacros.h>
 
+#define MAX_DIRTY_IDS 100000
+
 namespace KDC {
 
 Snapshot::Snapshot(ReplicaSide side, const DbNode &dbNode)
     : _side(side),
       _rootFolderId(side == ReplicaSide::ReplicaSideLocal ? dbNode.nodeIdLocal().value() : dbNode.nodeIdRemote().value()) {
-    _items.insert({_rootFolderId, SnapshotItem(_rootFolderId)});
+    _rootHandle = _store.insert(_rootFolderId);
 }
 
 Snapshot::~Snapshot() {
-    _items.clear();
+    _store.clear();
 }
 
 Snapshot &Snapshot::operator=(Snapshot &other) {
@@ -44,28 +49,68 @@ Snapshot &Snapshot::operator=(Snapshot &other) {
         const std::scoped_lock lock(_mutex, other._mutex);
 
         assert(_side == other._side);
-        assert(_rootFolderId == other._rootFolderId);
 
-        _items = other._items;
+        // The store pages are shared, not copied
+        _store = other._store;
+        _rootFolderId = other._rootFolderId;
+        _rootHandle = other._rootHandle;
         _isValid = other._isValid;
+
+        // The changes made to the source snapshot so far are captured by this version
+        other.startRead();
+
+        // Changes that this version has not synced yet stay in its journal
+        if (_dirtyIdsComplete && other._dirtyIdsComplete && _dirtyIds.size() + other._dirtyIds.size() <= MAX_DIRTY_IDS) {
+            _dirtyIds.merge(other._dirtyIds);
+        } else {
+            _dirtyIds.clear();
+            _dirtyIdsComplete = false;
+        }
+        other._dirtyIds.clear();
+        other._dirtyIdsComplete = true;
     }
 
     return *this;
 }
 
 void Snapshot::init() {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = writeLock();
     startUpdate();
 
-    _items.clear();
-    _items.insert({_rootFolderId, SnapshotItem(_rootFolderId)});
+    _store.clear();
+    _rootHandle = _store.insert(_rootFolderId);
 
     _isValid = false;
+    _dirtyIds.clear();
+    _dirtyIdsComplete = false;
+}
+
+void Snapshot::setRootFolderId(const NodeId &nodeId) {
+    const auto lock = writeLock();
+    _rootFolderId = nodeId;
+    _rootHandle = _store.insert(_rootFolderId);
+    _dirtyIds.clear();
+    _dirtyIdsComplete = false;
 }
 
 bool Snapshot::updateItem(const SnapshotItem &newItem) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = writeLock();
+    return updateItemUnlocked(newItem);
+}
+
+uint64_t Snapshot::updateItems(std::span<const SnapshotItem> items) {
+    const auto lock = writeLock();
+
+    uint64_t nbUpdated = 0;
+    for (const SnapshotItem &item : items) {
+        if (updateItemUnlocked(item)) {
+            nbUpdated++;
+        }
+    }
+    return nbUpdated;
+}
 
+bool Snapshot::updateItemUnlocked(const SnapshotItem &newItem) {
     if (newItem.parentId().empty()) {
         LOG_WARN(Log::instance()->getLogger(), "Parent ID is empty for item " << newItem.id().c_str());
         assert(false);
@@ -78,37 +123,34 @@ bool Snapshot::updateItem(const SnapshotItem &newItem) {
         return false;
     }
 
-    SnapshotItem &prevItem = _items[newItem.id()];
+    const bool isNew = _store.find(newItem.id()) == SnapshotStore::invalidHandle;
+    const Handle handle = _store.insert(newItem.id());
+
+    // Update item (before linking it, so that a new item is indexed once under its name)
+    _store.setAttributes(handle, newItem);
 
     // Update parent's children lists
     bool parentChanged = false;
-    if (prevItem.id() != _rootFolderId && prevItem.parentId() != newItem.parentId()) {
-        parentChanged = true;
-
-        // Remove children from previous parent
-        auto itParent = _items.find(prevItem.parentId());
-        if (itParent != _items.end()) {
-            itParent->second.removeChildren(newItem.id());
-        }
+    if (handle != _rootHandle) {
+        Handle parentHandle = _store.find(newItem.parentId());
+        if (isNew || _store.parent(handle) != parentHandle || parentHandle == SnapshotStore::invalidHandle) {
+            parentChanged = true;
+
+            if (parentHandle == SnapshotStore::invalidHandle) {
+                // New parent not found, create it
+                LOG_DEBUG(Log::instance()->getLogger(),
+                          "Parent " << newItem.parentId().c_str() << " does not exist yet, creating it");
+                parentHandle = _store.insert(newItem.parentId());
+            }
 
-        // Add children to new parent
-        itParent = _items.find(newItem.parentId());
-        if (itParent == _items.end()) {
-            // New parent not found, create it
-            LOG_DEBUG(Log::instance()->getLogger(),
-                      "Parent " << newItem.parentId().c_str() << " does not exist yet, creating it");
-            itParent = _items.insert({newItem.parentId(), SnapshotItem(newItem.parentId())}).first;
+            _store.setParent(handle, parentHandle);
         }
-
-        itParent->second.addChildren(newItem.id());
     }
 
-    // Update item
-    _items[newItem.id()] = newItem;
-
-    if (parentChanged || !isOrphan(newItem.id())) {
+    if (parentChanged || !isOrphan(handle)) {
         startUpdate();
     }
+    markDirty(newItem.id());
 
     if (ParametersCache::isExtendedLogEnabled()) {
         LOGW_DEBUG(Log::instance()->getLogger(), L"Item: " << SyncName2WStr(newItem.name()).c_str() << L" ("
@@ -120,32 +162,28 @@ bool Snapshot::updateItem(const SnapshotItem &newItem) {
 }
 
 bool Snapshot::removeItem(const NodeId &id) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = writeLock();
 
     if (id.empty()) {
         assert(false);
         return false;
     }
 
-    auto it = _items.find(id);
-    if (it == _items.end()) {
+    const Handle handle = _store.find(id);
+    if (handle == SnapshotStore::invalidHandle) {
         return true;  // Nothing to delete
     }
 
-    if (!isOrphan(id)) {
+    if (!isOrphan(handle)) {
         startUpdate();
     }
+    markDirty(id);
 
     // First remove all children
-    removeChildrenRecursively(id);
-
-    // Remove it also from its parent's children
-    auto parentIt = _items.find(it->second.parentId());
-    if (parentIt != _items.end()) {
-        parentIt->second.removeChildren(id);
-    }
+    removeChildrenRecursively(handle);
 
-    _items.erase(id);
+    // Then the item itself, which also removes it from its parent's children
+    _store.erase(handle);
 
     if (ParametersCache::isExtendedLogEnabled()) {
         LOG_DEBUG(Log::instance()->getLogger(), "Item " << id.c_str() << "removed from remote snapshot.");
@@ -155,53 +193,31 @@ bool Snapshot::removeItem(const NodeId &id) {
 }
 
 NodeId Snapshot::itemId(const SyncPath &path) {
-    const std::scoped_lock lock(_mutex);
-
-    NodeId ret;
-    auto itemIt = _items.find(_rootFolderId);
-
-    for (auto pathIt = path.begin(); pathIt != path.end(); pathIt++) {
-        if (pathIt->native() == Str("/")) {
-            continue;
-        }
-
-        bool idFound = false;
-        for (const NodeId &childId : itemIt->second.childrenIds()) {
-            if (name(childId) == *pathIt) {
-                itemIt = _items.find(childId);
-                ret = childId;
-                idFound = true;
-                break;
-            }
-        }
-
-        if (!idFound) {
-            return "";
-        }
-    }
-
-    return ret;
+    const auto lock = readLock();
+    const Handle handle = handleFromPath(path);
+    return handle == _rootHandle || handle == SnapshotStore::invalidHandle ? NodeId() : _store.id(handle);
 }
 
 NodeId Snapshot::parentId(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     NodeId ret;
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        ret = it->second.parentId();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle && _store.parent(handle) != SnapshotStore::invalidHandle) {
+        ret = _store.id(_store.parent(handle));
     }
     return ret;
 }
 
 bool Snapshot::setParentId(const NodeId &itemId, const NodeId &newParentId) {
-    const std::scoped_lock lock(_mutex);
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        it->second.setParentId(newParentId);
+    const auto lock = writeLock();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        _store.setParent(handle, newParentId.empty() ? SnapshotStore::invalidHandle : _store.insert(newParentId));
 
-        if (!isOrphan(itemId)) {
+        if (!isOrphan(handle)) {
             startUpdate();
         }
+        markDirty(itemId);
         return true;
     }
 
@@ -209,18 +225,17 @@ bool Snapshot::setParentId(const NodeId &itemId, const NodeId &newParentId) {
 }
 
 bool Snapshot::path(const NodeId &itemId, SyncPath &path) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     bool ok = true;
     std::deque<SyncName> names;
 
     bool parentIsRoot = false;
-    NodeId id = itemId;
+    Handle handle = _store.find(itemId);
     while (!parentIsRoot) {
-        auto it = _items.find(id);
-        if (it != _items.end()) {
-            names.push_back(it->second.name());
-            id = it->second.parentId();
-            parentIsRoot = id == _rootFolderId;
+        if (handle != SnapshotStore::invalidHandle) {
+            names.push_back(_store.name(handle));
+            handle = _store.parent(handle);
+            parentIsRoot = handle == _rootHandle;
             continue;
         }
 
@@ -236,272 +251,550 @@ bool Snapshot::path(const NodeId &itemId, SyncPath &path) {
         tmp.append(Str("/"));
         names.pop_back();
     }
-    tmp.pop_back();  // Remove the last '/'
+    if (!tmp.empty()) {
+        tmp.pop_back();  // Remove the last '/'
+    }
     path = tmp;
 
     return ok;
 }
 
 SyncName Snapshot::name(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     SyncName ret;
 
-    if (const auto it = _items.find(itemId); it != _items.cend()) {
-        ret = it->second.name();
+    if (const Handle handle = _store.find(itemId); handle != SnapshotStore::invalidHandle) {
+        ret = _store.name(handle);
     }
 
     return ret;
 }
 
 bool Snapshot::setName(const NodeId &itemId, const SyncName &newName) {
-    const std::scoped_lock lock(_mutex);
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        it->second.setName(newName);
+    const auto lock = writeLock();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        _store.setName(handle, newName);
 
-        if (!isOrphan(itemId)) {
+        if (!isOrphan(handle)) {
             startUpdate();
         }
+        markDirty(itemId);
         return true;
     }
     return false;
 }
 
 SyncTime Snapshot::createdAt(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     SyncTime ret = 0;
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        ret = it->second.createdAt();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        ret = _store.createdAt(handle);
     }
     return ret;
 }
 
 bool Snapshot::setCreatedAt(const NodeId &itemId, SyncTime newTime) {
-    const std::scoped_lock lock(_mutex);
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        it->second.setCreatedAt(newTime);
+    const auto lock = writeLock();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        _store.setCreatedAt(handle, newTime);
 
-        if (!isOrphan(itemId)) {
+        if (!isOrphan(handle)) {
             startUpdate();
         }
+        markDirty(itemId);
         return true;
     }
     return false;
 }
 
 SyncTime Snapshot::lastModified(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     SyncTime ret = 0;
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        ret = it->second.lastModified();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        ret = _store.lastModified(handle);
     }
     return ret;
 }
 
 bool Snapshot::setLastModified(const NodeId &itemId, SyncTime newTime) {
-    const std::scoped_lock lock(_mutex);
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        it->second.setLastModified(newTime);
+    const auto lock = writeLock();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        _store.setLastModified(handle, newTime);
 
-        if (!isOrphan(itemId)) {
+        if (!isOrphan(handle)) {
             startUpdate();
         }
+        markDirty(itemId);
         return true;
     }
     return false;
 }
 
 NodeType Snapshot::type(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     NodeType ret = NodeTypeUnknown;
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        ret = it->second.type();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        ret = _store.type(handle);
     }
     return ret;
 }
 
 int64_t Snapshot::size(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
-    int64_t ret = 0;
-    if (type(itemId) == NodeTypeDirectory) {
-        std::unordered_set<NodeId> childrenIds;
-        getChildrenIds(itemId, childrenIds);
-        for (auto &childId : childrenIds) {
-            ret += size(childId);
-        }
-    } else {
-        auto it = _items.find(itemId);
-        if (it != _items.end()) {
-            ret = it->second.size();
-        }
+    const auto lock = readLock();
+    const Handle handle = _store.find(itemId);
+    if (handle == SnapshotStore::invalidHandle) {
+        return 0;
     }
-    return ret;
+    return _store.subtreeSize(handle);
+}
+
+uint64_t Snapshot::nbFiles(const NodeId &itemId) {
+    const auto lock = readLock();
+    const Handle handle = _store.find(itemId);
+    if (handle == SnapshotStore::invalidHandle) {
+        return 0;
+    }
+    return _store.subtreeNbFiles(handle);
 }
 
 std::string Snapshot::contentChecksum(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     std::string ret;
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        ret = it->second.contentChecksum();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        ret = _store.contentChecksum(handle);
     }
     return ret;
 }
 
 bool Snapshot::setContentChecksum(const NodeId &itemId, const std::string &newChecksum) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = writeLock();
     // Note: do not call "startUpdate" here since the computation of content checksum is asynchronous
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        it->second.setContentChecksum(newChecksum);
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        _store.setContentChecksum(handle, newChecksum);
         return true;
     }
     return false;
 }
 
 bool Snapshot::canWrite(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     bool ret = true;
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        ret = it->second.canWrite();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        ret = _store.canWrite(handle);
     }
     return ret;
 }
 
 bool Snapshot::canShare(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     bool ret = true;
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        ret = it->second.canShare();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        ret = _store.canShare(handle);
     }
     return ret;
 }
 
 bool Snapshot::clearContentChecksum(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
-    return setContentChecksum(itemId, "");
-}
-
-bool Snapshot::exists(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
-    auto it = _items.find(itemId);
-    if (it != _items.end() && !isOrphan(itemId)) {
+    const auto lock = writeLock();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        _store.setContentChecksum(handle, "");
         return true;
     }
     return false;
 }
 
+bool Snapshot::exists(const NodeId &itemId) {
+    const auto lock = readLock();
+    const Handle handle = _store.find(itemId);
+    return handle != SnapshotStore::invalidHandle && !isOrphan(handle);
+}
+
 bool Snapshot::pathExists(const SyncPath &path) {
-    const std::scoped_lock lock(_mutex);
-    return !itemId(path).empty();
+    const auto lock = readLock();
+    const Handle handle = handleFromPath(path);
+    return handle != _rootHandle && handle != SnapshotStore::invalidHandle;
 }
 
 bool Snapshot::isLink(const NodeId &itemId) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     bool ret = false;
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        ret = it->second.isLink();
+    const Handle handle = _store.find(itemId);
+    if (handle != SnapshotStore::invalidHandle) {
+        ret = _store.isLink(handle);
     }
     return ret;
 }
 
 bool Snapshot::getChildrenIds(const NodeId &itemId, std::unordered_set<NodeId> &childrenIds) {
-    const std::scoped_lock lock(_mutex);
-    auto it = _items.find(itemId);
-    if (it != _items.end()) {
-        childrenIds = it->second.childrenIds();
-        return true;
+    const auto lock = readLock();
+    const Handle handle = _store.find(itemId);
+    if (handle == SnapshotStore::invalidHandle) {
+        return false;
     }
-    return false;
+
+    childrenIds.clear();
+    childrenIds.reserve(_store.nbChildren(handle));
+    for (Handle child = _store.firstChild(handle); child != SnapshotStore::invalidHandle; child = _store.nextSibling(child)) {
+        childrenIds.insert(_store.id(child));
+    }
+    return true;
+}
+
+bool Snapshot::getItem(const NodeId &itemId, SnapshotItem &item) {
+    const auto lock = readLock();
+    const Handle handle = _store.find(itemId);
+    if (handle == SnapshotStore::invalidHandle) {
+        return false;
+    }
+
+    const Handle parentHandle = _store.parent(handle);
+    item.setId(itemId);
+    item.setParentId(parentHandle != SnapshotStore::invalidHandle ? _store.id(parentHandle) : NodeId());
+    item.setName(_store.name(handle));
+    item.setCreatedAt(_store.createdAt(handle));
+    item.setLastModified(_store.lastModified(handle));
+    item.setType(_store.type(handle));
+    item.setSize(_store.size(handle));
+    item.setIsLink(_store.isLink(handle));
+    item.setContentChecksum(_store.contentChecksum(handle));
+    item.setCanWrite(_store.canWrite(handle));
+    item.setCanShare(_store.canShare(handle));
+    return true;
 }
 
 void Snapshot::ids(std::unordered_set<NodeId> &ids) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     ids.clear();
-    for (const auto &it : _items) {
-        ids.insert(it.first);
+    ids.reserve(_store.nbItems());
+    for (Handle handle = 0; handle < _store.handleUpperBound(); handle++) {
+        if (_store.isUsed(handle)) {
+            ids.insert(_store.id(handle));
+        }
     }
 }
 
 bool Snapshot::isAncestor(const NodeId &itemId, const NodeId &ancestorItemId) {
-    const std::scoped_lock lock(_mutex);
-    if (itemId == _rootFolderId) {
+    const auto lock = readLock();
+    Handle handle = _store.find(itemId);
+    if (handle == _rootHandle || handle == SnapshotStore::invalidHandle) {
         // Root directory cannot have any ancestor
         return false;
     }
 
-    NodeId directParentId = parentId(itemId);
-    if (directParentId == ancestorItemId) {
-        return true;
-    }
+    const Handle ancestorHandle = _store.find(ancestorItemId);
+    while (true) {
+        const Handle directParentHandle = _store.parent(handle);
+        if (directParentHandle == SnapshotStore::invalidHandle) {
+            return false;
+        }
 
-    if (directParentId == _rootFolderId) {
-        // We have reached the root directory
-        return false;
-    }
+        if (directParentHandle == ancestorHandle) {
+            return true;
+        }
 
-    return isAncestor(directParentId, ancestorItemId);
-}
+        if (directParentHandle == _rootHandle) {
+            // We have reached the root directory
+            return false;
+        }
 
-bool Snapshot::isOrphan(const NodeId &itemId) {
-    if (itemId == _rootFolderId) {
-        return false;
+        handle = directParentHandle;
     }
+}
 
-    NodeId nextParentId = parentId(itemId);
-    while (nextParentId != _rootFolderId) {
-        const NodeId tmpNextParentId = parentId(nextParentId);
-        if (tmpNextParentId.empty()) {
-            return true;
-        }
-        if (tmpNextParentId == nextParentId) {
-            // Should not happen
-            LOG_WARN(Log::instance()->getLogger(), "Parent ID equals item ID " << nextParentId.c_str());
-            assert(false);
-            break;
+bool Snapshot::isOrphan(const NodeId &itemId) {
+    const auto lock = readLock();
+    return isOrphan(_store.find(itemId));
+}
+
+uint64_t Snapshot::removeOrphans() {
+    const auto lock = writeLock();
+    const uint64_t nbItemsBefore = _store.nbItems();
+
+    // The orphans are exactly the subtrees of the detached items other than the root
+    Handle top = _store.firstDetached();
+    while (top != SnapshotStore::invalidHandle) {
+        const Handle next = _store.nextSibling(top);
+        if (top != _rootHandle) {
+            LOGW_DEBUG(Log::instance()->getLogger(), L"Node '" << SyncName2WStr(_store.name(top)).c_str() << L"' ("
+                                                               << Utility::s2ws(_store.id(top)).c_str()
+                                                               << L") is orphan. Removing it from "
+                                                               << Utility::s2ws(Utility::side2Str(_side)).c_str()
+                                                               << L" snapshot.");
+            markDirty(_store.id(top));
+            removeChildrenRecursively(top);
+            _store.erase(top);
         }
-        nextParentId = tmpNextParentId;
+        top = next;
     }
-    return false;
+
+    return nbItemsBefore - _store.nbItems();
 }
 
 bool Snapshot::isEmpty() {
-    const std::scoped_lock lock(_mutex);
-    return _items.empty();
+    const auto lock = readLock();
+    return _store.nbItems() == 0;
 }
 
 uint64_t Snapshot::nbItems() {
-    const std::scoped_lock lock(_mutex);
-    return _items.size();
+    const auto lock = readLock();
+    return _store.nbItems();
 }
 
 bool Snapshot::isValid() {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = readLock();
     return _isValid;
 }
 
 void Snapshot::setValid(bool newIsValid) {
-    const std::scoped_lock lock(_mutex);
+    const auto lock = writeLock();
     _isValid = newIsValid;
 }
 
-void Snapshot::removeChildrenRecursively(const NodeId &parentId) {
-    auto parentIt = _items.find(parentId);
-    if (parentIt == _items.end()) {
+uint64_t Snapshot::memoryUsage() {
+    const auto lock = readLock();
+    return _store.memoryUsage();
+}
+
+bool Snapshot::dirtyIds(std::unordered_set<NodeId> &ids) {
+    const auto lock = readLock();
+    ids = _dirtyIds;
+    return _dirtyIdsComplete;
+}
+
+void Snapshot::invalidateDirtyIds() {
+    const auto lock = writeLock();
+    _dirtyIds.clear();
+    _dirtyIdsComplete = false;
+}
+
+void Snapshot::clearDirtyIds() {
+    const auto lock = writeLock();
+    _dirtyIds.clear();
+    _dirtyIdsComplete = true;
+}
+
+Snapshot::LockStats Snapshot::lockStats() const {
+    LockStats stats;
+    stats.nbContendedReads = _nbContendedReads;
+    stats.nbContendedWrites = _nbContendedWrites;
+    stats.waitTimeUs = _lockWaitTimeUs;
+    return stats;
+}
+
+void Snapshot::resetLockStats() {
+    _nbContendedReads = 0;
+    _nbContendedWrites = 0;
+    _lockWaitTimeUs = 0;
+}
+
+bool Snapshot::save(const SyncPath &filePath, SnapshotFile::Metadata metadata) {
+    std::vector<SnapshotFile::Record> records;
+    std::string strings;
+    {
+        const auto lock = readLock();
+        metadata.side = _side;
+        metadata.rootFolderId = _rootFolderId;
+        records.reserve(_store.nbItems());
+
+        // Depth-first from the root, the record of an item is written before the ones of its children
+        std::vector<std::pair<Handle, uint32_t>> stack{{_rootHandle, SnapshotFile::noParent}};
+        while (!stack.empty()) {
+            const auto [handle, parentIndex] = stack.back();
+            stack.pop_back();
+
+            SnapshotFile::Record record;
+            record.parentIndex = parentIndex;
+            const std::string_view id = _store.idView(handle);
+            const SyncName name = _store.name(handle);
+            const std::string checksum = _store.contentChecksum(handle);
+            if (!SnapshotFile::appendString(strings, id.data(), id.size(), record.idOffset, record.idLength) ||
+                !SnapshotFile::appendString(strings, reinterpret_cast<const char *>(name.data()), name.size() * sizeof(SyncChar),
+                                            record.nameOffset, record.nameLength) ||
+                !SnapshotFile::appendString(strings, checksum.data(), checksum.size(), record.checksumOffset,
+                                            record.checksumLength)) {
+                LOG_WARN(Log::instance()->getLogger(), "Item " << std::string(id).c_str() << " cannot be saved");
+                return false;
+            }
+            record.createdAt = _store.createdAt(handle);
+            record.lastModified = _store.lastModified(handle);
+            record.size = _store.size(handle);
+            record.type = static_cast<uint8_t>(_store.type(handle));
+            record.flags = (_store.isLink(handle) ? SnapshotFile::RecordFlagIsLink : 0) |
+                           (_store.canWrite(handle) ? SnapshotFile::RecordFlagCanWrite : 0) |
+                           (_store.canShare(handle) ? SnapshotFile::RecordFlagCanShare : 0);
+
+            const auto index = static_cast<uint32_t>(records.size());
+            records.push_back(record);
+            for (Handle child = _store.firstChild(handle); child != SnapshotStore::invalidHandle;
+                 child = _store.nextSibling(child)) {
+                stack.emplace_back(child, index);
+            }
+        }
+    }
+
+    // The file is written without holding the lock
+    return SnapshotFile(filePath).write(metadata, records, strings);
+}
+
+bool Snapshot::load(const SyncPath &filePath, SnapshotFile::Metadata &metadata) {
+    std::vector<SnapshotFile::Record> records;
+    std::string strings;
+    const bool isRead = SnapshotFile(filePath).read(metadata, records, strings);
+
+    const auto lock = writeLock();
+    const auto clearItems = [this] {
+        startUpdate();
+        _store.clear();
+        _rootHandle = _store.insert(_rootFolderId);
+        _isValid = false;
+        _dirtyIds.clear();
+        _dirtyIdsComplete = false;
+    };
+
+    clearItems();
+    if (!isRead) {
+        return false;
+    }
+
+    if (metadata.side != _side || metadata.rootFolderId != _rootFolderId || records.empty() ||
+        std::string_view(strings.data() + records[0].idOffset, records[0].idLength) != _rootFolderId) {
+        LOG_INFO(Log::instance()->getLogger(), "Snapshot file saved from another sync");
+        return false;
+    }
+
+    // The records have been checked by SnapshotFile::read, parents come first
+    std::vector<Handle> handles(records.size(), SnapshotStore::invalidHandle);
+    handles[0] = _rootHandle;
+    for (size_t index = 1; index < records.size(); index++) {
+        const SnapshotFile::Record &record = records[index];
+        const NodeId id(strings.data() + record.idOffset, record.idLength);
+        if (_store.find(id) != SnapshotStore::invalidHandle) {
+            LOG_WARN(Log::instance()->getLogger(), "Item " << id.c_str() << " saved twice in snapshot file");
+            clearItems();
+            return false;
+        }
+
+        SyncName name(record.nameLength / sizeof(SyncChar), SyncChar());
+        memcpy(name.data(), strings.data() + record.nameOffset, record.nameLength);
+
+        SnapshotItem item(id);
+        item.setName(name);
+        item.setCreatedAt(record.createdAt);
+        item.setLastModified(record.lastModified);
+        item.setType(static_cast<NodeType>(record.type));
+        item.setSize(record.size);
+        item.setIsLink(record.flags & SnapshotFile::RecordFlagIsLink);
+        item.setContentChecksum(std::string(strings.data() + record.checksumOffset, record.checksumLength));
+        item.setCanWrite(record.flags & SnapshotFile::RecordFlagCanWrite);
+        item.setCanShare(record.flags & SnapshotFile::RecordFlagCanShare);
+
+        // Same order as updateItemUnlocked: attributes first, then linking
+        handles[index] = _store.insert(id);
+        _store.setAttributes(handles[index], item);
+        _store.setParent(handles[index], handles[record.parentIndex]);
+    }
+
+    return true;
+}
+
+std::shared_lock<std::shared_mutex> Snapshot::readLock() const {
+    std::shared_lock<std::shared_mutex> lock(_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        const auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        _nbContendedReads++;
+        _lockWaitTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    return lock;
+}
+
+std::unique_lock<std::shared_mutex> Snapshot::writeLock() {
+    std::unique_lock<std::shared_mutex> lock(_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        const auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        _nbContendedWrites++;
+        _lockWaitTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    return lock;
+}
+
+Snapshot::Handle Snapshot::handleFromPath(const SyncPath &path) const {
+    Handle handle = _rootHandle;
+    for (auto pathIt = path.begin(); pathIt != path.end() && handle != SnapshotStore::invalidHandle; pathIt++) {
+        if (pathIt->native() == Str("/")) {
+            continue;
+        }
+
+        handle = _store.findChild(handle, pathIt->native());
+    }
+    return handle;
+}
+
+bool Snapshot::isOrphan(Handle handle) const {
+    if (handle == _rootHandle) {
+        return false;
+    }
+
+    if (handle == SnapshotStore::invalidHandle) {
+        return true;
+    }
+
+    if (_store.nbDetached() == 1 && _store.parent(_rootHandle) == SnapshotStore::invalidHandle) {
+        // The root is the only item without parent, every other item is reachable from it
+        return false;
+    }
+
+    Handle nextParentHandle = _store.parent(handle);
+    while (nextParentHandle != _rootHandle) {
+        if (nextParentHandle == SnapshotStore::invalidHandle) {
+            return true;
+        }
+
+        const Handle tmpNextParentHandle = _store.parent(nextParentHandle);
+        if (tmpNextParentHandle == nextParentHandle) {
+            // Should not happen
+            LOG_WARN(Log::instance()->getLogger(), "Parent ID equals item ID " << _store.id(nextParentHandle).c_str());
+            assert(false);
+            break;
+        }
+        nextParentHandle = tmpNextParentHandle;
+    }
+    return false;
+}
+
+void Snapshot::removeChildrenRecursively(Handle parentHandle) {
+    Handle child = _store.firstChild(parentHandle);
+    while (child != SnapshotStore::invalidHandle) {
+        const Handle next = _store.nextSibling(child);
+        removeChildrenRecursively(child);
+        markDirty(_store.id(child));
+        _store.erase(child);
+        child = next;
+    }
+}
+
+void Snapshot::markDirty(const NodeId &itemId) {
+    if (!_dirtyIdsComplete) {
         return;
     }
 
-    for (const NodeId &childId : parentIt->second.childrenIds()) {
-        removeChildrenRecursively(childId);
-        _items.erase(childId);
+    _dirtyIds.insert(itemId);
+    if (_dirtyIds.size() > MAX_DIRTY_IDS) {
+        // A full comparison is cheaper than tracking that many changes
+        _dirtyIds.clear();
+        _dirtyIdsComplete = false;
     }
 }
 
@@ -19,27 +19,50 @@
 #pragma once
 
 #include "syncpal/sharedobject.h"
+#include "snapshotfile.h"
 #include "snapshotitem.h"
+#include "snapshotstore.h"
 #include "db/dbnode.h"
 
-#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
 #include <unordered_set>
 #include <vector>
-#include <mutex>
 
 namespace KDC {
 
+/**
+ * Readers (getters) share the lock and proceed in parallel, writers (setters, updateItem, removeItem...) take it exclusively.
+ */
 class Snapshot : public SharedObject {
     public:
+        /** Number of lock acquisitions that had to wait, and the total time spent waiting, since the last reset.
+         */
+        struct LockStats {
+                uint64_t nbContendedReads = 0;
+                uint64_t nbContendedWrites = 0;
+                uint64_t waitTimeUs = 0;
+        };
+
         Snapshot(ReplicaSide side, const DbNode &dbNode);
         ~Snapshot();
 
         Snapshot(Snapshot const &) = delete;
+        /** Makes this snapshot an immutable version of `other`, in constant time.
+         * The items are shared copy-on-write: later changes to either snapshot do not affect the other one.
+         * `other` is marked as read since its current changes are now captured by this version.
+         */
         Snapshot &operator=(Snapshot &other);
 
         void init();
 
         bool updateItem(const SnapshotItem &item);
+        /** Inserts or updates a batch of items under a single acquisition of the lock.
+         * @return the number of items updated, invalid items are skipped.
+         */
+        uint64_t updateItems(std::span<const SnapshotItem> items);
         bool removeItem(const NodeId &id);
 
         NodeId itemId(const SyncPath &path);
@@ -53,7 +76,12 @@ class Snapshot : public SharedObject {
         SyncTime lastModified(const NodeId &itemId);
         bool setLastModified(const NodeId &itemId, SyncTime newTime);
         NodeType type(const NodeId &itemId);
+        /** Size of a file, or total size of the files in the subtree of a directory. Constant time.
+         */
         int64_t size(const NodeId &itemId);
+        /** Number of files in the subtree of an item (1 for a file). Constant time.
+         */
+        uint64_t nbFiles(const NodeId &itemId);
         std::string contentChecksum(const NodeId &itemId);
         bool setContentChecksum(const NodeId &itemId, const std::string &newChecksum);
         bool canWrite(const NodeId &itemId);
@@ -64,6 +92,10 @@ class Snapshot : public SharedObject {
         bool isLink(const NodeId &itemId);
 
         bool getChildrenIds(const NodeId &itemId, std::unordered_set<NodeId> &childrenIds);
+        /** Gets all the attributes of an item under a single acquisition of the lock.
+         * The size of a directory is its own, not the one of its subtree.
+         */
+        bool getItem(const NodeId &itemId, SnapshotItem &item);
 
         void ids(std::unordered_set<NodeId> &ids);
         /** Checks if ancestorItem is an ancestor of item.
@@ -71,11 +103,15 @@ class Snapshot : public SharedObject {
          */
         bool isAncestor(const NodeId &itemId, const NodeId &ancestorItemId);
         bool isOrphan(const NodeId &itemId);
+        /** Removes all the items that are not reachable from the root, in a single pass over the detached subtrees.
+         * @return the number of removed items
+         */
+        uint64_t removeOrphans();
 
         inline ReplicaSide side() const { return _side; }
 
         inline NodeId rootFolderId() const { return _rootFolderId; }
-        inline void setRootFolderId(const NodeId &nodeId) { _rootFolderId = nodeId; }
+        void setRootFolderId(const NodeId &nodeId);
 
         bool isEmpty();
         uint64_t nbItems();
@@ -83,14 +119,57 @@ class Snapshot : public SharedObject {
         bool isValid();
         void setValid(bool newIsValid);
 
+        /** Estimated number of bytes used by the items of the snapshot.
+         */
+        uint64_t memoryUsage();
+
+        LockStats lockStats() const;
+        /** To be called at the end of each sync, so that the stats logged cover a single sync. */
+        void resetLockStats();
+
+        /** Writes the items reachable from the root to `filePath`, see SnapshotFile. The side and the root folder ID of the
+         * metadata are set by the snapshot.
+         */
+        bool save(const SyncPath &filePath, SnapshotFile::Metadata metadata);
+        /** Replaces the items with the ones saved in `filePath`. The snapshot stays invalid: it has to be checked against its
+         * replica before being used. The journal is incomplete.
+         * @return false if the file is missing, not valid or saved from another snapshot. The snapshot is then empty.
+         */
+        bool load(const SyncPath &filePath, SnapshotFile::Metadata &metadata);
+
+        /** IDs of the items inserted, changed or removed since the journal was last cleared, orphans included.
+         * @return false if the journal is incomplete (new snapshot, too many changes...) and a full comparison is needed.
+         */
+        bool dirtyIds(std::unordered_set<NodeId> &ids);
+        /** Forces a full comparison until the journal is cleared. */
+        void invalidateDirtyIds();
+        /** To be called once the changes listed in the journal have been synced. */
+        void clearDirtyIds();
+
     private:
-        void removeChildrenRecursively(const NodeId &parentId);
+        typedef SnapshotStore::Handle Handle;
+
+        std::shared_lock<std::shared_mutex> readLock() const;
+        std::unique_lock<std::shared_mutex> writeLock();
+
+        bool updateItemUnlocked(const SnapshotItem &item);
+        Handle handleFromPath(const SyncPath &path) const;
+        bool isOrphan(Handle handle) const;
+        void removeChildrenRecursively(Handle parentHandle);
+        void markDirty(const NodeId &itemId);
 
         ReplicaSide _side = ReplicaSideUnknown;
         NodeId _rootFolderId;
-        std::unordered_map<NodeId, SnapshotItem> _items;  // key: id
+        SnapshotStore _store;
+        Handle _rootHandle = SnapshotStore::invalidHandle;
         bool _isValid = false;
-        std::recursive_mutex _mutex;
+        // Changes not yet synced. A copy takes over the journal of its source.
+        std::unordered_set<NodeId> _dirtyIds;
+        bool _dirtyIdsComplete = false;
+        mutable std::shared_mutex _mutex;
+        mutable std::atomic<uint64_t> _nbContendedReads = 0;
+        mutable std::atomic<uint64_t> _nbContendedWrites = 0;
+        mutable std::atomic<uint64_t> _lockWaitTimeUs = 0;
 
         friend class TestSnapshot;
 };
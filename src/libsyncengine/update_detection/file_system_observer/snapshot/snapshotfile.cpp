@@ -0,0 +1,212 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshotfile.h"
+#include "libcommonserver/log/log.h"
+#include "libcommonserver/utility/utility.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <log4cplus/loggingmacros.h>
+
+#define SNAPSHOT_FILE_MAGIC "KDSNAPSH"
+#define SNAPSHOT_FILE_BYTE_ORDER 0x0102
+
+namespace KDC {
+
+namespace {
+
+struct Header {
+        char magic[8];
+        uint32_t version = 0;
+        uint16_t byteOrder = 0;
+        uint8_t charSize = 0;
+        uint8_t side = 0;
+        int64_t savedAt = 0;
+        uint64_t nbRecords = 0;
+        uint64_t stringsSize = 0;
+        uint32_t rootFolderIdLength = 0;
+        uint32_t cursorLength = 0;
+        uint32_t consistencyTokenLength = 0;
+        uint32_t reserved = 0;
+        uint64_t hash = 0;  // Of everything after the header
+};
+
+static_assert(sizeof(Header) == 64);
+static_assert(sizeof(SnapshotFile::Record) == 64);
+
+// The records start on an 8-byte boundary
+uint64_t metadataSize(const Header &header) {
+    const uint64_t size = static_cast<uint64_t>(header.rootFolderIdLength) + header.cursorLength + header.consistencyTokenLength;
+    return (size + 7) & ~static_cast<uint64_t>(7);
+}
+
+}  // namespace
+
+SnapshotFile::SnapshotFile(const SyncPath &filePath) : _filePath(filePath) {}
+
+bool SnapshotFile::write(const Metadata &metadata, const std::vector<Record> &records, const std::string &strings) {
+    Header header;
+    memcpy(header.magic, SNAPSHOT_FILE_MAGIC, sizeof(header.magic));
+    header.version = formatVersion;
+    header.byteOrder = SNAPSHOT_FILE_BYTE_ORDER;
+    header.charSize = sizeof(SyncChar);
+    header.side = static_cast<uint8_t>(metadata.side);
+    header.savedAt = metadata.savedAt;
+    header.nbRecords = records.size();
+    header.stringsSize = strings.size();
+    header.rootFolderIdLength = static_cast<uint32_t>(metadata.rootFolderId.size());
+    header.cursorLength = static_cast<uint32_t>(metadata.cursor.size());
+    header.consistencyTokenLength = static_cast<uint32_t>(metadata.consistencyToken.size());
+
+    std::string metadataBuffer = metadata.rootFolderId + metadata.cursor + metadata.consistencyToken;
+    metadataBuffer.resize(metadataSize(header), '\0');
+
+    const char *recordsData = reinterpret_cast<const char *>(records.data());
+    const size_t recordsSize = records.size() * sizeof(Record);
+    header.hash = hash(metadataBuffer.data(), metadataBuffer.size());
+    header.hash = hash(recordsData, recordsSize, header.hash);
+    header.hash = hash(strings.data(), strings.size(), header.hash);
+
+    SyncPath tmpPath(_filePath);
+    tmpPath.replace_filename(_filePath.filename().native() + Str(".tmp"));
+    {
+        std::ofstream os(tmpPath, std::ios::binary | std::ios::trunc);
+        os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        os.write(metadataBuffer.data(), metadataBuffer.size());
+        os.write(recordsData, recordsSize);
+        os.write(strings.data(), strings.size());
+        os.close();
+        if (!os) {
+            LOGW_WARN(Log::instance()->getLogger(), L"Unable to write snapshot file: " << Utility::formatSyncPath(tmpPath).c_str());
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, _filePath, ec);
+    if (ec) {
+        LOGW_WARN(Log::instance()->getLogger(), L"Unable to rename snapshot file: " << Utility::formatStdError(tmpPath, ec).c_str());
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+
+    return true;
+}
+
+bool SnapshotFile::read(Metadata &metadata, std::vector<Record> &records, std::string &strings) {
+    std::error_code ec;
+    const uint64_t fileSize = std::filesystem::file_size(_filePath, ec);
+    if (ec) {
+        return false;
+    }
+
+    std::ifstream is(_filePath, std::ios::binary);
+    Header header;
+    if (!is.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        memcmp(header.magic, SNAPSHOT_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != formatVersion ||
+        header.byteOrder != SNAPSHOT_FILE_BYTE_ORDER || header.charSize != sizeof(SyncChar)) {
+        LOGW_INFO(Log::instance()->getLogger(),
+                  L"Snapshot file with an unsupported format: " << Utility::formatSyncPath(_filePath).c_str());
+        return false;
+    }
+
+    // Checked before allocating anything
+    if (header.nbRecords > (fileSize - sizeof(header)) / sizeof(Record) ||
+        fileSize != sizeof(header) + metadataSize(header) + header.nbRecords * sizeof(Record) + header.stringsSize) {
+        LOGW_WARN(Log::instance()->getLogger(), L"Truncated snapshot file: " << Utility::formatSyncPath(_filePath).c_str());
+        return false;
+    }
+
+    std::string metadataBuffer(metadataSize(header), '\0');
+    records.resize(header.nbRecords);
+    strings.resize(header.stringsSize);
+    if (!is.read(metadataBuffer.data(), metadataBuffer.size()) ||
+        !is.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(Record)) ||
+        !is.read(strings.data(), strings.size())) {
+        LOGW_WARN(Log::instance()->getLogger(), L"Unable to read snapshot file: " << Utility::formatSyncPath(_filePath).c_str());
+        return false;
+    }
+
+    uint64_t fileHash = hash(metadataBuffer.data(), metadataBuffer.size());
+    fileHash = hash(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(Record), fileHash);
+    fileHash = hash(strings.data(), strings.size(), fileHash);
+    if (fileHash != header.hash) {
+        LOGW_WARN(Log::instance()->getLogger(), L"Corrupted snapshot file: " << Utility::formatSyncPath(_filePath).c_str());
+        return false;
+    }
+
+    // The records are used without further checks
+    for (uint64_t index = 0; index < records.size(); index++) {
+        const Record &record = records[index];
+        const bool parentValid = index == 0 ? record.parentIndex == noParent : record.parentIndex < index;
+        if (!parentValid || record.idLength == 0 || record.idOffset + record.idLength > strings.size() ||
+            record.nameOffset + record.nameLength > strings.size() || record.nameLength % sizeof(SyncChar) != 0 ||
+            record.checksumOffset + record.checksumLength > strings.size()) {
+            LOGW_WARN(Log::instance()->getLogger(),
+                      L"Invalid record in snapshot file: " << Utility::formatSyncPath(_filePath).c_str());
+            return false;
+        }
+    }
+
+    metadata.side = static_cast<ReplicaSide>(header.side);
+    metadata.rootFolderId = metadataBuffer.substr(0, header.rootFolderIdLength);
+    metadata.cursor = metadataBuffer.substr(header.rootFolderIdLength, header.cursorLength);
+    metadata.consistencyToken =
+        metadataBuffer.substr(header.rootFolderIdLength + header.cursorLength, header.consistencyTokenLength);
+    metadata.savedAt = header.savedAt;
+
+    return true;
+}
+
+void SnapshotFile::remove() {
+    std::error_code ec;
+    std::filesystem::remove(_filePath, ec);
+}
+
+bool SnapshotFile::appendString(std::string &strings, const char *data, size_t size, uint64_t &offset, uint16_t &length) {
+    if (size > UINT16_MAX) {
+        return false;
+    }
+
+    offset = strings.size();
+    length = static_cast<uint16_t>(size);
+    strings.append(data, size);
+    return true;
+}
+
+uint64_t SnapshotFile::hash(const char *data, size_t size, uint64_t seed /*= 0*/) {
+    uint64_t h = seed ^ 0xcbf29ce484222325ULL;
+    size_t index = 0;
+    for (; index + sizeof(uint64_t) <= size; index += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + index, sizeof(word));
+        h = (h ^ word) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    for (; index < size; index++) {
+        h = (h ^ static_cast<uint8_t>(data[index])) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+}  // namespace KDC
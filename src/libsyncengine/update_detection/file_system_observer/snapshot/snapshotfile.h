@@ -0,0 +1,95 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "libcommon/utility/types.h"
+
+#include <string>
+#include <vector>
+
+namespace KDC {
+
+/**
+ * File in which a Snapshot is kept between two runs of the application, next to the sync DB.
+ * Layout: a fixed-size header, the metadata strings, an array of fixed-size item records and the arena of the strings they
+ * refer to. The records are in depth-first order, a parent before its children, so that the snapshot is rebuilt in a single
+ * pass, and they can be read in place from a mapping of the file. Integers are in host byte order: a file written by another
+ * architecture, another version of the format or truncated is rejected and the snapshot is rebuilt from scratch.
+ */
+class SnapshotFile {
+    public:
+        static constexpr uint32_t formatVersion = 1;
+        static constexpr uint32_t noParent = UINT32_MAX;
+
+        struct Metadata {
+                ReplicaSide side = ReplicaSideUnknown;
+                NodeId rootFolderId;
+                std::string cursor;  // Remote listing cursor of the saved state
+                // Identifies what the saved state depends on (sync folder, black list, exclusion templates...)
+                std::string consistencyToken;
+                SyncTime savedAt = 0;
+        };
+
+        struct Record {
+                uint64_t idOffset = 0;
+                uint64_t nameOffset = 0;
+                uint64_t checksumOffset = 0;
+                int64_t createdAt = 0;
+                int64_t lastModified = 0;
+                int64_t size = 0;
+                uint32_t parentIndex = noParent;
+                uint16_t idLength = 0;
+                uint16_t nameLength = 0;  // In bytes
+                uint16_t checksumLength = 0;
+                uint8_t type = 0;
+                uint8_t flags = 0;
+                uint32_t reserved = 0;
+        };
+
+        enum RecordFlag : uint8_t {
+            RecordFlagIsLink = 1,
+            RecordFlagCanWrite = 2,
+            RecordFlagCanShare = 4
+        };
+
+        explicit SnapshotFile(const SyncPath &filePath);
+
+        inline const SyncPath &filePath() const { return _filePath; }
+
+        /** Writes to a temporary file renamed over the previous one, a reader never sees a partial file.
+         */
+        bool write(const Metadata &metadata, const std::vector<Record> &records, const std::string &strings);
+        /** Reads and checks the whole file.
+         * @return false if the file does not exist or is not valid.
+         */
+        bool read(Metadata &metadata, std::vector<Record> &records, std::string &strings);
+        void remove();
+
+        /** Appends a string to the arena.
+         * @return false if it is too long for a record.
+         */
+        static bool appendString(std::string &strings, const char *data, size_t size, uint64_t &offset, uint16_t &length);
+        /** Non-cryptographic hash of a buffer, 8 bytes at a time. */
+        static uint64_t hash(const char *data, size_t size, uint64_t seed = 0);
+
+    private:
+        SyncPath _filePath;
+};
+
+}  // namespace KDC
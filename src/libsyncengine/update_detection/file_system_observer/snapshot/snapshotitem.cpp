@@ -43,7 +43,6 @@ SnapshotItem::SnapshotItem(const SnapshotItem &other) {
 }
 
 SnapshotItem &SnapshotItem::operator=(const SnapshotItem &other) {
-    // Update all attributes but children list
     _id = other.id();
     _parentId = other.parentId();
     _name = other.name();
@@ -59,12 +58,4 @@ SnapshotItem &SnapshotItem::operator=(const SnapshotItem &other) {
     return *this;
 }
 
-void SnapshotItem::addChildren(const NodeId &id) {
-    _childrenIds.insert(id);
-}
-
-void SnapshotItem::removeChildren(const NodeId &id) {
-    _childrenIds.erase(id);
-}
-
 }  // namespace KDC
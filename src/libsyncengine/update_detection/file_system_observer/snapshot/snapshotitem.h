@@ -22,7 +22,6 @@
 #include "libcommonserver/utility/utility.h"
 
 #include <string>
-#include <unordered_set>
 
 namespace KDC {
 
@@ -38,8 +37,6 @@ class SnapshotItem {
         inline void setId(const NodeId &id) { _id = id; }
         inline const NodeId &parentId() const { return _parentId; }
         inline void setParentId(const NodeId &newParentId) { _parentId = newParentId; }
-        inline const std::unordered_set<NodeId> &childrenIds() const { return _childrenIds; }
-        inline void setChildrenIds(const std::unordered_set<NodeId> &newChildrenIds) { _childrenIds = newChildrenIds; }
         inline const SyncName &name() const { return _name; }
         inline void setName(const SyncName &newName) { _name = newName; }
         inline SyncTime createdAt() const { return _createdAt; }
@@ -60,9 +57,6 @@ class SnapshotItem {
         inline void setCanShare(bool canShare) { _canShare = canShare; }
         SnapshotItem &operator=(const SnapshotItem &other);
 
-        void addChildren(const NodeId &id);
-        void removeChildren(const NodeId &id);
-
     private:
         NodeId _id;
         NodeId _parentId;
@@ -76,8 +70,6 @@ class SnapshotItem {
         std::string _contentChecksum;
         bool _canWrite = true;
         bool _canShare = true;
-
-        std::unordered_set<NodeId> _childrenIds;
 };
 
 }  // namespace KDC
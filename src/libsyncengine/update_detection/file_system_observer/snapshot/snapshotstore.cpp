@@ -0,0 +1,398 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshotstore.h"
+#include "libcommonserver/utility/utility.h"
+
+#include <cassert>
+#include <functional>
+
+namespace KDC {
+
+static constexpr uint64_t minGarbageToCompact = 4096;
+
+SnapshotStore::Page::Page() {
+    parent.fill(invalidHandle);
+    firstChild.fill(invalidHandle);
+    nextSibling.fill(invalidHandle);
+    prevSibling.fill(invalidHandle);
+    nbChildren.fill(0);
+    nameHash.fill(0);
+    createdAt.fill(0);
+    lastModified.fill(0);
+    size.fill(0);
+    subtreeSize.fill(0);
+    subtreeNbFiles.fill(0);
+    type.fill(NodeTypeUnknown);
+    flags.fill(0);
+}
+
+void SnapshotStore::clear() {
+    _pages.clear();
+    _idIndex.clear();
+    _childIndex.clear();
+    _freeHandles.clear();
+    _firstDetached = invalidHandle;
+    _nbDetached = 0;
+    _nextHandle = 0;
+    _nbItems = 0;
+}
+
+SnapshotStore::Handle SnapshotStore::find(const NodeId &id) const {
+    return _idIndex.find(hash(id), [this, &id](Handle handle) { return idView(handle) == id; });
+}
+
+SnapshotStore::Handle SnapshotStore::insert(const NodeId &id) {
+    const uint32_t idHash = hash(id);
+    Handle handle = _idIndex.find(idHash, [this, &id](Handle handle) { return idView(handle) == id; });
+    if (handle != invalidHandle) {
+        return handle;
+    }
+
+    if (!_freeHandles.empty()) {
+        handle = _freeHandles.back();
+        _freeHandles.pop_back();
+    } else {
+        handle = _nextHandle++;
+        if (pageIndex(handle) >= _pages.size()) {
+            _pages.push_back(std::make_shared<Page>());
+        }
+    }
+
+    Page &itemPage = mutablePage(handle);
+    const uint32_t pos = offset(handle);
+    itemPage.parent[pos] = invalidHandle;
+    itemPage.firstChild[pos] = invalidHandle;
+    itemPage.nextSibling[pos] = invalidHandle;
+    itemPage.prevSibling[pos] = invalidHandle;
+    itemPage.nbChildren[pos] = 0;
+    itemPage.name[pos] = StrRef();
+    itemPage.nameHash[pos] = nameHash(SyncName());
+    itemPage.checksum[pos] = StrRef();
+    itemPage.createdAt[pos] = 0;
+    itemPage.lastModified[pos] = 0;
+    itemPage.size[pos] = 0;
+    itemPage.subtreeSize[pos] = 0;
+    itemPage.subtreeNbFiles[pos] = 0;
+    itemPage.type[pos] = NodeTypeUnknown;
+    itemPage.flags[pos] = FlagUsed | FlagCanWrite | FlagCanShare;
+    storeString(itemPage.strings, itemPage.id[pos], id, itemPage.garbage);
+
+    _idIndex.insert(idHash, handle);
+    _nbItems++;
+    link(handle, invalidHandle);
+
+    return handle;
+}
+
+void SnapshotStore::erase(Handle handle) {
+    if (!isUsed(handle)) {
+        assert(false);
+        return;
+    }
+
+    // The ancestors lose the whole subtree, then the children become the tops of detached trees
+    unlink(handle);
+
+    Handle child = firstChild(handle);
+    while (child != invalidHandle) {
+        const Handle next = nextSibling(child);
+        unlink(child);
+        link(child, invalidHandle);
+        child = next;
+    }
+
+    _idIndex.erase(hash(idView(handle)), handle);
+
+    Page &itemPage = mutablePage(handle);
+    const uint32_t pos = offset(handle);
+    itemPage.garbage += itemPage.id[pos].length + itemPage.checksum[pos].length + itemPage.name[pos].length;
+    itemPage.id[pos] = StrRef();
+    itemPage.name[pos] = StrRef();
+    itemPage.checksum[pos] = StrRef();
+    itemPage.firstChild[pos] = invalidHandle;
+    itemPage.nbChildren[pos] = 0;
+    itemPage.subtreeSize[pos] = 0;
+    itemPage.subtreeNbFiles[pos] = 0;
+    itemPage.flags[pos] = 0;
+
+    _freeHandles.push_back(handle);
+    _nbItems--;
+
+    compactIfNeeded(itemPage);
+}
+
+std::string_view SnapshotStore::idView(Handle handle) const {
+    const Page &itemPage = page(handle);
+    const StrRef &ref = itemPage.id[offset(handle)];
+    return std::string_view(itemPage.strings).substr(ref.offset, ref.length);
+}
+
+void SnapshotStore::setParent(Handle handle, Handle newParent) {
+    unlink(handle);
+    link(handle, newParent);
+}
+
+SnapshotStore::Handle SnapshotStore::findChild(Handle parentHandle, const SyncName &name) const {
+    const SyncName normalizedName = Utility::normalizedSyncName(name);
+    const uint32_t key = childKey(parentHandle, nameHash(normalizedName));
+    // Siblings whose names differ only by their normalization can exist on the local replica
+    const Handle exactHandle =
+        _childIndex.find(key, [&](Handle handle) { return parent(handle) == parentHandle && this->name(handle) == name; });
+    if (exactHandle != invalidHandle) {
+        return exactHandle;
+    }
+    return _childIndex.find(key, [&](Handle handle) {
+        return parent(handle) == parentHandle && Utility::normalizedSyncName(this->name(handle)) == normalizedName;
+    });
+}
+
+SyncName SnapshotStore::name(Handle handle) const {
+    const Page &itemPage = page(handle);
+    const StrRef &ref = itemPage.name[offset(handle)];
+    return itemPage.names.substr(ref.offset, ref.length);
+}
+
+void SnapshotStore::setName(Handle handle, const SyncName &name) {
+    Page &itemPage = mutablePage(handle);
+    updateName(itemPage, handle, name);
+    compactIfNeeded(itemPage);
+}
+
+std::string SnapshotStore::contentChecksum(Handle handle) const {
+    const Page &itemPage = page(handle);
+    const StrRef &ref = itemPage.checksum[offset(handle)];
+    return itemPage.strings.substr(ref.offset, ref.length);
+}
+
+void SnapshotStore::setContentChecksum(Handle handle, const std::string &checksum) {
+    Page &itemPage = mutablePage(handle);
+    storeString(itemPage.strings, itemPage.checksum[offset(handle)], checksum, itemPage.garbage);
+    compactIfNeeded(itemPage);
+}
+
+void SnapshotStore::setAttributes(Handle handle, const SnapshotItem &item) {
+    Page &itemPage = mutablePage(handle);
+    const uint32_t pos = offset(handle);
+    updateName(itemPage, handle, item.name());
+    storeString(itemPage.strings, itemPage.checksum[pos], item.contentChecksum(), itemPage.garbage);
+    itemPage.createdAt[pos] = item.createdAt();
+    itemPage.lastModified[pos] = item.lastModified();
+
+    // Directories only count through their content
+    const NodeType oldType = static_cast<NodeType>(itemPage.type[pos]);
+    const int64_t sizeDelta =
+        (item.type() != NodeTypeDirectory ? item.size() : 0) - (oldType != NodeTypeDirectory ? itemPage.size[pos] : 0);
+    const int64_t nbFilesDelta = (item.type() == NodeTypeFile ? 1 : 0) - (oldType == NodeTypeFile ? 1 : 0);
+    itemPage.size[pos] = item.size();
+    itemPage.type[pos] = static_cast<uint8_t>(item.type());
+    if (sizeDelta != 0 || nbFilesDelta != 0) {
+        addToSubtrees(handle, sizeDelta, nbFilesDelta);
+    }
+
+    uint8_t flags = FlagUsed;
+    if (item.isLink()) {
+        flags |= FlagIsLink;
+    }
+    if (item.canWrite()) {
+        flags |= FlagCanWrite;
+    }
+    if (item.canShare()) {
+        flags |= FlagCanShare;
+    }
+    itemPage.flags[pos] = flags;
+
+    compactIfNeeded(itemPage);
+}
+
+uint64_t SnapshotStore::memoryUsage() const {
+    uint64_t ret = sizeof(*this) + _idIndex.memoryUsage() + _childIndex.memoryUsage() + _freeHandles.capacity() * sizeof(Handle);
+    ret += _pages.capacity() * sizeof(std::shared_ptr<Page>);
+    for (const auto &itemPage : _pages) {
+        ret += sizeof(Page) + itemPage->strings.capacity() + itemPage->names.capacity() * sizeof(SyncChar);
+    }
+    return ret;
+}
+
+SnapshotStore::Page &SnapshotStore::mutablePage(Handle handle) {
+    std::shared_ptr<Page> &itemPage = _pages[pageIndex(handle)];
+    if (itemPage.use_count() > 1) {
+        // The page is shared with another version of the store
+        itemPage = std::make_shared<Page>(*itemPage);
+    }
+    return *itemPage;
+}
+
+uint32_t SnapshotStore::hash(std::string_view id) {
+    const size_t value = std::hash<std::string_view>{}(id);
+    return static_cast<uint32_t>(value ^ (static_cast<uint64_t>(value) >> 32));
+}
+
+uint32_t SnapshotStore::nameHash(const SyncName &normalizedName) {
+    const size_t value = std::hash<SyncName>{}(normalizedName);
+    return static_cast<uint32_t>(value ^ (static_cast<uint64_t>(value) >> 32));
+}
+
+uint32_t SnapshotStore::childKey(Handle parentHandle, uint32_t nameHash) {
+    uint32_t key = nameHash ^ (parentHandle + 0x9e3779b9 + (nameHash << 6) + (nameHash >> 2));
+    // Final mix so that the high bits, which select the index shard, depend on both values
+    key ^= key >> 16;
+    key *= 0x85ebca6b;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35;
+    key ^= key >> 16;
+    return key;
+}
+
+template <class Str>
+void SnapshotStore::storeString(Str &arena, StrRef &ref, const Str &value, uint64_t &garbage) {
+    assert(value.size() <= UINT16_MAX);
+    if (value.size() <= ref.length) {
+        // Overwrite in place
+        value.copy(arena.data() + ref.offset, value.size());
+        garbage += ref.length - value.size();
+    } else {
+        garbage += ref.length;
+        ref.offset = static_cast<uint32_t>(arena.size());
+        arena.append(value);
+    }
+    ref.length = static_cast<uint16_t>(value.size());
+}
+
+void SnapshotStore::compactIfNeeded(Page &itemPage) {
+    if (itemPage.garbage > minGarbageToCompact && itemPage.garbage > (itemPage.strings.size() + itemPage.names.size()) / 2) {
+        compactArenas(itemPage);
+    }
+}
+
+void SnapshotStore::compactArenas(Page &itemPage) {
+    std::string strings;
+    SyncName names;
+    for (uint32_t pos = 0; pos < pageSize; pos++) {
+        if (!(itemPage.flags[pos] & FlagUsed)) {
+            continue;
+        }
+
+        StrRef &idRef = itemPage.id[pos];
+        const uint32_t idOffset = static_cast<uint32_t>(strings.size());
+        strings.append(itemPage.strings, idRef.offset, idRef.length);
+        idRef.offset = idOffset;
+
+        StrRef &checksumRef = itemPage.checksum[pos];
+        const uint32_t checksumOffset = static_cast<uint32_t>(strings.size());
+        strings.append(itemPage.strings, checksumRef.offset, checksumRef.length);
+        checksumRef.offset = checksumOffset;
+
+        StrRef &nameRef = itemPage.name[pos];
+        const uint32_t nameOffset = static_cast<uint32_t>(names.size());
+        names.append(itemPage.names, nameRef.offset, nameRef.length);
+        nameRef.offset = nameOffset;
+    }
+    itemPage.strings.swap(strings);
+    itemPage.names.swap(names);
+    itemPage.garbage = 0;
+}
+
+void SnapshotStore::link(Handle handle, Handle newParent) {
+    Page &itemPage = mutablePage(handle);
+    const uint32_t pos = offset(handle);
+    itemPage.parent[pos] = newParent;
+
+    // Insert at the head of the new parent's children list, or of the detached list
+    Handle &head = newParent == invalidHandle ? _firstDetached : mutablePage(newParent).firstChild[offset(newParent)];
+    itemPage.prevSibling[pos] = invalidHandle;
+    itemPage.nextSibling[pos] = head;
+    if (head != invalidHandle) {
+        mutablePage(head).prevSibling[offset(head)] = handle;
+    }
+    head = handle;
+
+    if (newParent == invalidHandle) {
+        _nbDetached++;
+        return;
+    }
+
+    mutablePage(newParent).nbChildren[offset(newParent)]++;
+    _childIndex.insert(childKey(newParent, itemPage.nameHash[pos]), handle);
+    addToSubtrees(newParent, itemPage.subtreeSize[pos], itemPage.subtreeNbFiles[pos]);
+}
+
+void SnapshotStore::unlink(Handle handle) {
+    Page &itemPage = mutablePage(handle);
+    const uint32_t pos = offset(handle);
+    const Handle parentHandle = itemPage.parent[pos];
+    if (parentHandle != invalidHandle) {
+        _childIndex.erase(childKey(parentHandle, itemPage.nameHash[pos]), handle);
+        mutablePage(parentHandle).nbChildren[offset(parentHandle)]--;
+        addToSubtrees(parentHandle, -itemPage.subtreeSize[pos], -static_cast<int64_t>(itemPage.subtreeNbFiles[pos]));
+    } else {
+        _nbDetached--;
+    }
+
+    const Handle prev = itemPage.prevSibling[pos];
+    const Handle next = itemPage.nextSibling[pos];
+    if (prev != invalidHandle) {
+        mutablePage(prev).nextSibling[offset(prev)] = next;
+    } else if (parentHandle != invalidHandle) {
+        mutablePage(parentHandle).firstChild[offset(parentHandle)] = next;
+    } else {
+        _firstDetached = next;
+    }
+    if (next != invalidHandle) {
+        mutablePage(next).prevSibling[offset(next)] = prev;
+    }
+
+    itemPage.parent[pos] = invalidHandle;
+    itemPage.prevSibling[pos] = invalidHandle;
+    itemPage.nextSibling[pos] = invalidHandle;
+}
+
+void SnapshotStore::addToSubtrees(Handle handle, int64_t sizeDelta, int64_t nbFilesDelta) {
+    for (uint64_t depth = 0; handle != invalidHandle; depth++) {
+        if (depth > _nbItems) {
+            // The parent links form a cycle, should not happen
+            assert(false);
+            break;
+        }
+
+        Page &itemPage = mutablePage(handle);
+        const uint32_t pos = offset(handle);
+        itemPage.subtreeSize[pos] += sizeDelta;
+        itemPage.subtreeNbFiles[pos] = static_cast<uint32_t>(itemPage.subtreeNbFiles[pos] + nbFilesDelta);
+        handle = itemPage.parent[pos];
+    }
+}
+
+void SnapshotStore::updateName(Page &itemPage, Handle handle, const SyncName &name) {
+    const uint32_t pos = offset(handle);
+    const StrRef &ref = itemPage.name[pos];
+    if (itemPage.names.compare(ref.offset, ref.length, name) == 0) {
+        return;
+    }
+
+    const uint32_t newNameHash = nameHash(Utility::normalizedSyncName(name));
+    const Handle parentHandle = itemPage.parent[pos];
+    if (parentHandle != invalidHandle && newNameHash != itemPage.nameHash[pos]) {
+        _childIndex.erase(childKey(parentHandle, itemPage.nameHash[pos]), handle);
+        _childIndex.insert(childKey(parentHandle, newNameHash), handle);
+    }
+    itemPage.nameHash[pos] = newNameHash;
+    storeString(itemPage.names, itemPage.name[pos], name, itemPage.garbage);
+}
+
+}  // namespace KDC
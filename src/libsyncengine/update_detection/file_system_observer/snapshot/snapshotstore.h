@@ -0,0 +1,185 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "handleindex.h"
+#include "snapshotitem.h"
+#include "libcommon/utility/types.h"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace KDC {
+
+/**
+ * Compact storage of the items of a Snapshot.
+ * Node IDs are interned and mapped to 32-bit handles. Items are stored in fixed-size pages as a struct-of-arrays, the
+ * children of an item are linked through intrusive sibling links and all the strings (IDs, names and checksums) live in
+ * per-page arenas.
+ * A second index maps (parent, NFC-normalized name) to the child item so that paths are resolved without scanning the
+ * children of each directory. The size and the number of files of each subtree are maintained incrementally.
+ * Copying a store is cheap: pages and index shards are shared with the copy and duplicated only when one of the stores
+ * modifies them (copy-on-write). A copy is therefore an immutable version that is not affected by later changes.
+ */
+class SnapshotStore {
+    public:
+        typedef HandleIndex::Handle Handle;
+        static constexpr Handle invalidHandle = HandleIndex::invalidHandle;
+
+        SnapshotStore() = default;
+
+        SnapshotStore(const SnapshotStore &other) = default;
+        SnapshotStore &operator=(const SnapshotStore &other) = default;
+
+        void clear();
+
+        Handle find(const NodeId &id) const;
+        /** Inserts an empty item with no parent.
+         * @return the handle of the new item, or of the existing one if the ID is already known.
+         */
+        Handle insert(const NodeId &id);
+        /** Removes an item. Its children, if any, are detached and left without parent.
+         */
+        void erase(Handle handle);
+
+        inline bool isUsed(Handle handle) const {
+            return handle < _nextHandle && (page(handle).flags[offset(handle)] & FlagUsed);
+        }
+        inline uint64_t nbItems() const { return _nbItems; }
+        inline Handle handleUpperBound() const { return _nextHandle; }
+
+        std::string_view idView(Handle handle) const;
+        inline NodeId id(Handle handle) const { return NodeId(idView(handle)); }
+
+        inline Handle parent(Handle handle) const { return page(handle).parent[offset(handle)]; }
+        /** Moves an item (and its whole subtree) under a new parent. The parent can be invalidHandle.
+         */
+        void setParent(Handle handle, Handle newParent);
+        inline Handle firstChild(Handle handle) const { return page(handle).firstChild[offset(handle)]; }
+        inline Handle nextSibling(Handle handle) const { return page(handle).nextSibling[offset(handle)]; }
+        inline uint32_t nbChildren(Handle handle) const { return page(handle).nbChildren[offset(handle)]; }
+        /** Items without parent are the tops of detached trees. They are linked together through their sibling links.
+         */
+        inline Handle firstDetached() const { return _firstDetached; }
+        inline uint64_t nbDetached() const { return _nbDetached; }
+        /** Finds the child of an item by name. A child with the exact same name is preferred, otherwise the comparison is made
+         * on the NFC-normalized names.
+         */
+        Handle findChild(Handle parentHandle, const SyncName &name) const;
+
+        SyncName name(Handle handle) const;
+        void setName(Handle handle, const SyncName &name);
+        inline SyncTime createdAt(Handle handle) const { return page(handle).createdAt[offset(handle)]; }
+        inline void setCreatedAt(Handle handle, SyncTime time) { mutablePage(handle).createdAt[offset(handle)] = time; }
+        inline SyncTime lastModified(Handle handle) const { return page(handle).lastModified[offset(handle)]; }
+        inline void setLastModified(Handle handle, SyncTime time) { mutablePage(handle).lastModified[offset(handle)] = time; }
+        inline NodeType type(Handle handle) const { return static_cast<NodeType>(page(handle).type[offset(handle)]); }
+        inline int64_t size(Handle handle) const { return page(handle).size[offset(handle)]; }
+        inline bool isLink(Handle handle) const { return page(handle).flags[offset(handle)] & FlagIsLink; }
+        inline bool canWrite(Handle handle) const { return page(handle).flags[offset(handle)] & FlagCanWrite; }
+        inline bool canShare(Handle handle) const { return page(handle).flags[offset(handle)] & FlagCanShare; }
+        /** Aggregates of the subtree of an item, the item included. They are updated along the ancestors on each change.
+         */
+        inline int64_t subtreeSize(Handle handle) const { return page(handle).subtreeSize[offset(handle)]; }
+        inline uint64_t subtreeNbFiles(Handle handle) const { return page(handle).subtreeNbFiles[offset(handle)]; }
+        std::string contentChecksum(Handle handle) const;
+        void setContentChecksum(Handle handle, const std::string &checksum);
+
+        /** Sets all the attributes of an item but its ID and its parent.
+         */
+        void setAttributes(Handle handle, const SnapshotItem &item);
+
+        /** Estimated number of bytes used by the store, including the arenas and the ID index.
+         */
+        uint64_t memoryUsage() const;
+
+    private:
+        static constexpr uint32_t pageBits = 10;
+        static constexpr uint32_t pageSize = 1 << pageBits;
+
+        enum Flag : uint8_t {
+            FlagUsed = 0x01,
+            FlagIsLink = 0x02,
+            FlagCanWrite = 0x04,
+            FlagCanShare = 0x08
+        };
+
+        struct StrRef {
+                uint32_t offset = 0;
+                uint16_t length = 0;
+        };
+
+        struct Page {
+                Page();
+
+                std::array<Handle, pageSize> parent;
+                std::array<Handle, pageSize> firstChild;
+                std::array<Handle, pageSize> nextSibling;
+                std::array<Handle, pageSize> prevSibling;
+                std::array<uint32_t, pageSize> nbChildren;
+                std::array<StrRef, pageSize> id;
+                std::array<StrRef, pageSize> name;
+                std::array<uint32_t, pageSize> nameHash;  // Hash of the normalized name
+                std::array<StrRef, pageSize> checksum;
+                std::array<SyncTime, pageSize> createdAt;
+                std::array<SyncTime, pageSize> lastModified;
+                std::array<int64_t, pageSize> size;
+                std::array<int64_t, pageSize> subtreeSize;
+                std::array<uint32_t, pageSize> subtreeNbFiles;
+                std::array<uint8_t, pageSize> type;
+                std::array<uint8_t, pageSize> flags;
+
+                std::string strings;  // IDs and checksums
+                SyncName names;
+                uint64_t garbage = 0;  // Number of unreferenced characters in the arenas
+        };
+
+        static inline uint32_t pageIndex(Handle handle) { return handle >> pageBits; }
+        static inline uint32_t offset(Handle handle) { return handle & (pageSize - 1); }
+        static uint32_t hash(std::string_view id);
+        static uint32_t nameHash(const SyncName &normalizedName);
+        static uint32_t childKey(Handle parentHandle, uint32_t nameHash);
+
+        inline const Page &page(Handle handle) const { return *_pages[pageIndex(handle)]; }
+        Page &mutablePage(Handle handle);
+
+        template <class Str>
+        static void storeString(Str &arena, StrRef &ref, const Str &value, uint64_t &garbage);
+        static void compactIfNeeded(Page &page);
+        static void compactArenas(Page &page);
+
+        void link(Handle handle, Handle newParent);
+        void unlink(Handle handle);
+        void addToSubtrees(Handle handle, int64_t sizeDelta, int64_t nbFilesDelta);
+        void updateName(Page &page, Handle handle, const SyncName &name);
+
+        std::vector<std::shared_ptr<Page>> _pages;
+        HandleIndex _idIndex;
+        HandleIndex _childIndex;
+        std::vector<Handle> _freeHandles;
+        Handle _firstDetached = invalidHandle;
+        uint64_t _nbDetached = 0;
+        Handle _nextHandle = 0;
+        uint64_t _nbItems = 0;
+};
+
+}  // namespace KDC
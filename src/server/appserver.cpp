@@ -43,6 +43,7 @@
 #include "libsyncengine/requests/parameterscache.h"
 #include "libsyncengine/requests/exclusiontemplatecache.h"
 #include "libsyncengine/jobs/jobmanager.h"
+#include "libsyncengine/jobs/network/downloadjob.h"
 
 #include <iostream>
 #include <filesystem>
@@ -242,6 +243,9 @@ AppServer::AppServer(int &argc, char **argv)
     // Setup proxy
     setupProxy();
 
+    // Remove the partial downloads that will not be resumed
+    DownloadJob::removeOldTmpFiles();
+
     // Setup auto start
 #ifdef NDEBUG
     if (ParametersCache::instance()->parameters().autoStart() && !OldUtility::hasLaunchOnStartup(_theme->appName(), _logger)) {
@@ -22,6 +22,9 @@
 
 #include <time.h>
 
+#include <chrono>
+#include <iostream>
+
 using namespace CppUnit;
 
 namespace KDC {
@@ -446,4 +449,245 @@ void TestSyncDb::testSyncNodes() {
     CPPUNIT_ASSERT(nodeIdSet3.size() == 0);
 }
 
+void TestSyncDb::testSelectNodes() {
+    CPPUNIT_ASSERT(_testObj->clearNodes());
+
+    time_t tLoc = std::time(0);
+    time_t tDrive = std::time(0);
+    DbNode nodeDir(0, _testObj->rootNode().nodeId(), Str("Dir loc"), Str("Dir drive"), "id loc", "id drive", tLoc, tLoc, tDrive,
+                   NodeType::NodeTypeDirectory, 0, std::nullopt);
+    DbNodeId dbNodeIdDir;
+    bool constraintError = false;
+    CPPUNIT_ASSERT(_testObj->insertNode(nodeDir, dbNodeIdDir, constraintError));
+    for (int i = 0; i < 5; i++) {
+        const std::string index = std::to_string(i);
+        DbNode nodeFile(0, dbNodeIdDir, Str2SyncName("File loc " + index), Str2SyncName("File drive " + index),
+                        "id loc " + index, "id drive " + index, tLoc, tLoc, tDrive, NodeType::NodeTypeFile, i, "cs " + index);
+        DbNodeId dbNodeIdFile;
+        CPPUNIT_ASSERT(_testObj->insertNode(nodeFile, dbNodeIdFile, constraintError));
+    }
+
+    // Read the root, the directory and the files by pages of 3 nodes
+    std::vector<DbNode> allNodes;
+    std::vector<DbNode> dbNodes;
+    DbNodeId lastDbNodeId = 0;
+    int nbPages = 0;
+    do {
+        CPPUNIT_ASSERT(_testObj->selectNodes(lastDbNodeId, 3, dbNodes));
+        if (!dbNodes.empty()) {
+            lastDbNodeId = dbNodes.back().nodeId();
+            allNodes.insert(allNodes.end(), dbNodes.begin(), dbNodes.end());
+            nbPages++;
+        }
+    } while (dbNodes.size() == 3);
+
+    CPPUNIT_ASSERT_EQUAL(size_t(7), allNodes.size());
+    CPPUNIT_ASSERT_EQUAL(3, nbPages);
+    for (size_t i = 1; i < allNodes.size(); i++) {
+        CPPUNIT_ASSERT(allNodes[i - 1].nodeId() < allNodes[i].nodeId());
+    }
+
+    const DbNode &dbNodeFile = allNodes.back();
+    CPPUNIT_ASSERT(dbNodeFile.parentNodeId() == dbNodeIdDir);
+    CPPUNIT_ASSERT(dbNodeFile.nameLocal() == Str("File loc 4"));
+    CPPUNIT_ASSERT(dbNodeFile.nameRemote() == Str("File drive 4"));
+    CPPUNIT_ASSERT(dbNodeFile.nodeIdLocal() == "id loc 4");
+    CPPUNIT_ASSERT(dbNodeFile.nodeIdRemote() == "id drive 4");
+    CPPUNIT_ASSERT(dbNodeFile.type() == NodeType::NodeTypeFile);
+    CPPUNIT_ASSERT_EQUAL(int64_t(4), dbNodeFile.size());
+    CPPUNIT_ASSERT(dbNodeFile.checksum() == "cs 4");
+    CPPUNIT_ASSERT(dbNodeFile.lastModifiedRemote() == tDrive);
+}
+
+void TestSyncDb::testNodeIndex() {
+    CPPUNIT_ASSERT(_testObj->clearNodes());
+
+    time_t tLoc = std::time(0);
+    time_t tDrive = std::time(0);
+    DbNode nodeDirA(0, _testObj->rootNode().nodeId(), Str("A loc"), Str("A drive"), "id loc A", "id drive A", tLoc, tLoc,
+                    tDrive, NodeType::NodeTypeDirectory, 0, std::nullopt);
+    DbNodeId dbNodeIdDirA;
+    bool constraintError = false;
+    CPPUNIT_ASSERT(_testObj->insertNode(nodeDirA, dbNodeIdDirA, constraintError));
+    DbNode nodeDirB(0, _testObj->rootNode().nodeId(), Str("B loc"), Str("B drive"), "id loc B", "id drive B", tLoc, tLoc,
+                    tDrive, NodeType::NodeTypeDirectory, 0, std::nullopt);
+    DbNodeId dbNodeIdDirB;
+    CPPUNIT_ASSERT(_testObj->insertNode(nodeDirB, dbNodeIdDirB, constraintError));
+    DbNode nodeFile(0, dbNodeIdDirA, Str("File loc"), Str("File drive"), "id loc file", "id drive file", tLoc, tLoc, tDrive,
+                    NodeType::NodeTypeFile, 10, "cs");
+    DbNodeId dbNodeIdFile;
+    CPPUNIT_ASSERT(_testObj->insertNode(nodeFile, dbNodeIdFile, constraintError));
+    nodeFile.setNodeId(dbNodeIdFile);
+
+    SyncPath path;
+    bool found = false;
+    CPPUNIT_ASSERT(_testObj->path(ReplicaSide::ReplicaSideRemote, "id drive file", path, found) && found);
+    CPPUNIT_ASSERT(path == SyncPath(Str("A drive")) / Str("File drive"));
+    bool ret = false;
+    CPPUNIT_ASSERT(_testObj->ancestor(ReplicaSide::ReplicaSideLocal, "id loc A", "id loc file", ret, found) && found && ret);
+    CPPUNIT_ASSERT(_testObj->ancestor(ReplicaSide::ReplicaSideLocal, "id loc B", "id loc file", ret, found) && found && !ret);
+
+    // Move the file into B
+    nodeFile.setParentNodeId(dbNodeIdDirB);
+    nodeFile.setNameLocal(Str("File loc 2"));
+    CPPUNIT_ASSERT(_testObj->updateNode(nodeFile, found) && found);
+
+    SyncPath localPath;
+    SyncPath remotePath;
+    CPPUNIT_ASSERT(_testObj->path(dbNodeIdFile, localPath, remotePath, found) && found);
+    CPPUNIT_ASSERT(localPath == SyncPath(Str("B loc")) / Str("File loc 2"));
+    CPPUNIT_ASSERT(remotePath == SyncPath(Str("B drive")) / Str("File drive"));
+    std::optional<NodeId> nodeId;
+    CPPUNIT_ASSERT(_testObj->id(ReplicaSide::ReplicaSideLocal, SyncPath(Str("B loc")) / Str("File loc 2"), nodeId, found) &&
+                   found);
+    CPPUNIT_ASSERT(nodeId == "id loc file");
+    CPPUNIT_ASSERT(_testObj->id(ReplicaSide::ReplicaSideLocal, SyncPath(Str("A loc")) / Str("File loc"), nodeId, found) &&
+                   !found);
+    CPPUNIT_ASSERT(_testObj->ancestor(ReplicaSide::ReplicaSideRemote, "id drive B", "id drive file", ret, found) && found &&
+                   ret);
+
+    // Deleting B deletes the file too
+    CPPUNIT_ASSERT(_testObj->deleteNode(dbNodeIdDirB, found) && found);
+    DbNodeId dbNodeId;
+    CPPUNIT_ASSERT(_testObj->dbId(ReplicaSide::ReplicaSideLocal, "id loc file", dbNodeId, found) && !found);
+    CPPUNIT_ASSERT(_testObj->dbId(ReplicaSide::ReplicaSideLocal, SyncPath(Str("A loc")), dbNodeId, found) && found);
+    CPPUNIT_ASSERT_EQUAL(dbNodeIdDirA, dbNodeId);
+}
+
+void TestSyncDb::testBatchWrites() {
+    CPPUNIT_ASSERT(_testObj->clearNodes());
+
+    // Commit every 2 rows, the last row is committed by endBatch
+    _testObj->startBatch(2, std::chrono::hours(1));
+    time_t tLoc = std::time(0);
+    time_t tDrive = std::time(0);
+    std::vector<DbNodeId> dbNodeIds;
+    for (int i = 0; i < 3; i++) {
+        const std::string index = std::to_string(i);
+        DbNode nodeFile(0, _testObj->rootNode().nodeId(), Str2SyncName("File loc " + index),
+                        Str2SyncName("File drive " + index), "id loc " + index, "id drive " + index, tLoc, tLoc, tDrive,
+                        NodeType::NodeTypeFile, i, std::nullopt);
+        DbNodeId dbNodeId;
+        bool constraintError = false;
+        CPPUNIT_ASSERT(_testObj->insertNode(nodeFile, dbNodeId, constraintError));
+        dbNodeIds.push_back(dbNodeId);
+    }
+    CPPUNIT_ASSERT(_testObj->commitBatchIfDue());
+
+    // Pending writes are visible before the commit
+    bool found = false;
+    DbNode dbNode;
+    CPPUNIT_ASSERT(_testObj->node(dbNodeIds.back(), dbNode, found) && found);
+
+    bool updated = false;
+    dbNode.setSize(10);
+    CPPUNIT_ASSERT(_testObj->updateNode(dbNode, updated) && updated);
+    CPPUNIT_ASSERT(_testObj->endBatch());
+
+    CPPUNIT_ASSERT(_testObj->node(dbNodeIds.back(), dbNode, found) && found);
+    CPPUNIT_ASSERT_EQUAL(int64_t(10), dbNode.size());
+    std::vector<DbNode> dbNodes;
+    CPPUNIT_ASSERT(_testObj->selectNodes(0, 10, dbNodes));
+    CPPUNIT_ASSERT_EQUAL(size_t(4), dbNodes.size());
+}
+
+void TestSyncDb::testNodeLookupTiming() {
+    CPPUNIT_ASSERT(_testObj->clearNodes());
+
+    const int nbNodes = 1000;
+    const int nbLookups = 20000;
+    time_t tLoc = std::time(0);
+    time_t tDrive = std::time(0);
+    _testObj->startBatch(nbNodes, std::chrono::hours(1));
+    for (int i = 0; i < nbNodes; i++) {
+        const std::string index = std::to_string(i);
+        DbNode nodeFile(0, _testObj->rootNode().nodeId(), Str2SyncName("File loc " + index),
+                        Str2SyncName("File drive " + index), "id loc " + index, "id drive " + index, tLoc, tLoc, tDrive,
+                        NodeType::NodeTypeFile, i, "cs " + index);
+        DbNodeId dbNodeId;
+        bool constraintError = false;
+        CPPUNIT_ASSERT(_testObj->insertNode(nodeFile, dbNodeId, constraintError));
+    }
+    CPPUNIT_ASSERT(_testObj->endBatch());
+
+    // Point lookups by replica ID, each one runs a prepared query and reads all its columns
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nbLookups; i++) {
+        const int nodeIndex = (i * 7919) % nbNodes;
+        DbNode dbNode;
+        bool found = false;
+        CPPUNIT_ASSERT(_testObj->node(ReplicaSide::ReplicaSideLocal, "id loc " + std::to_string(nodeIndex), dbNode, found) &&
+                       found);
+        CPPUNIT_ASSERT_EQUAL(int64_t(nodeIndex), dbNode.size());
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << " nsPerLookup=" << elapsed.count() / nbLookups;
+}
+
+void TestSyncDb::testUploadSessions() {
+    int64_t tokenDbId = 0;
+    CPPUNIT_ASSERT(_testObj->insertUploadSessionToken(UploadSessionToken("token1"), tokenDbId));
+
+    const SyncPath filePath = SyncPath("dir") / "file.bin";
+    CPPUNIT_ASSERT(_testObj->insertUploadSessionInfo(
+        UploadSessionInfo(tokenDbId, filePath, Str("file.bin"), "parentId", 300, 12345, 100, 3, 1000)));
+    CPPUNIT_ASSERT(_testObj->insertUploadSessionChunk(tokenDbId, 1, "hash1"));
+    CPPUNIT_ASSERT(_testObj->insertUploadSessionChunk(tokenDbId, 3, "hash3"));
+
+    UploadSessionInfo uploadSessionInfo;
+    bool found = false;
+    CPPUNIT_ASSERT(_testObj->selectUploadSessionInfo(filePath, uploadSessionInfo, found) && found);
+    CPPUNIT_ASSERT_EQUAL(tokenDbId, uploadSessionInfo.tokenDbId());
+    CPPUNIT_ASSERT_EQUAL(std::string("token1"), uploadSessionInfo.token());
+    CPPUNIT_ASSERT(uploadSessionInfo.fileName() == Str("file.bin"));
+    CPPUNIT_ASSERT_EQUAL(int64_t(300), uploadSessionInfo.size());
+    CPPUNIT_ASSERT_EQUAL(SyncTime(12345), uploadSessionInfo.modtime());
+    CPPUNIT_ASSERT_EQUAL(int64_t(3), uploadSessionInfo.totalChunks());
+    CPPUNIT_ASSERT_EQUAL(size_t(2), uploadSessionInfo.chunkHashes().size());
+    CPPUNIT_ASSERT_EQUAL(std::string("hash3"), uploadSessionInfo.chunkHashes().at(3));
+
+    CPPUNIT_ASSERT(_testObj->selectUploadSessionInfo(SyncPath("dir") / "other.bin", uploadSessionInfo, found) && !found);
+
+    // The session info is deleted with its token
+    CPPUNIT_ASSERT(_testObj->deleteUploadSessionTokenByDbId(tokenDbId, found) && found);
+    CPPUNIT_ASSERT(_testObj->selectUploadSessionInfo(tokenDbId, uploadSessionInfo, found) && !found);
+}
+
+void TestSyncDb::testChecksumCache() {
+    CPPUNIT_ASSERT(_testObj->insertCachedChecksum(42, 300, 12345, 1000, "checksum1"));
+
+    std::string checksum;
+    bool found = false;
+    CPPUNIT_ASSERT(_testObj->selectCachedChecksum(42, 300, 12345, 1000, checksum, found) && found);
+    CPPUNIT_ASSERT_EQUAL(std::string("checksum1"), checksum);
+
+    // Any change of size, modtime or creation time invalidates the checksum
+    CPPUNIT_ASSERT(_testObj->selectCachedChecksum(42, 301, 12345, 1000, checksum, found) && !found);
+    CPPUNIT_ASSERT(_testObj->selectCachedChecksum(42, 300, 12346, 1000, checksum, found) && !found);
+    CPPUNIT_ASSERT(_testObj->selectCachedChecksum(42, 300, 12345, 1001, checksum, found) && !found);
+
+    // A new checksum replaces the previous one for the same inode
+    CPPUNIT_ASSERT(_testObj->insertCachedChecksum(42, 400, 23456, 1000, "checksum2"));
+    CPPUNIT_ASSERT(_testObj->selectCachedChecksum(42, 300, 12345, 1000, checksum, found) && !found);
+    CPPUNIT_ASSERT(_testObj->selectCachedChecksum(42, 400, 23456, 1000, checksum, found) && found);
+    CPPUNIT_ASSERT_EQUAL(std::string("checksum2"), checksum);
+
+    // Only the checksums of the files still in the node table are kept
+    CPPUNIT_ASSERT(_testObj->clearNodes());
+    const time_t t = std::time(0);
+    DbNode nodeFile(0, _testObj->rootNode().nodeId(), Str("File loc"), Str("File drive"), "43", "id drive", t, t, t,
+                    NodeType::NodeTypeFile, 0, std::nullopt);
+    DbNodeId dbNodeId;
+    bool constraintError = false;
+    CPPUNIT_ASSERT(_testObj->insertNode(nodeFile, dbNodeId, constraintError));
+    CPPUNIT_ASSERT(_testObj->insertCachedChecksum(43, 500, 34567, 1000, "checksum3"));
+
+    int nbDeleted = 0;
+    CPPUNIT_ASSERT(_testObj->deleteOrphanCachedChecksums(nbDeleted));
+    CPPUNIT_ASSERT_EQUAL(1, nbDeleted);
+    CPPUNIT_ASSERT(_testObj->selectCachedChecksum(42, 400, 23456, 1000, checksum, found) && !found);
+    CPPUNIT_ASSERT(_testObj->selectCachedChecksum(43, 500, 34567, 1000, checksum, found) && found);
+    CPPUNIT_ASSERT_EQUAL(std::string("checksum3"), checksum);
+}
+
 }  // namespace KDC
@@ -29,6 +29,12 @@ class TestSyncDb : public CppUnit::TestFixture {
         CPPUNIT_TEST_SUITE(TestSyncDb);
         CPPUNIT_TEST(testNodes);
         CPPUNIT_TEST(testSyncNodes);
+        CPPUNIT_TEST(testSelectNodes);
+        CPPUNIT_TEST(testNodeIndex);
+        CPPUNIT_TEST(testBatchWrites);
+        CPPUNIT_TEST(testNodeLookupTiming);
+        CPPUNIT_TEST(testUploadSessions);
+        CPPUNIT_TEST(testChecksumCache);
         CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -38,6 +44,12 @@ class TestSyncDb : public CppUnit::TestFixture {
     protected:
         void testNodes();
         void testSyncNodes();
+        void testSelectNodes();
+        void testNodeIndex();
+        void testBatchWrites();
+        void testNodeLookupTiming();
+        void testUploadSessions();
+        void testChecksumCache();
 
     private:
         SyncDb *_testObj;
@@ -22,6 +22,7 @@
 #include "jobs/network/createdirjob.h"
 #include "jobs/network/deletejob.h"
 #include "jobs/network/downloadjob.h"
+#include "jobs/network/downloadsegmentjob.h"
 #include "jobs/network/duplicatejob.h"
 #include "jobs/network/csvfullfilelistwithcursorjob.h"
 #include "jobs/network/getavatarjob.h"
@@ -32,11 +33,14 @@
 #include "jobs/network/getinfouserjob.h"
 #include "jobs/network/getinfodrivejob.h"
 #include "jobs/network/getthumbnailjob.h"
+#include "jobs/network/httpsessionpool.h"
 #include "jobs/network/jsonfullfilelistwithcursorjob.h"
 #include "jobs/network/movejob.h"
 #include "jobs/network/renamejob.h"
 #include "jobs/network/upload_session/uploadsession.h"
+#include "jobs/network/upload_session/chunkbufferpool.h"
 #include "jobs/network/uploadjob.h"
+#include "db/syncdb.h"
 #include "jobs/jobmanager.h"
 #include "network/proxy.h"
 #include "libcommon/utility/utility.h"
@@ -47,6 +51,10 @@
 #include "requests/parameterscache.h"
 #include "test_utility/temporarydirectory.h"
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 using namespace CppUnit;
 
 namespace KDC {
@@ -239,6 +247,62 @@ void TestNetworkJobs::testDownloadAborted() {
     CPPUNIT_ASSERT(!std::filesystem::exists(localDestFilePath));
 }
 
+void TestNetworkJobs::testDownloadSegment() {
+    int64_t start = 0;
+    int64_t end = 0;
+    int64_t total = 0;
+    CPPUNIT_ASSERT(DownloadSegmentJob::parseContentRange("bytes 10-19/100", start, end, total));
+    CPPUNIT_ASSERT(start == 10 && end == 19 && total == 100);
+    CPPUNIT_ASSERT(DownloadSegmentJob::parseContentRange("bytes 0-0/*", start, end, total));
+    CPPUNIT_ASSERT(total == -1);
+    CPPUNIT_ASSERT(!DownloadSegmentJob::parseContentRange("bytes */100", start, end, total));
+
+    // Download the middle of the test file into a preallocated file
+    const TemporaryDirectory temporaryDirectory("testDownloadSegment");
+    SyncPath localDestFilePath = temporaryDirectory.path / "test_file.txt";
+    {
+        std::ofstream ofs(localDestFilePath.string().c_str(), std::ios::binary);
+        ofs << "____";
+    }
+
+    DownloadSegmentJob job(_driveDbId, testFileRemoteId, localDestFilePath, 1, 2, 4);
+    ExitCode exitCode = job.runSynchronously();
+    CPPUNIT_ASSERT(exitCode == ExitCodeOk);
+    CPPUNIT_ASSERT(!job.rangeNotSupported());
+    CPPUNIT_ASSERT(job.written() == 2);
+
+    std::ifstream ifs(localDestFilePath.string().c_str(), std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(ifs)), (std::istreambuf_iterator<char>()));
+    CPPUNIT_ASSERT(content == "_es_");
+}
+
+void TestNetworkJobs::testDownloadTmpFiles() {
+    const TemporaryDirectory temporaryDirectory("testDownloadTmpFiles");
+    DownloadJob job(_driveDbId, testFileRemoteId, temporaryDirectory.path / "test_file.txt", 10, 0, 1640995201, false);
+
+    SyncPath tmpPath;
+    CPPUNIT_ASSERT(job.tmpFilePath(false, tmpPath));
+    const SyncPath otherVersionTmpPath = tmpPath.parent_path() / (job.tmpFilePrefix() + "20_1640995202.part");
+    const SyncPath oldTmpPath = tmpPath.parent_path() / "kdrive_testDownloadTmpFiles_old.part";
+    for (const auto &path : {tmpPath, otherVersionTmpPath, oldTmpPath}) {
+        std::ofstream(path) << "partial";
+    }
+    std::filesystem::last_write_time(oldTmpPath, std::filesystem::last_write_time(oldTmpPath) - std::chrono::hours(8 * 24));
+
+    // The partial downloads of the other versions of the file cannot be resumed
+    job.removeOutdatedTmpFiles();
+    CPPUNIT_ASSERT(std::filesystem::exists(tmpPath));
+    CPPUNIT_ASSERT(!std::filesystem::exists(otherVersionTmpPath));
+    CPPUNIT_ASSERT(std::filesystem::exists(oldTmpPath));
+
+    // The old partial downloads are removed at startup
+    DownloadJob::removeOldTmpFiles();
+    CPPUNIT_ASSERT(std::filesystem::exists(tmpPath));
+    CPPUNIT_ASSERT(!std::filesystem::exists(oldTmpPath));
+
+    std::filesystem::remove(tmpPath);
+}
+
 void TestNetworkJobs::testGetAvatar() {
     GetInfoUserJob job(_userDbId);
     ExitCode exitCode = job.runSynchronously();
@@ -426,6 +490,56 @@ void TestNetworkJobs::testFullFileListWithCursorCsvZip() {
     CPPUNIT_ASSERT(counter == 5);
 }
 
+void TestNetworkJobs::testFullFileListWithCursorCsvStreamed() {
+    CsvFullFileListWithCursorJob job(_driveDbId, "1", {}, true);
+    int counter = 0;
+    int nbNewReplies = 0;
+    job.setItemsCallback([&counter, &nbNewReplies](std::span<SnapshotItem> items, bool newReply) {
+        if (newReply) {
+            nbNewReplies++;
+            counter = 0;
+        }
+        for (const SnapshotItem &item : items) {
+            if (item.parentId() == pictureDirRemoteId) {
+                counter++;
+            }
+        }
+        return true;
+    });
+    ExitCode exitCode = job.runSynchronously();
+    CPPUNIT_ASSERT(exitCode == ExitCodeOk);
+
+    CPPUNIT_ASSERT(nbNewReplies >= 1);
+    CPPUNIT_ASSERT(!job.getCursor().empty());
+    CPPUNIT_ASSERT(counter == 5);
+}
+
+void TestNetworkJobs::testFullFileListWithCursorCsvNoFinalLineBreak() {
+    const std::string header = "id,parent_id,name,type,size,created_at,last_modified_at,can_write,is_link\n";
+    const std::string records = "2,1,\"A\",dir,0,10,20,1,0\n3,2,\"B\nC\",file,5,10,20,1,0\n4,2,\"D\",file,7,10,20,1,0";
+
+    // The last record is kept
+    for (const std::string &reply : {header + records, header + records + "\n"}) {
+        CsvFullFileListWithCursorJob job(_driveDbId, "1", {}, false);
+        std::vector<NodeId> ids;
+        job.setItemsCallback([&ids](std::span<SnapshotItem> items, bool) {
+            for (const SnapshotItem &item : items) {
+                ids.push_back(item.id());
+            }
+            return true;
+        });
+        std::istringstream is(reply);
+        CPPUNIT_ASSERT(job.handleResponse(is));
+        CPPUNIT_ASSERT(ids == std::vector<NodeId>({"2", "3", "4"}));
+    }
+
+    // A reply that ends in a double quoted value is truncated
+    CsvFullFileListWithCursorJob job(_driveDbId, "1", {}, false);
+    job.setItemsCallback([](std::span<SnapshotItem>, bool) { return true; });
+    std::istringstream is(header + "2,1,\"A");
+    CPPUNIT_ASSERT(!job.handleResponse(is));
+}
+
 void TestNetworkJobs::testFullFileListWithCursorJsonBlacklist() {
     JsonFullFileListWithCursorJob job(_driveDbId, "1", {pictureDirRemoteId}, true);
     ExitCode exitCode = job.runSynchronously();
@@ -579,6 +693,36 @@ void TestNetworkJobs::testUpload() {
     CPPUNIT_ASSERT(name == bigFileName);
 }
 
+void TestNetworkJobs::testUploadStreamed() {
+    CPPUNIT_ASSERT(createTestDir());
+
+    // Several blocks of the send buffer, the last one partial
+    const TemporaryDirectory temporaryDirectory("testUploadStreamed");
+    const SyncPath localFilePath = temporaryDirectory.path / "test_upload_streamed.bin";
+    const uint64_t fileSize = 3 * 64 * 1024 + 123;
+    {
+        std::ofstream file(localFilePath, std::ios_base::binary);
+        for (uint64_t i = 0; i < fileSize; i++) {
+            file.put(static_cast<char>(i * 7 % 251));
+        }
+    }
+
+    // The server checks the content against total_size and total_chunk_hash
+    UploadJob job(_driveDbId, localFilePath, localFilePath.filename().native(), _dirId, 0);
+    CPPUNIT_ASSERT(job.runSynchronously() == ExitCodeOk);
+    CPPUNIT_ASSERT(!job.nodeId().empty());
+
+    // The file is not kept open by the job
+    const SyncPath renamedFilePath = temporaryDirectory.path / "test_upload_streamed_renamed.bin";
+    std::error_code ec;
+    std::filesystem::rename(localFilePath, renamedFilePath, ec);
+    CPPUNIT_ASSERT(!ec);
+
+    GetFileInfoJob fileInfoJob(_driveDbId, job.nodeId());
+    CPPUNIT_ASSERT(fileInfoJob.runSynchronously() == ExitCodeOk);
+    CPPUNIT_ASSERT_EQUAL(static_cast<int64_t>(fileSize), fileInfoJob.size());
+}
+
 void TestNetworkJobs::testUploadAborted() {
     CPPUNIT_ASSERT(createTestDir());
 
@@ -730,6 +874,145 @@ void TestNetworkJobs::testUploadSessionAsynchronous5Aborted() {
     CPPUNIT_ASSERT(dataArray->size() == 0);
 }
 
+void TestNetworkJobs::testUploadSessionResume() {
+    LOGW_DEBUG(Log::instance()->getLogger(), L"$$$$$ testUploadSessionResume");
+
+    CPPUNIT_ASSERT(createTestDir());
+
+    bool alreadyExists = false;
+    const SyncPath syncDbPath = Db::makeDbName(1, 1, 1, 1, alreadyExists);
+    std::filesystem::remove(syncDbPath);
+    auto syncDb = std::make_shared<SyncDb>(syncDbPath.string(), "3.6.2");
+    syncDb->setAutoDelete(true);
+
+    SyncPath localFilePath = localTestDirPath / bigFileDirName / bigFileName;
+
+    // Simulate a connection drop once some chunks have been uploaded
+    auto uploadSessionJob = std::make_shared<UploadSession>(_driveDbId, syncDb, localFilePath,
+                                                            localFilePath.filename().native(), _dirId, 12345, false, 2);
+    JobManager::instance()->queueAsyncJob(uploadSessionJob);
+
+    UploadSessionInfo uploadSessionInfo;
+    bool found = false;
+    for (int i = 0; i < 600; i++) {
+        CPPUNIT_ASSERT(syncDb->selectUploadSessionInfo(localFilePath, uploadSessionInfo, found));
+        if (found && !uploadSessionInfo.chunkHashes().empty()) {
+            break;
+        }
+        Utility::msleep(100);
+    }
+    uploadSessionJob->abort();
+    while (!JobManager::instance()->isJobFinished(uploadSessionJob->jobId())) {
+        Utility::msleep(100);
+    }
+    CPPUNIT_ASSERT(uploadSessionJob->nodeId().empty());
+
+    // The session is kept with the chunks already uploaded
+    CPPUNIT_ASSERT(syncDb->selectUploadSessionInfo(localFilePath, uploadSessionInfo, found) && found);
+    CPPUNIT_ASSERT(!uploadSessionInfo.chunkHashes().empty());
+
+    // A new upload of the same file resumes the session
+    UploadSession resumedUploadSessionJob(_driveDbId, syncDb, localFilePath, localFilePath.filename().native(), _dirId, 12345,
+                                          false, 2);
+    ExitCode exitCode = resumedUploadSessionJob.runSynchronously();
+    CPPUNIT_ASSERT(exitCode == ExitCodeOk);
+
+    GetFileListJob fileListJob(_driveDbId, _dirId);
+    exitCode = fileListJob.runSynchronously();
+    CPPUNIT_ASSERT(exitCode == ExitCodeOk);
+
+    Poco::JSON::Object::Ptr resObj = fileListJob.jsonRes();
+    CPPUNIT_ASSERT(resObj);
+    Poco::JSON::Array::Ptr dataArray = resObj->getArray(dataKey);
+    CPPUNIT_ASSERT(dataArray->getObject(0)->get(idKey) == resumedUploadSessionJob.nodeId());
+
+    // The session is forgotten once finished
+    CPPUNIT_ASSERT(syncDb->selectUploadSessionInfo(localFilePath, uploadSessionInfo, found) && !found);
+    syncDb->close();
+}
+
+void TestNetworkJobs::testUploadSessionResumeAfterAbortedChunks() {
+    LOGW_DEBUG(Log::instance()->getLogger(), L"$$$$$ testUploadSessionResumeAfterAbortedChunks");
+
+    CPPUNIT_ASSERT(createTestDir());
+
+    SyncPath localFilePath = localTestDirPath / bigFileDirName / bigFileName;
+
+    // Synchronous and asynchronous sessions
+    for (uint64_t nbThreads : {1, 3}) {
+        const SyncName fileName = Str2SyncName(std::to_string(nbThreads) + "_") + localFilePath.filename().native();
+
+        bool alreadyExists = false;
+        const SyncPath syncDbPath = Db::makeDbName(1, 1, 1, 1, alreadyExists);
+        std::filesystem::remove(syncDbPath);
+        auto syncDb = std::make_shared<SyncDb>(syncDbPath.string(), "3.6.2");
+        syncDb->setAutoDelete(true);
+
+        // Abort as soon as a chunk has been uploaded, while the next ones are being sent
+        auto uploadSessionJob =
+            std::make_shared<UploadSession>(_driveDbId, syncDb, localFilePath, fileName, _dirId, 12345, false, nbThreads);
+        JobManager::instance()->queueAsyncJob(uploadSessionJob);
+
+        UploadSessionInfo uploadSessionInfo;
+        bool found = false;
+        for (int i = 0; i < 6000; i++) {
+            CPPUNIT_ASSERT(syncDb->selectUploadSessionInfo(localFilePath, uploadSessionInfo, found));
+            if (found && !uploadSessionInfo.chunkHashes().empty()) {
+                break;
+            }
+            Utility::msleep(10);
+        }
+        uploadSessionJob->abort();
+        while (!JobManager::instance()->isJobFinished(uploadSessionJob->jobId())) {
+            Utility::msleep(100);
+        }
+        CPPUNIT_ASSERT(uploadSessionJob->nodeId().empty());
+        CPPUNIT_ASSERT(syncDb->selectUploadSessionInfo(localFilePath, uploadSessionInfo, found) && found);
+
+        // The server only accepts the end of the resumed session if none of the chunks recorded as uploaded has been cut
+        UploadSession resumedUploadSessionJob(_driveDbId, syncDb, localFilePath, fileName, _dirId, 12345, false, nbThreads);
+        CPPUNIT_ASSERT(resumedUploadSessionJob.runSynchronously() == ExitCodeOk);
+        CPPUNIT_ASSERT(!resumedUploadSessionJob.nodeId().empty());
+        CPPUNIT_ASSERT(syncDb->selectUploadSessionInfo(localFilePath, uploadSessionInfo, found) && !found);
+        syncDb->close();
+    }
+}
+
+void TestNetworkJobs::testChunkBufferPool() {
+    ChunkBufferPool *pool = ChunkBufferPool::instance();
+    const uint64_t initialBudget = pool->budget();
+    pool->setBudget(2 * chunkMinSize);
+    pool->sessionStarted();
+
+    auto chunk1 = pool->acquire(chunkMinSize, std::chrono::milliseconds(0));
+    auto chunk2 = pool->acquire(chunkMinSize, std::chrono::milliseconds(0));
+    CPPUNIT_ASSERT(chunk1 && chunk2);
+    CPPUNIT_ASSERT_EQUAL(2 * chunkMinSize, pool->usedSize());
+
+    // The budget is reached
+    CPPUNIT_ASSERT(!pool->acquire(chunkMinSize, std::chrono::milliseconds(10)));
+
+    // A released buffer is reused
+    const char *chunk1Data = chunk1->data();
+    chunk1.reset();
+    auto chunk3 = pool->acquire(chunkMinSize, std::chrono::milliseconds(0));
+    CPPUNIT_ASSERT(chunk3);
+    CPPUNIT_ASSERT(chunk3->data() == chunk1Data);
+    CPPUNIT_ASSERT_EQUAL(2 * chunkMinSize, pool->allocatedSize());
+
+    chunk2.reset();
+    CPPUNIT_ASSERT_EQUAL(chunkMinSize, pool->usedSize());
+    CPPUNIT_ASSERT_EQUAL(2 * chunkMinSize, pool->allocatedSize());
+
+    // The free buffers are freed once no session uses the pool, the buffers in use once released
+    pool->sessionFinished();
+    CPPUNIT_ASSERT_EQUAL(chunkMinSize, pool->allocatedSize());
+    chunk3.reset();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), pool->usedSize());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), pool->allocatedSize());
+    pool->setBudget(initialBudget);
+}
+
 bool TestNetworkJobs::createTestDir() {
     _dirName = Str("test_dir_") + Str2SyncName(CommonUtility::generateRandomStringAlphaNum(10));
     CreateDirJob job(_driveDbId, _dirName, _remoteDirId, _dirName);
@@ -752,4 +1035,57 @@ bool TestNetworkJobs::createTestDir() {
     return true;
 }
 
+void TestNetworkJobs::testHttpSessionPool() {
+    HttpSessionPool::instance()->clear();
+
+    // The connection of the first request is reused by the next one
+    const uint64_t nbCreatedSessions = HttpSessionPool::instance()->nbCreatedSessions();
+    const uint64_t nbReusedSessions = HttpSessionPool::instance()->nbReusedSessions();
+    for (int i = 0; i < 3; i++) {
+        GetFileInfoJob job(_driveDbId, testFileRemoteId);
+        ExitCode exitCode = job.runSynchronously();
+        CPPUNIT_ASSERT(exitCode == ExitCodeOk);
+        CPPUNIT_ASSERT(HttpSessionPool::instance()->nbIdleSessions() == 1);
+    }
+    CPPUNIT_ASSERT(HttpSessionPool::instance()->nbCreatedSessions() == nbCreatedSessions + 1);
+    CPPUNIT_ASSERT(HttpSessionPool::instance()->nbReusedSessions() == nbReusedSessions + 2);
+
+    HttpSessionPool::instance()->clear();
+    CPPUNIT_ASSERT(HttpSessionPool::instance()->nbIdleSessions() == 0);
+
+    // A drive cannot check out more connections than the limit, the next request waits for one to be checked in
+    Poco::Net::Context::Ptr context =
+        new Poco::Net::Context(Poco::Net::Context::TLS_CLIENT_USE, "", Poco::Net::Context::VERIFY_NONE);
+    const Poco::URI uri("https://www.infomaniak.com");
+    const int driveDbId = 1000;
+    bool reused = false;
+    std::vector<std::unique_ptr<Poco::Net::HTTPSClientSession>> sessions;
+    for (int i = 0; i < sessionPoolMaxActivePerDrive; i++) {
+        sessions.push_back(HttpSessionPool::instance()->checkOut(uri, 0, context, driveDbId, reused));
+    }
+
+    std::atomic<bool> checkedOut = false;
+    std::thread waitingThread([&uri, &context, &checkedOut]() {
+        bool waitingReused = false;
+        auto session = HttpSessionPool::instance()->checkOut(uri, 0, context, driveDbId, waitingReused);
+        checkedOut = true;
+        HttpSessionPool::instance()->checkIn(std::move(session), driveDbId, false);
+    });
+    Utility::msleep(100);
+    CPPUNIT_ASSERT(!checkedOut);
+
+    // The other drives are not limited
+    auto otherDriveSession = HttpSessionPool::instance()->checkOut(uri, 0, context, driveDbId + 1, reused);
+    CPPUNIT_ASSERT(otherDriveSession);
+    HttpSessionPool::instance()->checkIn(std::move(otherDriveSession), driveDbId + 1, false);
+
+    HttpSessionPool::instance()->checkIn(std::move(sessions.back()), driveDbId, false);
+    sessions.pop_back();
+    waitingThread.join();
+    CPPUNIT_ASSERT(checkedOut);
+    for (auto &session : sessions) {
+        HttpSessionPool::instance()->checkIn(std::move(session), driveDbId, false);
+    }
+}
+
 }  // namespace KDC
@@ -33,6 +33,8 @@ class TestNetworkJobs : public CppUnit::TestFixture {
         CPPUNIT_TEST(testDelete);
         CPPUNIT_TEST(testDownload);
         CPPUNIT_TEST(testDownloadAborted);
+        CPPUNIT_TEST(testDownloadSegment);
+        CPPUNIT_TEST(testDownloadTmpFiles);
         CPPUNIT_TEST(testGetAvatar);
         CPPUNIT_TEST(testGetDriveList);
         CPPUNIT_TEST(testGetFileInfo);
@@ -42,6 +44,8 @@ class TestNetworkJobs : public CppUnit::TestFixture {
         CPPUNIT_TEST(testFullFileListWithCursorJsonZip);
         CPPUNIT_TEST(testFullFileListWithCursorCsv);
         CPPUNIT_TEST(testFullFileListWithCursorCsvZip);
+        CPPUNIT_TEST(testFullFileListWithCursorCsvStreamed);
+        CPPUNIT_TEST(testFullFileListWithCursorCsvNoFinalLineBreak);
         CPPUNIT_TEST(testFullFileListWithCursorJsonBlacklist);
         CPPUNIT_TEST(testFullFileListWithCursorCsvBlacklist);
         CPPUNIT_TEST(testGetInfoUser);
@@ -50,6 +54,7 @@ class TestNetworkJobs : public CppUnit::TestFixture {
         CPPUNIT_TEST(testDuplicateRenameMove);
         CPPUNIT_TEST(testRename);
         CPPUNIT_TEST(testUpload);
+        CPPUNIT_TEST(testUploadStreamed);
         CPPUNIT_TEST(testUploadAborted);
         CPPUNIT_TEST(testUploadSessionConstructorException);
         CPPUNIT_TEST(testUploadSessionSynchronous);
@@ -57,6 +62,10 @@ class TestNetworkJobs : public CppUnit::TestFixture {
         CPPUNIT_TEST(testUploadSessionAsynchronous5);
         CPPUNIT_TEST(testUploadSessionSynchronousAborted);
         CPPUNIT_TEST(testUploadSessionAsynchronous5Aborted);
+        CPPUNIT_TEST(testUploadSessionResume);
+        CPPUNIT_TEST(testUploadSessionResumeAfterAbortedChunks);
+        CPPUNIT_TEST(testChunkBufferPool);
+        CPPUNIT_TEST(testHttpSessionPool);
         CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -69,6 +78,8 @@ class TestNetworkJobs : public CppUnit::TestFixture {
         void testDelete();
         void testDownload();
         void testDownloadAborted();
+        void testDownloadSegment();
+        void testDownloadTmpFiles();
         void testGetAvatar();
         void testGetDriveList();
         void testGetFileInfo();
@@ -78,6 +89,8 @@ class TestNetworkJobs : public CppUnit::TestFixture {
         void testFullFileListWithCursorJsonZip();
         void testFullFileListWithCursorCsv();
         void testFullFileListWithCursorCsvZip();
+        void testFullFileListWithCursorCsvStreamed();
+        void testFullFileListWithCursorCsvNoFinalLineBreak();
         void testFullFileListWithCursorJsonBlacklist();
         void testFullFileListWithCursorCsvBlacklist();
         void testGetInfoUser();
@@ -86,6 +99,7 @@ class TestNetworkJobs : public CppUnit::TestFixture {
         void testDuplicateRenameMove();
         void testRename();
         void testUpload();
+        void testUploadStreamed();  // The content of a file is sent from the file, in several blocks
         void testUploadAborted();
         void testUploadSessionConstructorException();
         void testUploadSessionSynchronous();
@@ -93,6 +107,10 @@ class TestNetworkJobs : public CppUnit::TestFixture {
         void testUploadSessionAsynchronous5();
         void testUploadSessionSynchronousAborted();
         void testUploadSessionAsynchronous5Aborted();
+        void testUploadSessionResume();  // An interrupted session resumes from the chunks not uploaded yet
+        void testUploadSessionResumeAfterAbortedChunks();  // The chunks cut by an abort are not considered as uploaded
+        void testChunkBufferPool();
+        void testHttpSessionPool();
 
     private:
         bool createTestDir();
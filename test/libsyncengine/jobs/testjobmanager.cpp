@@ -21,6 +21,7 @@
 #include "config.h"
 #include "db/parmsdb.h"
 #include "jobs/jobmanager.h"
+#include "jobs/jobexecutor.h"
 #include "jobs/network/createdirjob.h"
 #include "jobs/network/deletejob.h"
 #include "jobs/network/getfilelistjob.h"
@@ -31,7 +32,11 @@
 #include "libcommonserver/utility/utility.h"
 #include "requests/parameterscache.h"
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <unordered_set>
+#include <vector>
 
 using namespace CppUnit;
 
@@ -260,6 +265,169 @@ void TestJobManager::testJobDependencies() {
     }
 }
 
+class NoOpJob : public AbstractJob {
+    public:
+        void runJob() override { _exitCode = ExitCodeOk; }
+};
+
+void TestJobManager::testJobDependencyLatency() {
+    const int nbJobs = 100;
+    std::vector<UniqueId> jobIds;
+    std::shared_ptr<NoOpJob> parentJob = nullptr;
+    std::vector<std::shared_ptr<NoOpJob>> jobs;
+    for (int i = 0; i < nbJobs; i++) {
+        auto job = std::make_shared<NoOpJob>();
+        if (parentJob) {
+            job->setParentJobId(parentJob->jobId());
+        }
+        jobs.push_back(job);
+        jobIds.push_back(job->jobId());
+        parentJob = job;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (auto &job : jobs) {
+        JobManager::instance()->queueAsyncJob(job);
+    }
+    jobs.clear();
+    parentJob = nullptr;
+
+    while (!JobManager::instance()->isJobFinished(jobIds.back())) {
+        Utility::msleep(1);
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << " dependencyChainMs=" << elapsed.count();
+
+    // Each dependency hop used to cost up to 100ms of polling
+    CPPUNIT_ASSERT(elapsed.count() < nbJobs * 10);
+}
+
+class WaitingRunnable : public Poco::Runnable {
+    public:
+        void run() override {
+            while (!release) {
+                Utility::msleep(1);
+            }
+            done = true;
+        }
+
+        std::atomic<bool> release = false;
+        std::atomic<bool> done = false;
+};
+
+void TestJobManager::testExecutorLanes() {
+    JobExecutor executor({1, 1, 1});
+
+    WaitingRunnable networkTask;
+    WaitingRunnable controlTask;
+    controlTask.release = true;
+
+    executor.submit(JobLaneNetwork, networkTask);
+    CPPUNIT_ASSERT(!executor.available(JobLaneNetwork));
+    CPPUNIT_ASSERT(executor.available(JobLaneControl));
+    executor.submit(JobLaneControl, controlTask);
+
+    const auto start = std::chrono::steady_clock::now();
+    while (!controlTask.done && std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+        Utility::msleep(1);
+    }
+    CPPUNIT_ASSERT(controlTask.done);
+    CPPUNIT_ASSERT(!networkTask.done);
+
+    networkTask.release = true;
+    executor.stop();
+    CPPUNIT_ASSERT(networkTask.done);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), executor.laneStats(JobLaneNetwork).nbCompleted);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), executor.laneStats(JobLaneControl).nbCompleted);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), executor.laneStats(JobLaneDiskCpu).nbCompleted);
+}
+
+void TestJobManager::testExecutorStealing() {
+    JobExecutor executor({2, 1, 1});
+
+    WaitingRunnable firstTask;
+    WaitingRunnable secondTask;
+    WaitingRunnable thirdTask;
+    thirdTask.release = true;
+
+    executor.submit(JobLaneNetwork, firstTask);
+    executor.submit(JobLaneNetwork, secondTask);
+    auto start = std::chrono::steady_clock::now();
+    while (executor.laneStats(JobLaneNetwork).nbRunning < 2 &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+        Utility::msleep(1);
+    }
+    CPPUNIT_ASSERT_EQUAL(int64_t(2), executor.laneStats(JobLaneNetwork).nbRunning);
+
+    // Queued behind a busy worker, taken by the first worker to be free
+    executor.submit(JobLaneNetwork, thirdTask);
+    secondTask.release = true;
+    start = std::chrono::steady_clock::now();
+    while (!thirdTask.done && std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+        Utility::msleep(1);
+    }
+    CPPUNIT_ASSERT(thirdTask.done);
+    CPPUNIT_ASSERT(!firstTask.done);
+    CPPUNIT_ASSERT(executor.laneStats(JobLaneNetwork).nbStolen >= 1);
+
+    firstTask.release = true;
+    executor.stop();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(3), executor.laneStats(JobLaneNetwork).nbCompleted);
+}
+
+class OrderedRunnable : public Poco::Runnable {
+    public:
+        OrderedRunnable(int id, std::vector<int> &order, std::mutex &orderMutex) :
+            _id(id),
+            _order(order),
+            _orderMutex(orderMutex) {}
+
+        void run() override {
+            const std::lock_guard<std::mutex> lock(_orderMutex);
+            _order.push_back(_id);
+        }
+
+    private:
+        int _id;
+        std::vector<int> &_order;
+        std::mutex &_orderMutex;
+};
+
+void TestJobManager::testExecutorPriority() {
+    JobExecutor executor({1, 1, 1});
+
+    WaitingRunnable blockingTask;
+    executor.submit(JobLaneNetwork, blockingTask);
+    const auto start = std::chrono::steady_clock::now();
+    while (executor.laneStats(JobLaneNetwork).nbRunning < 1 &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+        Utility::msleep(1);
+    }
+    CPPUNIT_ASSERT_EQUAL(int64_t(1), executor.laneStats(JobLaneNetwork).nbRunning);
+
+    // Queued behind the blocking task
+    std::vector<int> order;
+    std::mutex orderMutex;
+    OrderedRunnable lowTask(1, order, orderMutex);
+    OrderedRunnable firstHighTask(2, order, orderMutex);
+    OrderedRunnable normalTask(3, order, orderMutex);
+    OrderedRunnable secondHighTask(4, order, orderMutex);
+    executor.submit(JobLaneNetwork, lowTask, Poco::Thread::PRIO_LOW);
+    executor.submit(JobLaneNetwork, firstHighTask, Poco::Thread::PRIO_HIGH);
+    executor.submit(JobLaneNetwork, normalTask, Poco::Thread::PRIO_NORMAL);
+    executor.submit(JobLaneNetwork, secondHighTask, Poco::Thread::PRIO_HIGH);
+
+    blockingTask.release = true;
+    while (executor.laneStats(JobLaneNetwork).nbCompleted < 5 &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+        Utility::msleep(1);
+    }
+    executor.stop();
+
+    const std::lock_guard<std::mutex> lock(orderMutex);
+    CPPUNIT_ASSERT((order == std::vector<int>{2, 4, 3, 1}));
+}
+
 void TestJobManager::testJobPriority() {
     SyncPath pict1Path = localTestDirPath_pictures / "picture-1.jpg";
     SyncPath pict2Path = localTestDirPath_pictures / "picture-2.jpg";
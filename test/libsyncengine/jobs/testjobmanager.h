@@ -36,6 +36,10 @@ class TestJobManager : public CppUnit::TestFixture {
         CPPUNIT_TEST(testWithCallback);
         CPPUNIT_TEST(testCancelJobs);
         CPPUNIT_TEST(testJobDependencies);
+        CPPUNIT_TEST(testJobDependencyLatency);
+        CPPUNIT_TEST(testExecutorLanes);
+        CPPUNIT_TEST(testExecutorStealing);
+        CPPUNIT_TEST(testExecutorPriority);
         CPPUNIT_TEST(testJobPriority);
         CPPUNIT_TEST(testJobPriority2);
         CPPUNIT_TEST(testJobPriority3);
@@ -51,6 +55,10 @@ class TestJobManager : public CppUnit::TestFixture {
         void testWithCallback();
         void testCancelJobs();
         void testJobDependencies();
+        void testJobDependencyLatency();  // A job must be started as soon as its parent job has finished
+        void testExecutorLanes();         // A saturated lane must not delay the jobs of the other lanes
+        void testExecutorStealing();      // A task queued behind a busy worker must be taken by an idle one
+        void testExecutorPriority();      // Queued tasks must be started by decreasing priority
         void testJobPriority();   // Test execution order of jobs with different priority. Jobs with higher piority must be
                                   // executed first.
         void testJobPriority2();  // Test execution order of jobs with same priority. Jobs created first must be executed first.
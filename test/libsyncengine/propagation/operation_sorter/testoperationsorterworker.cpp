@@ -50,7 +50,7 @@ void TestOperationSorterWorker::tearDown() {
     _syncPal->_syncDb->close();
 }
 
-void TestOperationSorterWorker::testMoveFirstAfterSecond() {
+void TestOperationSorterWorker::testSortByDependencies() {
     std::shared_ptr<Node> node1 =
         std::shared_ptr<Node>(new Node(std::nullopt, ReplicaSideLocal, Str("1"), NodeTypeDirectory, std::nullopt, 0, 0, 12345));
     std::shared_ptr<Node> node2 =
@@ -80,7 +80,9 @@ void TestOperationSorterWorker::testMoveFirstAfterSecond() {
     CPPUNIT_ASSERT(_syncPal->_syncOps->size() == 5);
 
     // op2 is moved after op4
-    _syncPal->_operationsSorterWorker->moveFirstAfterSecond(op2, op4);
+    _syncPal->_operationsSorterWorker->addDependency(op2, op4);
+    CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
+    CPPUNIT_ASSERT(op2->parentId() == op4->id());
     int opFirstId;
     int opSecondId;
     int i = 1;
@@ -97,7 +99,9 @@ void TestOperationSorterWorker::testMoveFirstAfterSecond() {
     CPPUNIT_ASSERT(opFirstId == 4);
     CPPUNIT_ASSERT(opSecondId == 3);
     // nothing moved bc op5 is at 5 and op2 at 4
-    _syncPal->_operationsSorterWorker->moveFirstAfterSecond(op5, op2);
+    _syncPal->_operationsSorterWorker->addDependency(op5, op2);
+    CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
+    CPPUNIT_ASSERT(op5->parentId() == op2->id());
     i = 1;
     for (const auto &opId : _syncPal->_syncOps->opSortedList()) {
         SyncOpPtr op = _syncPal->_syncOps->getOp(opId);
@@ -111,21 +115,23 @@ void TestOperationSorterWorker::testMoveFirstAfterSecond() {
     }
     CPPUNIT_ASSERT(opFirstId == 5);
     CPPUNIT_ASSERT(opSecondId == 4);
-    // op4 is moved at 5 and op5 at 4
-    _syncPal->_operationsSorterWorker->moveFirstAfterSecond(op4, op5);
-    i = 1;
+    // op4 cannot run after op5: cycle op4 -> op2 -> op5 -> op4, the order is left unchanged
+    _syncPal->_operationsSorterWorker->addDependency(op4, op5);
+    CPPUNIT_ASSERT(!_syncPal->_operationsSorterWorker->sortByDependencies());
+    std::vector<SyncOpPtr> expectedOrder = {op1, op3, op4, op2, op5};
+    int index = 0;
     for (const auto &opId : _syncPal->_syncOps->opSortedList()) {
-        SyncOpPtr op = _syncPal->_syncOps->getOp(opId);
-        if (op == op4) {
-            opFirstId = i;
-        }
-        if (op == op5) {
-            opSecondId = i;
-        }
-        i++;
+        CPPUNIT_ASSERT(opId == expectedOrder[index++]->id());
     }
-    CPPUNIT_ASSERT(opFirstId == 5);
-    CPPUNIT_ASSERT(opSecondId == 4);
+
+    std::list<SyncOperationList> cycles = _syncPal->_operationsSorterWorker->findCompleteCycles();
+    CPPUNIT_ASSERT(cycles.size() == 1);
+    std::vector<SyncOpPtr> expectedCycle = {op4, op2, op5};
+    index = 0;
+    for (const auto &opId : cycles.front()._opSortedList) {
+        CPPUNIT_ASSERT(opId == expectedCycle[index++]->id());
+    }
+    CPPUNIT_ASSERT(index == 3);
 }
 
 void TestOperationSorterWorker::testFixDeleteBeforeMove() {
@@ -233,6 +239,7 @@ void TestOperationSorterWorker::testFixDeleteBeforeMove() {
     _syncPal->_operationsSorterWorker->_unsortedList = *_syncPal->_syncOps;
 
     _syncPal->_operationsSorterWorker->fixDeleteBeforeMove();
+    CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op1->id());
     _syncPal->_syncOps->_opSortedList.pop_back();
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op2->id());
@@ -347,6 +354,7 @@ void TestOperationSorterWorker::testFixMoveBeforeCreate() {
     _syncPal->_operationsSorterWorker->_unsortedList = *_syncPal->_syncOps;
 
     _syncPal->_operationsSorterWorker->fixMoveBeforeCreate();
+    CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op2->id());
     _syncPal->_syncOps->_opSortedList.pop_back();
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op1->id());
@@ -459,6 +467,7 @@ void TestOperationSorterWorker::testFixMoveBeforeDelete() {
     _syncPal->_operationsSorterWorker->_unsortedList = *_syncPal->_syncOps;
 
     _syncPal->_operationsSorterWorker->fixMoveBeforeDelete();
+    CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op2->id());
     _syncPal->_syncOps->_opSortedList.pop_back();
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op1->id());
@@ -573,6 +582,7 @@ void TestOperationSorterWorker::testFixCreateBeforeMove() {
     _syncPal->_operationsSorterWorker->_unsortedList = *_syncPal->_syncOps;
 
     _syncPal->_operationsSorterWorker->fixCreateBeforeMove();
+    CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op1->id());
     _syncPal->_syncOps->_opSortedList.pop_back();
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op2->id());
@@ -629,6 +639,7 @@ void TestOperationSorterWorker::testFixCreateBeforeMoveBis() {
     _syncPal->_operationsSorterWorker->_unsortedList = *_syncPal->_syncOps;
 
     _syncPal->_operationsSorterWorker->fixMoveBeforeCreate();
+    CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op2->id());
     _syncPal->_syncOps->_opSortedList.pop_back();
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op1->id());
@@ -751,6 +762,7 @@ void TestOperationSorterWorker::testFixDeleteBeforeCreate() {
     _syncPal->_operationsSorterWorker->_unsortedList = *_syncPal->_syncOps;
 
     _syncPal->_operationsSorterWorker->fixDeleteBeforeCreate();
+    CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op2->id());
     _syncPal->_syncOps->_opSortedList.pop_back();
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op1->id());
@@ -842,6 +854,7 @@ void TestOperationSorterWorker::testFixMoveBeforeMoveOccupied() {
     _syncPal->_operationsSorterWorker->_unsortedList = *_syncPal->_syncOps;
 
     _syncPal->_operationsSorterWorker->fixMoveBeforeMoveOccupied();
+    CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op1->id());
     _syncPal->_syncOps->_opSortedList.pop_back();
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op2->id());
@@ -961,6 +974,7 @@ void TestOperationSorterWorker::testFixCreateBeforeCreate() {
         std::vector<SyncOpPtr> expectedRes = {opA, opAA, opAAA, opAAB, opAB, opB};
 
         _syncPal->_operationsSorterWorker->fixCreateBeforeCreate();
+        CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
 
         Console << Str("Final ops order : ");
         for (const auto &opId : _syncPal->_syncOps->_opSortedList) {
@@ -986,16 +1000,17 @@ void TestOperationSorterWorker::testFixCreateBeforeCreate() {
         _syncPal->_syncOps->pushOp(opA);
         _syncPal->_syncOps->pushOp(opB);
         _syncPal->_operationsSorterWorker->_unsortedList = *_syncPal->_syncOps;
-        // Expected order: A AB AA AAB AAA B
+        // Expected order: A AA AAA AAB AB B
         Console << Str("Initial ops order : ");
         for (const auto &opId : _syncPal->_syncOps->_opSortedList) {
             SyncOpPtr op = _syncPal->_syncOps->_allOps[opId];
             Console << op->affectedNode()->name().c_str() << Str(" ");
         }
         Console << std::endl;
-        std::vector<SyncOpPtr> expectedRes = {opA, opAB, opAA, opAAB, opAAA, opB};
+        std::vector<SyncOpPtr> expectedRes = {opA, opAA, opAAA, opAAB, opAB, opB};
 
         _syncPal->_operationsSorterWorker->fixCreateBeforeCreate();
+        CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
 
         Console << Str("Final ops order : ");
         for (const auto &opId : _syncPal->_syncOps->_opSortedList) {
@@ -1021,16 +1036,17 @@ void TestOperationSorterWorker::testFixCreateBeforeCreate() {
         _syncPal->_syncOps->pushOp(opAB);
         _syncPal->_syncOps->pushOp(opA);
         _syncPal->_operationsSorterWorker->_unsortedList = *_syncPal->_syncOps;
-        // Expected order: B A AB AA AAB AAA
+        // Expected order: B A AA AAA AAB AB
         Console << Str("Initial ops order : ");
         for (const auto &opId : _syncPal->_syncOps->_opSortedList) {
             SyncOpPtr op = _syncPal->_syncOps->_allOps[opId];
             Console << op->affectedNode()->name().c_str() << Str(" ");
         }
         Console << std::endl;
-        std::vector<SyncOpPtr> expectedRes = {opB, opA, opAB, opAA, opAAB, opAAA};
+        std::vector<SyncOpPtr> expectedRes = {opB, opA, opAA, opAAA, opAAB, opAB};
 
         _syncPal->_operationsSorterWorker->fixCreateBeforeCreate();
+        CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
 
         Console << Str("Final ops order : ");
         for (const auto &opId : _syncPal->_syncOps->_opSortedList) {
@@ -1128,6 +1144,7 @@ void TestOperationSorterWorker::testFixMoveBeforeMoveParentChildFilp() {
     _syncPal->_operationsSorterWorker->_unsortedList = *_syncPal->_syncOps;
 
     _syncPal->_operationsSorterWorker->fixMoveBeforeMoveHierarchyFlip();
+    CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortByDependencies());
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op3->id());
     _syncPal->_syncOps->_opSortedList.pop_back();
     CPPUNIT_ASSERT(_syncPal->_syncOps->_opSortedList.back() == op1->id());
@@ -1297,7 +1314,17 @@ void TestOperationSorterWorker::testFindCompleteCycles() {
     opD->setAffectedNode(nodeD);
     opD->setNewName(Str("D*"));
 
-    _syncPal->_operationsSorterWorker->_reorderings = {{opB, opC}, {opD, opA}, {opA, opB}, {opC, opD}};
+    _syncPal->_syncOps->pushOp(opA);
+    _syncPal->_syncOps->pushOp(opB);
+    _syncPal->_syncOps->pushOp(opC);
+    _syncPal->_syncOps->pushOp(opD);
+
+    // A -> B -> C -> D -> A
+    _syncPal->_operationsSorterWorker->addDependency(opC, opB);
+    _syncPal->_operationsSorterWorker->addDependency(opA, opD);
+    _syncPal->_operationsSorterWorker->addDependency(opB, opA);
+    _syncPal->_operationsSorterWorker->addDependency(opD, opC);
+    CPPUNIT_ASSERT(!_syncPal->_operationsSorterWorker->sortByDependencies());
     std::list<SyncOperationList> cycles = _syncPal->_operationsSorterWorker->findCompleteCycles();
     CPPUNIT_ASSERT(cycles.size() == 1);
     CPPUNIT_ASSERT(cycles.back()._opSortedList.back() == opD->id());
@@ -1308,7 +1335,12 @@ void TestOperationSorterWorker::testFindCompleteCycles() {
     cycles.back()._opSortedList.pop_back();
     CPPUNIT_ASSERT(cycles.back()._opSortedList.back() == opA->id());
 
-    _syncPal->_operationsSorterWorker->_reorderings = {{opB, opA}, {opA, opC}, {opC, opA}};
+    // B -> A, A -> C -> A
+    _syncPal->_operationsSorterWorker->_dependencies.clear();
+    _syncPal->_operationsSorterWorker->addDependency(opA, opB);
+    _syncPal->_operationsSorterWorker->addDependency(opC, opA);
+    _syncPal->_operationsSorterWorker->addDependency(opA, opC);
+    CPPUNIT_ASSERT(!_syncPal->_operationsSorterWorker->sortByDependencies());
     cycles = _syncPal->_operationsSorterWorker->findCompleteCycles();
     CPPUNIT_ASSERT(cycles.size() == 1);
     CPPUNIT_ASSERT(cycles.back()._opSortedList.back() == opC->id());
@@ -1450,5 +1482,61 @@ void TestOperationSorterWorker::testBreakCycleEx2() {
     CPPUNIT_ASSERT(resolutionOp->affectedNode()->idb() == op1->affectedNode()->idb());
 }
 
+void TestOperationSorterWorker::testSortOperationsTiming() {
+    SyncTime createdAt = 1654788079;
+    SyncTime lastmodified = 1654788079;
+    int64_t size = 12345;
+    std::shared_ptr<Node> rootNode(new Node(std::nullopt, ReplicaSideLocal, Str(""), NodeTypeDirectory, OperationTypeNone,
+                                            "root", createdAt, lastmodified, size, nullptr));
+
+    for (const int nbOps : {10000, 100000, 500000}) {
+        // 1 directory for 9 files, the files are listed before the directories
+        const int nbDirs = nbOps / 10;
+        std::vector<SyncOpPtr> dirOps;
+        std::list<SyncOpPtr> ops;
+        for (int i = 0; i < nbDirs; i++) {
+            std::shared_ptr<Node> dirNode(new Node(std::nullopt, ReplicaSideLocal, Str2SyncName("Dir " + std::to_string(i)),
+                                                   NodeTypeDirectory, OperationTypeCreate, "d" + std::to_string(i), createdAt,
+                                                   lastmodified, size, rootNode));
+            SyncOpPtr dirOp = std::make_shared<SyncOperation>();
+            dirOp->setAffectedNode(dirNode);
+            dirOp->setTargetSide(ReplicaSideRemote);
+            dirOp->setType(OperationTypeCreate);
+            dirOps.push_back(dirOp);
+        }
+        for (int i = 0; i < nbOps - nbDirs; i++) {
+            std::shared_ptr<Node> fileNode(new Node(std::nullopt, ReplicaSideLocal, Str2SyncName("File " + std::to_string(i)),
+                                                    NodeTypeFile, OperationTypeCreate, "f" + std::to_string(i), createdAt,
+                                                    lastmodified, size, dirOps[i % nbDirs]->affectedNode()));
+            SyncOpPtr fileOp = std::make_shared<SyncOperation>();
+            fileOp->setAffectedNode(fileNode);
+            fileOp->setTargetSide(ReplicaSideRemote);
+            fileOp->setType(OperationTypeCreate);
+            ops.push_back(fileOp);
+        }
+        ops.insert(ops.end(), dirOps.begin(), dirOps.end());
+        _syncPal->_syncOps->setOpList(ops);
+
+        const auto start = std::chrono::steady_clock::now();
+        CPPUNIT_ASSERT(_syncPal->_operationsSorterWorker->sortOperations() == ExitCodeOk);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << " nbOps" << nbOps << "_ms=" << elapsed.count();
+
+        // Each file comes after the directory containing it
+        CPPUNIT_ASSERT(_syncPal->_syncOps->size() == nbOps);
+        std::unordered_set<NodeId> createdDirIds;
+        for (const auto &opId : _syncPal->_syncOps->opSortedList()) {
+            SyncOpPtr op = _syncPal->_syncOps->getOp(opId);
+            if (op->affectedNode()->type() == NodeTypeDirectory) {
+                createdDirIds.insert(*op->affectedNode()->id());
+            } else {
+                const NodeId parentId = *op->affectedNode()->parentNode()->id();
+                CPPUNIT_ASSERT(createdDirIds.find(parentId) != createdDirIds.end());
+                CPPUNIT_ASSERT(op->parentId() == _syncPal->_syncOps->getOpIdsFromNodeId(parentId).front());
+            }
+        }
+        _syncPal->_syncOps->clear();
+    }
+}
 
 }  // namespace KDC
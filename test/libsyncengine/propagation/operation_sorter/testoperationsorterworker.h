@@ -25,7 +25,7 @@ namespace KDC {
 
 class TestOperationSorterWorker : public CppUnit::TestFixture {
         CPPUNIT_TEST_SUITE(TestOperationSorterWorker);
-        CPPUNIT_TEST(testMoveFirstAfterSecond);
+        CPPUNIT_TEST(testSortByDependencies);
         CPPUNIT_TEST(testFixDeleteBeforeMove);
         CPPUNIT_TEST(testFixMoveBeforeCreate);
         CPPUNIT_TEST(testFixMoveBeforeDelete);
@@ -39,13 +39,14 @@ class TestOperationSorterWorker : public CppUnit::TestFixture {
         CPPUNIT_TEST(testFindCompleteCycles);
         CPPUNIT_TEST(testBreakCycleEx1);
         CPPUNIT_TEST(testBreakCycleEx2);
+        CPPUNIT_TEST(testSortOperationsTiming);
         CPPUNIT_TEST_SUITE_END();
 
     public:
         void setUp() override;
         void tearDown() override;
 
-        void testMoveFirstAfterSecond();
+        void testSortByDependencies();
         void testFixDeleteBeforeMove();
         void testFixMoveBeforeCreate();
         void testFixMoveBeforeDelete();
@@ -59,6 +60,9 @@ class TestOperationSorterWorker : public CppUnit::TestFixture {
         void testFindCompleteCycles();
         void testBreakCycleEx1();
         void testBreakCycleEx2();
+        /** Sorts large lists of create operations, listed children first, and prints the time taken for each size.
+         */
+        void testSortOperationsTiming();
 
     private:
         std::shared_ptr<SyncPal> _syncPal = nullptr;
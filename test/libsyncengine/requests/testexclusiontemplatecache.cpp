@@ -211,4 +211,62 @@ void TestExclusionTemplateCache::testIsExcluded() {
 #endif
 }
 
+void TestExclusionTemplateCache::testMatcher() {
+    const std::vector<ExclusionTemplate> templates = {
+        ExclusionTemplate("exact"), ExclusionTemplate("pre*"),  ExclusionTemplate("*.suf", true), ExclusionTemplate("*mid*"),
+        ExclusionTemplate("a*b*c"), ExclusionTemplate("*x*y"),  ExclusionTemplate("ab*ba"),       ExclusionTemplate("q**"),
+        ExclusionTemplate("pre.suf*")};
+    ExclusionTemplateMatcher matcher(templates);
+    auto matchedTemplate = [&matcher](const std::string &fileName) {
+        const ExclusionTemplate *exclusionTemplate = matcher.match(fileName);
+        return exclusionTemplate ? exclusionTemplate->templ() : std::string();
+    };
+
+    CPPUNIT_ASSERT_EQUAL(templates[0].templ(), matchedTemplate("exact"));
+    CPPUNIT_ASSERT(matchedTemplate("exact2").empty());
+    CPPUNIT_ASSERT_EQUAL(templates[1].templ(), matchedTemplate("prefix"));
+    CPPUNIT_ASSERT_EQUAL(templates[2].templ(), matchedTemplate("file.suf"));
+    CPPUNIT_ASSERT_EQUAL(templates[3].templ(), matchedTemplate("amidb"));
+    CPPUNIT_ASSERT_EQUAL(templates[4].templ(), matchedTemplate("abc"));
+    CPPUNIT_ASSERT_EQUAL(templates[4].templ(), matchedTemplate("a1b2c"));
+    CPPUNIT_ASSERT(matchedTemplate("a1b2c3").empty());
+    CPPUNIT_ASSERT_EQUAL(templates[5].templ(), matchedTemplate("1x2y"));
+    CPPUNIT_ASSERT(matchedTemplate("1x2y3").empty());
+    CPPUNIT_ASSERT_EQUAL(templates[6].templ(), matchedTemplate("abba"));
+    CPPUNIT_ASSERT(matchedTemplate("aba").empty());
+    CPPUNIT_ASSERT_EQUAL(templates[7].templ(), matchedTemplate("q"));
+
+    // The first template in list order wins
+    CPPUNIT_ASSERT_EQUAL(templates[1].templ(), matchedTemplate("pre.suf"));
+    CPPUNIT_ASSERT_EQUAL(templates[2].templ(), matchedTemplate("x.suf"));
+    CPPUNIT_ASSERT(matcher.match("mid.suf")->warning());
+
+    // Only the file name is matched
+    bool isWarning = false;
+    CPPUNIT_ASSERT(ExclusionTemplateCache::instance()->isExcludedByTemplate(SyncPath("dir") / "test.lock", isWarning));
+    CPPUNIT_ASSERT(!ExclusionTemplateCache::instance()->isExcludedByTemplate(SyncPath("test.lock") / "test", isWarning));
+}
+
+void TestExclusionTemplateCache::testIsExcludedByTemplateTiming() {
+    const int nbNames = 2000000;
+    std::vector<SyncPath> names;
+    names.reserve(nbNames);
+    for (int i = 0; i < nbNames; i++) {
+        names.emplace_back("Folder " + std::to_string(i % 100) + "/Document " + std::to_string(i) + (i % 10 ? ".txt" : ".lock"));
+    }
+
+    int nbExcluded = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &name : names) {
+        bool isWarning = false;
+        if (ExclusionTemplateCache::instance()->isExcludedByTemplate(name, isWarning)) {
+            nbExcluded++;
+        }
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << " nsPerName=" << elapsed.count() / nbNames;
+
+    CPPUNIT_ASSERT_EQUAL(nbNames / 10, nbExcluded);
+}
+
 }  // namespace KDC
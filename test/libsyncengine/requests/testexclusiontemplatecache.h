@@ -27,6 +27,8 @@ namespace KDC {
 class TestExclusionTemplateCache : public CppUnit::TestFixture {
         CPPUNIT_TEST_SUITE(TestExclusionTemplateCache);
         CPPUNIT_TEST(testIsExcluded);
+        CPPUNIT_TEST(testMatcher);
+        CPPUNIT_TEST(testIsExcludedByTemplateTiming);
         CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -35,6 +37,10 @@ class TestExclusionTemplateCache : public CppUnit::TestFixture {
 
     protected:
         void testIsExcluded();
+        void testMatcher();
+        /** Matches millions of file names against the default templates and prints the time per name.
+         */
+        void testIsExcludedByTemplateTiming();
 };
 
 }  // namespace KDC
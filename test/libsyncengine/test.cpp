@@ -24,6 +24,11 @@
 #include "update_detection/file_system_observer/testlocalfilesystemobserverworker.h"
 #include "update_detection/file_system_observer/testsnapshot.h"
 #include "update_detection/file_system_observer/testcomputefsoperationworker.h"
+#include "update_detection/file_system_observer/testfileeventcoalescer.h"
+#if defined(__linux__)
+#include "update_detection/file_system_observer/testdirectoryscanner.h"
+#include "update_detection/file_system_observer/testparalleltreewalker.h"
+#endif
 #include "update_detection/update_detector/testupdatetree.h"
 #include "update_detection/update_detector/testupdatetreeworker.h"
 #include "reconciliation/platform_inconsistency_checker/testplatforminconsistencycheckerworker.h"
@@ -40,6 +45,11 @@
 namespace KDC {
 CPPUNIT_TEST_SUITE_REGISTRATION(TestExclusionTemplateCache);
 CPPUNIT_TEST_SUITE_REGISTRATION(TestLocalJobs);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestFileEventCoalescer);
+#if defined(__linux__)
+CPPUNIT_TEST_SUITE_REGISTRATION(TestDirectoryScanner);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestParallelTreeWalker);
+#endif
 // CPPUNIT_TEST_SUITE_REGISTRATION(TestNetworkJobs);
 // CPPUNIT_TEST_SUITE_REGISTRATION(TestJobManager);
 // CPPUNIT_TEST_SUITE_REGISTRATION(TestSyncDb);
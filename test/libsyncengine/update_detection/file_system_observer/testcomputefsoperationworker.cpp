@@ -213,7 +213,7 @@ void TestComputeFSOperationWorker::testMultipleOps() {
     // Rename operation on a blacklisted directory
     _syncPal->_remoteSnapshot->setName("rac", Str("AC-renamed"));
 
-
+    _syncPal->copySnapshots();
     _syncPal->_computeFSOperationsWorker->execute();
 
     FSOpPtr tmpOp = nullptr;
@@ -244,4 +244,28 @@ void TestComputeFSOperationWorker::testLnkFileAlreadySynchronized() {
     CPPUNIT_ASSERT(_syncPal->_localOperationSet->ops().empty());
 }
 
+void TestComputeFSOperationWorker::testIncrementalComparison() {
+    // The first comparison is a full one
+    _syncPal->_computeFSOperationsWorker->execute();
+    _syncPal->_localSnapshotCopy->clearDirtyIds();
+    _syncPal->_remoteSnapshotCopy->clearDirtyIds();
+
+    // Edit operation
+    _syncPal->_localSnapshot->setLastModified("laa", defaultTime + 60);
+    // Create operation
+    _syncPal->_localSnapshot->updateItem(SnapshotItem("lad", "la", Str("AD"), defaultTime, defaultTime, NodeTypeFile, 123));
+    _syncPal->copySnapshots();
+
+    std::unordered_set<NodeId> dirtyIds;
+    CPPUNIT_ASSERT(_syncPal->_localSnapshotCopy->dirtyIds(dirtyIds));
+    CPPUNIT_ASSERT(dirtyIds == std::unordered_set<NodeId>({"laa", "lad"}));
+
+    _syncPal->_computeFSOperationsWorker->execute();
+
+    FSOpPtr tmpOp = nullptr;
+    CPPUNIT_ASSERT(_syncPal->_localOperationSet->findOp("laa", OperationTypeEdit, tmpOp));
+    CPPUNIT_ASSERT(_syncPal->_localOperationSet->findOp("lad", OperationTypeCreate, tmpOp));
+    CPPUNIT_ASSERT_EQUAL(size_t(2), _syncPal->_localOperationSet->ops().size());
+}
+
 }  // namespace KDC
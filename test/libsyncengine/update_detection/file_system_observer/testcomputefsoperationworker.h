@@ -29,6 +29,7 @@ class TestComputeFSOperationWorker : public CppUnit::TestFixture {
         CPPUNIT_TEST(testNoOps);
         CPPUNIT_TEST(testMultipleOps);
         CPPUNIT_TEST(testLnkFileAlreadySynchronized);
+        CPPUNIT_TEST(testIncrementalComparison);
         CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -52,6 +53,10 @@ class TestComputeFSOperationWorker : public CppUnit::TestFixture {
          * No FS operation should be generated on an excluded file.
          */
         void testLnkFileAlreadySynchronized();
+        /**
+         * Once a sync has completed, only the items changed since then are compared with the DB.
+         */
+        void testIncrementalComparison();
 
     private:
         std::shared_ptr<SyncPal> _syncPal = nullptr;
@@ -0,0 +1,124 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testdirectoryscanner.h"
+#include "test_utility/temporarydirectory.h"
+
+#include <algorithm>
+#include <fstream>
+
+using namespace CppUnit;
+
+namespace KDC {
+
+static bool hasChange(const DirectoryScanner::ScanResult &result, const SyncPath &path, OperationType opType) {
+    return std::find(result.changes.begin(), result.changes.end(), std::make_pair(path, opType)) != result.changes.end();
+}
+
+void TestDirectoryScanner::testChanges() {
+    const TemporaryDirectory temporaryDirectory;
+    const SyncPath dirPath = temporaryDirectory.path / "dir";
+    std::filesystem::create_directories(dirPath / "subdir");
+    std::ofstream(dirPath / "edited") << "a";
+    std::ofstream(dirPath / "deleted") << "a";
+    std::ofstream(dirPath / "replaced") << "a";
+
+    DirectoryScanner scanner(std::chrono::milliseconds(1000), std::chrono::milliseconds(8000), std::chrono::minutes(5));
+    const auto now = std::chrono::steady_clock::now();
+    CPPUNIT_ASSERT(scanner.add(dirPath, now));
+    CPPUNIT_ASSERT(scanner.add(dirPath / "subdir", now));
+    CPPUNIT_ASSERT(!scanner.add(dirPath / "edited", now));
+    CPPUNIT_ASSERT_EQUAL(size_t(2), scanner.size());
+
+    // Nothing changed
+    DirectoryScanner::ScanResult result;
+    scanner.check(dirPath, now, result);
+    CPPUNIT_ASSERT(result.changes.empty() && result.changedDirs.empty());
+
+    std::ofstream(dirPath / "edited") << "ab";
+    std::filesystem::remove(dirPath / "deleted");
+    std::filesystem::remove(dirPath / "replaced");
+    std::filesystem::create_directory(dirPath / "replaced");
+    std::ofstream(dirPath / "created") << "a";
+    std::filesystem::rename(dirPath / "subdir", dirPath / "renamed");
+
+    scanner.check(dirPath, now, result);
+    CPPUNIT_ASSERT_EQUAL(size_t(7), result.changes.size());
+    CPPUNIT_ASSERT(hasChange(result, dirPath / "edited", OperationTypeEdit));
+    CPPUNIT_ASSERT(hasChange(result, dirPath / "deleted", OperationTypeDelete));
+    CPPUNIT_ASSERT(hasChange(result, dirPath / "replaced", OperationTypeDelete));
+    CPPUNIT_ASSERT(hasChange(result, dirPath / "replaced", OperationTypeCreate));
+    CPPUNIT_ASSERT(hasChange(result, dirPath / "created", OperationTypeCreate));
+    CPPUNIT_ASSERT(hasChange(result, dirPath / "subdir", OperationTypeDelete));
+    CPPUNIT_ASSERT(hasChange(result, dirPath / "renamed", OperationTypeCreate));
+
+    CPPUNIT_ASSERT(result.changedDirs == std::vector<SyncPath>{dirPath});
+    CPPUNIT_ASSERT(result.deletedDirs == std::vector<SyncPath>{dirPath / "subdir"});
+    CPPUNIT_ASSERT_EQUAL(size_t(2), result.createdDirs.size());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(7), scanner.detectedChangeCount());
+
+    // The directories below are removed with their parent
+    scanner.removeBelow(dirPath);
+    CPPUNIT_ASSERT(scanner.isEmpty());
+}
+
+void TestDirectoryScanner::testSchedule() {
+    const TemporaryDirectory temporaryDirectory;
+    const SyncPath dirPath = temporaryDirectory.path / "dir";
+    std::filesystem::create_directories(dirPath);
+
+    DirectoryScanner scanner(std::chrono::milliseconds(1000), std::chrono::milliseconds(4000), std::chrono::minutes(5));
+    const auto start = std::chrono::steady_clock::now();
+    CPPUNIT_ASSERT(scanner.add(dirPath, start));
+    CPPUNIT_ASSERT(scanner.nextCheckTime() == start + std::chrono::milliseconds(1000));
+
+    // Nothing is due yet
+    DirectoryScanner::ScanResult result;
+    scanner.checkDueDirectories(start, 10, result);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), scanner.checkCount());
+
+    // The interval doubles while the directory does not change, up to the maximum
+    auto now = start + std::chrono::milliseconds(1000);
+    scanner.checkDueDirectories(now, 10, result);
+    CPPUNIT_ASSERT(scanner.nextCheckTime() == now + std::chrono::milliseconds(2000));
+    now += std::chrono::milliseconds(2000);
+    scanner.checkDueDirectories(now, 10, result);
+    CPPUNIT_ASSERT(scanner.nextCheckTime() == now + std::chrono::milliseconds(4000));
+    now += std::chrono::milliseconds(4000);
+    scanner.checkDueDirectories(now, 10, result);
+    CPPUNIT_ASSERT(scanner.nextCheckTime() == now + std::chrono::milliseconds(4000));
+    CPPUNIT_ASSERT_EQUAL(uint64_t(3), scanner.checkCount());
+    CPPUNIT_ASSERT(result.changes.empty());
+
+    // A change brings it back to the minimum. The modification time is set back first, so that the change is not made
+    // within the same tick of the coarse kernel clock as the creation of the directory.
+    std::filesystem::last_write_time(dirPath, std::filesystem::last_write_time(dirPath) - std::chrono::seconds(10));
+    std::ofstream(dirPath / "created") << "a";
+    now += std::chrono::milliseconds(4000);
+    scanner.checkDueDirectories(now, 10, result);
+    CPPUNIT_ASSERT(hasChange(result, dirPath / "created", OperationTypeCreate));
+    CPPUNIT_ASSERT(scanner.nextCheckTime() == now + std::chrono::milliseconds(1000));
+
+    // A deleted directory is not checked anymore
+    std::filesystem::remove_all(dirPath);
+    now += std::chrono::milliseconds(1000);
+    scanner.checkDueDirectories(now, 10, result);
+    CPPUNIT_ASSERT(scanner.isEmpty());
+}
+
+}  // namespace KDC
@@ -0,0 +1,86 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testfileeventcoalescer.h"
+
+using namespace CppUnit;
+
+namespace KDC {
+
+void TestFileEventCoalescer::testMerge() {
+    FileEventCoalescer coalescer(std::chrono::milliseconds(50), std::chrono::milliseconds(500));
+    const auto now = std::chrono::steady_clock::now();
+
+    // Edits are merged, a create wins over an edit
+    coalescer.push("A", OperationTypeEdit, now);
+    coalescer.push("A", OperationTypeEdit, now);
+    coalescer.push("B", OperationTypeCreate, now);
+    coalescer.push("B", OperationTypeEdit, now);
+    coalescer.push("A", OperationTypeMove, now);
+
+    // A delete replaces the previous events, and a later create is kept apart
+    coalescer.push("C", OperationTypeCreate, now);
+    coalescer.push("C", OperationTypeDelete, now);
+    coalescer.push("C", OperationTypeDelete, now);
+    coalescer.push("C", OperationTypeCreate, now);
+    coalescer.push("C", OperationTypeEdit, now);
+
+    auto events = coalescer.take();
+    CPPUNIT_ASSERT(coalescer.isEmpty());
+    CPPUNIT_ASSERT_EQUAL(size_t(4), events.size());
+    auto it = events.begin();
+    CPPUNIT_ASSERT(it->first == SyncPath("A") && it->second == OperationTypeMove);
+    it++;
+    CPPUNIT_ASSERT(it->first == SyncPath("B") && it->second == OperationTypeCreate);
+    it++;
+    CPPUNIT_ASSERT(it->first == SyncPath("C") && it->second == OperationTypeDelete);
+    it++;
+    CPPUNIT_ASSERT(it->first == SyncPath("C") && it->second == OperationTypeCreate);
+
+    CPPUNIT_ASSERT_EQUAL(uint64_t(10), coalescer.rawEventCount());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(4), coalescer.deliveredEventCount());
+
+    // Nothing is merged with the events already taken
+    coalescer.push("A", OperationTypeEdit, now);
+    events = coalescer.take();
+    CPPUNIT_ASSERT_EQUAL(size_t(1), events.size());
+    CPPUNIT_ASSERT(events.front().second == OperationTypeEdit);
+}
+
+void TestFileEventCoalescer::testDeadline() {
+    FileEventCoalescer coalescer(std::chrono::milliseconds(50), std::chrono::milliseconds(500));
+    const auto start = std::chrono::steady_clock::now();
+
+    coalescer.push("A", OperationTypeEdit, start);
+    CPPUNIT_ASSERT(coalescer.deadline() == start + std::chrono::milliseconds(50));
+
+    // Each event postpones the delivery...
+    coalescer.push("A", OperationTypeEdit, start + std::chrono::milliseconds(40));
+    CPPUNIT_ASSERT(coalescer.deadline() == start + std::chrono::milliseconds(90));
+
+    // ...but not beyond the maximum delay
+    coalescer.push("A", OperationTypeEdit, start + std::chrono::milliseconds(480));
+    CPPUNIT_ASSERT(coalescer.deadline() == start + std::chrono::milliseconds(500));
+
+    // The window starts again with the next event
+    coalescer.take();
+    coalescer.push("A", OperationTypeEdit, start + std::chrono::milliseconds(600));
+    CPPUNIT_ASSERT(coalescer.deadline() == start + std::chrono::milliseconds(650));
+}
+
+}  // namespace KDC
@@ -36,6 +36,8 @@
 #include <Poco/Path.h>
 #include <Poco/File.h>
 
+#include <fstream>
+
 using namespace CppUnit;
 
 namespace KDC {
@@ -416,4 +418,83 @@ void TestLocalFileSystemObserverWorker::testFolderWatcher() {
     LOGW_DEBUG(_logger, L"***** Tests succesfully finished! *****");
 }
 
+#if defined(__linux__)
+void TestLocalFileSystemObserverWorker::testRestoreSnapshot() {
+    auto worker = std::dynamic_pointer_cast<LocalFileSystemObserverWorker>(_syncPal->_localFSObserverWorker);
+    CPPUNIT_ASSERT(worker);
+
+    // The snapshot is saved, restored and checked by the test
+    worker->stop();
+    worker->waitForExit();
+
+    const SyncPath rootPath = worker->_rootFolder;
+    std::filesystem::create_directory(rootPath / "A/AB/ABA");
+    std::ofstream(rootPath / "A/AB/removed.txt") << "removed";
+    std::ofstream(rootPath / "B/BB/replaced.txt") << "replaced";
+    std::ofstream(rootPath / "B/BB/edited.txt") << "edited";
+
+    // Directories not modified for a while: they are checked only if their timestamps change after the save
+    const auto oldTime = std::filesystem::last_write_time(rootPath) - std::chrono::hours(1);
+    for (const auto &dirPath : {rootPath / "A", rootPath / "A/AA", rootPath / "A/AB", rootPath / "A/AB/ABA", rootPath / "B",
+                                rootPath / "B/BA", rootPath / "B/BB", rootPath / testPicturesFolderPath}) {
+        std::filesystem::last_write_time(dirPath, oldTime);
+    }
+    Utility::msleep(2000);  // The change times are out of the window of the save
+
+    worker->_snapshot->init();
+    CPPUNIT_ASSERT(worker->exploreDir(rootPath) == ExitCodeOk);
+    worker->_snapshot->setValid(true);
+    worker->saveSnapshot();
+    CPPUNIT_ASSERT(std::filesystem::exists(worker->snapshotFilePath()));
+
+    // Changed directories
+    std::ofstream(rootPath / "A/AA/created.txt") << "created";
+    std::filesystem::rename(rootPath / testPicturesFolderPath / "picture-1.jpg",
+                            rootPath / testPicturesFolderPath / "picture-1-renamed.jpg");
+    std::filesystem::rename(rootPath / "B/BA", rootPath / "A/BA");
+
+    // Directories whose modification time is restored, as rsync -a or tar do
+    std::filesystem::remove(rootPath / "A/AB/removed.txt");
+    std::filesystem::rename(rootPath / "A/AB/ABA", rootPath / "A/AB/ABA-renamed");
+    std::filesystem::last_write_time(rootPath / "A/AB", oldTime);
+    std::filesystem::remove(rootPath / "B/BB/replaced.txt");
+    std::ofstream(rootPath / "B/BB/replaced.txt") << "replaced again";
+    std::ofstream(rootPath / "B/BB/edited.txt", std::ios::app) << " again";
+    std::filesystem::last_write_time(rootPath / "B/BB", oldTime);
+
+    SnapshotFile::Metadata metadata;
+    CPPUNIT_ASSERT(worker->restoreSnapshot(metadata));
+    CPPUNIT_ASSERT(worker->exploreDir(rootPath, metadata.savedAt) == ExitCodeOk);
+
+    std::unordered_set<NodeId> restoredIds;
+    worker->_snapshot->ids(restoredIds);
+    std::unordered_map<NodeId, SnapshotItem> restoredItems;
+    for (const auto &id : restoredIds) {
+        CPPUNIT_ASSERT(worker->_snapshot->getItem(id, restoredItems[id]));
+    }
+
+    // The restored snapshot must be the same as a snapshot built from scratch
+    worker->_snapshot->init();
+    CPPUNIT_ASSERT(worker->exploreDir(rootPath) == ExitCodeOk);
+
+    std::unordered_set<NodeId> ids;
+    worker->_snapshot->ids(ids);
+    CPPUNIT_ASSERT_EQUAL(ids.size(), restoredItems.size());
+    for (const auto &id : ids) {
+        SnapshotItem item;
+        CPPUNIT_ASSERT(worker->_snapshot->getItem(id, item));
+        const auto restoredItemIt = restoredItems.find(id);
+        CPPUNIT_ASSERT(restoredItemIt != restoredItems.end());
+        const SnapshotItem &restoredItem = restoredItemIt->second;
+        CPPUNIT_ASSERT(restoredItem.parentId() == item.parentId());
+        CPPUNIT_ASSERT(restoredItem.name() == item.name());
+        CPPUNIT_ASSERT(restoredItem.createdAt() == item.createdAt());
+        CPPUNIT_ASSERT(restoredItem.lastModified() == item.lastModified());
+        CPPUNIT_ASSERT(restoredItem.type() == item.type());
+        CPPUNIT_ASSERT(restoredItem.size() == item.size());
+        CPPUNIT_ASSERT(restoredItem.isLink() == item.isLink());
+    }
+}
+#endif
+
 }  // namespace KDC
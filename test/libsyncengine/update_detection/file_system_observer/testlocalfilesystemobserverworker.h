@@ -34,6 +34,9 @@ class LocalFileSystemObserverWorker;
 class TestLocalFileSystemObserverWorker : public CppUnit::TestFixture {
         CPPUNIT_TEST_SUITE(TestLocalFileSystemObserverWorker);
         CPPUNIT_TEST(testFolderWatcher);
+#if defined(__linux__)
+        CPPUNIT_TEST(testRestoreSnapshot);
+#endif
         CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -42,6 +45,9 @@ class TestLocalFileSystemObserverWorker : public CppUnit::TestFixture {
 
     protected:
         void testFolderWatcher(void);
+#if defined(__linux__)
+        void testRestoreSnapshot(void);
+#endif
 
     private:
         log4cplus::Logger _logger;
@@ -0,0 +1,181 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testparalleltreewalker.h"
+#include "test_utility/temporarydirectory.h"
+
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <unordered_set>
+
+using namespace CppUnit;
+
+namespace KDC {
+
+// `nbDirs` directories per level, with `nbFiles` files in each directory
+static uint64_t generateTree(const SyncPath &path, int depth, int nbDirs, int nbFiles) {
+    uint64_t nbItems = 0;
+    for (int i = 0; i < nbFiles; i++) {
+        std::ofstream(path / ("file" + std::to_string(i)));
+        nbItems++;
+    }
+    if (depth > 0) {
+        for (int i = 0; i < nbDirs; i++) {
+            const SyncPath dirPath = path / ("dir" + std::to_string(i));
+            std::filesystem::create_directory(dirPath);
+            nbItems += 1 + generateTree(dirPath, depth - 1, nbDirs, nbFiles);
+        }
+    }
+    return nbItems;
+}
+
+void TestParallelTreeWalker::testWalk() {
+    const TemporaryDirectory temporaryDirectory;
+    const SyncPath rootPath = temporaryDirectory.path / "tree";
+    std::filesystem::create_directory(rootPath);
+    const uint64_t nbItems = generateTree(rootPath, 3, 4, 5);
+    std::filesystem::create_directory_symlink(rootPath / "dir0", rootPath / "link");
+    std::filesystem::create_directories(rootPath / "skipped" / "child");
+
+    struct stat rootStat;
+    CPPUNIT_ASSERT(stat(rootPath.c_str(), &rootStat) == 0);
+
+    for (size_t nbThreads : {1, 4}) {
+        ParallelTreeWalker walker(nbThreads, 8);
+        std::vector<std::vector<uint64_t>> visited(nbThreads);
+        std::mutex mutex;
+        std::unordered_set<uint64_t> flushed;
+        std::unordered_set<uint64_t> allVisited;
+        bool isParentFlushed = true;
+        bool isVisitedOnce = true;
+
+        const ParallelTreeWalker::Visitor visit = [&](const ParallelTreeWalker::DirEntry &entry, size_t threadIndex) {
+            {
+                // The entries of a directory are visited after the directory itself has been flushed
+                const std::lock_guard<std::mutex> lock(mutex);
+                if (entry.dirInode != rootStat.st_ino && !flushed.contains(entry.dirInode)) {
+                    isParentFlushed = false;
+                }
+            }
+            visited[threadIndex].push_back(entry.stat.st_ino);
+            return std::string(entry.name) != "skipped";
+        };
+        const ParallelTreeWalker::Flusher flush = [&](size_t threadIndex) {
+            const std::lock_guard<std::mutex> lock(mutex);
+            for (uint64_t inode : visited[threadIndex]) {
+                if (!allVisited.insert(inode).second) {
+                    isVisitedOnce = false;
+                }
+                flushed.insert(inode);
+            }
+            visited[threadIndex].clear();
+        };
+
+        CPPUNIT_ASSERT(walker.walk(rootPath, visit, flush));
+        CPPUNIT_ASSERT(isParentFlushed);
+        CPPUNIT_ASSERT(isVisitedOnce);
+        // Each item once, plus the link and the skipped directory, but not what is below them
+        CPPUNIT_ASSERT_EQUAL(nbItems + 2, static_cast<uint64_t>(allVisited.size()));
+        CPPUNIT_ASSERT_EQUAL(uint64_t(1 + 4 + 16 + 64), walker.nbDirectories());
+    }
+
+    // Stop
+    ParallelTreeWalker walker(4);
+    const auto visit = [](const ParallelTreeWalker::DirEntry &, size_t) { return true; };
+    const auto flush = [](size_t) {};
+    CPPUNIT_ASSERT(!walker.walk(rootPath, visit, flush, [] { return true; }));
+    CPPUNIT_ASSERT_EQUAL(0, walker.error());
+
+    // Error
+    CPPUNIT_ASSERT(!walker.walk(rootPath / "missing", visit, flush));
+    CPPUNIT_ASSERT_EQUAL(ENOENT, walker.error());
+}
+
+void TestParallelTreeWalker::testWalkStress() {
+    // Deep and narrow: a single directory per level has children, so that the queues are mostly empty and the threads keep
+    // stealing the few directories available
+    const TemporaryDirectory temporaryDirectory;
+    SyncPath dirPath = temporaryDirectory.path / "tree";
+    std::filesystem::create_directory(dirPath);
+    const SyncPath rootPath = dirPath;
+    uint64_t nbItems = 0;
+    for (int depth = 0; depth < 100; depth++) {
+        std::ofstream(dirPath / "file");
+        std::filesystem::create_directory(dirPath / "leaf");
+        std::filesystem::create_directory(dirPath / "next");
+        dirPath /= "next";
+        nbItems += 3;
+    }
+
+    for (size_t batchSize : {1, 2, 16}) {
+        for (int i = 0; i < 200; i++) {
+            ParallelTreeWalker walker(16, batchSize);
+            std::atomic<uint64_t> nbVisited = 0;
+            // Bounded, so that a walk that never ends fails instead of blocking the tests
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            CPPUNIT_ASSERT(walker.walk(
+                rootPath,
+                [&nbVisited](const ParallelTreeWalker::DirEntry &, size_t) {
+                    nbVisited++;
+                    return true;
+                },
+                [](size_t) {}, [&deadline] { return std::chrono::steady_clock::now() > deadline; }));
+            CPPUNIT_ASSERT_EQUAL(nbItems, nbVisited.load());
+        }
+    }
+}
+
+void TestParallelTreeWalker::testWalkTiming() {
+    const TemporaryDirectory temporaryDirectory;
+    const SyncPath rootPath = temporaryDirectory.path / "tree";
+    std::filesystem::create_directory(rootPath);
+    const uint64_t nbItems = generateTree(rootPath, 2, 20, 50);
+
+    // Reference: one path resolution per entry
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nbFound = 0;
+    for (auto dirIt = std::filesystem::recursive_directory_iterator(rootPath);
+         dirIt != std::filesystem::recursive_directory_iterator(); ++dirIt) {
+        struct stat entryStat;
+        if (lstat(dirIt->path().c_str(), &entryStat) == 0) {
+            nbFound++;
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << " nbItems=" << nbItems << " iterator_ms=" << elapsed.count();
+    CPPUNIT_ASSERT_EQUAL(nbItems, nbFound);
+
+    for (size_t nbThreads : {size_t(1), ParallelTreeWalker::defaultThreadCount()}) {
+        ParallelTreeWalker walker(nbThreads);
+        std::atomic<uint64_t> nbVisited = 0;
+        start = std::chrono::steady_clock::now();
+        CPPUNIT_ASSERT(walker.walk(
+            rootPath,
+            [&nbVisited](const ParallelTreeWalker::DirEntry &, size_t) {
+                nbVisited++;
+                return true;
+            },
+            [](size_t) {}));
+        elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << " threads" << nbThreads << "_ms=" << elapsed.count();
+        CPPUNIT_ASSERT_EQUAL(nbItems, nbVisited.load());
+    }
+}
+
+}  // namespace KDC
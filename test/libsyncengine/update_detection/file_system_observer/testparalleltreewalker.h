@@ -0,0 +1,41 @@
+/*
+ * Infomaniak kDrive - Desktop
+ * Copyright (C) 2023-2024 Infomaniak Network SA
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "testincludes.h"
+#include "update_detection/file_system_observer/paralleltreewalker.h"
+
+using namespace CppUnit;
+
+namespace KDC {
+
+class TestParallelTreeWalker : public CppUnit::TestFixture {
+        CPPUNIT_TEST_SUITE(TestParallelTreeWalker);
+        CPPUNIT_TEST(testWalk);
+        CPPUNIT_TEST(testWalkStress);
+        CPPUNIT_TEST(testWalkTiming);
+        CPPUNIT_TEST_SUITE_END();
+
+    protected:
+        void testWalk();
+        void testWalkStress();
+        void testWalkTiming();
+};
+
+}  // namespace KDC
@@ -18,8 +18,13 @@
 
 #include "testsnapshot.h"
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <memory>
+#include <thread>
 #include "update_detection/file_system_observer/snapshot/snapshot.h"
+#include "test_utility/temporarydirectory.h"
 #include "libcommon/keychainmanager/keychainmanager.h"
 #include "libcommon/utility/utility.h"
 #include "db/syncdb.h"
@@ -104,8 +109,9 @@ void TestSnapshot::testSnapshot() {
     CPPUNIT_ASSERT(_syncPal->_localSnapshot->exists("a"));
     CPPUNIT_ASSERT(_syncPal->_localSnapshot->name("a") == Str("A"));
     CPPUNIT_ASSERT(_syncPal->_localSnapshot->type("a") == NodeType::NodeTypeDirectory);
-    auto itItem = _syncPal->_localSnapshot->_items.find(SyncDb::driveRootNode().nodeIdLocal().value());
-    CPPUNIT_ASSERT(itItem->second.childrenIds().find("a") != itItem->second.childrenIds().end());
+    std::unordered_set<NodeId> childrenIds;
+    _syncPal->_localSnapshot->getChildrenIds(SyncDb::driveRootNode().nodeIdLocal().value(), childrenIds);
+    CPPUNIT_ASSERT(childrenIds.find("a") != childrenIds.end());
 
     _syncPal->_localSnapshot->updateItem(SnapshotItem("a", SyncDb::driveRootNode().nodeIdLocal().value(), Str("A*"), 1640995202,
                                                       1640995202, NodeType::NodeTypeDirectory, 123));
@@ -115,19 +121,19 @@ void TestSnapshot::testSnapshot() {
                        NodeType::NodeTypeDirectory, 123);
     _syncPal->_localSnapshot->updateItem(itemB);
     CPPUNIT_ASSERT(_syncPal->_localSnapshot->exists("b"));
-    itItem = _syncPal->_localSnapshot->_items.find(SyncDb::driveRootNode().nodeIdLocal().value());
-    CPPUNIT_ASSERT(itItem->second.childrenIds().find("b") != itItem->second.childrenIds().end());
+    _syncPal->_localSnapshot->getChildrenIds(SyncDb::driveRootNode().nodeIdLocal().value(), childrenIds);
+    CPPUNIT_ASSERT(childrenIds.find("b") != childrenIds.end());
 
     SnapshotItem itemAA("aa", "a", Str("AA"), 1640995204, 1640995204, NodeType::NodeTypeDirectory, 123);
     _syncPal->_localSnapshot->updateItem(itemAA);
-    itItem = _syncPal->_localSnapshot->_items.find("a");
-    CPPUNIT_ASSERT(itItem->second.childrenIds().find("aa") != itItem->second.childrenIds().end());
+    _syncPal->_localSnapshot->getChildrenIds("a", childrenIds);
+    CPPUNIT_ASSERT(childrenIds.find("aa") != childrenIds.end());
 
     SnapshotItem itemAAA("aaa", "aa", Str("AAA"), 1640995205, 1640995205, NodeType::NodeTypeFile, 123);
     _syncPal->_localSnapshot->updateItem(itemAAA);
     CPPUNIT_ASSERT(_syncPal->_localSnapshot->exists("aaa"));
-    itItem = _syncPal->_localSnapshot->_items.find("aa");
-    CPPUNIT_ASSERT(itItem->second.childrenIds().find("aaa") != itItem->second.childrenIds().end());
+    _syncPal->_localSnapshot->getChildrenIds("aa", childrenIds);
+    CPPUNIT_ASSERT(childrenIds.find("aaa") != childrenIds.end());
 
     SyncPath path;
     _syncPal->_localSnapshot->path("aaa", path);
@@ -141,20 +147,322 @@ void TestSnapshot::testSnapshot() {
     _syncPal->_localSnapshot->updateItem(
         SnapshotItem("aa", "b", Str("AA"), 1640995204, 1640995204, NodeType::NodeTypeDirectory, 123));
     CPPUNIT_ASSERT(_syncPal->_localSnapshot->parentId("aa") == "b");
-    itItem = _syncPal->_localSnapshot->_items.find("b");
-    CPPUNIT_ASSERT(itItem->second.childrenIds().find("aa") != itItem->second.childrenIds().end());
-    itItem = _syncPal->_localSnapshot->_items.find("a");
-    CPPUNIT_ASSERT(itItem->second.childrenIds().empty());
+    _syncPal->_localSnapshot->getChildrenIds("b", childrenIds);
+    CPPUNIT_ASSERT(childrenIds.find("aa") != childrenIds.end());
+    _syncPal->_localSnapshot->getChildrenIds("a", childrenIds);
+    CPPUNIT_ASSERT(childrenIds.empty());
 
     _syncPal->_localSnapshot->removeItem("b");
     CPPUNIT_ASSERT(!_syncPal->_localSnapshot->exists("aaa"));
     CPPUNIT_ASSERT(!_syncPal->_localSnapshot->exists("aa"));
     CPPUNIT_ASSERT(!_syncPal->_localSnapshot->exists("b"));
-    itItem = _syncPal->_localSnapshot->_items.find(SyncDb::driveRootNode().nodeIdLocal().value());
-    CPPUNIT_ASSERT(itItem->second.childrenIds().find("b") == itItem->second.childrenIds().end());
+    _syncPal->_localSnapshot->getChildrenIds(SyncDb::driveRootNode().nodeIdLocal().value(), childrenIds);
+    CPPUNIT_ASSERT(childrenIds.find("b") == childrenIds.end());
 
     _syncPal->_localSnapshot->init();
-    CPPUNIT_ASSERT(_syncPal->_localSnapshot->_items.size() == 1);
+    CPPUNIT_ASSERT(_syncPal->_localSnapshot->nbItems() == 1);
+}
+
+void TestSnapshot::testSnapshotMemoryUsage() {
+    Snapshot snapshot(ReplicaSide::ReplicaSideLocal, SyncDb::driveRootNode());
+    const NodeId rootId = SyncDb::driveRootNode().nodeIdLocal().value();
+
+    // 1000 directories containing 100 files each
+    const int nbDirs = 1000;
+    const int nbFilesPerDir = 100;
+    for (int i = 0; i < nbDirs; i++) {
+        const NodeId dirId = "d" + std::to_string(i);
+        snapshot.updateItem(
+            SnapshotItem(dirId, rootId, Str2SyncName("Dir " + std::to_string(i)), 1640995201, 1640995201, NodeTypeDirectory, 0));
+        for (int j = 0; j < nbFilesPerDir; j++) {
+            snapshot.updateItem(SnapshotItem(dirId + "f" + std::to_string(j), dirId,
+                                             Str2SyncName("File " + std::to_string(j) + ".txt"), 1640995201, 1640995201,
+                                             NodeTypeFile, 123));
+        }
+    }
+    CPPUNIT_ASSERT(snapshot.nbItems() == 1 + nbDirs * (nbFilesPerDir + 1));
+
+    const uint64_t bytesPerItem = snapshot.memoryUsage() / snapshot.nbItems();
+    std::cout << " bytesPerItem=" << bytesPerItem;
+    CPPUNIT_ASSERT(bytesPerItem < 256);
+
+    SyncPath path;
+    CPPUNIT_ASSERT(snapshot.path("d999f99", path));
+    CPPUNIT_ASSERT(path == SyncPath("Dir 999/File 99.txt"));
+    CPPUNIT_ASSERT(snapshot.size("d999") == nbFilesPerDir * 123);
+}
+
+void TestSnapshot::testSnapshotCopy() {
+    const NodeId rootId = SyncDb::driveRootNode().nodeIdLocal().value();
+    Snapshot snapshot(ReplicaSide::ReplicaSideLocal, SyncDb::driveRootNode());
+    snapshot.updateItem(SnapshotItem("a", rootId, Str("A"), 1640995201, 1640995201, NodeTypeDirectory, 0));
+    snapshot.updateItem(SnapshotItem("aa", "a", Str("AA"), 1640995201, 1640995201, NodeTypeFile, 123));
+    CPPUNIT_ASSERT(snapshot.updated());
+
+    Snapshot snapshotCopy(ReplicaSide::ReplicaSideLocal, SyncDb::driveRootNode());
+    snapshotCopy = snapshot;
+    CPPUNIT_ASSERT(!snapshot.updated());
+    CPPUNIT_ASSERT(snapshotCopy.exists("aa"));
+
+    // Changes made to the source after the copy must not be visible in the copy
+    snapshot.updateItem(SnapshotItem("b", rootId, Str("B"), 1640995202, 1640995202, NodeTypeDirectory, 0));
+    snapshot.updateItem(SnapshotItem("aa", "b", Str("AA*"), 1640995202, 1640995202, NodeTypeFile, 456));
+    snapshot.removeItem("a");
+    CPPUNIT_ASSERT(snapshot.updated());
+
+    CPPUNIT_ASSERT(!snapshotCopy.exists("b"));
+    CPPUNIT_ASSERT(snapshotCopy.exists("a"));
+    CPPUNIT_ASSERT(snapshotCopy.parentId("aa") == "a");
+    CPPUNIT_ASSERT(snapshotCopy.name("aa") == Str("AA"));
+    CPPUNIT_ASSERT(snapshotCopy.size("aa") == 123);
+    CPPUNIT_ASSERT(snapshotCopy.itemId(SyncPath("A/AA")) == "aa");
+
+    CPPUNIT_ASSERT(!snapshot.exists("a"));
+    CPPUNIT_ASSERT(snapshot.itemId(SyncPath("B/AA*")) == "aa");
+}
+
+void TestSnapshot::testSnapshotPathResolution() {
+    Snapshot snapshot(ReplicaSide::ReplicaSideLocal, SyncDb::driveRootNode());
+    const NodeId rootId = SyncDb::driveRootNode().nodeIdLocal().value();
+
+    // Path resolution must not depend on the number of items in a directory
+    const int nbLookups = 10000;
+    for (const int fanOut : {10, 1000, 50000}) {
+        const NodeId dirId = "d" + std::to_string(fanOut);
+        const std::string dirName = "Dir " + std::to_string(fanOut);
+        snapshot.updateItem(SnapshotItem(dirId, rootId, Str2SyncName(dirName), 1640995201, 1640995201, NodeTypeDirectory, 0));
+        for (int i = 0; i < fanOut; i++) {
+            snapshot.updateItem(SnapshotItem(dirId + "f" + std::to_string(i), dirId,
+                                             Str2SyncName("File " + std::to_string(i) + ".txt"), 1640995201, 1640995201,
+                                             NodeTypeFile, 123));
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < nbLookups; i++) {
+            const int fileIndex = (i * 7919) % fanOut;
+            const SyncPath path = SyncPath(Str2SyncName(dirName)) / Str2SyncName("File " + std::to_string(fileIndex) + ".txt");
+            CPPUNIT_ASSERT(snapshot.itemId(path) == dirId + "f" + std::to_string(fileIndex));
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << " fanOut" << fanOut << "_nsPerLookup=" << elapsed.count() / nbLookups;
+    }
+
+    // Renamed and removed items are reflected in the index
+    CPPUNIT_ASSERT(snapshot.setName("d10f0", Str("Renamed.txt")));
+    CPPUNIT_ASSERT(snapshot.itemId(SyncPath("Dir 10/Renamed.txt")) == "d10f0");
+    CPPUNIT_ASSERT(snapshot.itemId(SyncPath("Dir 10/File 0.txt")).empty());
+    CPPUNIT_ASSERT(snapshot.removeItem("d10f1"));
+    CPPUNIT_ASSERT(snapshot.itemId(SyncPath("Dir 10/File 1.txt")).empty());
+
+    // Names are compared once NFC-normalized
+    snapshot.updateItem(SnapshotItem("nfd", "d10", Str("e\u0301te\u0301.txt"), 1640995201, 1640995201, NodeTypeFile, 0));
+    CPPUNIT_ASSERT(snapshot.itemId(SyncPath(Str("Dir 10/\u00e9t\u00e9.txt"))) == "nfd");
+
+    // Unless a sibling has exactly the same name
+    snapshot.updateItem(SnapshotItem("nfc", "d10", Str("\u00e9t\u00e9.txt"), 1640995201, 1640995201, NodeTypeFile, 0));
+    CPPUNIT_ASSERT(snapshot.itemId(SyncPath(Str("Dir 10/\u00e9t\u00e9.txt"))) == "nfc");
+    CPPUNIT_ASSERT(snapshot.itemId(SyncPath(Str("Dir 10/e\u0301te\u0301.txt"))) == "nfd");
+    CPPUNIT_ASSERT(snapshot.removeItem("nfc"));
+    CPPUNIT_ASSERT(snapshot.itemId(SyncPath(Str("Dir 10/\u00e9t\u00e9.txt"))) == "nfd");
+}
+
+void TestSnapshot::testSnapshotAggregates() {
+    Snapshot snapshot(ReplicaSide::ReplicaSideLocal, SyncDb::driveRootNode());
+    const NodeId rootId = SyncDb::driveRootNode().nodeIdLocal().value();
+
+    snapshot.updateItem(SnapshotItem("a", rootId, Str("A"), 1640995201, 1640995201, NodeTypeDirectory, 0));
+    snapshot.updateItem(SnapshotItem("aa", "a", Str("AA"), 1640995201, 1640995201, NodeTypeDirectory, 0));
+    snapshot.updateItem(SnapshotItem("aaa", "aa", Str("AAA"), 1640995201, 1640995201, NodeTypeFile, 100));
+    snapshot.updateItem(SnapshotItem("aab", "aa", Str("AAB"), 1640995201, 1640995201, NodeTypeFile, 20));
+    snapshot.updateItem(SnapshotItem("b", rootId, Str("B"), 1640995201, 1640995201, NodeTypeDirectory, 0));
+    CPPUNIT_ASSERT(snapshot.size("a") == 120);
+    CPPUNIT_ASSERT(snapshot.nbFiles("a") == 2);
+    CPPUNIT_ASSERT(snapshot.size(rootId) == 120);
+
+    // Edit, move and remove
+    snapshot.updateItem(SnapshotItem("aaa", "aa", Str("AAA"), 1640995201, 1640995202, NodeTypeFile, 300));
+    CPPUNIT_ASSERT(snapshot.size("a") == 320);
+    snapshot.updateItem(SnapshotItem("aa", "b", Str("AA"), 1640995201, 1640995201, NodeTypeDirectory, 0));
+    CPPUNIT_ASSERT(snapshot.size("a") == 0);
+    CPPUNIT_ASSERT(snapshot.nbFiles("a") == 0);
+    CPPUNIT_ASSERT(snapshot.size("b") == 320);
+    CPPUNIT_ASSERT(snapshot.nbFiles("b") == 2);
+    snapshot.removeItem("aab");
+    CPPUNIT_ASSERT(snapshot.size("b") == 300);
+    CPPUNIT_ASSERT(snapshot.nbFiles(rootId) == 1);
+
+    // Items received before their parent are orphans until the parent arrives
+    snapshot.updateItem(SnapshotItem("c", "unknown", Str("C"), 1640995201, 1640995201, NodeTypeDirectory, 0));
+    snapshot.updateItem(SnapshotItem("ca", "c", Str("CA"), 1640995201, 1640995201, NodeTypeFile, 10));
+    CPPUNIT_ASSERT(snapshot.isOrphan("ca"));
+    CPPUNIT_ASSERT(!snapshot.isOrphan("aaa"));
+    CPPUNIT_ASSERT(snapshot.size("c") == 10);
+    CPPUNIT_ASSERT(snapshot.size(rootId) == 300);
+
+    const uint64_t nbItems = snapshot.nbItems();
+    CPPUNIT_ASSERT(snapshot.removeOrphans() == 3);
+    CPPUNIT_ASSERT(snapshot.nbItems() == nbItems - 3);
+    CPPUNIT_ASSERT(!snapshot.exists("ca"));
+    CPPUNIT_ASSERT(snapshot.exists("aaa"));
+    CPPUNIT_ASSERT(snapshot.removeOrphans() == 0);
+}
+
+void TestSnapshot::testSnapshotConcurrentAccess() {
+    Snapshot snapshot(ReplicaSide::ReplicaSideLocal, SyncDb::driveRootNode());
+    const NodeId rootId = SyncDb::driveRootNode().nodeIdLocal().value();
+
+    const int nbFiles = 10000;
+    for (int i = 0; i < nbFiles; i++) {
+        snapshot.updateItem(SnapshotItem("f" + std::to_string(i), rootId, Str2SyncName("File " + std::to_string(i)), 1640995201,
+                                         1640995201, NodeTypeFile, 1));
+    }
+
+    // One writer (the observer) and several readers
+    std::atomic<bool> stop = false;
+    std::thread writer([&snapshot, &stop]() {
+        for (SyncTime time = 1640995202; !stop; time++) {
+            snapshot.setLastModified("f" + std::to_string(time % nbFiles), time);
+        }
+    });
+
+    const int nbReaders = 4;
+    const int nbReadsPerReader = 100000;
+    std::atomic<int> nbErrors = 0;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> readers;
+    for (int readerIndex = 0; readerIndex < nbReaders; readerIndex++) {
+        readers.emplace_back([&snapshot, &nbErrors, readerIndex, &rootId]() {
+            for (int i = 0; i < nbReadsPerReader; i++) {
+                const NodeId id = "f" + std::to_string((i * (readerIndex + 1)) % nbFiles);
+                if (snapshot.type(id) != NodeTypeFile || snapshot.lastModified(id) < 1640995201 ||
+                    snapshot.parentId(id) != rootId) {
+                    nbErrors++;
+                }
+            }
+        });
+    }
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    stop = true;
+    writer.join();
+
+    CPPUNIT_ASSERT(nbErrors == 0);
+    CPPUNIT_ASSERT(snapshot.nbItems() == nbFiles + 1);
+
+    const Snapshot::LockStats lockStats = snapshot.lockStats();
+    std::cout << " readsPerMs=" << nbReaders * nbReadsPerReader * 3 / std::max<int64_t>(elapsed.count(), 1)
+              << " contendedReads=" << lockStats.nbContendedReads << " contendedWrites=" << lockStats.nbContendedWrites
+              << " lockWaitUs=" << lockStats.waitTimeUs;
+
+    snapshot.resetLockStats();
+    CPPUNIT_ASSERT(snapshot.lockStats().nbContendedReads == 0);
+    CPPUNIT_ASSERT(snapshot.lockStats().nbContendedWrites == 0);
+    CPPUNIT_ASSERT(snapshot.lockStats().waitTimeUs == 0);
+}
+
+void TestSnapshot::testSnapshotDirtyIds() {
+    const NodeId rootId = SyncDb::driveRootNode().nodeIdLocal().value();
+    Snapshot snapshot(ReplicaSide::ReplicaSideLocal, SyncDb::driveRootNode());
+    snapshot.updateItem(SnapshotItem("a", rootId, Str("A"), 1640995201, 1640995201, NodeTypeDirectory, 0));
+    snapshot.updateItem(SnapshotItem("aa", "a", Str("AA"), 1640995201, 1640995201, NodeTypeFile, 123));
+    snapshot.updateItem(SnapshotItem("b", rootId, Str("B"), 1640995201, 1640995201, NodeTypeFile, 123));
+
+    // The first version of a snapshot needs a full comparison
+    Snapshot snapshotCopy(ReplicaSide::ReplicaSideLocal, SyncDb::driveRootNode());
+    snapshotCopy = snapshot;
+    std::unordered_set<NodeId> dirtyIds;
+    CPPUNIT_ASSERT(!snapshotCopy.dirtyIds(dirtyIds));
+    snapshotCopy.clearDirtyIds();
+
+    // Changes made after a copy are listed in the next one
+    snapshot.setLastModified("b", 1640995202);
+    snapshot.removeItem("a");
+    snapshotCopy = snapshot;
+    CPPUNIT_ASSERT(snapshotCopy.dirtyIds(dirtyIds));
+    CPPUNIT_ASSERT(dirtyIds == std::unordered_set<NodeId>({"a", "aa", "b"}));
+
+    // They stay listed until they have been synced
+    snapshot.setName("b", Str("B*"));
+    snapshot.updateItem(SnapshotItem("c", rootId, Str("C"), 1640995201, 1640995201, NodeTypeFile, 123));
+    snapshotCopy = snapshot;
+    CPPUNIT_ASSERT(snapshotCopy.dirtyIds(dirtyIds));
+    CPPUNIT_ASSERT(dirtyIds == std::unordered_set<NodeId>({"a", "aa", "b", "c"}));
+
+    snapshotCopy.clearDirtyIds();
+    snapshotCopy = snapshot;
+    CPPUNIT_ASSERT(snapshotCopy.dirtyIds(dirtyIds));
+    CPPUNIT_ASSERT(dirtyIds.empty());
+
+    // A rebuilt snapshot needs a full comparison
+    snapshot.init();
+    snapshotCopy = snapshot;
+    CPPUNIT_ASSERT(!snapshotCopy.dirtyIds(dirtyIds));
+}
+
+void TestSnapshot::testSnapshotSaveAndLoad() {
+    const TemporaryDirectory temporaryDirectory;
+    const SyncPath filePath = temporaryDirectory.path / "snapshot";
+    const NodeId rootId = SyncDb::driveRootNode().nodeIdLocal().value();
+
+    Snapshot snapshot(ReplicaSide::ReplicaSideLocal, SyncDb::driveRootNode());
+    snapshot.updateItem(SnapshotItem("a", rootId, Str("A"), 1640995201, 1640995202, NodeTypeDirectory, 0));
+    snapshot.updateItem(SnapshotItem("aa", "a", Str("AA"), 1640995203, 1640995204, NodeTypeDirectory, 0, false, false));
+    SnapshotItem fileItem("aaa", "aa", Str("AAA"), 1640995205, 1640995206, NodeTypeFile, 123, false, true, false);
+    fileItem.setContentChecksum("checksum");
+    snapshot.updateItem(fileItem);
+    snapshot.updateItem(SnapshotItem("b", rootId, Str("B"), 1640995207, 1640995208, NodeTypeFile, 456, true));
+    snapshot.updateItem(SnapshotItem("orphan", "unknown", Str("O"), 1640995209, 1640995209, NodeTypeFile, 789));
+
+    SnapshotFile::Metadata metadata;
+    metadata.cursor = "cursor";
+    metadata.consistencyToken = "token";
+    metadata.savedAt = 1640995210;
+    CPPUNIT_ASSERT(snapshot.save(filePath, metadata));
+
+    // Only the items reachable from the root are saved
+    Snapshot loadedSnapshot(ReplicaSide::ReplicaSideLocal, SyncDb::driveRootNode());
+    SnapshotFile::Metadata loadedMetadata;
+    CPPUNIT_ASSERT(loadedSnapshot.load(filePath, loadedMetadata));
+    CPPUNIT_ASSERT(!loadedSnapshot.isValid());
+    CPPUNIT_ASSERT_EQUAL(std::string("cursor"), loadedMetadata.cursor);
+    CPPUNIT_ASSERT_EQUAL(std::string("token"), loadedMetadata.consistencyToken);
+    CPPUNIT_ASSERT_EQUAL(SyncTime(1640995210), loadedMetadata.savedAt);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(5), loadedSnapshot.nbItems());
+    CPPUNIT_ASSERT(!loadedSnapshot.exists("orphan"));
+    CPPUNIT_ASSERT_EQUAL(NodeId("aaa"), loadedSnapshot.itemId(SyncPath("A/AA/AAA")));
+    CPPUNIT_ASSERT_EQUAL(int64_t(123 + 456), loadedSnapshot.size(rootId));
+
+    for (const NodeId &id : {"a", "aa", "aaa", "b"}) {
+        SnapshotItem item;
+        SnapshotItem loadedItem;
+        CPPUNIT_ASSERT(snapshot.getItem(id, item));
+        CPPUNIT_ASSERT(loadedSnapshot.getItem(id, loadedItem));
+        CPPUNIT_ASSERT_EQUAL(item.parentId(), loadedItem.parentId());
+        CPPUNIT_ASSERT(item.name() == loadedItem.name());
+        CPPUNIT_ASSERT_EQUAL(item.createdAt(), loadedItem.createdAt());
+        CPPUNIT_ASSERT_EQUAL(item.lastModified(), loadedItem.lastModified());
+        CPPUNIT_ASSERT_EQUAL(item.type(), loadedItem.type());
+        CPPUNIT_ASSERT_EQUAL(item.size(), loadedItem.size());
+        CPPUNIT_ASSERT_EQUAL(item.isLink(), loadedItem.isLink());
+        CPPUNIT_ASSERT_EQUAL(item.contentChecksum(), loadedItem.contentChecksum());
+        CPPUNIT_ASSERT_EQUAL(item.canWrite(), loadedItem.canWrite());
+        CPPUNIT_ASSERT_EQUAL(item.canShare(), loadedItem.canShare());
+    }
+
+    // A file saved by the other side is rejected
+    Snapshot remoteSnapshot(ReplicaSide::ReplicaSideRemote, SyncDb::driveRootNode());
+    CPPUNIT_ASSERT(!remoteSnapshot.load(filePath, loadedMetadata));
+
+    // So is a corrupted file, the snapshot is left empty
+    {
+        std::fstream file(filePath, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-1, std::ios::end);
+        file.put('#');
+    }
+    CPPUNIT_ASSERT(!loadedSnapshot.load(filePath, loadedMetadata));
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), loadedSnapshot.nbItems());
 }
 
 }  // namespace KDC
@@ -28,6 +28,13 @@ namespace KDC {
 class TestSnapshot : public CppUnit::TestFixture {
         CPPUNIT_TEST_SUITE(TestSnapshot);
         CPPUNIT_TEST(testSnapshot);
+        CPPUNIT_TEST(testSnapshotMemoryUsage);
+        CPPUNIT_TEST(testSnapshotCopy);
+        CPPUNIT_TEST(testSnapshotPathResolution);
+        CPPUNIT_TEST(testSnapshotAggregates);
+        CPPUNIT_TEST(testSnapshotConcurrentAccess);
+        CPPUNIT_TEST(testSnapshotDirtyIds);
+        CPPUNIT_TEST(testSnapshotSaveAndLoad);
         CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -36,6 +43,13 @@ class TestSnapshot : public CppUnit::TestFixture {
 
     protected:
         void testSnapshot();
+        void testSnapshotMemoryUsage();
+        void testSnapshotCopy();
+        void testSnapshotPathResolution();
+        void testSnapshotAggregates();
+        void testSnapshotConcurrentAccess();
+        void testSnapshotDirtyIds();
+        void testSnapshotSaveAndLoad();
 
     private:
         std::shared_ptr<SyncPal> _syncPal = nullptr;